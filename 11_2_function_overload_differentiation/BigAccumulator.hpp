@@ -0,0 +1,177 @@
+/**
+ * @file BigAccumulator.hpp
+ * @author Daniel Even
+ * @brief big_accumulator, an integer sum of unlimited size for when even a
+ * fixed width is a guess: it grows by one 64-bit limb whenever its top limb
+ * carries out.
+ *
+ * The positive and the negative values are summed separately, as two
+ * unsigned magnitudes. Adding a 64-bit magnitude is then one add-with-carry
+ * into the lowest limb, and the carry only travels further up when that limb
+ * wraps, about once every 2^64 / value additions, so the cost does not grow
+ * with the size of the sum. (A single two's complement sum would have to
+ * sign-extend every negative value across all of its limbs.) The two
+ * magnitudes are only subtracted when the result is read.
+ *
+ * Whole arrays go through wide::sum() from WideSum.hpp first, and only the
+ * int128 result is added here.
+ */
+#pragma once
+
+#include "WideInt.hpp"
+#include "WideSum.hpp"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace wide {
+
+class big_accumulator
+{
+public:
+    big_accumulator() = default;
+
+    template <std::integral T>
+    big_accumulator& operator+=(T value)
+    {
+        // Both the magnitude and its target are computed without a branch,
+        // since the signs of a stream of values are rarely predictable, and
+        // the carry past the lowest limb almost never happens.
+        const std::size_t sign = value < 0 ? 1 : 0;
+        const std::uint64_t mask = 0 - std::uint64_t{sign};
+        const std::uint64_t magnitude = (static_cast<std::uint64_t>(value) ^ mask) - mask;
+        std::vector<std::uint64_t>& limbs = magnitudes_[sign];
+        if (add_carry(0, limbs[0], magnitude, limbs[0]) != 0)
+            carry_into(limbs, 1);
+        return *this;
+    }
+
+    template <std::size_t Bits>
+    big_accumulator& operator+=(const wide_int<Bits>& value)
+    {
+        // For min() the negation wraps to itself, which is the right magnitude
+        // when read as unsigned.
+        const wide_int<Bits> magnitude = value.is_negative() ? -value : value;
+        std::uint64_t limbs[wide_int<Bits>::limb_count];
+        for (std::size_t i = 0; i < wide_int<Bits>::limb_count; ++i)
+            limbs[i] = magnitude.limb(i);
+        add_magnitude(magnitudes_[value.is_negative() ? 1 : 0], limbs, wide_int<Bits>::limb_count);
+        return *this;
+    }
+
+    big_accumulator& operator+=(std::span<const std::int32_t> values) { return *this += sum(values); }
+    big_accumulator& operator+=(std::span<const std::int64_t> values) { return *this += sum(values); }
+
+    /**
+     * @brief The number of 64-bit limbs the larger of the two magnitudes uses.
+     */
+    std::size_t limb_count() const { return std::max(magnitudes_[0].size(), magnitudes_[1].size()); }
+
+    /**
+     * @brief The sum as a wide_int.
+     *
+     * @throws std::range_error if it does not fit in Bits bits.
+     */
+    template <std::size_t Bits>
+    wide_int<Bits> value() const
+    {
+        bool negative = false;
+        const std::vector<std::uint64_t> magnitude = difference(negative);
+        constexpr std::size_t count = wide_int<Bits>::limb_count;
+        std::array<std::uint64_t, count> limbs{};
+        // The magnitude may use every bit of the limbs except the sign bit,
+        // and a negative sum may be exactly 2^(Bits - 1).
+        const bool fits = magnitude.size() < count ||
+                          (magnitude.size() == count &&
+                           (magnitude.back() >> 63 == 0 ||
+                            (negative && magnitude.back() == std::uint64_t{1} << 63 &&
+                             std::all_of(magnitude.begin(), magnitude.end() - 1, [](auto limb) { return limb == 0; }))));
+        if (!fits)
+            throw std::range_error("big_accumulator::value(): " + to_string() + " does not fit in " +
+                                   std::to_string(Bits) + " bits");
+        std::copy(magnitude.begin(), magnitude.end(), limbs.begin());
+        const wide_int<Bits> result = wide_int<Bits>::from_limbs(limbs);
+        return negative ? -result : result;
+    }
+
+    /**
+     * @brief The sum in decimal.
+     */
+    std::string to_string() const
+    {
+        bool negative = false;
+        const std::string digits = detail::to_decimal(difference(negative));
+        return negative ? "-" + digits : digits;
+    }
+
+private:
+    static void add_magnitude(std::vector<std::uint64_t>& limbs, const std::uint64_t* value, std::size_t count)
+    {
+        if (limbs.size() < count)
+            limbs.resize(count, 0);
+        unsigned char carry = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            carry = add_carry(carry, limbs[i], value[i], limbs[i]);
+        if (carry != 0)
+            carry_into(limbs, count);
+    }
+
+    /**
+     * @brief Adds a carry into limb 'from', growing the magnitude by one limb
+     * if it travels out of the top.
+     */
+    static void carry_into(std::vector<std::uint64_t>& limbs, std::size_t from)
+    {
+        for (std::size_t i = from; i < limbs.size(); ++i)
+            if (++limbs[i] != 0)
+                return;
+        limbs.push_back(1);
+    }
+
+    /**
+     * @brief |positive - negative|, with the sign of the difference in
+     * 'negative', and no leading zero limbs.
+     */
+    std::vector<std::uint64_t> difference(bool& negative) const
+    {
+        negative = less(magnitudes_[0], magnitudes_[1]);
+        const std::vector<std::uint64_t>& larger = magnitudes_[negative ? 1 : 0];
+        const std::vector<std::uint64_t>& smaller = magnitudes_[negative ? 0 : 1];
+
+        // larger - smaller = larger + ~smaller + 1, over the length of larger.
+        std::vector<std::uint64_t> result(larger.size());
+        unsigned char carry = 1;
+        for (std::size_t i = 0; i < larger.size(); ++i)
+            carry = add_carry(carry, larger[i], ~(i < smaller.size() ? smaller[i] : 0), result[i]);
+        while (!result.empty() && result.back() == 0)
+            result.pop_back();
+        return result;
+    }
+
+    static bool less(const std::vector<std::uint64_t>& a, const std::vector<std::uint64_t>& b)
+    {
+        for (std::size_t i = std::max(a.size(), b.size()); i-- > 0;)
+        {
+            const std::uint64_t x = i < a.size() ? a[i] : 0;
+            const std::uint64_t y = i < b.size() ? b[i] : 0;
+            if (x != y)
+                return x < y;
+        }
+        return false;
+    }
+
+    // The sums of the positive values (index 0) and of the magnitudes of the
+    // negative ones (index 1). Never empty, so that adding an integer can go
+    // straight to limb 0.
+    std::array<std::vector<std::uint64_t>, 2> magnitudes_{std::vector<std::uint64_t>(1, 0),
+                                                          std::vector<std::uint64_t>(1, 0)};
+};
+
+} // namespace wide
@@ -0,0 +1,315 @@
+/**
+ * @file ConcurrentOverloadClass.hpp
+ * @author Daniel Even
+ * @brief OverloadClass's split between the const get_number(), for reading,
+ * and the non-const one, for writing, applied to threads.
+ *
+ * A getter guarded by a mutex makes every reader write to the mutex's cache
+ * line, so 32 threads reading a shared config take turns even though none of
+ * them changes it. Here readers never write to shared memory at all:
+ *
+ * 1) SeqLock<T> keeps a trivially copyable T behind a sequence number. A
+ * reader copies the value and checks that the sequence did not change while
+ * it did; it only retries if a writer published a new value in exactly that
+ * window. Writers take an exclusive lock, change a private copy of the value,
+ * and publish it in one short step, so readers keep seeing the old value for
+ * as long as a writer holds the lock.
+ *
+ * 2) ConcurrentOverloadClass is OverloadClass on top of a SeqLock: the const
+ * get_number() returns a snapshot, and the non-const get_number() returns a
+ * WriteAccess that holds the write lock until it is destroyed.
+ *
+ * 3) For values written more often than they are read, such as statistics,
+ * ShardedCounter gives every thread its own cache line to add to, and a read
+ * adds up all the shards. ShardedOverloadClass is OverloadClass on top of it.
+ *
+ * Everything that is written by one side and read by the other sits on its
+ * own 64-byte cache line, so unrelated objects never share one.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+namespace concurrent {
+
+inline constexpr std::size_t cache_line = 64;
+
+/**
+ * @brief Tells the CPU this is a spin-wait loop.
+ */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief A sequence lock, after Boehm, "Can Seqlocks Get Along With
+ * Programming Language Memory Models?" (MSPC 2012): the value is stored as
+ * relaxed atomic words, so a read that races a write is a retry, not a data
+ * race.
+ */
+template <typename T>
+class alignas(cache_line) SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock: T must be trivially copyable");
+
+public:
+    SeqLock() : SeqLock(T{}) {}
+
+    explicit SeqLock(const T& value) : staged_(value) { publish(); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /**
+     * @brief A consistent copy of the latest published value. Never blocks and
+     * never writes to shared memory.
+     */
+    T load() const
+    {
+        for (;;)
+        {
+            const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+            if ((before & 1) == 0)
+            {
+                std::uint64_t words[word_count];
+                for (std::size_t i = 0; i < word_count; ++i)
+                    words[i] = words_[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence_.load(std::memory_order_relaxed) == before)
+                {
+                    T value;
+                    std::memcpy(&value, words, sizeof(T));
+                    return value;
+                }
+            }
+            cpu_relax();
+        }
+    }
+
+    /**
+     * @brief Takes the write lock. Until unlock(), staged() may be changed and
+     * readers still see the previous value.
+     */
+    void lock()
+    {
+        int spins = 0;
+        while (writer_.exchange(true, std::memory_order_acquire))
+        {
+            while (writer_.load(std::memory_order_relaxed))
+            {
+                if (++spins < 64)
+                    cpu_relax();
+                else
+                    std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * @brief Publishes staged() and releases the write lock.
+     */
+    void unlock()
+    {
+        publish();
+        writer_.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief The writer's copy. Only valid between lock() and unlock().
+     */
+    T& staged() { return staged_; }
+
+    void store(const T& value)
+    {
+        lock();
+        staged_ = value;
+        unlock();
+    }
+
+private:
+    static constexpr std::size_t word_count = (sizeof(T) + 7) / 8;
+
+    void publish()
+    {
+        std::uint64_t words[word_count]{};
+        std::memcpy(words, &staged_, sizeof(T));
+
+        const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < word_count; ++i)
+            words_[i].store(words[i], std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // What readers touch, and writers only while publishing.
+    std::atomic<std::uint64_t> sequence_{0};
+    std::atomic<std::uint64_t> words_[word_count]{};
+
+    // What only writers touch.
+    alignas(cache_line) std::atomic<bool> writer_{false};
+    T staged_;
+};
+
+/**
+ * @brief A counter split into one cache line per thread (up to the number of
+ * shards), so that adding never bounces a line between cores.
+ */
+class ShardedCounter
+{
+public:
+    /**
+     * @param shards Rounded up to a power of two. 0 means one per hardware
+     * thread.
+     */
+    explicit ShardedCounter(std::size_t shards = 0)
+    {
+        if (shards == 0)
+            shards = std::max(1u, std::thread::hardware_concurrency());
+        std::size_t rounded = 1;
+        while (rounded < shards)
+            rounded *= 2;
+        mask_ = rounded - 1;
+        shards_ = std::make_unique<Shard[]>(rounded);
+    }
+
+    void add(std::int64_t delta)
+    {
+        shards_[thread_index() & mask_].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief The sum of all shards. Adds made while it runs may or may not be
+     * included; once the writers stop it is exact.
+     */
+    std::int64_t load() const
+    {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i <= mask_; ++i)
+            sum += shards_[i].value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    std::size_t shards() const { return mask_ + 1; }
+
+private:
+    struct alignas(cache_line) Shard
+    {
+        std::atomic<std::int64_t> value{0};
+    };
+
+    /**
+     * @brief Threads are numbered in the order they first add to any
+     * counter, so the first N threads get N different shards.
+     */
+    static std::size_t thread_index()
+    {
+        static std::atomic<std::size_t> next{0};
+        thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t mask_;
+};
+
+/**
+ * @brief OverloadClass for many threads: the const get_number() is a
+ * snapshot read, the non-const one exclusive write access.
+ */
+class ConcurrentOverloadClass
+{
+public:
+    /**
+     * @brief Holds the write lock for as long as it exists, and publishes the
+     * new number when destroyed. Behaves like an int&.
+     */
+    class WriteAccess
+    {
+    public:
+        explicit WriteAccess(SeqLock<int>& number) : number_(number) { number_.lock(); }
+        ~WriteAccess() { number_.unlock(); }
+
+        WriteAccess(const WriteAccess&) = delete;
+        WriteAccess& operator=(const WriteAccess&) = delete;
+
+        int& operator*() { return number_.staged(); }
+        operator int() const { return number_.staged(); }
+
+        WriteAccess& operator=(int value)
+        {
+            number_.staged() = value;
+            return *this;
+        }
+
+        WriteAccess& operator+=(int delta)
+        {
+            number_.staged() += delta;
+            return *this;
+        }
+
+    private:
+        SeqLock<int>& number_;
+    };
+
+    explicit ConcurrentOverloadClass(int number = 0) : number_(number) {}
+
+    WriteAccess get_number() { return WriteAccess(number_); }
+
+    int get_number() const { return number_.load(); }
+
+private:
+    SeqLock<int> number_;
+};
+
+/**
+ * @brief OverloadClass for write-heavy use: the non-const get_number() can
+ * only be added to, and the const one sums the shards.
+ */
+class ShardedOverloadClass
+{
+public:
+    class AddAccess
+    {
+    public:
+        explicit AddAccess(ShardedCounter& number) : number_(number) {}
+
+        AddAccess& operator+=(std::int64_t delta)
+        {
+            number_.add(delta);
+            return *this;
+        }
+
+        AddAccess& operator++()
+        {
+            number_.add(1);
+            return *this;
+        }
+
+    private:
+        ShardedCounter& number_;
+    };
+
+    explicit ShardedOverloadClass(std::size_t shards = 0) : number_(shards) {}
+
+    AddAccess get_number() { return AddAccess(number_); }
+
+    std::int64_t get_number() const { return number_.load(); }
+
+private:
+    ShardedCounter number_;
+};
+
+} // namespace concurrent
@@ -0,0 +1,399 @@
+/**
+ * @file MultiDispatch.hpp
+ * @author Daniel Even
+ * @brief Overload resolution at runtime, for values whose types are only known
+ * once the program is running (read from a config file, say).
+ *
+ * DynamicValue<Ts...> holds one value of any of the types Ts together with a
+ * small tag saying which. Multimethod<Value, Arity, Functions...> takes an
+ * overload set as a list of function pointers and builds, entirely at compile
+ * time, a flat table with one entry per combination of argument tags. A call
+ * computes the table index from the tags and makes one indirect call, so its
+ * cost does not depend on the number of types or overloads.
+ *
+ * Each entry is resolved with the same ladder main.cpp describes:
+ *
+ * 1) exact match, 2) promotion, 3) conversion, 4) user-defined conversion and
+ * 5) ellipsis are ranked per argument, and an overload is chosen if it is at
+ * least as good as every other viable overload for every argument and better
+ * for at least one.
+ *
+ * 6) Combinations with no viable overload, or no single best one, get an
+ * entry that throws std::invalid_argument, where the compiler would have
+ * given an error.
+ *
+ * This covers arithmetic types and classes with converting constructors or
+ * conversion operators. Finer tie-breakers that only matter for references,
+ * pointers and inheritance are not modelled. main.cpp checks with
+ * static_assert that every entry picks the same overload the compiler does.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief The steps of the overload resolution ladder, best first.
+ */
+enum class MatchRank : std::uint8_t
+{
+    exact,
+    promotion,
+    conversion,
+    user_defined,
+    ellipsis,
+    none,
+};
+
+/**
+ * @brief How an argument of type From would be passed to a parameter of type
+ * To.
+ */
+template <typename From, typename To>
+consteval MatchRank match_rank()
+{
+    using F = std::remove_cvref_t<From>;
+    using T = std::remove_cvref_t<To>;
+
+    if constexpr (std::is_same_v<F, T>)
+        return MatchRank::exact;
+    else if constexpr (std::is_arithmetic_v<F> && std::is_arithmetic_v<T>)
+    {
+        // Integral promotion takes anything narrower than int to int (which is
+        // exactly what unary + does); float to double is the only floating
+        // point promotion.
+        if constexpr (std::is_integral_v<F> && std::is_same_v<T, decltype(+std::declval<F>())>)
+            return MatchRank::promotion;
+        else if constexpr (std::is_same_v<F, float> && std::is_same_v<T, double>)
+            return MatchRank::promotion;
+        else
+            return MatchRank::conversion;
+    }
+    else if constexpr ((std::is_class_v<F> || std::is_class_v<T>) && std::is_convertible_v<F, T>)
+        return MatchRank::user_defined;
+    else
+        return MatchRank::none;
+}
+
+template <typename Value, std::size_t Arity, auto... Functions>
+class Multimethod;
+
+/**
+ * @brief One value of any of the types Ts. Construction only accepts exactly
+ * one of those types, so the tag always reflects the type the caller had.
+ */
+template <typename... Ts>
+class DynamicValue
+{
+public:
+    static_assert(sizeof...(Ts) > 0 && sizeof...(Ts) <= 255, "DynamicValue: 1 to 255 types");
+    static_assert((std::is_trivially_copyable_v<Ts> && ...),
+                  "DynamicValue: the types must be trivially copyable");
+
+    using Types = std::tuple<Ts...>;
+    static constexpr std::size_t type_count = sizeof...(Ts);
+
+    /**
+     * @brief The tag of T, i.e. its index in Ts.
+     */
+    template <typename T>
+    static constexpr std::size_t tag_of()
+    {
+        constexpr std::array<bool, type_count> matches{std::is_same_v<T, Ts>...};
+        for (std::size_t i = 0; i < type_count; ++i)
+            if (matches[i])
+                return i;
+        return type_count;
+    }
+
+    template <typename T>
+        requires(tag_of<T>() < type_count)
+    DynamicValue(T value) : tag_(static_cast<std::uint8_t>(tag_of<T>()))
+    {
+        std::memcpy(storage_, &value, sizeof(T));
+    }
+
+    std::size_t tag() const { return tag_; }
+
+    template <typename T>
+    bool holds() const
+    {
+        return tag_ == tag_of<T>();
+    }
+
+    /**
+     * @brief The value as a T, the type the value was created with.
+     *
+     * @throws std::invalid_argument if it was created with another type.
+     */
+    template <typename T>
+        requires(tag_of<T>() < type_count)
+    T get() const
+    {
+        if (!holds<T>())
+            throw std::invalid_argument("DynamicValue::get(): the value holds type " + std::to_string(tag_) +
+                                        ", not type " + std::to_string(tag_of<T>()));
+        return load<T>();
+    }
+
+private:
+    // Multimethod picks its table entry by the tags, so it reads the values
+    // without checking them again.
+    template <typename Value, std::size_t Arity, auto... Functions>
+    friend class Multimethod;
+
+    template <typename T>
+    T load() const
+    {
+        T value;
+        std::memcpy(&value, storage_, sizeof(T));
+        return value;
+    }
+
+    std::uint8_t tag_;
+    alignas(Ts...) unsigned char storage_[std::max({sizeof(Ts)...})];
+};
+
+namespace multi_dispatch_detail {
+
+template <typename F>
+struct Signature;
+
+template <typename R, typename... Ps>
+struct Signature<R (*)(Ps...)>
+{
+    using Result = R;
+    using Parameters = std::tuple<Ps...>;
+    static constexpr bool variadic = false;
+};
+
+template <typename R, typename... Ps>
+struct Signature<R (*)(Ps..., ...)>
+{
+    using Result = R;
+    using Parameters = std::tuple<Ps...>;
+    static constexpr bool variadic = true;
+};
+
+inline constexpr int no_match = -1;
+inline constexpr int ambiguous = -2;
+
+/**
+ * @brief The rank of every argument for one candidate. 'viable' is false if
+ * the candidate cannot be called with these arguments at all.
+ */
+template <std::size_t Arity>
+struct CandidateRanks
+{
+    bool viable = false;
+    std::array<MatchRank, Arity> ranks{};
+};
+
+/**
+ * @brief The rank of argument K. Arguments past the last parameter can only be
+ * matched by an ellipsis.
+ */
+template <std::size_t K, typename Args, typename Params>
+consteval MatchRank argument_rank()
+{
+    if constexpr (K < std::tuple_size_v<Params>)
+        return match_rank<std::tuple_element_t<K, Args>, std::tuple_element_t<K, Params>>();
+    else
+        return MatchRank::ellipsis;
+}
+
+template <auto Function, typename Args>
+consteval auto rank_candidate()
+{
+    using Sig = Signature<decltype(Function)>;
+    using Params = typename Sig::Parameters;
+    constexpr std::size_t arity = std::tuple_size_v<Args>;
+    constexpr std::size_t fixed = std::tuple_size_v<Params>;
+
+    CandidateRanks<arity> result;
+    if constexpr (arity < fixed || (arity > fixed && !Sig::variadic))
+        return result;
+    else
+    {
+        result.ranks = []<std::size_t... K>(std::index_sequence<K...>) {
+            return std::array<MatchRank, arity>{argument_rank<K, Args, Params>()...};
+        }(std::make_index_sequence<arity>{});
+
+        result.viable = true;
+        for (MatchRank rank : result.ranks)
+            result.viable &= rank != MatchRank::none;
+        return result;
+    }
+}
+
+/**
+ * @brief True if a is at least as good as b for every argument and better for
+ * at least one.
+ */
+template <std::size_t Arity>
+constexpr bool better(const CandidateRanks<Arity>& a, const CandidateRanks<Arity>& b)
+{
+    bool strictly = false;
+    for (std::size_t k = 0; k < Arity; ++k)
+    {
+        if (a.ranks[k] > b.ranks[k])
+            return false;
+        strictly |= a.ranks[k] < b.ranks[k];
+    }
+    return strictly;
+}
+
+/**
+ * @brief The index of the best candidate in Functions for arguments of the
+ * types in Args, or no_match / ambiguous.
+ */
+template <typename Args, auto... Functions>
+consteval int select_overload()
+{
+    constexpr std::size_t arity = std::tuple_size_v<Args>;
+    constexpr std::array<CandidateRanks<arity>, sizeof...(Functions)> candidates{
+        rank_candidate<Functions, Args>()...};
+
+    bool any_viable = false;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (!candidates[i].viable)
+            continue;
+        any_viable = true;
+
+        bool best = true;
+        for (std::size_t j = 0; j < candidates.size(); ++j)
+            best &= j == i || !candidates[j].viable || better(candidates[i], candidates[j]);
+        if (best)
+            return static_cast<int>(i);
+    }
+    return any_viable ? ambiguous : no_match;
+}
+
+} // namespace multi_dispatch_detail
+
+/**
+ * @brief The dispatch table for an overload set. Every function's return type
+ * must be one of Ts, and the result comes back as a DynamicValue.
+ */
+template <typename... Ts, std::size_t Arity, auto... Functions>
+class Multimethod<DynamicValue<Ts...>, Arity, Functions...>
+{
+public:
+    using Value = DynamicValue<Ts...>;
+
+    static constexpr std::size_t type_count = sizeof...(Ts);
+    static constexpr std::size_t table_size = [] {
+        std::size_t size = 1;
+        for (std::size_t k = 0; k < Arity; ++k)
+            size *= type_count;
+        return size;
+    }();
+
+    static_assert(sizeof...(Functions) > 0, "Multimethod: the overload set is empty");
+    static_assert(table_size <= 65536, "Multimethod: the table would be too large");
+
+    /**
+     * @brief Calls whichever overload the compiler would have picked for the
+     * arguments' runtime types.
+     *
+     * @throws std::invalid_argument if the compiler would have rejected the
+     * call as having no matching or an ambiguous overload.
+     */
+    template <typename... Args>
+        requires(sizeof...(Args) == Arity && (std::is_same_v<Args, Value> && ...))
+    static Value call(const Args&... args)
+    {
+        std::size_t index = 0;
+        ((index = index * type_count + args.tag()), ...);
+        const std::array<const Value*, Arity> pointers{&args...};
+        return table_[index](pointers.data());
+    }
+
+    /**
+     * @brief The index into Functions chosen for these argument tags, or a
+     * negative number if there is none (-1) or it is ambiguous (-2).
+     */
+    static constexpr int selected(const std::array<std::size_t, Arity>& tags)
+    {
+        std::size_t index = 0;
+        for (std::size_t tag : tags)
+            index = index * type_count + tag;
+        return selections_[index];
+    }
+
+private:
+    using Entry = Value (*)(const Value* const* args);
+
+    template <std::size_t Index>
+    struct Combination
+    {
+        template <std::size_t K>
+        static constexpr std::size_t tag()
+        {
+            std::size_t divisor = 1;
+            for (std::size_t k = K + 1; k < Arity; ++k)
+                divisor *= type_count;
+            return Index / divisor % type_count;
+        }
+
+        using Args = decltype([]<std::size_t... K>(std::index_sequence<K...>) {
+            return std::tuple<std::tuple_element_t<tag<K>(), std::tuple<Ts...>>...>{};
+        }(std::make_index_sequence<Arity>{}));
+
+        static constexpr int selection = multi_dispatch_detail::select_overload<Args, Functions...>();
+    };
+
+    template <std::size_t Index>
+    static Value entry(const Value* const* args)
+    {
+        using C = Combination<Index>;
+        constexpr int selection = C::selection;
+
+        if constexpr (selection == multi_dispatch_detail::no_match)
+            throw std::invalid_argument("Multimethod: no overload matches these argument types");
+        else if constexpr (selection == multi_dispatch_detail::ambiguous)
+            throw std::invalid_argument("Multimethod: the call is ambiguous for these argument types");
+        else
+        {
+            using Function = std::tuple_element_t<selection, std::tuple<decltype(Functions)...>>;
+            static constexpr Function function = std::get<selection>(std::tuple{Functions...});
+            using Sig = multi_dispatch_detail::Signature<Function>;
+            using Params = typename Sig::Parameters;
+            using Result = typename Sig::Result;
+            static_assert(Value::template tag_of<Result>() < type_count,
+                          "Multimethod: every return type must be one of the DynamicValue types");
+
+            return [&]<std::size_t... K>(std::index_sequence<K...>) {
+                auto argument = [&]<std::size_t J>() {
+                    using Arg = std::tuple_element_t<J, typename C::Args>;
+                    const Arg value = args[J]->template load<Arg>();
+                    // Parameters get the implicit conversion the ranking
+                    // allowed; arguments matched by an ellipsis go through
+                    // as they are and get the usual default promotions.
+                    if constexpr (J < std::tuple_size_v<Params>)
+                        return static_cast<std::tuple_element_t<J, Params>>(value);
+                    else
+                        return value;
+                };
+                return Value(static_cast<Result>(function(argument.template operator()<K>()...)));
+            }(std::make_index_sequence<Arity>{});
+        }
+    }
+
+    static constexpr std::array<Entry, table_size> table_ = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<Entry, table_size>{&entry<I>...};
+    }(std::make_index_sequence<table_size>{});
+
+    static constexpr std::array<int, table_size> selections_ = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<int, table_size>{Combination<I>::selection...};
+    }(std::make_index_sequence<table_size>{});
+};
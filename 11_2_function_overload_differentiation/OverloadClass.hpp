@@ -5,7 +5,8 @@
  * the C++ language with regards to member functions. 
  */
 
- #include <iostream>
+ #include "OutputSink.hpp"
+ #include "Trace.hpp"
 
  /**
   * @brief This is a sample class used solely to demonstrate how one can
@@ -22,12 +23,14 @@ private:
     int num1 = 0;
 public:
     int get_number(void) {
-        std::cout << "The non-const version of this function has been called from OverloadClass!" << std::endl;
+        TRACE_SCOPE("OverloadClass::get_number()");
+        io::out() << "The non-const version of this function has been called from OverloadClass!" << io::endl;
         return OverloadClass::num1;
     }
     
     int get_number(void) const {
-        std::cout << "The const version of this function has been called from OverloadClass!" << std::endl;
+        TRACE_SCOPE("OverloadClass::get_number() const");
+        io::out() << "The const version of this function has been called from OverloadClass!" << io::endl;
         return OverloadClass::num1;
     }
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+/**
+ * @file VariadicAdd.hpp
+ * @author Daniel Even
+ * @brief A type-safe, compile-time replacement for the C-style ellipsis add
+ * demonstrated in main.cpp. The ellipsis version walks a va_list one argument
+ * at a time, trusts the caller to pass a correct count, and can only ever
+ * assume that every argument is an int. A variadic function template instead
+ * knows the number and type of every argument at compile time, so the sum can
+ * be written as a fold expression that the compiler fully unrolls.
+ *
+ * Topics:
+ *
+ * Parameter Packs: 'typename... Ts' declares a template parameter pack and
+ * 'Ts... values' declares a function parameter pack. 'sizeof...(Ts)' yields the
+ * number of elements in the pack as a compile-time constant.
+ *
+ * Fold Expressions: Since C++17, '(pack op ...)' expands a pack over a binary
+ * operator. No loop or branch is generated; the expansion is a straight line
+ * of additions.
+ *
+ * @note This is deliberately NOT named 'add'. An unconstrained function
+ * template is an exact match for every argument list, so it would outrank the
+ * ellipsis overload (step 5 of overload resolution) as well as the add(int,
+ * int) overload for calls such as add('c', 'd') which otherwise resolve by
+ * promotion (step 2). Giving it its own name keeps every call in main.cpp
+ * resolving exactly as it did before.
+ */
+#pragma once
+
+#include "WideInt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdarg>
+#include <cstddef>
+#include <type_traits>
+
+// GCC and Clang's built-in 128-bit integer. __extension__ keeps -Wpedantic
+// quiet about it.
+__extension__ typedef __int128 variadic_int128;
+
+/**
+ * @brief Selects the accumulator type for add_all() at compile time. Any
+ * floating point argument forces a double (or long double if one was passed).
+ * Integer sums are exact, rather than overflowing the way the int-returning
+ * ellipsis version does:
+ *
+ * - If every argument is narrower than long long, the sum is carried in long
+ *   long, or unsigned long long if every argument is unsigned. No pack is
+ *   long enough to overflow it.
+ *
+ * - Otherwise a 64-bit argument could overflow long long on its own (or not
+ *   fit in it at all, for a uint64_t), so the sum is carried in the built-in
+ *   __int128, which holds any mix of signed and unsigned 64-bit values.
+ *   add_all(1, UINT64_MAX) is 2^64, not 0.
+ */
+template <typename... Ts>
+struct variadic_accumulator
+{
+    using type = std::conditional_t<
+        (std::is_same_v<Ts, long double> || ...), long double,
+        std::conditional_t<
+            (std::is_floating_point_v<Ts> || ...), double,
+            std::conditional_t<
+                ((sizeof(Ts) >= sizeof(long long)) || ...), variadic_int128,
+                std::conditional_t<(std::is_unsigned_v<Ts> && ...),
+                                   unsigned long long, long long>>>>;
+};
+
+template <typename T>
+inline constexpr std::size_t wide_bits_v = 0;
+
+template <std::size_t Bits>
+inline constexpr std::size_t wide_bits_v<wide::wide_int<Bits>> = Bits;
+
+/**
+ * @brief A wide_int argument (see WideInt.hpp) asks for a sum that long long
+ * cannot hold, so the sum is carried in the widest wide_int passed.
+ */
+template <typename... Ts>
+    requires (wide::is_wide_int_v<Ts> || ...)
+struct variadic_accumulator<Ts...>
+{
+    static_assert(!(std::is_floating_point_v<Ts> || ...),
+                  "add_all(): wide integers cannot be added to floating point values");
+    using type = wide::wide_int<std::max({wide_bits_v<Ts>...})>;
+};
+
+template <typename... Ts>
+using variadic_accumulator_t = typename variadic_accumulator<Ts...>::type;
+
+/**
+ * @brief Sums values[Lo, Hi) as a balanced binary tree. Floating point addition
+ * is not associative, so the compiler is not allowed to reorder a left-to-right
+ * chain of additions. Spelling out a pairwise order instead gives independent
+ * additions at every level that can be issued in parallel or packed into SIMD
+ * registers, and it also bounds the rounding error to O(log n).
+ */
+template <std::size_t Lo, std::size_t Hi, typename Acc, std::size_t N>
+constexpr Acc pairwise_sum(const std::array<Acc, N>& values) noexcept
+{
+    static_assert(Lo < Hi && Hi <= N, "pairwise_sum(): invalid range");
+
+    if constexpr (Hi - Lo == 1)
+        return values[Lo];
+    else
+        return pairwise_sum<Lo, Lo + (Hi - Lo) / 2>(values) +
+               pairwise_sum<Lo + (Hi - Lo) / 2, Hi>(values);
+}
+
+/**
+ * @brief The variadic template version of add. Every argument must be an
+ * arithmetic type or a wide_int; anything else is rejected at compile time
+ * instead of being silently misread by va_arg.
+ *
+ * @note Integer sums are exact in any order so a plain fold is used and the
+ * optimizer is free to reassociate it. Floating point sums use pairwise_sum()
+ * so the result does not depend on what the optimizer decides to do.
+ */
+template <typename... Ts>
+    requires (sizeof...(Ts) > 0) && ((std::is_arithmetic_v<Ts> || wide::is_wide_int_v<Ts>) && ...)
+constexpr variadic_accumulator_t<Ts...> add_all(Ts... values) noexcept
+{
+    using Acc = variadic_accumulator_t<Ts...>;
+
+    if constexpr (std::is_floating_point_v<Acc>)
+    {
+        const std::array<Acc, sizeof...(Ts)> widened{static_cast<Acc>(values)...};
+        return pairwise_sum<0, sizeof...(Ts)>(widened);
+    }
+    else
+    {
+        return (static_cast<Acc>(values) + ...);
+    }
+}
+
+/**
+ * @brief The ellipsis add from main.cpp without the logging, kept as a baseline
+ * to compare add_all() against.
+ */
+inline int add_va(int count, ...)
+{
+    std::va_list list;
+    va_start(list, count);
+    int sum = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        sum += va_arg(list, int);
+    }
+
+    va_end(list);
+
+    return sum;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file WideInt.hpp
+ * @author Daniel Even
+ * @brief wide_int<Bits>, a fixed-width signed integer of 128, 256 or more
+ * bits, for sums that would overflow the int the add overloads in main.cpp
+ * return. Adding 2^63 values of type int64_t needs at most 127 bits, so a
+ * wide::int128 accumulator does not overflow for any array that fits in
+ * memory, and wide::int256 covers sums of int128 values the same way.
+ *
+ * The value is stored as Bits / 64 limbs of 64 bits, least significant first,
+ * in two's complement. Addition runs one add-with-carry per limb
+ * (_addcarry_u64 on x86-64, which compiles to an ADD followed by ADCs), so
+ * adding two int128 values costs the same two instructions as __int128.
+ * Like the unsigned types, the arithmetic wraps modulo 2^Bits.
+ *
+ * Overload resolution: every integer type converts implicitly to wide_int,
+ * and add() is declared as a hidden friend, so it is found by
+ * argument-dependent lookup only when one of the arguments already is a
+ * wide_int. add(1, 2) therefore still resolves to add(int, int) from
+ * OverloadSet.hpp at the cost it always had (step 1, an exact match), while
+ * add(wide::int128{INT_MAX}, 1) cannot use add(int, int), since wide_int does
+ * not convert back to int, and picks the 128 bit overload through the
+ * user-defined conversion of the 1 (step 4). The wide argument has to be the
+ * first one, though: in add(1, wide::int128{2}), add(int, ...) matches the 1
+ * exactly and the wide overload matches the second argument better, so the
+ * call is ambiguous.
+ */
+#pragma once
+
+#include <array>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace wide {
+
+/**
+ * @brief out = a + b + carry. Returns the carry out of the top bit.
+ */
+constexpr unsigned char add_carry(unsigned char carry, std::uint64_t a, std::uint64_t b, std::uint64_t& out)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    if (!std::is_constant_evaluated())
+    {
+        unsigned long long result;
+        carry = _addcarry_u64(carry, a, b, &result);
+        out = result;
+        return carry;
+    }
+#endif
+    const std::uint64_t sum = a + b;
+    const std::uint64_t total = sum + carry;
+    out = total;
+    return static_cast<unsigned char>((sum < a) | (total < sum));
+}
+
+namespace detail {
+
+/**
+ * @brief Calls f(std::integral_constant<std::size_t, I>{}) for every I in
+ * [0, N), so that the limb loops are straight-line code at any -O level and
+ * one carry flag can flow through them.
+ */
+template <std::size_t N, typename F>
+constexpr void for_each_limb(F&& f)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (f(std::integral_constant<std::size_t, I>{}), ...);
+    }(std::make_index_sequence<N>{});
+}
+
+/**
+ * @brief The decimal digits of an unsigned integer stored as 64-bit limbs,
+ * least significant first.
+ */
+inline std::string to_decimal(std::vector<std::uint64_t> limbs)
+{
+    // Divide by 10^9 one 32-bit half limb at a time, so that every partial
+    // dividend fits in 64 bits.
+    constexpr std::uint64_t chunk = 1000000000;
+    std::vector<std::uint32_t> chunks;
+    while (!limbs.empty() && limbs.back() == 0)
+        limbs.pop_back();
+    while (!limbs.empty())
+    {
+        std::uint64_t remainder = 0;
+        for (std::size_t i = limbs.size(); i-- > 0;)
+        {
+            const std::uint64_t high = (remainder << 32) | (limbs[i] >> 32);
+            const std::uint64_t low = ((high % chunk) << 32) | (limbs[i] & 0xffffffffu);
+            limbs[i] = ((high / chunk) << 32) | (low / chunk);
+            remainder = low % chunk;
+        }
+        chunks.push_back(static_cast<std::uint32_t>(remainder));
+        while (!limbs.empty() && limbs.back() == 0)
+            limbs.pop_back();
+    }
+
+    if (chunks.empty())
+        return "0";
+    std::string text = std::to_string(chunks.back());
+    for (std::size_t i = chunks.size() - 1; i-- > 0;)
+    {
+        const std::string digits = std::to_string(chunks[i]);
+        text.append(9 - digits.size(), '0');
+        text += digits;
+    }
+    return text;
+}
+
+} // namespace detail
+
+/**
+ * @brief A signed two's complement integer of Bits bits.
+ */
+template <std::size_t Bits>
+class wide_int
+{
+public:
+    static_assert(Bits >= 128 && Bits % 64 == 0, "wide_int: Bits must be a multiple of 64 and at least 128");
+
+    static constexpr std::size_t bits = Bits;
+    static constexpr std::size_t limb_count = Bits / 64;
+
+    constexpr wide_int() = default;
+
+    /**
+     * @brief Sign-extends (or zero-extends) any integer. Implicit, since it
+     * never loses information, like the conversion from int to long long.
+     */
+    template <std::integral T>
+    constexpr wide_int(T value)
+    {
+        limbs_[0] = static_cast<std::uint64_t>(value);
+        const std::uint64_t extension = (std::is_signed_v<T> && value < 0) ? ~std::uint64_t{0} : 0;
+        for (std::size_t i = 1; i < limb_count; ++i)
+            limbs_[i] = extension;
+    }
+
+    /**
+     * @brief Sign-extends a narrower wide_int.
+     */
+    template <std::size_t OtherBits>
+        requires (OtherBits < Bits)
+    constexpr wide_int(const wide_int<OtherBits>& other)
+    {
+        for (std::size_t i = 0; i < other.limb_count; ++i)
+            limbs_[i] = other.limb(i);
+        const std::uint64_t extension = other.is_negative() ? ~std::uint64_t{0} : 0;
+        for (std::size_t i = other.limb_count; i < limb_count; ++i)
+            limbs_[i] = extension;
+    }
+
+    static constexpr wide_int from_limbs(const std::array<std::uint64_t, limb_count>& limbs)
+    {
+        wide_int result;
+        result.limbs_ = limbs;
+        return result;
+    }
+
+    static constexpr wide_int max()
+    {
+        wide_int result;
+        for (auto& limb : result.limbs_)
+            limb = ~std::uint64_t{0};
+        result.limbs_[limb_count - 1] >>= 1;
+        return result;
+    }
+
+    static constexpr wide_int min() { return -max() - 1; }
+
+    /**
+     * @brief Limb i, where limb 0 holds the least significant 64 bits.
+     */
+    constexpr std::uint64_t limb(std::size_t i) const { return limbs_[i]; }
+
+    constexpr bool is_negative() const { return (limbs_[limb_count - 1] >> 63) != 0; }
+
+    constexpr wide_int& operator+=(const wide_int& other)
+    {
+#if defined(__SIZEOF_INT128__)
+        // GCC does not keep the carry flag of _addcarry_u64 alive across the
+        // sign extension of an integer operand, and saves it with SETC
+        // instead. For two limbs the compiler's own 128-bit type gives the
+        // plain ADD, ADC pair.
+        if constexpr (limb_count == 2)
+        {
+            if (!std::is_constant_evaluated())
+            {
+                __extension__ using native = unsigned __int128;
+                const native sum = ((native{limbs_[1]} << 64) | limbs_[0]) +
+                                   ((native{other.limbs_[1]} << 64) | other.limbs_[0]);
+                limbs_[0] = static_cast<std::uint64_t>(sum);
+                limbs_[1] = static_cast<std::uint64_t>(sum >> 64);
+                return *this;
+            }
+        }
+#endif
+        unsigned char carry = 0;
+        detail::for_each_limb<limb_count>(
+            [&](auto i) { carry = add_carry(carry, limbs_[i], other.limbs_[i], limbs_[i]); });
+        return *this;
+    }
+
+    constexpr wide_int& operator-=(const wide_int& other)
+    {
+        // a - b = a + ~b + 1
+        unsigned char carry = 1;
+        detail::for_each_limb<limb_count>(
+            [&](auto i) { carry = add_carry(carry, limbs_[i], ~other.limbs_[i], limbs_[i]); });
+        return *this;
+    }
+
+    constexpr wide_int operator-() const { return wide_int{} - *this; }
+
+    friend constexpr wide_int operator+(wide_int a, const wide_int& b) { return a += b; }
+    friend constexpr wide_int operator-(wide_int a, const wide_int& b) { return a -= b; }
+
+    /**
+     * @brief The add overloads for wide integers. See the note at the top for
+     * how they take part in overload resolution.
+     */
+    friend constexpr wide_int add(const wide_int& num1, const wide_int& num2) { return num1 + num2; }
+
+    friend constexpr wide_int add(const wide_int& num1, const wide_int& num2, const wide_int& num3)
+    {
+        return num1 + num2 + num3;
+    }
+
+    friend constexpr bool operator==(const wide_int&, const wide_int&) = default;
+
+    friend constexpr std::strong_ordering operator<=>(const wide_int& a, const wide_int& b)
+    {
+        const auto top_a = static_cast<std::int64_t>(a.limbs_[limb_count - 1]);
+        const auto top_b = static_cast<std::int64_t>(b.limbs_[limb_count - 1]);
+        if (top_a != top_b)
+            return top_a <=> top_b;
+        for (std::size_t i = limb_count - 1; i-- > 0;)
+            if (a.limbs_[i] != b.limbs_[i])
+                return a.limbs_[i] <=> b.limbs_[i];
+        return std::strong_ordering::equal;
+    }
+
+    /**
+     * @brief The value as a T.
+     *
+     * @throws std::range_error if it does not fit.
+     */
+    template <std::integral T>
+    constexpr T narrow() const
+    {
+        if (*this < wide_int(std::numeric_limits<T>::min()) || *this > wide_int(std::numeric_limits<T>::max()))
+            throw std::range_error("wide_int::narrow(): " + to_string() + " does not fit");
+        return static_cast<T>(limbs_[0]);
+    }
+
+    /**
+     * @brief The value in decimal.
+     */
+    std::string to_string() const
+    {
+        // The magnitude of min() is 2^(Bits - 1), which the negation below
+        // leaves as it is, and which is right when read as unsigned.
+        const wide_int magnitude = is_negative() ? -*this : *this;
+        const std::string digits = detail::to_decimal({magnitude.limbs_.begin(), magnitude.limbs_.end()});
+        return is_negative() ? "-" + digits : digits;
+    }
+
+private:
+    std::array<std::uint64_t, limb_count> limbs_{};
+};
+
+using int128 = wide_int<128>;
+using int256 = wide_int<256>;
+
+template <typename T>
+struct is_wide_int : std::false_type
+{
+};
+
+template <std::size_t Bits>
+struct is_wide_int<wide_int<Bits>> : std::true_type
+{
+};
+
+template <typename T>
+inline constexpr bool is_wide_int_v = is_wide_int<T>::value;
+
+} // namespace wide
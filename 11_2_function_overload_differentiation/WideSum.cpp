@@ -0,0 +1,105 @@
+/**
+ * @file WideSum.cpp
+ * @author Daniel Even
+ * @brief The scalar kernels, the CPUID based kernel selection, and the split
+ * of long int32_t arrays into pieces no kernel can overflow on.
+ */
+#include "WideSum.hpp"
+#define WIDE_SUM_ISA scalar
+#include "WideSumKernels.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+/**
+ * @brief One add-with-carry chain through a wide::int128.
+ */
+WideLaneSum scalar_sum_i64(const std::int64_t* data, std::size_t count)
+{
+    wide::int128 sum;
+    for (std::size_t i = 0; i < count; ++i)
+        sum += data[i];
+    return WideLaneSum{sum.limb(0), sum.limb(1)};
+}
+
+/**
+ * @brief Fewer than 2^32 int32_t values cannot overflow an int64_t.
+ */
+WideLaneSum scalar_sum_i32(const std::int32_t* data, std::size_t count)
+{
+    std::int64_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        sum += data[i];
+    WideLaneSum total{0, 0};
+    detail::accumulate(total, sum);
+    return total;
+}
+
+const WideSumKernels& kernels_for(cpu::Isa isa)
+{
+    if (!cpu::supported(isa))
+        return scalar_wide_sum_kernels();
+
+    switch (isa)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case cpu::Isa::avx512:
+        return avx512_wide_sum_kernels();
+    case cpu::Isa::avx2:
+        return avx2_wide_sum_kernels();
+#endif
+    default:
+        return scalar_wide_sum_kernels();
+    }
+}
+
+wide::int128 to_int128(const WideLaneSum& sum)
+{
+    return wide::int128::from_limbs({sum.low, sum.high});
+}
+
+} // namespace
+
+const WideSumKernels& scalar_wide_sum_kernels()
+{
+    static constexpr WideSumKernels kernels{scalar_sum_i32, scalar_sum_i64};
+    return kernels;
+}
+
+cpu::Isa wide_sum_isa()
+{
+    return cpu::selected<cpu::Isa::avx512, cpu::Isa::avx2>();
+}
+
+namespace wide {
+
+int128 sum(std::span<const std::int32_t> values, cpu::Isa isa)
+{
+    // The kernels sum int32_t values in 64-bit lanes, which are only safe
+    // from overflow for fewer than 2^32 values.
+    constexpr std::size_t piece = std::size_t{1} << 31;
+    const WideSumKernel<std::int32_t> kernel = kernels_for(isa).sum_i32;
+    int128 total;
+    for (std::size_t i = 0; i < values.size(); i += piece)
+        total += to_int128(kernel(values.data() + i, std::min(piece, values.size() - i)));
+    return total;
+}
+
+int128 sum(std::span<const std::int64_t> values, cpu::Isa isa)
+{
+    return to_int128(kernels_for(isa).sum_i64(values.data(), values.size()));
+}
+
+int128 sum(std::span<const std::int32_t> values)
+{
+    return sum(values, wide_sum_isa());
+}
+
+int128 sum(std::span<const std::int64_t> values)
+{
+    return sum(values, wide_sum_isa());
+}
+
+} // namespace wide
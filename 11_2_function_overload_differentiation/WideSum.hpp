@@ -0,0 +1,48 @@
+/**
+ * @file WideSum.hpp
+ * @author Daniel Even
+ * @brief Exact sums of whole arrays of int32_t and int64_t, as a wide::int128
+ * that cannot overflow. The span overloads of add in 11_6_function_templates
+ * wrap instead; these are for counters that must not.
+ *
+ * Adding into one int128 is a chain of dependent ADD/ADC pairs, one element
+ * at a time. The SIMD kernels instead keep 16 independent carry-save lanes:
+ * each lane holds the low 64 bits of its partial sum and, separately, a count
+ * of the carries out of them (plus -1 for every negative element, which is how
+ * an int64_t is sign-extended to 128 bits). A carry is detected by the sum
+ * becoming smaller than the value just added, so each element costs an add,
+ * an unsigned compare and two adds of the resulting masks, with no carry
+ * flag to serialize on. The lanes are only combined into one int128 at the
+ * end. int32_t elements are widened to int64_t lanes instead, which cannot
+ * carry for 2^32 elements per lane.
+ *
+ * The kernels are built for AVX2 and AVX-512 and picked once at runtime by
+ * CPUID, like the span reductions of 11_6_function_templates. The scalar
+ * kernel adds into a wide::int128 with add-with-carry.
+ */
+#pragma once
+
+#include "CpuDispatch.hpp"
+#include "WideInt.hpp"
+
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief The instruction set selected at startup for wide::sum(): AVX-512 or
+ * AVX2 if the CPU supports one, scalar otherwise.
+ */
+cpu::Isa wide_sum_isa();
+
+namespace wide {
+
+int128 sum(std::span<const std::int32_t> values);
+int128 sum(std::span<const std::int64_t> values);
+
+// These overloads force a specific instruction set, which is how the SIMD
+// kernels are checked against the scalar path. An unsupported ISA falls back to
+// the scalar kernel.
+int128 sum(std::span<const std::int32_t> values, cpu::Isa isa);
+int128 sum(std::span<const std::int64_t> values, cpu::Isa isa);
+
+} // namespace wide
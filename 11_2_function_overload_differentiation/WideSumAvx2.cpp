@@ -0,0 +1,52 @@
+/**
+ * @file WideSumAvx2.cpp
+ * @author Daniel Even
+ * @brief AVX2 carry-save kernels. This file is compiled with -mavx2 and must
+ * only be called after cpu::supported(cpu::Isa::avx2) has returned true.
+ * AVX2 only compares 64-bit lanes as signed, so the unsigned compare flips the
+ * sign bit of both operands first.
+ */
+#define WIDE_SUM_ISA avx2
+#include "WideSumKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+template <typename T>
+struct Avx2Lanes
+{
+    using value_type = T;
+    using reg = __m256i;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const value_type* p)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        else
+            return _mm256_loadu_si256(reinterpret_cast<const reg*>(p));
+    }
+
+    static void store(std::uint64_t* p, reg v) { _mm256_storeu_si256(reinterpret_cast<reg*>(p), v); }
+    static reg zero() { return _mm256_setzero_si256(); }
+    static reg add(reg a, reg b) { return _mm256_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi64(a, b); }
+
+    static reg less_unsigned(reg a, reg b)
+    {
+        const reg sign = _mm256_set1_epi64x(INT64_MIN);
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(b, sign), _mm256_xor_si256(a, sign));
+    }
+
+    static reg negative(reg a) { return _mm256_cmpgt_epi64(_mm256_setzero_si256(), a); }
+};
+
+} // namespace
+
+const WideSumKernels& avx2_wide_sum_kernels()
+{
+    static constexpr WideSumKernels kernels =
+        detail::make_wide_sum_kernels<Avx2Lanes<std::int32_t>, Avx2Lanes<std::int64_t>>();
+    return kernels;
+}
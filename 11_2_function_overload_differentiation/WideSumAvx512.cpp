@@ -0,0 +1,51 @@
+/**
+ * @file WideSumAvx512.cpp
+ * @author Daniel Even
+ * @brief AVX-512 carry-save kernels. This file is compiled with -mavx512f and
+ * must only be called after cpu::supported(cpu::Isa::avx512) has
+ * returned true. AVX-512 compares unsigned 64-bit lanes directly, into a mask
+ * that is expanded back to all-ones lanes.
+ */
+#define WIDE_SUM_ISA avx512
+#include "WideSumKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+template <typename T>
+struct Avx512Lanes
+{
+    using value_type = T;
+    using reg = __m512i;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const value_type* p)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        else
+            return _mm512_loadu_si512(p);
+    }
+
+    static void store(std::uint64_t* p, reg v) { _mm512_storeu_si512(p, v); }
+    static reg zero() { return _mm512_setzero_si512(); }
+    static reg add(reg a, reg b) { return _mm512_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_epi64(a, b); }
+
+    static reg less_unsigned(reg a, reg b)
+    {
+        return _mm512_maskz_set1_epi64(_mm512_cmplt_epu64_mask(a, b), -1);
+    }
+
+    static reg negative(reg a) { return _mm512_srai_epi64(a, 63); }
+};
+
+} // namespace
+
+const WideSumKernels& avx512_wide_sum_kernels()
+{
+    static constexpr WideSumKernels kernels =
+        detail::make_wide_sum_kernels<Avx512Lanes<std::int32_t>, Avx512Lanes<std::int64_t>>();
+    return kernels;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file WideSumKernels.hpp
+ * @author Daniel Even
+ * @brief Private to the WideSum*.cpp files. Defines the carry-save loop
+ * described in WideSum.hpp once, over a description of one vector type, so
+ * that every ISA shares it.
+ *
+ * @note Each WideSum<Isa>.cpp file is compiled with different -m flags, and
+ * defines WIDE_SUM_ISA to the name of its instruction set before including
+ * this file. The functions below live in an inline namespace of that name, so
+ * every instruction set keeps its own copy. For the same reason the kernels
+ * return a plain WideLaneSum rather than a wide::int128, whose inline members
+ * could otherwise be merged with a copy compiled for a wider instruction set.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A 128-bit two's complement sum as two halves.
+ */
+struct WideLaneSum
+{
+    std::uint64_t low;
+    std::uint64_t high;
+};
+
+/**
+ * @brief Sums 'count' elements of 'data' exactly. For int32_t, 'count' must
+ * be below 2^32, so that no 64-bit lane can overflow.
+ */
+template <typename T>
+using WideSumKernel = WideLaneSum (*)(const T* data, std::size_t count);
+
+/**
+ * @brief The kernels for one instruction set.
+ */
+struct WideSumKernels
+{
+    WideSumKernel<std::int32_t> sum_i32;
+    WideSumKernel<std::int64_t> sum_i64;
+};
+
+const WideSumKernels& scalar_wide_sum_kernels();
+#if defined(__x86_64__) || defined(__i386__)
+const WideSumKernels& avx2_wide_sum_kernels();
+const WideSumKernels& avx512_wide_sum_kernels();
+#endif
+
+inline constexpr std::size_t wide_sum_lanes = 16;
+
+#ifndef WIDE_SUM_ISA
+#error "WideSumKernels.hpp: define WIDE_SUM_ISA to the instruction set this file is compiled for"
+#endif
+
+namespace detail {
+inline namespace WIDE_SUM_ISA {
+
+/**
+ * @brief total += (high, low), with the carry out of the low half found by
+ * comparing, so that this compiles the same with any flags.
+ */
+inline void accumulate(WideLaneSum& total, std::uint64_t low, std::uint64_t high)
+{
+    total.low += low;
+    total.high += high + (total.low < low ? 1 : 0);
+}
+
+template <typename T>
+inline void accumulate(WideLaneSum& total, T value)
+{
+    accumulate(total, static_cast<std::uint64_t>(static_cast<std::int64_t>(value)),
+               value < 0 ? ~std::uint64_t{0} : 0);
+}
+
+/**
+ * @brief The carry-save loop for one vector type V of 64-bit lanes, which
+ * provides its register type, width (in 64-bit lanes), load (widening an
+ * int32_t source to 64-bit lanes), add, sub, and two compares that return
+ * all ones in the lanes where they hold: less_unsigned(a, b) and
+ * negative(a).
+ *
+ * Element i goes to lane i % 16, in 16 / V::width registers, so that the
+ * additions of one iteration are independent of each other.
+ */
+template <typename V>
+inline WideLaneSum simd_wide_sum(const typename V::value_type* data, std::size_t count)
+{
+    using T = typename V::value_type;
+    using reg = typename V::reg;
+    constexpr std::size_t regs = wide_sum_lanes / V::width;
+    static_assert(regs * V::width == wide_sum_lanes);
+
+    reg low[regs];
+    reg high[regs];
+    for (std::size_t r = 0; r < regs; ++r)
+        low[r] = high[r] = V::zero();
+
+    const std::size_t full = count - count % wide_sum_lanes;
+    for (std::size_t i = 0; i < full; i += wide_sum_lanes)
+    {
+        for (std::size_t r = 0; r < regs; ++r)
+        {
+            const reg x = V::load(data + i + r * V::width);
+            low[r] = V::add(low[r], x);
+            if constexpr (sizeof(T) == 8)
+            {
+                // The low half carried if it wrapped around to below x.
+                high[r] = V::sub(high[r], V::less_unsigned(low[r], x));
+                high[r] = V::add(high[r], V::negative(x));
+            }
+        }
+    }
+
+    std::uint64_t low_lanes[wide_sum_lanes];
+    std::uint64_t high_lanes[wide_sum_lanes];
+    for (std::size_t r = 0; r < regs; ++r)
+    {
+        V::store(low_lanes + r * V::width, low[r]);
+        V::store(high_lanes + r * V::width, high[r]);
+    }
+
+    WideLaneSum total{0, 0};
+    for (std::size_t k = 0; k < wide_sum_lanes; ++k)
+    {
+        if constexpr (sizeof(T) == 8)
+            accumulate(total, low_lanes[k], high_lanes[k]);
+        else
+            // The 64-bit lanes of widened int32_t values hold exact signed sums.
+            accumulate(total, static_cast<std::int64_t>(low_lanes[k]));
+    }
+    for (std::size_t i = full; i < count; ++i)
+        accumulate(total, data[i]);
+    return total;
+}
+
+/**
+ * @brief Builds the kernel table for one ISA from its vector descriptions.
+ */
+template <typename I32, typename I64>
+constexpr WideSumKernels make_wide_sum_kernels()
+{
+    return WideSumKernels{simd_wide_sum<I32>, simd_wide_sum<I64>};
+}
+
+} // namespace WIDE_SUM_ISA
+} // namespace detail
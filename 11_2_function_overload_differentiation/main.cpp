@@ -44,109 +44,428 @@
  * considered.
  * 
  * 6) There is no resolution and a compiler error will be issued.
+ *
+ * @note The add overloads are in OverloadSet.hpp, part of cpp_concepts_core.
+ * Every overload is instrumented with TRACE_SCOPE. Configure with
+ * -DENABLE_TRACING=ON to print per-overload call counts and latencies at exit;
+ * see Trace.hpp for details.
+ *
+ * @note MultiDispatch.hpp applies the same ladder at runtime, to values whose
+ * types are only known while the program runs.
+ *
+ * @note ConcurrentOverloadClass.hpp applies the const/non-const split of
+ * OverloadClass to threads: the const overload becomes a seqlock snapshot read
+ * and the non-const one exclusive write access.
+ *
+ * @note The int overloads of add overflow like any int. WideInt.hpp adds
+ * add overloads for 128 and 256 bit integers that overload resolution only
+ * picks when an argument already is one, WideSum.hpp sums whole arrays into
+ * 128 bits with SIMD, and BigAccumulator.hpp grows without limit.
  */
-#include <iostream>
-#include <cstdarg>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "BigAccumulator.hpp"
+#include "ConcurrentOverloadClass.hpp"
+#include "MultiDispatch.hpp"
+#include "OutputSink.hpp"
 #include "OverloadClass.hpp"
+#include "OverloadSet.hpp"
+#include "Trace.hpp"
+#include "VariadicAdd.hpp"
+#include "WideInt.hpp"
+#include "WideSum.hpp"
 
 // Uncomment this to demonstrate how functions cannot be overloaded based on
 // return type.
 // #define RETURN_TYPE_EXAMPLE
 
+// Uncomment this to hammer ConcurrentOverloadClass.hpp from several threads
+// and check that no reader ever sees a torn value and no add is lost.
+// #define VERIFY_CONCURRENT_OVERLOAD
+
+// Uncomment this to check wide_int, wide::sum() on every instruction set and
+// big_accumulator against __int128 and against each other.
+// #define VERIFY_WIDE_ACCUMULATION
+
+#ifdef VERIFY_CONCURRENT_OVERLOAD
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#endif // VERIFY_CONCURRENT_OVERLOAD
+
+#ifdef VERIFY_WIDE_ACCUMULATION
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#endif // VERIFY_WIDE_ACCUMULATION
+
 
 //==============================================================================
 // Function Declarations
 //==============================================================================
+// The overloaded add functions are declared in OverloadSet.hpp and defined in
+// the cpp_concepts_core library, so that the benchmarks call the very same
+// functions. They live in a namespace of their own there, next to the add
+// template from 11_6; this brings them into scope as if declared here.
+using namespace overload_set;
+
+#ifdef RETURN_TYPE_EXAMPLE
+namespace overload_set {
+
+/**
+ * @brief A trivial function used to try to force the compiler to overload based
+ * on the return type. This is not allowed and will fail.
+ */
+float add(int num1, int num2);
+
+float add(int num1, int num2)
+{
+    TRACE_SCOPE("add(int, int) -> float");
+    io::out() << "Fourth add version called! (Overloaded based on return type)" << io::endl;
+    return num1 + num2;
+}
+
+} // namespace overload_set
+#endif
+
+//==============================================================================
+// Runtime Dispatch
+//==============================================================================
 /**
- * @brief A trivial function that will be overloaded in the following examples.
+ * @brief The add overloads that take two arguments, as a runtime dispatch
+ * table. Each overloaded name has to be cast to pick out one function.
  */
-int add(int num1, int num2);
+using DynamicNumber = DynamicValue<bool, char, short, int, long, float, double>;
+using DynamicAdd = Multimethod<DynamicNumber, 2,
+                               static_cast<int (*)(int, int)>(add),
+                               static_cast<float (*)(float, float)>(add),
+                               static_cast<int (*)(int, ...)>(add)>;
 
 /**
- * @brief A trivial function to force the compiler to overload based on the
- * number of parameters used.
+ * @brief Stand-ins for the same three overloads that only report which one the
+ * compiler chose, so that the choice can be inspected with decltype.
  */
-int add(int num1, int num2, int num3);
+struct AddProbe
+{
+    std::integral_constant<int, 0> operator()(int, int) const;
+    std::integral_constant<int, 1> operator()(float, float) const;
+    std::integral_constant<int, 2> operator()(int, ...) const;
+};
 
 /**
- * @brief A trivial function to force the compiler to overload based on the
- * type of parameters used.
+ * @brief True if DynamicAdd picks the overload the compiler picks for every
+ * pair of argument types, and fails exactly where the compiler does.
  */
-float add(float num1, float num2);
+template <typename... Ts>
+consteval bool dispatch_matches_compiler(std::type_identity<DynamicValue<Ts...>>)
+{
+    auto row = []<typename A>(std::type_identity<A>) {
+        auto cell = []<typename B>(std::type_identity<B>) {
+            constexpr int runtime = DynamicAdd::selected({DynamicNumber::tag_of<A>(), DynamicNumber::tag_of<B>()});
+            if constexpr (requires { AddProbe{}(std::declval<A>(), std::declval<B>()); })
+                return runtime == decltype(AddProbe{}(std::declval<A>(), std::declval<B>()))::value;
+            else
+                return runtime < 0;
+        };
+        return (cell(std::type_identity<Ts>{}) && ...);
+    };
+    return (row(std::type_identity<Ts>{}) && ...);
+}
 
+static_assert(dispatch_matches_compiler(std::type_identity<DynamicNumber>{}),
+              "The dispatch table must resolve every call the way the compiler does");
 
-#ifdef RETURN_TYPE_EXAMPLE
+// The add overloads of WideInt.hpp are hidden friends of wide_int, so they are
+// only candidates when an argument already is one, and add(1, 2) still
+// resolves to add(int, int). Mixed widths widen to the larger one. The wide
+// argument has to come first: add(1, wide::int128{2}) also matches
+// add(int, ...) with an exact match for the 1, so neither overload is better
+// for every argument and the call is ambiguous.
+static_assert(std::is_same_v<decltype(add(1, 2)), int>);
+static_assert(std::is_same_v<decltype(add(wide::int128{1}, 2)), wide::int128>);
+static_assert(std::is_same_v<decltype(add(wide::int256{1}, 2, 3)), wide::int256>);
+static_assert(std::is_same_v<decltype(add(wide::int128{1}, wide::int256{2})), wide::int256>);
+
+#ifdef VERIFY_CONCURRENT_OVERLOAD
 /**
- * @brief A trivial function used to try to force the compiler to overload based
- * on the return type. This is not allowed and will fail.
+ * @brief A value that is only consistent if all four fields come from the
+ * same write, and large enough to span several words.
  */
-float add(int num1, int num2);
-#endif
+struct Quad
+{
+    std::int64_t a = 0, b = 1, c = 2, d = 3;
+};
 
 /**
- * @brief This demonstrates the compilers ability to differentiate ellipses from
- * standard parameters
+ * @brief One writer keeps publishing consistent Quads while the readers check
+ * every snapshot, then every thread adds to a ShardedOverloadClass.
  */
-int add(int num1, ...);
+bool verify_concurrent_overload()
+{
+    const unsigned readers = std::max(2u, std::thread::hardware_concurrency());
+    constexpr std::int64_t writes = 200'000;
+    constexpr std::int64_t adds = 100'000;
 
+    concurrent::SeqLock<Quad> quad;
+    std::atomic<bool> done{false};
+    std::atomic<std::uint64_t> torn{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < readers; ++t)
+        threads.emplace_back([&] {
+            std::int64_t last = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                const Quad q = quad.load();
+                if (q.b != q.a + 1 || q.c != q.a + 2 || q.d != q.a + 3 || q.a < last)
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                last = q.a;
+            }
+        });
+    for (std::int64_t i = 1; i <= writes; ++i)
+        quad.store({i, i + 1, i + 2, i + 3});
+    done.store(true);
+    for (std::thread& thread : threads)
+        thread.join();
 
-//==============================================================================
-// Function Definitions
-//==============================================================================
-int add(int num1, int num2)
+    concurrent::ShardedOverloadClass counter;
+    threads.clear();
+    for (unsigned t = 0; t < readers; ++t)
+        threads.emplace_back([&] {
+            for (std::int64_t i = 0; i < adds; ++i)
+                ++counter.get_number();
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    const std::int64_t total = std::as_const(counter).get_number();
+
+    io::out() << "SeqLock: " << torn.load() << " torn reads with " << readers << " readers; ShardedCounter: "
+              << total << " of " << adds * readers << " adds" << io::endl;
+    return torn.load() == 0 && total == adds * static_cast<std::int64_t>(readers);
+}
+#endif // VERIFY_CONCURRENT_OVERLOAD
+
+#ifdef VERIFY_WIDE_ACCUMULATION
+__extension__ typedef __int128 reference_int128;
+__extension__ typedef unsigned __int128 reference_uint128;
+
+wide::int128 from_reference(reference_int128 value)
 {
-    std::cout << "First add version called!" << std::endl;
-    return num1 + num2;
+    const auto bits = static_cast<reference_uint128>(value);
+    return wide::int128::from_limbs({static_cast<std::uint64_t>(bits), static_cast<std::uint64_t>(bits >> 64)});
 }
 
-int add(int num1, int num2, int num3)
+std::string reference_to_string(reference_int128 value)
 {
-    std::cout << "Second add version called! (Overloaded based on number of parameters)" << std::endl;
-    return num1 + num2 + num3;
+    const bool negative = value < 0;
+    auto magnitude = negative ? reference_uint128{0} - static_cast<reference_uint128>(value)
+                              : static_cast<reference_uint128>(value);
+    std::string digits;
+    do
+    {
+        digits.insert(digits.begin(), static_cast<char>('0' + static_cast<int>(magnitude % 10)));
+        magnitude /= 10;
+    } while (magnitude != 0);
+    return negative ? "-" + digits : digits;
 }
 
-float add(float num1, float num2)
+/**
+ * @brief Checks wide_int arithmetic, comparison and formatting against
+ * __int128, and the int256 overloads against the int128 ones. Returns the
+ * number of failures.
+ */
+int verify_wide_int(std::mt19937_64& rng)
 {
-    std::cout << "Third add version called! (Overloaded based on type of parameters)" << std::endl;
-    return num1 + num2;
+    int failures = 0;
+    auto check = [&failures](bool passed, const std::string& what) {
+        if (!passed && ++failures <= 10)
+            io::out() << "wide_int: " << what << " is wrong" << io::endl;
+    };
+
+    const reference_int128 max = static_cast<reference_int128>(~reference_uint128{0} >> 1);
+    check(from_reference(max) == wide::int128::max(), "int128::max()");
+    check(from_reference(-max - 1) == wide::int128::min(), "int128::min()");
+    check(wide::int128::min().to_string() == "-170141183460469231731687303715884105728", "min().to_string()");
+    check(wide::int128{0}.to_string() == "0", "0.to_string()");
+    check(wide::int256{-1} + 1 == 0, "int256 -1 + 1");
+
+    // add_all() carries any pack with a 64-bit integer in 128 bits.
+    check(add_all(1, UINT64_MAX) == reference_int128{UINT64_MAX} + 1, "add_all(1, UINT64_MAX)");
+    check(add_all(-1, std::uint64_t{1} << 63) == (reference_int128{1} << 63) - 1, "add_all(-1, 2^63)");
+    check(add_all(INT64_MIN, INT64_MIN, 0u) == reference_int128{INT64_MIN} * 2, "add_all(INT64_MIN, INT64_MIN, 0u)");
+    check(add_all(UINT64_MAX, UINT64_MAX) == reference_int128{UINT64_MAX} * 2, "add_all(UINT64_MAX, UINT64_MAX)");
+
+    for (int trial = 0; trial < 100000; ++trial)
+    {
+        // Full-width values, and values near zero where the sign changes.
+        const int shift = static_cast<int>(rng() % 128);
+        const auto a = static_cast<reference_int128>((reference_uint128{rng()} << 64 | rng())) >> shift;
+        const auto b = static_cast<reference_int128>((reference_uint128{rng()} << 64 | rng())) >> (127 - shift);
+        const wide::int128 x = from_reference(a), y = from_reference(b);
+        const auto wrapped_sum = static_cast<reference_int128>(static_cast<reference_uint128>(a) + b);
+        const auto wrapped_difference = static_cast<reference_int128>(static_cast<reference_uint128>(a) - b);
+
+        check(add(x, y) == from_reference(wrapped_sum), "add(int128, int128)");
+        check(x - y == from_reference(wrapped_difference), "int128 - int128");
+        check((x <=> y) == (a <=> b), "int128 <=> int128");
+        check(x.to_string() == reference_to_string(a), "int128::to_string()");
+        // The same sums in 256 bits do not wrap.
+        const wide::int256 wide_sum = add(wide::int256{x}, y);
+        check(wide_sum - y == x && (wide_sum - x) - y == 0, "add(int256, int256)");
+        check((wide::int256{x} <=> wide::int256{y}) == (a <=> b), "int256 <=> int256");
+
+        const auto small = static_cast<std::int64_t>(rng()) >> (rng() % 64);
+        check(wide::int128{small}.narrow<std::int64_t>() == small && wide::int128{small} == from_reference(small),
+              "int128 from int64_t");
+    }
+
+    bool threw = false;
+    try
+    {
+        (void)(wide::int128{INT_MAX} + 1).narrow<int>();
+    }
+    catch (const std::range_error&)
+    {
+        threw = true;
+    }
+    check(threw, "narrow<int>() of INT_MAX + 1");
+    return failures;
 }
 
-#ifdef RETURN_TYPE_EXAMPLE
-float add(int num1, int num2)
+/**
+ * @brief Checks wide::sum() on one instruction set against a __int128 loop,
+ * for sizes around the 16 lanes and for values at the ends of the range,
+ * where every lane carries. Returns the number of failures.
+ */
+template <typename T>
+int verify_wide_sum(std::mt19937_64& rng, cpu::Isa isa)
 {
-    std::cout << "Fourth add version called! (Overloaded based on return type)" << std::endl;
-    return num1 + num2;
+    int failures = 0;
+    for (std::size_t size : {0, 1, 15, 16, 17, 1000, 100003})
+    {
+        for (int pattern = 0; pattern < 3; ++pattern)
+        {
+            std::vector<T> values(size);
+            for (T& value : values)
+            {
+                if (pattern == 0)
+                    value = static_cast<T>(rng());
+                else if (pattern == 1)
+                    value = std::numeric_limits<T>::max() - static_cast<T>(rng() % 4);
+                else
+                    value = std::numeric_limits<T>::min() + static_cast<T>(rng() % 4);
+            }
+            reference_int128 expected = 0;
+            for (T value : values)
+                expected += value;
+            if (wide::sum(std::span<const T>(values), isa) != from_reference(expected))
+            {
+                ++failures;
+                io::out() << "wide::sum<" << sizeof(T) * 8 << ">(" << to_string(isa) << ") of " << size
+                          << " values, pattern " << pattern << " is wrong" << io::endl;
+            }
+        }
+    }
+    return failures;
 }
-#endif
 
-int add(int count, ...)
+/**
+ * @brief Checks big_accumulator against __int128 while the sum fits, and
+ * against int512 once it has grown past 256 bits. Returns the number of
+ * failures.
+ */
+int verify_big_accumulator(std::mt19937_64& rng)
 {
-    std::cout << "Fifth add version called! (The variable argument list type)" << std::endl;
-    va_list list;
-    va_start(list, count);
-    int sum = 0;
+    int failures = 0;
+    auto check = [&failures](bool passed, const char* what) {
+        if (!passed)
+        {
+            ++failures;
+            io::out() << "big_accumulator: " << what << " is wrong" << io::endl;
+        }
+    };
 
-    for (int i = 0; i < count; ++i)
+    wide::big_accumulator total;
+    reference_int128 expected = 0;
+    std::vector<std::int64_t> values(1000);
+    for (int trial = 0; trial < 1000; ++trial)
     {
-        sum += static_cast<double>(va_arg(list, int));
+        const auto value = static_cast<std::int64_t>(rng());
+        total += value;
+        expected += value;
+        for (auto& element : values)
+            element = static_cast<std::int64_t>(rng());
+        total += std::span<const std::int64_t>(values);
+        for (auto element : values)
+            expected += element;
     }
+    check(total.value<128>() == from_reference(expected), "the sum of int64_t values");
+    check(total.to_string() == reference_to_string(expected), "to_string()");
 
-    va_end(list);
+    using int512 = wide::wide_int<512>;
+    wide::big_accumulator grown;
+    int512 grown_expected = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        grown += wide::int256::max();
+        grown_expected += wide::int256::max();
+    }
+    grown += wide::int256::min();
+    grown_expected += wide::int256::min();
+    check(grown.value<512>() == grown_expected && grown.to_string() == grown_expected.to_string(),
+          "the sum past 256 bits");
 
-    return sum;
+    bool threw = false;
+    try
+    {
+        (void)grown.value<256>();
+    }
+    catch (const std::range_error&)
+    {
+        threw = true;
+    }
+    check(threw, "value<256>() of a sum past 256 bits");
+
+    wide::big_accumulator lowest;
+    lowest += wide::int128::min();
+    check(lowest.value<128>() == wide::int128::min(), "value<128>() of int128::min()");
+    return failures;
+}
+
+void verify_wide_accumulation()
+{
+    std::mt19937_64 rng(21);
+    int failures = verify_wide_int(rng);
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+        failures += verify_wide_sum<std::int32_t>(rng, isa);
+        failures += verify_wide_sum<std::int64_t>(rng, isa);
+    }
+    failures += verify_big_accumulator(rng);
+    io::out() << "wide_int, wide::sum (selected ISA " << to_string(wide_sum_isa()) << ") and big_accumulator: "
+              << failures << " failures" << io::endl;
 }
+#endif // VERIFY_WIDE_ACCUMULATION
 
 int main() {
     // Demonstrate the initial 3 examples
     // This should call the first copy of the function.
-    int sol = add(1, 2); 
+    [[maybe_unused]] int sol = add(1, 2); 
 
     // This should call the second. Note that this was called with precedence 
     // over the variable argument list version of the function! Very interesting.
     sol = add(1, 2, 3); 
 
     // And this should call the third.
-    float float_solution = add(1.0f, 2.0f); 
+    [[maybe_unused]] float float_solution = add(1.0f, 2.0f); 
 
     // This should call the variable argument list version
     sol = add(5, 1, 2, 3, 4, 5);
@@ -157,6 +476,63 @@ int main() {
     // choose?
     sol = add('c', 'd');
 
+    // The same resolution when the types are only known at runtime. These
+    // values could just as well have come from a config file.
+    const DynamicNumber lhs = 'c';
+    const DynamicNumber rhs = 'd';
+    DynamicNumber dynamic_sum = DynamicAdd::call(lhs, rhs);
+    io::out() << "Dynamic add('c', 'd') returned an int: " << dynamic_sum.get<int>() << io::endl;
+
+    // Reading it as another type is an error, not a reinterpretation of the
+    // int's bytes.
+    try
+    {
+        (void)dynamic_sum.get<float>();
+    }
+    catch (const std::invalid_argument& error)
+    {
+        io::out() << error.what() << io::endl;
+    }
+
+    // add(1.0, 2.0) would not compile: double converts equally well to int
+    // and to float. The dispatch table turns that into an exception.
+    try
+    {
+        dynamic_sum = DynamicAdd::call(DynamicNumber(1.0), DynamicNumber(2.0));
+    }
+    catch (const std::invalid_argument& error)
+    {
+        io::out() << error.what() << io::endl;
+    }
+
+    // The variadic template version does not need a count and is type checked
+    // at compile time. It has its own name so that it does not take over any
+    // of the calls above; see VariadicAdd.hpp for why.
+    io::out() << "add_all(1, 2, 3, 4, 5) = " << add_all(1, 2, 3, 4, 5) << io::endl;
+    io::out() << "add_all(1, 2.5f, 3.25) = " << add_all(1, 2.5f, 3.25) << io::endl;
+    // A 64-bit argument carries the sum in an __int128, so it cannot wrap.
+    io::out() << "add_all(1, UINT64_MAX) > UINT64_MAX: " << (add_all(1, UINT64_MAX) > UINT64_MAX ? "yes" : "no")
+              << io::endl;
+
+    // add(1, 2) above returns an int, which overflows like any int. A wide
+    // integer argument rules out add(int, int), since a wide_int does not
+    // convert back to int, and picks the overload for wide::int128 from
+    // WideInt.hpp instead, converting the other argument to match.
+    io::out() << "add(int128{INT_MAX}, INT_MAX) = " << add(wide::int128{INT_MAX}, INT_MAX).to_string() << io::endl;
+    io::out() << "add_all(int256{INT64_MAX}, INT64_MAX, INT64_MAX) = "
+              << add_all(wide::int256{INT64_MAX}, INT64_MAX, INT64_MAX).to_string() << io::endl;
+
+    // Whole arrays are summed into 128 bits with SIMD, and big_accumulator
+    // grows for as long as the sum does.
+    const std::vector<std::int64_t> counters(1000, INT64_MAX);
+    io::out() << "The sum of 1000 x INT64_MAX is " << wide::sum(counters).to_string() << " (with "
+              << to_string(wide_sum_isa()) << ")" << io::endl;
+    wide::big_accumulator total;
+    for (int i = 0; i < 4; ++i)
+        total += wide::int256::max();
+    io::out() << "4 x int256 max is " << total.to_string() << ", in " << total.limb_count() << " limbs"
+              << io::endl;
+
 
     // Demonstrate how member functions of a class can be overloaded based on 
     // const or volatile qualifiers.
@@ -172,4 +548,22 @@ int main() {
 
     // Check the logs to see which version of this function was called.
     (void)overload_class_const.get_number(); 
+
+    // The same split for an object shared between threads. The non-const
+    // overload hands out exclusive write access until the end of the
+    // statement; the const one is a snapshot read that never blocks, however
+    // many threads read at once.
+    concurrent::ConcurrentOverloadClass shared_number;
+    shared_number.get_number() += 5;
+    const concurrent::ConcurrentOverloadClass& shared_view = shared_number;
+    io::out() << "Snapshot read from the const overload: " << shared_view.get_number() << io::endl;
+
+#ifdef VERIFY_CONCURRENT_OVERLOAD
+    const bool concurrent_passed = verify_concurrent_overload();
+    io::out() << "Concurrent overloads are consistent: " << (concurrent_passed ? "yes" : "NO") << io::endl;
+#endif // VERIFY_CONCURRENT_OVERLOAD
+
+#ifdef VERIFY_WIDE_ACCUMULATION
+    verify_wide_accumulation();
+#endif // VERIFY_WIDE_ACCUMULATION
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+/**
+ * @file NumericConvert.cpp
+ * @author Daniel Even
+ * @brief Picks the AVX2 kernel, if any, for each conversion and mode used by
+ * convert(). Conversions without a kernel report 0 elements done and are left
+ * entirely to the scalar loops in the header.
+ */
+#include "NumericConvert.hpp"
+#include "CpuDispatch.hpp"
+
+#include <type_traits>
+
+namespace numeric {
+
+#if defined(__x86_64__) || defined(__i386__)
+// Defined in NumericConvertAvx2.cpp.
+std::size_t convert_i32_i16_saturate_avx2(const std::int32_t* in, std::int16_t* out, std::size_t count);
+std::size_t convert_i16_i8_saturate_avx2(const std::int16_t* in, std::int8_t* out, std::size_t count);
+std::size_t convert_i32_i8_saturate_avx2(const std::int32_t* in, std::int8_t* out, std::size_t count);
+std::size_t convert_i32_i16_truncate_avx2(const std::int32_t* in, std::int16_t* out, std::size_t count);
+std::size_t convert_i16_i8_truncate_avx2(const std::int16_t* in, std::int8_t* out, std::size_t count);
+std::size_t convert_i32_i8_truncate_avx2(const std::int32_t* in, std::int8_t* out, std::size_t count);
+std::size_t convert_f32_i32_saturate_avx2(const float* in, std::int32_t* out, std::size_t count);
+std::size_t convert_f64_f32_saturate_avx2(const double* in, float* out, std::size_t count);
+std::size_t convert_f64_f32_truncate_avx2(const double* in, float* out, std::size_t count);
+std::size_t convert_i32_f32_avx2(const std::int32_t* in, float* out, std::size_t count);
+std::size_t convert_i8_i16_avx2(const std::int8_t* in, std::int16_t* out, std::size_t count);
+std::size_t convert_i8_i32_avx2(const std::int8_t* in, std::int32_t* out, std::size_t count);
+std::size_t convert_i16_i32_avx2(const std::int16_t* in, std::int32_t* out, std::size_t count);
+std::size_t convert_i32_i64_avx2(const std::int32_t* in, std::int64_t* out, std::size_t count);
+std::size_t convert_i32_f64_avx2(const std::int32_t* in, double* out, std::size_t count);
+std::size_t convert_f32_f64_avx2(const float* in, double* out, std::size_t count);
+#endif
+
+namespace {
+
+template <typename F, typename T, typename From, typename To>
+inline constexpr bool is_pair = std::is_same_v<F, From> && std::is_same_v<T, To>;
+
+} // namespace
+
+/**
+ * @brief Mode is saturate_t, truncate_t, or void for the lossless overload.
+ * checked_t reuses the saturate_t kernels.
+ */
+template <ConvertibleElement From, ConvertibleElement To, typename Mode>
+std::size_t convert_simd(const From* in, To* out, std::size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (!cpu::supported(cpu::Isa::avx2))
+        return 0;
+
+    constexpr bool saturating = std::is_same_v<Mode, saturate_t>;
+    constexpr bool truncating = std::is_same_v<Mode, truncate_t>;
+
+    if constexpr (is_pair<From, To, std::int32_t, std::int16_t>)
+    {
+        if constexpr (saturating)
+            return convert_i32_i16_saturate_avx2(in, out, count);
+        else if constexpr (truncating)
+            return convert_i32_i16_truncate_avx2(in, out, count);
+    }
+    else if constexpr (is_pair<From, To, std::int16_t, std::int8_t>)
+    {
+        if constexpr (saturating)
+            return convert_i16_i8_saturate_avx2(in, out, count);
+        else if constexpr (truncating)
+            return convert_i16_i8_truncate_avx2(in, out, count);
+    }
+    else if constexpr (is_pair<From, To, std::int32_t, std::int8_t>)
+    {
+        if constexpr (saturating)
+            return convert_i32_i8_saturate_avx2(in, out, count);
+        else if constexpr (truncating)
+            return convert_i32_i8_truncate_avx2(in, out, count);
+    }
+    else if constexpr (is_pair<From, To, float, std::int32_t>)
+    {
+        // Truncation saturates for floating point sources, so both modes share
+        // a kernel.
+        if constexpr (saturating || truncating)
+            return convert_f32_i32_saturate_avx2(in, out, count);
+    }
+    else if constexpr (is_pair<From, To, double, float>)
+    {
+        if constexpr (saturating)
+            return convert_f64_f32_saturate_avx2(in, out, count);
+        else if constexpr (truncating)
+            return convert_f64_f32_truncate_avx2(in, out, count);
+    }
+    else if constexpr (is_pair<From, To, std::int32_t, float>)
+        return convert_i32_f32_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, std::int8_t, std::int16_t>)
+        return convert_i8_i16_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, std::int8_t, std::int32_t>)
+        return convert_i8_i32_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, std::int16_t, std::int32_t>)
+        return convert_i16_i32_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, std::int32_t, std::int64_t>)
+        return convert_i32_i64_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, std::int32_t, double>)
+        return convert_i32_f64_avx2(in, out, count);
+    else if constexpr (is_pair<From, To, float, double>)
+        return convert_f32_f64_avx2(in, out, count);
+#endif
+    (void)in;
+    (void)out;
+    (void)count;
+    return 0;
+}
+
+// Every combination of element types and modes the header can ask for.
+#define NUMERIC_CONVERT_INSTANTIATE(From, To)                                             \
+    template std::size_t convert_simd<From, To, void>(const From*, To*, std::size_t);       \
+    template std::size_t convert_simd<From, To, saturate_t>(const From*, To*, std::size_t); \
+    template std::size_t convert_simd<From, To, truncate_t>(const From*, To*, std::size_t);
+
+#define NUMERIC_CONVERT_INSTANTIATE_FROM(From)         \
+    NUMERIC_CONVERT_INSTANTIATE(From, std::int8_t)     \
+    NUMERIC_CONVERT_INSTANTIATE(From, std::int16_t)    \
+    NUMERIC_CONVERT_INSTANTIATE(From, std::int32_t)    \
+    NUMERIC_CONVERT_INSTANTIATE(From, std::int64_t)    \
+    NUMERIC_CONVERT_INSTANTIATE(From, float)           \
+    NUMERIC_CONVERT_INSTANTIATE(From, double)
+
+NUMERIC_CONVERT_INSTANTIATE_FROM(std::int8_t)
+NUMERIC_CONVERT_INSTANTIATE_FROM(std::int16_t)
+NUMERIC_CONVERT_INSTANTIATE_FROM(std::int32_t)
+NUMERIC_CONVERT_INSTANTIATE_FROM(std::int64_t)
+NUMERIC_CONVERT_INSTANTIATE_FROM(float)
+NUMERIC_CONVERT_INSTANTIATE_FROM(double)
+
+#undef NUMERIC_CONVERT_INSTANTIATE_FROM
+#undef NUMERIC_CONVERT_INSTANTIATE
+
+} // namespace numeric
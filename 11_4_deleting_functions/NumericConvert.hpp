@@ -0,0 +1,353 @@
+/**
+ * @file NumericConvert.hpp
+ * @author Daniel Even
+ * @brief The deleted function patterns from main.cpp applied to numeric
+ * conversions:
+ *
+ * 1) Exact<T> is a strong typedef whose constructor only accepts a T. Just like
+ * 'template <typename T> void bar(T) = delete;', a deleted constructor template
+ * catches every other argument type, so Exact<std::int16_t>{some_int} does not
+ * compile instead of silently narrowing.
+ *
+ * 2) convert(in, out) copies a span of one arithmetic type into a span of
+ * another. If every value of the source type is exactly representable in the
+ * destination (int16 -> int32, float -> double, ...) no mode is needed. For
+ * every other pair the two-argument overload is deleted, so the caller has to
+ * say what should happen to values that do not fit by passing one of:
+ *
+ * * saturate - out of range values clamp to the destination's limits, NaN
+ *   becomes 0 for integer destinations, and fractions round toward zero.
+ *
+ * * truncate - integers keep their low bits (two's complement wrap-around),
+ *   like static_cast. Floating point to integer rounds toward zero and
+ *   saturates, since there are no "low bits" of a float to keep. Double to
+ *   float rounds to nearest and overflows to infinity.
+ *
+ * * checked - throws std::range_error naming the first element that does not
+ *   survive a round trip through the destination type unchanged (NaN is
+ *   allowed to stay NaN).
+ *
+ * Everything is in namespace numeric, where truncate cannot collide with
+ * POSIX ::truncate from <unistd.h>:
+ *
+ *     numeric::convert(std::span(wide), std::span(narrow), numeric::saturate);
+ *
+ * The common int32/int16/int8, float/int32 and double/float paths have AVX2
+ * kernels built from the pack and convert instructions; everything else uses
+ * the scalar conversions below, which are also the reference semantics.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace numeric {
+
+/**
+ * @brief The mode tags. They are empty types so that choosing a mode is a
+ * matter of overload resolution rather than a runtime branch.
+ */
+struct saturate_t
+{
+    explicit saturate_t() = default;
+};
+struct truncate_t
+{
+    explicit truncate_t() = default;
+};
+struct checked_t
+{
+    explicit checked_t() = default;
+};
+
+inline constexpr saturate_t saturate{};
+inline constexpr truncate_t truncate{};
+inline constexpr checked_t checked{};
+
+/**
+ * @brief The element types the conversion kernels support.
+ */
+template <typename T>
+concept ConvertibleElement =
+    std::is_same_v<T, std::int8_t> || std::is_same_v<T, std::int16_t> ||
+    std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::int64_t> ||
+    std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+/**
+ * @brief True if every From value converts to To exactly.
+ */
+template <typename From, typename To>
+inline constexpr bool is_lossless_v =
+    std::is_same_v<From, To> ||
+    (std::is_integral_v<From> && std::is_integral_v<To> && sizeof(To) > sizeof(From)) ||
+    (std::is_integral_v<From> && std::is_floating_point_v<To> &&
+     std::numeric_limits<From>::digits <= std::numeric_limits<To>::digits) ||
+    (std::is_floating_point_v<From> && std::is_floating_point_v<To> && sizeof(To) > sizeof(From));
+
+/**
+ * @brief A value of exactly type T. Construction from anything other than a T
+ * is deleted, and arithmetic is only defined between two Exact<T> of the same T.
+ */
+template <ConvertibleElement T>
+class Exact
+{
+public:
+    constexpr explicit Exact(T value) : value_(value) {}
+
+    // Every other type lands here instead of being converted to T.
+    template <typename U>
+    Exact(U) = delete;
+
+    constexpr T get() const { return value_; }
+
+    friend constexpr Exact operator+(Exact a, Exact b) { return Exact(static_cast<T>(a.value_ + b.value_)); }
+    friend constexpr Exact operator-(Exact a, Exact b) { return Exact(static_cast<T>(a.value_ - b.value_)); }
+    friend constexpr Exact operator*(Exact a, Exact b) { return Exact(static_cast<T>(a.value_ * b.value_)); }
+    friend constexpr Exact operator/(Exact a, Exact b) { return Exact(static_cast<T>(a.value_ / b.value_)); }
+    friend constexpr auto operator<=>(Exact a, Exact b) = default;
+
+private:
+    T value_;
+};
+
+using Int8 = Exact<std::int8_t>;
+using Int16 = Exact<std::int16_t>;
+using Int32 = Exact<std::int32_t>;
+using Int64 = Exact<std::int64_t>;
+using Float32 = Exact<float>;
+using Float64 = Exact<double>;
+
+namespace detail {
+
+/**
+ * @brief 2^digits of the integer type Int, as a Float. It is exactly
+ * representable, and it is the smallest Float that does not fit in Int.
+ */
+template <typename Int, typename Float>
+inline constexpr Float integer_upper_bound =
+    static_cast<Float>(std::numeric_limits<Int>::max() / 2 + 1) * Float{2};
+
+} // namespace detail
+
+/**
+ * @brief Clamps value into To's range. Fractions round toward zero and NaN
+ * becomes 0 for integer destinations.
+ */
+template <ConvertibleElement To, ConvertibleElement From>
+constexpr To saturate_cast(From value)
+{
+    if constexpr (is_lossless_v<From, To>)
+        return static_cast<To>(value);
+    else if constexpr (std::is_floating_point_v<To>)
+    {
+        // Integer sources always fit in range; only double -> float can
+        // overflow.
+        if constexpr (std::is_floating_point_v<From>)
+        {
+            if (value > std::numeric_limits<To>::max())
+                return std::numeric_limits<To>::max();
+            if (value < std::numeric_limits<To>::lowest())
+                return std::numeric_limits<To>::lowest();
+        }
+        return static_cast<To>(value);
+    }
+    else if constexpr (std::is_floating_point_v<From>)
+    {
+        if (value != value)
+            return To{0};
+        if (value >= detail::integer_upper_bound<To, From>)
+            return std::numeric_limits<To>::max();
+        if (value < static_cast<From>(std::numeric_limits<To>::min()))
+            return std::numeric_limits<To>::min();
+        return static_cast<To>(value);
+    }
+    else
+    {
+        if (value > static_cast<From>(std::numeric_limits<To>::max()))
+            return std::numeric_limits<To>::max();
+        if (value < static_cast<From>(std::numeric_limits<To>::min()))
+            return std::numeric_limits<To>::min();
+        return static_cast<To>(value);
+    }
+}
+
+/**
+ * @brief Integer -> integer keeps the low bits; everything involving floating
+ * point behaves as described at the top of this file.
+ */
+template <ConvertibleElement To, ConvertibleElement From>
+constexpr To truncate_cast(From value)
+{
+    if constexpr (std::is_integral_v<From> && std::is_integral_v<To>)
+        return static_cast<To>(value);
+    else if constexpr (std::is_floating_point_v<From> && std::is_integral_v<To>)
+        return saturate_cast<To>(value);
+    else
+        return static_cast<To>(value);
+}
+
+/**
+ * @brief True if value survives a round trip through To unchanged.
+ */
+template <ConvertibleElement To, ConvertibleElement From>
+constexpr bool fits_exactly(From value)
+{
+    if constexpr (is_lossless_v<From, To>)
+        return true;
+    else if constexpr (std::is_floating_point_v<From> && std::is_integral_v<To>)
+    {
+        // Written so that NaN fails both comparisons.
+        if (!(value >= static_cast<From>(std::numeric_limits<To>::min()) &&
+              value < detail::integer_upper_bound<To, From>))
+            return false;
+        return static_cast<From>(static_cast<To>(value)) == value;
+    }
+    else if constexpr (std::is_integral_v<From> && std::is_floating_point_v<To>)
+    {
+        // The maximum of a 64-bit integer rounds up to 2^63, which must not be
+        // converted back.
+        const To converted = static_cast<To>(value);
+        return converted < detail::integer_upper_bound<From, To> &&
+               static_cast<From>(converted) == value;
+    }
+    else if constexpr (std::is_floating_point_v<From>)
+    {
+        if (value != value)
+            return true;
+        return static_cast<From>(static_cast<To>(value)) == value;
+    }
+    else
+        return static_cast<From>(static_cast<To>(value)) == value;
+}
+
+/**
+ * @brief Runs the AVX2 kernel for this conversion, if there is one and the CPU
+ * supports it. Returns how many leading elements were converted; the caller
+ * finishes the rest with the scalar path. Defined in NumericConvert.cpp.
+ */
+template <ConvertibleElement From, ConvertibleElement To, typename Mode>
+std::size_t convert_simd(const From* in, To* out, std::size_t count);
+
+namespace detail {
+
+template <typename From, typename To>
+void check_sizes(std::span<From> in, std::span<To> out)
+{
+    if (in.size() != out.size())
+        throw std::invalid_argument("convert(): input and output spans differ in size");
+}
+
+} // namespace detail
+
+/**
+ * @brief Lossless conversion. Available only when every From value fits in To.
+ *
+ * @throws std::invalid_argument if the spans differ in size.
+ */
+template <typename From, ConvertibleElement To>
+    requires ConvertibleElement<std::remove_const_t<From>> &&
+             is_lossless_v<std::remove_const_t<From>, To>
+void convert(std::span<From> in, std::span<To> out)
+{
+    using F = std::remove_const_t<From>;
+    detail::check_sizes(in, out);
+    std::size_t i = convert_simd<F, To, void>(in.data(), out.data(), in.size());
+    for (; i < in.size(); ++i)
+        out[i] = static_cast<To>(in[i]);
+}
+
+/**
+ * @brief Any conversion that could lose information must name a mode. This is
+ * the same trick as 'void foo(char) = delete;' in main.cpp.
+ */
+template <typename From, ConvertibleElement To>
+    requires ConvertibleElement<std::remove_const_t<From>> &&
+             (!is_lossless_v<std::remove_const_t<From>, To>)
+void convert(std::span<From> in, std::span<To> out) = delete;
+
+/**
+ * @throws std::invalid_argument if the spans differ in size.
+ */
+template <typename From, ConvertibleElement To>
+    requires ConvertibleElement<std::remove_const_t<From>>
+void convert(std::span<From> in, std::span<To> out, saturate_t)
+{
+    using F = std::remove_const_t<From>;
+    detail::check_sizes(in, out);
+    std::size_t i = convert_simd<F, To, saturate_t>(in.data(), out.data(), in.size());
+    for (; i < in.size(); ++i)
+        out[i] = saturate_cast<To>(in[i]);
+}
+
+/**
+ * @throws std::invalid_argument if the spans differ in size.
+ */
+template <typename From, ConvertibleElement To>
+    requires ConvertibleElement<std::remove_const_t<From>>
+void convert(std::span<From> in, std::span<To> out, truncate_t)
+{
+    using F = std::remove_const_t<From>;
+    detail::check_sizes(in, out);
+    std::size_t i = convert_simd<F, To, truncate_t>(in.data(), out.data(), in.size());
+    for (; i < in.size(); ++i)
+        out[i] = truncate_cast<To>(in[i]);
+}
+
+/**
+ * @brief Converts every element, then reports the first one that did not fit.
+ * The check counts misfits over the whole span without branching so it stays vectorizable;
+ * the failing index is only searched for once a failure is known.
+ *
+ * @throws std::invalid_argument if the spans differ in size.
+ * @throws std::range_error if any element does not fit exactly. The output
+ * span is left fully written with saturated values.
+ */
+template <typename From, ConvertibleElement To>
+    requires ConvertibleElement<std::remove_const_t<From>>
+void convert(std::span<From> in, std::span<To> out, checked_t)
+{
+    using F = std::remove_const_t<From>;
+    detail::check_sizes(in, out);
+    std::size_t i = convert_simd<F, To, saturate_t>(in.data(), out.data(), in.size());
+    for (; i < in.size(); ++i)
+        out[i] = saturate_cast<To>(in[i]);
+
+    if constexpr (!is_lossless_v<F, To>)
+    {
+        // For integer destinations the saturated output round-trips exactly
+        // when the input fit, which lets the check reuse it without branches.
+        std::size_t misfits = 0;
+        if constexpr (std::is_integral_v<F> && std::is_integral_v<To>)
+        {
+            for (std::size_t j = 0; j < in.size(); ++j)
+                misfits += static_cast<F>(out[j]) != in[j];
+        }
+        else if constexpr (std::is_integral_v<To>)
+        {
+            constexpr F lower = static_cast<F>(std::numeric_limits<To>::min());
+            constexpr F upper = detail::integer_upper_bound<To, F>;
+            for (std::size_t j = 0; j < in.size(); ++j)
+                misfits += !((in[j] >= lower) & (in[j] < upper) & (static_cast<F>(out[j]) == in[j]));
+        }
+        else
+        {
+            for (std::size_t j = 0; j < in.size(); ++j)
+                misfits += !fits_exactly<To>(in[j]);
+        }
+
+        if (misfits != 0)
+        {
+            for (std::size_t j = 0; j < in.size(); ++j)
+                if (!fits_exactly<To>(in[j]))
+                    throw std::range_error("convert(): element " + std::to_string(j) +
+                                           " does not fit in the destination type");
+        }
+    }
+}
+
+} // namespace numeric
@@ -0,0 +1,223 @@
+/**
+ * @file NumericConvertAvx2.cpp
+ * @author Daniel Even
+ * @brief AVX2 kernels for convert(). This file is compiled with -mavx2 and must
+ * only be called once AVX2 support has been confirmed. It deliberately calls
+ * none of the inline functions from NumericConvert.hpp so that no AVX2 copy of
+ * them can leak into the scalar path.
+ *
+ * Each kernel processes as many whole vectors as fit and returns the number of
+ * elements it wrote. The results match saturate_cast/truncate_cast exactly.
+ */
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+__m256i load(const void* p)
+{
+    return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+}
+
+void store(void* p, __m256i v)
+{
+    _mm256_storeu_si256(static_cast<__m256i*>(p), v);
+}
+
+// The 256-bit pack instructions work within each 128-bit lane, which leaves
+// the 64-bit quarters of the result in the order 0, 2, 1, 3.
+__m256i fix_pack_order(__m256i v)
+{
+    return _mm256_permute4x64_epi64(v, 0b11011000);
+}
+
+// After packing four vectors down to bytes the 32-bit groups are interleaved
+// as a0 b0 c0 d0 a1 b1 c1 d1.
+__m256i fix_double_pack_order(__m256i v)
+{
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+} // namespace
+
+namespace numeric {
+
+// Narrowing integer conversions, saturating.
+
+std::size_t convert_i32_i16_saturate_avx2(const std::int32_t* in, std::int16_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        store(out + i, fix_pack_order(_mm256_packs_epi32(load(in + i), load(in + i + 8))));
+    return i;
+}
+
+std::size_t convert_i16_i8_saturate_avx2(const std::int16_t* in, std::int8_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+        store(out + i, fix_pack_order(_mm256_packs_epi16(load(in + i), load(in + i + 16))));
+    return i;
+}
+
+std::size_t convert_i32_i8_saturate_avx2(const std::int32_t* in, std::int8_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i ab = _mm256_packs_epi32(load(in + i), load(in + i + 8));
+        const __m256i cd = _mm256_packs_epi32(load(in + i + 16), load(in + i + 24));
+        store(out + i, fix_double_pack_order(_mm256_packs_epi16(ab, cd)));
+    }
+    return i;
+}
+
+// Narrowing integer conversions, keeping the low bits. Masking first keeps
+// every value inside the unsigned pack's range, so the pack never saturates.
+
+std::size_t convert_i32_i16_truncate_avx2(const std::int32_t* in, std::int16_t* out, std::size_t count)
+{
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m256i a = _mm256_and_si256(load(in + i), mask);
+        const __m256i b = _mm256_and_si256(load(in + i + 8), mask);
+        store(out + i, fix_pack_order(_mm256_packus_epi32(a, b)));
+    }
+    return i;
+}
+
+std::size_t convert_i16_i8_truncate_avx2(const std::int16_t* in, std::int8_t* out, std::size_t count)
+{
+    const __m256i mask = _mm256_set1_epi16(0xff);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i a = _mm256_and_si256(load(in + i), mask);
+        const __m256i b = _mm256_and_si256(load(in + i + 16), mask);
+        store(out + i, fix_pack_order(_mm256_packus_epi16(a, b)));
+    }
+    return i;
+}
+
+std::size_t convert_i32_i8_truncate_avx2(const std::int32_t* in, std::int8_t* out, std::size_t count)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i ab = _mm256_packus_epi32(_mm256_and_si256(load(in + i), mask),
+                                               _mm256_and_si256(load(in + i + 8), mask));
+        const __m256i cd = _mm256_packus_epi32(_mm256_and_si256(load(in + i + 16), mask),
+                                               _mm256_and_si256(load(in + i + 24), mask));
+        store(out + i, fix_double_pack_order(_mm256_packus_epi16(ab, cd)));
+    }
+    return i;
+}
+
+// Floating point conversions.
+
+std::size_t convert_f32_i32_saturate_avx2(const float* in, std::int32_t* out, std::size_t count)
+{
+    const __m256 limit = _mm256_set1_ps(2147483648.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(in + i);
+        // VCVTTPS2DQ returns 0x80000000 for anything out of range. That is
+        // already right for large negative values; large positive values are
+        // flipped to 0x7fffffff and NaN is cleared to 0.
+        __m256i r = _mm256_cvttps_epi32(x);
+        r = _mm256_xor_si256(r, _mm256_castps_si256(_mm256_cmp_ps(x, limit, _CMP_GE_OQ)));
+        r = _mm256_and_si256(r, _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_ORD_Q)));
+        store(out + i, r);
+    }
+    return i;
+}
+
+std::size_t convert_f64_f32_saturate_avx2(const double* in, float* out, std::size_t count)
+{
+    const __m256d upper = _mm256_set1_pd(FLT_MAX);
+    const __m256d lower = _mm256_set1_pd(-FLT_MAX);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // MINPD/MAXPD return their second operand when either is NaN, so
+        // putting x second lets NaN through unchanged.
+        __m256d x = _mm256_loadu_pd(in + i);
+        x = _mm256_max_pd(lower, _mm256_min_pd(upper, x));
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(x));
+    }
+    return i;
+}
+
+std::size_t convert_f64_f32_truncate_avx2(const double* in, float* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(in + i)));
+    return i;
+}
+
+std::size_t convert_i32_f32_avx2(const std::int32_t* in, float* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(load(in + i)));
+    return i;
+}
+
+// Widening conversions.
+
+std::size_t convert_i8_i16_avx2(const std::int8_t* in, std::int16_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        store(out + i, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    return i;
+}
+
+std::size_t convert_i8_i32_avx2(const std::int8_t* in, std::int32_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        store(out + i, _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i))));
+    return i;
+}
+
+std::size_t convert_i16_i32_avx2(const std::int16_t* in, std::int32_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        store(out + i, _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    return i;
+}
+
+std::size_t convert_i32_i64_avx2(const std::int32_t* in, std::int64_t* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        store(out + i, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    return i;
+}
+
+std::size_t convert_i32_f64_avx2(const std::int32_t* in, double* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm256_storeu_pd(out + i, _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    return i;
+}
+
+std::size_t convert_f32_f64_avx2(const float* in, double* out, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+    return i;
+}
+
+} // namespace numeric
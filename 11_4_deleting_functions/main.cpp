@@ -11,8 +11,17 @@
  * exact match for parameter types, no conversion/promotion allowed. This is 
  * achieved with a function template which will take precedence over all other
  * types.
+ *
+ * NumericConvert.hpp applies both patterns to numbers: a strong typedef that
+ * only accepts its exact type, and bulk conversions where every narrowing
+ * conversion without an explicit saturate/truncate/checked mode is deleted.
  */
-#include <iostream>
+#include "NumericConvert.hpp"
+#include "OutputSink.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
 
 // Uncomment this line to attempt to call the deleted function parameter and to
 // see the resulting compiler error.
@@ -23,20 +32,34 @@
 // compiler error.
 // #define ATTEMPT_TEMPLATE_DELETED_FUNCTION
 
+// Uncomment this line to attempt a narrowing numeric conversion without
+// choosing a mode, and to construct a strong typedef from the wrong type.
+// #define ATTEMPT_NARROWING_CONVERSION
+
+// Uncomment this line to compare the SIMD conversion kernels against the scalar
+// reference conversions for edge cases and random values.
+// #define VERIFY_NUMERIC_CONVERT
+
+#ifdef VERIFY_NUMERIC_CONVERT
+#include <limits>
+#include <random>
+#include <stdexcept>
+#endif // VERIFY_NUMERIC_CONVERT
+
 /**
  * @brief Our example function
  */
-void foo(int x)
+void foo([[maybe_unused]] int x)
 {
-    std::cout << "This function should never be called with a char as a parameter." << std::endl;
+    io::out() << "This function should never be called with a char as a parameter." << io::endl;
 }
 
 /**
  * @brief Our second example function
  */
-void bar(int x)
+void bar([[maybe_unused]] int x)
 {
-    std::cout << "This function should never be called with anything other than an int as a parameter." << std::endl;
+    io::out() << "This function should never be called with anything other than an int as a parameter." << io::endl;
 }
 
 /**
@@ -53,6 +76,100 @@ void bar(T x) = delete;
 // This should block compiling if we attempt to call foo with a char.
 void foo(char) = delete; 
 
+#ifdef VERIFY_NUMERIC_CONVERT
+/**
+ * @brief Edge values of From followed by random ones. The length is odd so the
+ * scalar tail after the vector loop is exercised too.
+ */
+template <typename From>
+std::vector<From> conversion_inputs()
+{
+    using limits = std::numeric_limits<From>;
+    std::vector<From> values{limits::lowest(), limits::max(), From{0}, From{1}, From{-1}};
+    std::mt19937_64 rng(7);
+    if constexpr (std::is_floating_point_v<From>)
+    {
+        values.insert(values.end(), {limits::quiet_NaN(), limits::infinity(), -limits::infinity(),
+                                     From(2147483648.0), From(-2147483648.0), From(2147483520.0),
+                                     From(-0.5), From(0.5), From(32767.5), From(-129.9)});
+        std::uniform_real_distribution<From> wide(From(-1e10), From(1e10));
+        std::uniform_real_distribution<From> narrow(From(-70000), From(70000));
+        for (int i = 0; i < 5000; ++i)
+        {
+            values.push_back(wide(rng));
+            values.push_back(narrow(rng));
+        }
+    }
+    else
+    {
+        // uniform_int_distribution is not defined for 8-bit types.
+        std::uniform_int_distribution<std::int64_t> wide(limits::min(), limits::max());
+        std::uniform_int_distribution<std::int64_t> narrow(-300, 300);
+        for (int i = 0; i < 5000; ++i)
+        {
+            values.push_back(static_cast<From>(wide(rng)));
+            values.push_back(static_cast<From>(narrow(rng)));
+        }
+    }
+    if (values.size() % 2 == 0)
+        values.push_back(From{3});
+    return values;
+}
+
+template <typename T>
+bool same_value(T a, T b)
+{
+    // NaN only ever compares equal to NaN here.
+    return a == b || (a != a && b != b);
+}
+
+/**
+ * @brief Checks convert() in every mode against the scalar casts, and that the
+ * checked mode throws exactly when some element does not fit.
+ */
+template <typename From, typename To>
+bool verify_conversion()
+{
+    const std::vector<From> in = conversion_inputs<From>();
+    std::vector<To> out(in.size());
+    bool passed = true;
+
+    numeric::convert(std::span(in), std::span(out), numeric::saturate);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        passed &= same_value(out[i], numeric::saturate_cast<To>(in[i]));
+
+    numeric::convert(std::span(in), std::span(out), numeric::truncate);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        passed &= same_value(out[i], numeric::truncate_cast<To>(in[i]));
+
+    bool threw = false;
+    try
+    {
+        numeric::convert(std::span(in), std::span(out), numeric::checked);
+    }
+    catch (const std::range_error&)
+    {
+        threw = true;
+    }
+    bool all_fit = true;
+    for (From value : in)
+        all_fit &= numeric::fits_exactly<To>(value);
+    passed &= threw != all_fit;
+
+    if (!passed)
+        io::out() << "MISMATCH converting " << sizeof(From) << "-byte "
+                  << (std::is_floating_point_v<From> ? "float" : "int") << " to " << sizeof(To)
+                  << "-byte " << (std::is_floating_point_v<To> ? "float" : "int") << io::endl;
+    return passed;
+}
+
+template <typename From, typename... Tos>
+bool verify_conversions_from()
+{
+    return (verify_conversion<From, Tos>() && ...);
+}
+#endif // VERIFY_NUMERIC_CONVERT
+
 int main()
 {
     // Let's call foo with the intendent type of parameter, and int
@@ -78,5 +195,46 @@ int main()
     bar(true);
     bar(1.0f);
 #endif // ATTEMPT_TEMPLATE_DELETED_FUNCTION
+
+    // The same idea applied to numbers. Widening never loses anything, so it
+    // needs no mode:
+    const std::vector<std::int16_t> samples{-300, -1, 0, 1, 127, 300};
+    std::vector<std::int32_t> widened(samples.size());
+    numeric::convert(std::span(samples), std::span(widened));
+
+    // Narrowing has to say what to do with values that do not fit.
+    std::vector<std::int8_t> narrowed(samples.size());
+    numeric::convert(std::span(samples), std::span(narrowed), numeric::saturate);
+    io::out() << "saturated:";
+    for (std::int8_t value : narrowed)
+        io::out() << " " << static_cast<int>(value);
+    io::out() << io::endl;
+
+    numeric::convert(std::span(samples), std::span(narrowed), numeric::truncate);
+    io::out() << "truncated:";
+    for (std::int8_t value : narrowed)
+        io::out() << " " << static_cast<int>(value);
+    io::out() << io::endl;
+
+    const numeric::Int32 total = numeric::Int32(std::int32_t{40}) + numeric::Int32(std::int32_t{2});
+    io::out() << "Int32 total: " << total.get() << io::endl;
+
+#ifdef ATTEMPT_NARROWING_CONVERSION
+    // Both of these resolve to deleted functions:
+    numeric::convert(std::span(samples), std::span(narrowed));
+    numeric::Int16 small(97);
+#endif // ATTEMPT_NARROWING_CONVERSION
+
+#ifdef VERIFY_NUMERIC_CONVERT
+    using std::int8_t, std::int16_t, std::int32_t, std::int64_t;
+    const bool passed =
+        verify_conversions_from<int8_t, int8_t, int16_t, int32_t, int64_t, float, double>() &&
+        verify_conversions_from<int16_t, int8_t, int16_t, int32_t, int64_t, float, double>() &&
+        verify_conversions_from<int32_t, int8_t, int16_t, int32_t, int64_t, float, double>() &&
+        verify_conversions_from<int64_t, int8_t, int16_t, int32_t, int64_t, float, double>() &&
+        verify_conversions_from<float, int8_t, int16_t, int32_t, int64_t, float, double>() &&
+        verify_conversions_from<double, int8_t, int16_t, int32_t, int64_t, float, double>();
+    io::out() << "numeric conversion kernels: " << (passed ? "PASSED" : "FAILED") << io::endl;
+#endif // VERIFY_NUMERIC_CONVERT
 }
 
@@ -0,0 +1,65 @@
+/**
+ * @file ConstantMult.cpp
+ * @author Daniel Even
+ * @brief The batch paths of FixedMultiplier and FixedDivisor. Whole vectors are
+ * handed to the AVX2 kernels when the CPU supports them and whatever is left
+ * over is finished with the scalar code from the header.
+ */
+#include "ConstantMult.hpp"
+#include "CpuDispatch.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+// Defined in ConstantMultAvx2.cpp. Each processes as many whole 8-element
+// vectors as fit and returns the number of elements it wrote.
+std::size_t fixed_mult_avx2(const std::int32_t* in, std::int32_t* out,
+                            std::size_t count, std::int32_t multiplier);
+std::size_t fixed_divide_avx2(const std::int32_t* in, std::int32_t* out,
+                              std::size_t count, const DivisionMagic& magic);
+#endif
+
+namespace {
+
+void check_sizes(std::span<const std::int32_t> in, std::span<std::int32_t> out)
+{
+    if (in.size() != out.size())
+        throw std::invalid_argument("input and output spans differ in size");
+}
+
+} // namespace
+
+void FixedMultiplier::mult(std::span<const std::int32_t> in, std::span<std::int32_t> out) const
+{
+    check_sizes(in, out);
+
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::supported(cpu::Isa::avx2))
+        done = fixed_mult_avx2(in.data(), out.data(), in.size(), multiplier_);
+#endif
+    for (std::size_t i = done; i < in.size(); ++i)
+        out[i] = mult(in[i]);
+}
+
+FixedDivisor::FixedDivisor(std::int32_t divisor) : divisor_(divisor)
+{
+    if (divisor == 0)
+        throw std::invalid_argument("FixedDivisor: divisor must not be zero");
+    if (divisor != 1 && divisor != -1)
+        magic_ = compute_division_magic(divisor);
+}
+
+void FixedDivisor::divide(std::span<const std::int32_t> in, std::span<std::int32_t> out) const
+{
+    check_sizes(in, out);
+
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::supported(cpu::Isa::avx2) && divisor_ != 1 && divisor_ != -1)
+        done = fixed_divide_avx2(in.data(), out.data(), in.size(), magic_);
+#endif
+    for (std::size_t i = done; i < in.size(); ++i)
+        out[i] = divide(in[i]);
+}
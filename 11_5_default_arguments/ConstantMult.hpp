@@ -0,0 +1,226 @@
+/**
+ * @file ConstantMult.hpp
+ * @author Daniel Even
+ * @brief Specializations of mult for multipliers that are known ahead of time.
+ * In practice mult(num1, num2) is almost always called with a num2 that is
+ * either a compile-time constant or fixed for a whole batch of calls. Both
+ * cases allow the multiplication (and division) to be strength-reduced:
+ *
+ * 1) Known at compile time: mult<K>(x) and divide<K>(x) take the constant as a
+ * non-type template parameter and pick shifts, adds or a magic-number
+ * reciprocal with if constexpr.
+ *
+ * 2) Known at runtime but fixed for a batch: FixedMultiplier and FixedDivisor
+ * do the expensive work (computing the reciprocal) once in the constructor and
+ * then apply it to whole arrays, using AVX2 when the CPU has it.
+ *
+ * Overload resolution: mult<K> is a function template whose only template
+ * parameter cannot be deduced, so a plain call like mult(10) or mult(10, 3)
+ * can never select it. Those calls still resolve to mult(int, int = 2) exactly
+ * as before, and mult<3>(10) can only resolve to the template.
+ *
+ * Signed overflow wraps in all of these, computing in unsigned arithmetic.
+ */
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief The multiplier and shift used to replace a signed 32-bit division by d
+ * with a multiply-high, as described in Hacker's Delight (section 10-4). The
+ * add/subtract flags record the correction needed when the magic number's sign
+ * differs from the divisor's.
+ */
+struct DivisionMagic
+{
+    std::int32_t multiplier;
+    int shift;
+    bool add_dividend;
+    bool subtract_dividend;
+};
+
+/**
+ * @brief Computes the DivisionMagic for a divisor with |d| >= 2.
+ */
+constexpr DivisionMagic compute_division_magic(std::int32_t d)
+{
+    constexpr std::uint32_t two31 = 0x80000000u;
+
+    const std::uint32_t ad = d < 0 ? 0u - static_cast<std::uint32_t>(d)
+                                   : static_cast<std::uint32_t>(d);
+    const std::uint32_t t = two31 + (static_cast<std::uint32_t>(d) >> 31);
+    const std::uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    std::uint32_t q1 = two31 / anc;
+    std::uint32_t r1 = two31 - q1 * anc;
+    std::uint32_t q2 = two31 / ad;
+    std::uint32_t r2 = two31 - q2 * ad;
+    std::uint32_t delta = 0;
+
+    do
+    {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    std::uint32_t magic = q2 + 1;
+    if (d < 0)
+        magic = 0u - magic;
+
+    const auto multiplier = static_cast<std::int32_t>(magic);
+    return DivisionMagic{multiplier, p - 32, d > 0 && multiplier < 0,
+                         d < 0 && multiplier > 0};
+}
+
+/**
+ * @brief Applies a DivisionMagic: n / d rounded toward zero, like the built-in
+ * '/' operator.
+ */
+constexpr std::int32_t apply_division_magic(std::int32_t n, const DivisionMagic& magic)
+{
+    const std::int64_t product = static_cast<std::int64_t>(n) * magic.multiplier;
+    auto q = static_cast<std::int32_t>(product >> 32);
+    if (magic.add_dividend)
+        q = static_cast<std::int32_t>(static_cast<std::uint32_t>(q) + static_cast<std::uint32_t>(n));
+    if (magic.subtract_dividend)
+        q = static_cast<std::int32_t>(static_cast<std::uint32_t>(q) - static_cast<std::uint32_t>(n));
+    q >>= magic.shift;
+    return q + static_cast<std::int32_t>(static_cast<std::uint32_t>(q) >> 31);
+}
+
+/**
+ * @brief mult with a compile-time multiplier. Powers of two become a single
+ * shift, multipliers with two bits set become two shifts and an add, and
+ * multipliers of the form 2^n - 1 become a shift and a subtract. Anything else
+ * is left as a multiply, which the compiler will still lower to LEA sequences
+ * where profitable.
+ */
+template <std::int32_t K>
+constexpr std::int32_t mult(std::int32_t num1)
+{
+    constexpr std::uint32_t k = K < 0 ? 0u - static_cast<std::uint32_t>(K)
+                                      : static_cast<std::uint32_t>(K);
+    const auto x = static_cast<std::uint32_t>(num1);
+    std::uint32_t result = 0;
+
+    if constexpr (k == 0)
+        result = 0;
+    else if constexpr (std::has_single_bit(k))
+        result = x << std::countr_zero(k);
+    else if constexpr (std::popcount(k) == 2)
+        result = (x << (std::bit_width(k) - 1)) + (x << std::countr_zero(k));
+    else if constexpr (std::has_single_bit(k + 1))
+        result = (x << std::bit_width(k)) - x;
+    else
+        result = x * k;
+
+    return static_cast<std::int32_t>(K < 0 ? 0u - result : result);
+}
+
+/**
+ * @brief Division by a compile-time divisor, rounding toward zero. Powers of two
+ * become a shift with a sign fix-up and every other divisor becomes a
+ * multiply-high by a magic number computed while compiling.
+ */
+template <std::int32_t K>
+constexpr std::int32_t divide(std::int32_t num1)
+{
+    static_assert(K != 0, "divide(): K must not be zero");
+
+    if constexpr (K == 1)
+        return num1;
+    else if constexpr (K == -1)
+        return static_cast<std::int32_t>(0u - static_cast<std::uint32_t>(num1));
+    else if constexpr (K > 0 && std::has_single_bit(static_cast<std::uint32_t>(K)))
+    {
+        // Arithmetic shifts round toward negative infinity, so negative
+        // dividends are biased by K - 1 first.
+        constexpr int shift = std::countr_zero(static_cast<std::uint32_t>(K));
+        const std::int32_t bias = (num1 >> 31) & (K - 1);
+        return (num1 + bias) >> shift;
+    }
+    else
+    {
+        constexpr DivisionMagic magic = compute_division_magic(K);
+        return apply_division_magic(num1, magic);
+    }
+}
+
+/**
+ * @brief A multiplier fixed at runtime and applied to whole arrays.
+ */
+class FixedMultiplier
+{
+public:
+    explicit FixedMultiplier(std::int32_t multiplier) : multiplier_(multiplier) {}
+
+    std::int32_t multiplier() const { return multiplier_; }
+
+    std::int32_t mult(std::int32_t num1) const
+    {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(num1) *
+                                         static_cast<std::uint32_t>(multiplier_));
+    }
+
+    /**
+     * @brief out[i] = in[i] * multiplier().
+     *
+     * @throws std::invalid_argument if the spans differ in size.
+     */
+    void mult(std::span<const std::int32_t> in, std::span<std::int32_t> out) const;
+
+private:
+    std::int32_t multiplier_;
+};
+
+/**
+ * @brief A divisor fixed at runtime, libdivide style. The constructor computes
+ * the magic number once; every division after that is a multiply, a shift and
+ * an add.
+ */
+class FixedDivisor
+{
+public:
+    /**
+     * @throws std::invalid_argument if divisor is zero.
+     */
+    explicit FixedDivisor(std::int32_t divisor);
+
+    std::int32_t divisor() const { return divisor_; }
+
+    std::int32_t divide(std::int32_t num1) const
+    {
+        if (divisor_ == 1)
+            return num1;
+        if (divisor_ == -1)
+            return static_cast<std::int32_t>(0u - static_cast<std::uint32_t>(num1));
+        return apply_division_magic(num1, magic_);
+    }
+
+    /**
+     * @brief out[i] = in[i] / divisor(), rounded toward zero.
+     *
+     * @throws std::invalid_argument if the spans differ in size.
+     */
+    void divide(std::span<const std::int32_t> in, std::span<std::int32_t> out) const;
+
+private:
+    std::int32_t divisor_;
+    DivisionMagic magic_{};
+};
@@ -0,0 +1,54 @@
+/**
+ * @file ConstantMultAvx2.cpp
+ * @author Daniel Even
+ * @brief AVX2 kernels for FixedMultiplier and FixedDivisor. This file is
+ * compiled with -mavx2 and must only be called once AVX2 support has been
+ * confirmed. It deliberately calls none of the inline functions from
+ * ConstantMult.hpp so that no AVX2 copy of them can leak into the scalar path.
+ */
+#include "ConstantMult.hpp"
+
+#include <cstddef>
+#include <immintrin.h>
+
+std::size_t fixed_mult_avx2(const std::int32_t* in, std::int32_t* out,
+                            std::size_t count, std::int32_t multiplier)
+{
+    const __m256i k = _mm256_set1_epi32(multiplier);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(x, k));
+    }
+    return i;
+}
+
+std::size_t fixed_divide_avx2(const std::int32_t* in, std::int32_t* out,
+                              std::size_t count, const DivisionMagic& magic)
+{
+    const __m256i multiplier = _mm256_set1_epi32(magic.multiplier);
+    const __m128i shift = _mm_cvtsi32_si128(magic.shift);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+
+        // AVX2 has no 32-bit multiply-high, so the even and odd lanes are
+        // multiplied separately into 64-bit products and the high halves are
+        // blended back together.
+        const __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(n, multiplier), 32);
+        const __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(n, 32), multiplier);
+        __m256i q = _mm256_blend_epi32(even, odd, 0b10101010);
+
+        if (magic.add_dividend)
+            q = _mm256_add_epi32(q, n);
+        if (magic.subtract_dividend)
+            q = _mm256_sub_epi32(q, n);
+        q = _mm256_sra_epi32(q, shift);
+        q = _mm256_add_epi32(q, _mm256_srli_epi32(q, 31));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), q);
+    }
+    return i;
+}
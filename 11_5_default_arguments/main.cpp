@@ -17,26 +17,79 @@
  * lead to situations where an otherwise clear match leads to an ambiguous
  * match.
  * 
+ * 3) Overloading with a function template that has a non-deducible template
+ * parameter is a way around this. ConstantMult.hpp adds mult<K>(num1), which
+ * can only be selected by naming K explicitly, so it never competes with
+ * mult(num1) or mult(num1, num2). See the AMBIGUOUS_MATCH example below for
+ * what happens with a plain overload instead.
+ *
+ * @note Memoize.hpp wraps a pure function such as mult in memo::memoize, which
+ * serves repeated arguments from a cache that many threads can read at once.
+ *
+ * @note Run with "--stream [FILE [NUM2]]" to multiply every number in FILE (or
+ * stdin) by NUM2, which defaults to 2 just like mult's. FILE may also be an
+ * int32 column file (see ColumnFile.hpp). See run_stream() below.
+ *
  */
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
 #include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ColumnFile.hpp"
+#include "ConstantMult.hpp"
+#include "DefaultArguments.hpp"
+#include "Memoize.hpp"
+#include "NumberStream.hpp"
+#include "OutputSink.hpp"
 
 // Uncomment this line to demonstrate how a somewhat unexpected ambiguous match
 // can arise when overloading 
 // #define AMBIGUOUS_MATCH
 
-/**
- * @brief A trivial multiplication function to demonstrate the use of a default
- * argument
- * 
- * @note The default value can be supplied here or in the function definition,
- * but not in both.
- */
-int mult(int num1, int num2 = 2);
+// Uncomment this line to check mult<K>, divide<K>, FixedMultiplier and
+// FixedDivisor against the built-in operators.
+// #define VERIFY_CONSTANT_MULT
 
-int mult(int num1, int num2)
-{
-    return num1 * num2;
-}
+#ifdef VERIFY_CONSTANT_MULT
+#include <cstdint>
+#include <limits>
+#include <random>
+#endif // VERIFY_CONSTANT_MULT
+
+// Uncomment this line to check memo::memoize against mult from several threads
+// at once, with a cache small enough to keep evicting, and its counters.
+// Scaling over Zipf-distributed arguments is measured by cpp_concepts_bench.
+// #define VERIFY_MEMOIZE
+
+#ifdef VERIFY_MEMOIZE
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#endif // VERIFY_MEMOIZE
+
+// Uncomment this line to check that NumberReader carries a number cut off by
+// the end of a read() block over to the next one, and rejects one that is too
+// long to carry instead of cutting it short.
+// #define VERIFY_NUMBER_STREAM
+
+#ifdef VERIFY_NUMBER_STREAM
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#endif // VERIFY_NUMBER_STREAM
+
+// mult(num1, num2 = 2) is declared in DefaultArguments.hpp and defined in the
+// cpp_concepts_core library. The default argument lives on that declaration,
+// since it is the caller that fills it in.
 
 #ifdef AMBIGUOUS_MATCH
 // This specific function signature triggers an ambiguous match error because 
@@ -49,11 +102,328 @@ int mult(int num)
 #endif // AMBIGUOUS_MATCH
 
 
-int main()
+#ifdef VERIFY_CONSTANT_MULT
+/**
+ * @brief Compares divide<K> and FixedDivisor(K), scalar and batch, against the
+ * '/' operator for the extreme dividends and a set of random ones.
+ */
+template <std::int32_t K>
+bool verify_divisor(const std::vector<std::int32_t>& dividends)
+{
+    const FixedDivisor divisor(K);
+    std::vector<std::int32_t> batch(dividends.size());
+    divisor.divide(dividends, batch);
+
+    for (std::size_t i = 0; i < dividends.size(); ++i)
+    {
+        const std::int32_t n = dividends[i];
+        // INT_MIN / -1 overflows, so it is skipped.
+        if (K == -1 && n == std::numeric_limits<std::int32_t>::min())
+            continue;
+        const std::int32_t expected = n / K;
+        if (divide<K>(n) != expected || divisor.divide(n) != expected || batch[i] != expected)
+        {
+            io::out() << "MISMATCH: " << n << " / " << K << io::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <std::int32_t... Ks>
+bool verify_divisors(const std::vector<std::int32_t>& dividends)
+{
+    return (verify_divisor<Ks>(dividends) && ...);
+}
+
+/**
+ * @brief Compares every FixedDivisor for divisors in [-1000, 1000] against '/'.
+ */
+bool verify_runtime_divisors(const std::vector<std::int32_t>& dividends)
+{
+    std::vector<std::int32_t> batch(dividends.size());
+    for (std::int32_t d = -1000; d <= 1000; ++d)
+    {
+        if (d == 0 || d == -1)
+            continue;
+        const FixedDivisor divisor(d);
+        divisor.divide(dividends, batch);
+        for (std::size_t i = 0; i < dividends.size(); ++i)
+        {
+            if (batch[i] != dividends[i] / d)
+            {
+                io::out() << "MISMATCH: " << dividends[i] << " / " << d << io::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#endif // VERIFY_CONSTANT_MULT
+
+#ifdef VERIFY_MEMOIZE
+/**
+ * @brief Calls a memoized mult from four threads with arguments drawn from a
+ * skewed set larger than the cache, and compares every result with mult.
+ */
+bool verify_memoize()
+{
+    constexpr int threads = 4;
+    constexpr int calls = 200'000;
+    memo::memoize cached_mult([](int num1, int num2) { return mult(num1, num2); }, 1024);
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&cached_mult, &mismatches, t] {
+            std::mt19937 rng(static_cast<unsigned>(t));
+            // Most arguments are small, but there are 2 * 4096 pairs in all.
+            std::geometric_distribution<int> num1(0.01);
+            std::uniform_int_distribution<int> num2(-1, 0);
+            for (int i = 0; i < calls; ++i)
+            {
+                const int a = num1(rng) % 4096;
+                const int b = num2(rng) == 0 ? 3 : -3;
+                if (cached_mult(a, b) != mult(a, b))
+                    mismatches.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    const memo::CacheStats stats = cached_mult.stats();
+    io::out() << "memoize(mult): " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions
+        << " evictions over " << cached_mult.cache().shard_count() << " shards" << io::endl;
+
+    bool rejected = false;
+    try
+    {
+        memo::ConcurrentCache<int, int> empty(0);
+    }
+    catch (const std::invalid_argument&)
+    {
+        rejected = true;
+    }
+    return mismatches.load() == 0 && stats.hits + stats.misses == std::uint64_t{threads} * calls &&
+           stats.evictions > 0 && stats.hits > stats.misses && rejected;
+}
+#endif // VERIFY_MEMOIZE
+
+#ifdef VERIFY_NUMBER_STREAM
+/**
+ * @brief Feeds "0" lines and then a 300-digit 1e299 through a pipe, so that
+ * NumberReader reads blocks instead of mapping the input, with the number
+ * starting 'prefix' bytes before the end of the first 1 MiB block. Returns
+ * everything read, or rethrows what read() threw.
+ */
+std::vector<double> read_split_number(std::size_t prefix)
+{
+    constexpr std::size_t block_size = std::size_t{1} << 20;
+    std::string text;
+    for (std::size_t i = 0; i < (block_size - prefix) / 2; ++i)
+        text += "0\n";
+    text += '1';
+    text.append(299, '0');
+    text += '\n';
+
+    int fds[2];
+    if (::pipe(fds) != 0)
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    std::thread writer([&] {
+        for (std::size_t done = 0; done < text.size();)
+        {
+            const ssize_t n = ::write(fds[1], text.data() + done, text.size() - done);
+            if (n <= 0)
+                break;
+            done += static_cast<std::size_t>(n);
+        }
+        ::close(fds[1]);
+    });
+
+    // The reader opens its own descriptor, so the writer never sees a closed
+    // pipe, and at most the end of the text is left in the pipe if it throws.
+    std::vector<double> values;
+    std::exception_ptr failure;
+    try
+    {
+        io::NumberReader reader("/dev/fd/" + std::to_string(fds[0]));
+        std::vector<double> batch(io::default_batch);
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+            values.insert(values.end(), batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
+    writer.join();
+    ::close(fds[0]);
+    if (failure)
+        std::rethrow_exception(failure);
+    return values;
+}
+
+/**
+ * @brief A number whose first 200 bytes are in the first block is carried
+ * over and read whole; one with 280 bytes there is longer than NumberReader
+ * can carry, and must be rejected rather than split into two numbers.
+ */
+bool verify_number_stream()
+{
+    const std::vector<double> carried = read_split_number(200);
+    const bool carried_whole = carried.size() == ((std::size_t{1} << 20) - 200) / 2 + 1 && carried.back() == 1e299;
+
+    bool rejected = false;
+    try
+    {
+        const std::vector<double> cut = read_split_number(280);
+        io::out() << "300-digit number read as " << cut.size() - ((std::size_t{1} << 20) - 280) / 2 << " numbers" << io::endl;
+    }
+    catch (const std::invalid_argument& error)
+    {
+        io::out() << "300-digit number: " << error.what() << io::endl;
+        rejected = true;
+    }
+    return carried_whole && rejected;
+}
+#endif // VERIFY_NUMBER_STREAM
+
+/**
+ * @brief The streaming mode. Reads the input one batch at a time, multiplies
+ * each batch with a FixedMultiplier and writes the products one per line.
+ * Memory use does not depend on the size of the input.
+ */
+int run_stream(int argc, char* argv[])
+{
+    std::int32_t num2 = 2;
+    bool valid = argc <= 4;
+    if (valid && argc > 3)
+    {
+        const std::string_view text = argv[3];
+        const auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), num2);
+        valid = error == std::errc{} && last == text.data() + text.size();
+    }
+    if (!valid)
+    {
+        std::cerr << "usage: " << argv[0] << " --stream [FILE [NUM2]]" << std::endl;
+        return 2;
+    }
+
+    try
+    {
+        const std::string path = argc > 2 ? argv[2] : "-";
+        const FixedMultiplier multiplier(num2);
+        std::vector<std::int32_t> products(io::default_batch);
+
+        // A column is multiplied straight out of the mapping, a batch at a
+        // time so the products stay in cache until they are written.
+        if (io::is_column_file(path))
+        {
+            const io::ColumnFile file(path);
+            std::span<const std::int32_t> values = file.values<std::int32_t>();
+            while (!values.empty())
+            {
+                const std::size_t n = std::min(values.size(), products.size());
+                multiplier.mult(values.first(n), std::span(products.data(), n));
+                io::write_numbers(stdout, std::span<const std::int32_t>(products.data(), n));
+                values = values.subspan(n);
+            }
+            return 0;
+        }
+
+        io::NumberReader reader(path);
+        std::vector<std::int32_t> batch(io::default_batch);
+
+        while (const std::size_t n = reader.read(std::span<std::int32_t>(batch)))
+        {
+            multiplier.mult(std::span<const std::int32_t>(batch.data(), n), std::span(products.data(), n));
+            io::write_numbers(stdout, std::span<const std::int32_t>(products.data(), n));
+        }
+        return 0;
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string_view(argv[1]) == "--stream")
+        return run_stream(argc, argv);
+
+
     // We'll demonstrate this by calling our function with only one parameter.
-    std::cout << "mult(10)=" << mult(10) << std::endl;
+    io::out() << "mult(10)=" << mult(10) << io::endl;
 
     // Now we'll try it with both parameters included.
-    std::cout << "mult(10, 3)=" << mult(10, 3) << std::endl;
+    io::out() << "mult(10, 3)=" << mult(10, 3) << io::endl;
+
+    // The multiplier can also be passed as a template argument, which lets the
+    // compiler replace the multiplication with shifts and adds. Note that this
+    // does not conflict with either call above.
+    io::out() << "mult<3>(10)=" << mult<3>(10) << io::endl;
+    io::out() << "divide<7>(100)=" << divide<7>(100) << io::endl;
+
+    // A pure function called with the same arguments again and again can have
+    // its results cached. mult is an overload set, so it is wrapped in a lambda.
+    memo::memoize cached_mult([](int num1, int num2) { return mult(num1, num2); }, 256);
+    cached_mult(10, 3);
+    io::out() << "cached mult(10, 3)=" << cached_mult(10, 3) << " (" << cached_mult.stats().hits
+        << " hit after the first call)" << io::endl;
+
+    // When the multiplier or divisor is only known at runtime but is the same
+    // for a whole batch, the fixed versions do the setup once.
+    const std::vector<int> batch{10, 20, 30, 40, 50, 60, 70, 80, 90};
+    std::vector<int> results(batch.size());
+    FixedDivisor(7).divide(batch, results);
+    io::out() << "Dividing a batch by 7:";
+    for (int result : results)
+        io::out() << " " << result;
+    io::out() << io::endl;
+
+#ifdef VERIFY_CONSTANT_MULT
+    std::vector<std::int32_t> dividends{std::numeric_limits<std::int32_t>::min(),
+                                        std::numeric_limits<std::int32_t>::min() + 1,
+                                        -1, 0, 1,
+                                        std::numeric_limits<std::int32_t>::max() - 1,
+                                        std::numeric_limits<std::int32_t>::max()};
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<std::int32_t> dist(std::numeric_limits<std::int32_t>::min(),
+                                                     std::numeric_limits<std::int32_t>::max());
+    for (int i = 0; i < 10'000; ++i)
+        dividends.push_back(dist(rng));
+
+    FixedMultiplier multiplier(-37);
+    std::vector<std::int32_t> products(dividends.size());
+    multiplier.mult(dividends, products);
+    bool passed = true;
+    for (std::size_t i = 0; i < dividends.size(); ++i)
+    {
+        const auto expected = static_cast<std::int32_t>(static_cast<std::uint32_t>(dividends[i]) * static_cast<std::uint32_t>(-37));
+        passed = passed && products[i] == expected && mult<-37>(dividends[i]) == expected;
+    }
+
+    passed = passed &&
+             verify_divisors<1, -1, 2, -2, 3, 7, -7, 8, 10, 16, 125, 641, -1000,
+                             std::numeric_limits<std::int32_t>::max(),
+                             std::numeric_limits<std::int32_t>::min()>(dividends) &&
+             verify_runtime_divisors(dividends);
+    io::out() << "Constant mult/divide match the built-in operators: "
+        << (passed ? "yes" : "NO") << io::endl;
+#endif // VERIFY_CONSTANT_MULT
+
+#ifdef VERIFY_MEMOIZE
+    const bool memoize_passed = verify_memoize();
+    io::out() << "memoize(mult) matches mult from several threads: " << (memoize_passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_MEMOIZE
+
+#ifdef VERIFY_NUMBER_STREAM
+    const bool number_stream_passed = verify_number_stream();
+    io::out() << "NumberReader handles numbers split across blocks: " << (number_stream_passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_NUMBER_STREAM
 }
@@ -0,0 +1,366 @@
+/**
+ * @file ArrayExpression.hpp
+ * @author Daniel Even
+ * @brief add, mult and max over whole arrays, fused into a single loop with
+ * expression templates.
+ *
+ * Applied to arrays one step at a time, max(add(a, mult(b, 3)), c) computes
+ * mult(b, 3) into a temporary array, adds a to it into a second one, and takes
+ * the max with c into a third: three allocations and three passes over
+ * memory. Here the same call computes nothing. Each of add, mult and max
+ * returns a small object that only records its operation and refers to its
+ * operands, so the whole expression becomes a tree of types, e.g.
+ *
+ *     Binary<Max, Binary<Add, View<double>, Binary<Mult, View<double>, Scalar<int>>>, View<double>>
+ *
+ * The work happens when the tree is assigned to an Array (or evaluate()d into
+ * a std::span): a single loop computes element i of the whole expression, for
+ * every i, straight into the destination. The compiler inlines the tree into
+ * the loop body and vectorizes it, no intermediate array is ever allocated, and
+ * each input is read from memory once. An expression of k operations over
+ * arrays too large for the cache therefore moves roughly 1/k as many bytes as
+ * the step-by-step version.
+ *
+ * Operands are Arrays, view()s of any contiguous range (std::vector,
+ * std::array, std::span), other expressions, and plain numbers, which stand for
+ * an array filled with that number:
+ *
+ *     array_expr::Array<double> result = max(add(view(a), mult(view(b), 3)), view(c));
+ *
+ * The operations are found by argument-dependent lookup, so an unqualified
+ * call works as soon as one operand is from this namespace. Like mult() in
+ * 11_5_default_arguments, mult(x) multiplies by 2.
+ *
+ * @note Expressions refer to their array operands, they do not copy them. An
+ * expression must not outlive its operands, so store it with auto only within
+ * the statement or scope that owns them.
+ *
+ * @note Every element is computed from elements at the same index only, so an
+ * expression may be assigned to one of its own operands (a = add(a, b)). The
+ * destination must not partially overlap an operand, e.g. be a subspan of it
+ * shifted by a few elements.
+ */
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace array_expr {
+
+/**
+ * @brief The base of every expression type. Only used to recognize them.
+ */
+struct ExpressionBase
+{
+};
+
+template <typename T>
+concept Expression = std::derived_from<std::remove_cvref_t<T>, ExpressionBase>;
+
+/**
+ * @brief A number that takes part in an expression as if it were an array of
+ * any length filled with it.
+ */
+template <typename T>
+concept ScalarOperand = std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+template <typename T>
+concept Operand = Expression<T> || ScalarOperand<T>;
+
+/**
+ * @brief A read-only view of a contiguous array.
+ */
+template <typename T>
+class View : public ExpressionBase
+{
+public:
+    using value_type = T;
+
+    explicit View(std::span<const T> values) : values_(values) {}
+
+    std::size_t size() const { return values_.size(); }
+    T operator[](std::size_t i) const { return values_[i]; }
+
+private:
+    std::span<const T> values_;
+};
+
+template <typename T>
+class Scalar : public ExpressionBase
+{
+public:
+    using value_type = T;
+
+    explicit Scalar(T value) : value_(value) {}
+
+    // A scalar has no length of its own; it takes the length of the arrays
+    // around it.
+    static constexpr bool sized = false;
+
+    std::size_t size() const { return 0; }
+    T operator[](std::size_t) const { return value_; }
+
+private:
+    T value_;
+};
+
+/**
+ * @brief The view of any contiguous range of numbers.
+ */
+template <typename Range>
+    requires std::is_arithmetic_v<std::remove_cvref_t<decltype(*std::data(std::declval<const Range&>()))>>
+auto view(const Range& values)
+{
+    using T = std::remove_cvref_t<decltype(*std::data(values))>;
+    return View<T>(std::span<const T>(std::data(values), std::size(values)));
+}
+
+namespace detail {
+
+template <typename E>
+constexpr bool is_sized()
+{
+    if constexpr (requires { E::sized; })
+        return E::sized;
+    else
+        return true;
+}
+
+/**
+ * @brief How an operand is stored in an expression: Arrays as Views,
+ * other expressions by value (they are a few pointers and lengths at most),
+ * numbers as Scalars.
+ */
+template <typename T>
+auto as_expression(const T& operand)
+{
+    if constexpr (requires { operand.view(); })
+        return operand.view();
+    else if constexpr (Expression<T>)
+        return operand;
+    else
+        return Scalar<T>(operand);
+}
+
+template <typename T>
+using expression_t = decltype(as_expression(std::declval<const T&>()));
+
+// The operations, named after the functions that combine two values in
+// 11_5_default_arguments and 11_6_function_templates.
+struct Add
+{
+    template <typename T>
+    static T apply(T x, T y)
+    {
+        return x + y;
+    }
+};
+
+struct Mult
+{
+    template <typename T>
+    static T apply(T x, T y)
+    {
+        return x * y;
+    }
+};
+
+// The same comparison as max<T> in main.cpp, so a NaN in x is kept and one in
+// y is not.
+struct Max
+{
+    template <typename T>
+    static T apply(T x, T y)
+    {
+        return (x < y) ? y : x;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief One operation applied element by element to two operands. The values
+ * are converted to their common type first, so mult(ints, 0.5) is an
+ * expression of doubles.
+ *
+ * @throws std::invalid_argument from the constructor if both operands are
+ * arrays and their lengths differ.
+ */
+template <typename Op, Expression L, Expression R>
+class Binary : public ExpressionBase
+{
+public:
+    using value_type = std::common_type_t<typename L::value_type, typename R::value_type>;
+
+    static constexpr bool sized = detail::is_sized<L>() || detail::is_sized<R>();
+
+    Binary(const L& left, const R& right) : left_(left), right_(right)
+    {
+        if constexpr (detail::is_sized<L>() && detail::is_sized<R>())
+        {
+            if (left_.size() != right_.size())
+                throw std::invalid_argument("array_expr: the operands have different lengths");
+        }
+    }
+
+    std::size_t size() const
+    {
+        if constexpr (detail::is_sized<L>())
+            return left_.size();
+        else
+            return right_.size();
+    }
+
+    value_type operator[](std::size_t i) const
+    {
+        return Op::apply(static_cast<value_type>(left_[i]), static_cast<value_type>(right_[i]));
+    }
+
+private:
+    L left_;
+    R right_;
+};
+
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+auto add(const L& left, const R& right)
+{
+    using Left = detail::expression_t<L>;
+    using Right = detail::expression_t<R>;
+    return Binary<detail::Add, Left, Right>(detail::as_expression(left), detail::as_expression(right));
+}
+
+template <Operand L, Operand R = int>
+    requires(Expression<L> || Expression<R>)
+auto mult(const L& left, const R& right = 2)
+{
+    using Left = detail::expression_t<L>;
+    using Right = detail::expression_t<R>;
+    return Binary<detail::Mult, Left, Right>(detail::as_expression(left), detail::as_expression(right));
+}
+
+template <Operand L, Operand R>
+    requires(Expression<L> || Expression<R>)
+auto max(const L& left, const R& right)
+{
+    using Left = detail::expression_t<L>;
+    using Right = detail::expression_t<R>;
+    return Binary<detail::Max, Left, Right>(detail::as_expression(left), detail::as_expression(right));
+}
+
+/**
+ * @brief Computes every element of 'expression' into 'out' in one loop.
+ *
+ * @throws std::invalid_argument if the lengths differ. An expression made of
+ * numbers only fills all of 'out'.
+ */
+template <typename T, Expression E>
+void evaluate(const E& expression, std::span<T> out)
+{
+    if (detail::is_sized<E>() && expression.size() != out.size())
+        throw std::invalid_argument("array_expr: the destination has a different length");
+
+    const std::size_t count = out.size();
+    T* const data = out.data();
+    // Element i only depends on element i of each operand (see the note at the
+    // top), so the loops can be vectorized without checking for overlap. The
+    // blocks have a fixed length so that -O2, which does not vectorize loops
+    // that need a scalar remainder, vectorizes the inner loop too.
+    constexpr std::size_t block = 16;
+    std::size_t i = 0;
+    for (; i + block <= count; i += block)
+    {
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#elif defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#endif
+        for (std::size_t j = i; j < i + block; ++j)
+            data[j] = static_cast<T>(expression[j]);
+    }
+    for (; i < count; ++i)
+        data[i] = static_cast<T>(expression[i]);
+}
+
+/**
+ * @brief An owning array that expressions can be assigned to. It is also an
+ * operand itself.
+ */
+template <typename T>
+class Array : public ExpressionBase
+{
+public:
+    using value_type = T;
+
+    Array() = default;
+
+    explicit Array(std::size_t count, T value = T{}) : values_(count, value) {}
+
+    Array(std::initializer_list<T> values) : values_(values) {}
+
+    explicit Array(std::vector<T> values) : values_(std::move(values)) {}
+
+    template <Expression E>
+        requires(!std::same_as<std::remove_cvref_t<E>, Array>)
+    Array(const E& expression) : values_(expression.size())
+    {
+        evaluate(expression, std::span<T>(values_));
+    }
+
+    /**
+     * @brief Evaluates 'expression' into this array. Only allocates if the
+     * length changes, and then before any element is computed, so the
+     * expression may still read this array.
+     */
+    template <Expression E>
+        requires(!std::same_as<std::remove_cvref_t<E>, Array>)
+    Array& operator=(const E& expression)
+    {
+        if (expression.size() == values_.size())
+            evaluate(expression, std::span<T>(values_));
+        else
+        {
+            std::vector<T> values(expression.size());
+            evaluate(expression, std::span<T>(values));
+            values_ = std::move(values);
+        }
+        return *this;
+    }
+
+    std::size_t size() const { return values_.size(); }
+    T operator[](std::size_t i) const { return values_[i]; }
+    T& operator[](std::size_t i) { return values_[i]; }
+
+    T* data() { return values_.data(); }
+    const T* data() const { return values_.data(); }
+
+    auto begin() { return values_.begin(); }
+    auto end() { return values_.end(); }
+    auto begin() const { return values_.begin(); }
+    auto end() const { return values_.end(); }
+
+    View<T> view() const { return View<T>(values_); }
+
+    operator std::span<const T>() const { return values_; }
+
+private:
+    std::vector<T> values_;
+};
+
+/**
+ * @brief Evaluates an expression into a new Array of its value type.
+ */
+template <Expression E>
+auto evaluate(const E& expression)
+{
+    return Array<typename E::value_type>(expression);
+}
+
+} // namespace array_expr
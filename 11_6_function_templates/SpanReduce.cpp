@@ -0,0 +1,135 @@
+/**
+ * @file SpanReduce.cpp
+ * @author Daniel Even
+ * @brief The scalar reduction kernels, the CPUID based kernel selection and the
+ * block-level pairwise driver shared by every ISA.
+ */
+#include "SpanReduce.hpp"
+#define SPAN_REDUCE_ISA scalar
+#include "SpanReduceKernels.hpp"
+
+namespace {
+
+/**
+ * @brief Reduces values as a balanced binary tree of blocks. The split point is
+ * always a block boundary, so the tree shape depends only on the element count
+ * and never on the ISA that reduces each block.
+ */
+template <typename T, typename Op>
+T reduce_blocks(BlockKernel<T> kernel, const T* data, std::size_t count)
+{
+    if (count <= reduce_block)
+        return kernel(data, count);
+
+    const std::size_t blocks = (count + reduce_block - 1) / reduce_block;
+    const std::size_t split = (blocks / 2) * reduce_block;
+
+    return Op::apply(reduce_blocks<T, Op>(kernel, data, split),
+                     reduce_blocks<T, Op>(kernel, data + split, count - split));
+}
+
+const BlockKernels& kernels_for(cpu::Isa isa)
+{
+    if (!cpu::supported(isa))
+        return scalar_block_kernels();
+
+    switch (isa)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case cpu::Isa::avx512:
+        return avx512_block_kernels();
+    case cpu::Isa::avx2:
+        return avx2_block_kernels();
+    case cpu::Isa::sse2:
+        return sse2_block_kernels();
+#endif
+    default:
+        return scalar_block_kernels();
+    }
+}
+
+/**
+ * @brief Runs a reduction with the kernel selected by 'member', falling back to
+ * the scalar kernel if the ISA does not provide one for this operation.
+ */
+template <typename T, typename Op>
+T reduce(std::span<const T> values, cpu::Isa isa, BlockKernel<T> BlockKernels::*member)
+{
+    BlockKernel<T> kernel = kernels_for(isa).*member;
+    if (!kernel)
+        kernel = scalar_block_kernels().*member;
+
+    return reduce_blocks<T, Op>(kernel, values.data(), values.size());
+}
+
+} // namespace
+
+const BlockKernels& scalar_block_kernels()
+{
+    static constexpr BlockKernels kernels{
+        detail::scalar_block<std::int32_t, detail::SumOp<std::int32_t>>,
+        detail::scalar_block<std::int64_t, detail::SumOp<std::int64_t>>,
+        detail::scalar_block<float, detail::SumOp<float>>,
+        detail::scalar_block<double, detail::SumOp<double>>,
+        detail::scalar_block<std::int32_t, detail::MaxOp<std::int32_t>>,
+        detail::scalar_block<std::int64_t, detail::MaxOp<std::int64_t>>,
+        detail::scalar_block<float, detail::MaxOp<float>>,
+        detail::scalar_block<double, detail::MaxOp<double>>,
+    };
+    return kernels;
+}
+
+cpu::Isa span_reduce_isa()
+{
+    return cpu::selected<cpu::Isa::avx512, cpu::Isa::avx2, cpu::Isa::sse2>();
+}
+
+std::int32_t add(std::span<const std::int32_t> values, cpu::Isa isa)
+{
+    return reduce<std::int32_t, detail::SumOp<std::int32_t>>(values, isa, &BlockKernels::add_i32);
+}
+
+std::int64_t add(std::span<const std::int64_t> values, cpu::Isa isa)
+{
+    return reduce<std::int64_t, detail::SumOp<std::int64_t>>(values, isa, &BlockKernels::add_i64);
+}
+
+float add(std::span<const float> values, cpu::Isa isa)
+{
+    return reduce<float, detail::SumOp<float>>(values, isa, &BlockKernels::add_f32);
+}
+
+double add(std::span<const double> values, cpu::Isa isa)
+{
+    return reduce<double, detail::SumOp<double>>(values, isa, &BlockKernels::add_f64);
+}
+
+std::int32_t max(std::span<const std::int32_t> values, cpu::Isa isa)
+{
+    return reduce<std::int32_t, detail::MaxOp<std::int32_t>>(values, isa, &BlockKernels::max_i32);
+}
+
+std::int64_t max(std::span<const std::int64_t> values, cpu::Isa isa)
+{
+    return reduce<std::int64_t, detail::MaxOp<std::int64_t>>(values, isa, &BlockKernels::max_i64);
+}
+
+float max(std::span<const float> values, cpu::Isa isa)
+{
+    return reduce<float, detail::MaxOp<float>>(values, isa, &BlockKernels::max_f32);
+}
+
+double max(std::span<const double> values, cpu::Isa isa)
+{
+    return reduce<double, detail::MaxOp<double>>(values, isa, &BlockKernels::max_f64);
+}
+
+std::int32_t add(std::span<const std::int32_t> values) { return add(values, span_reduce_isa()); }
+std::int64_t add(std::span<const std::int64_t> values) { return add(values, span_reduce_isa()); }
+float add(std::span<const float> values) { return add(values, span_reduce_isa()); }
+double add(std::span<const double> values) { return add(values, span_reduce_isa()); }
+
+std::int32_t max(std::span<const std::int32_t> values) { return max(values, span_reduce_isa()); }
+std::int64_t max(std::span<const std::int64_t> values) { return max(values, span_reduce_isa()); }
+float max(std::span<const float> values) { return max(values, span_reduce_isa()); }
+double max(std::span<const double> values) { return max(values, span_reduce_isa()); }
@@ -0,0 +1,65 @@
+/**
+ * @file SpanReduce.hpp
+ * @author Daniel Even
+ * @brief Overloads of add and max that reduce a whole std::span instead of a
+ * pair of values. The templated add<T> and max<T> in main.cpp are combiners;
+ * these apply the same combiner to every element of an array using SSE2, AVX2
+ * or AVX-512 kernels, whichever the CPU supports. The choice is made once, the
+ * first time a reduction runs, by querying CPUID.
+ *
+ * These are ordinary (non-template) overloads, one per element type. Because
+ * they take a single argument they never compete with the two-argument
+ * templates during overload resolution, and a std::vector or std::array binds
+ * to them through std::span's converting constructor.
+ *
+ * Reduction order: floating point addition is not associative, so the order of
+ * a sum changes its result. Every kernel, including the scalar fallback, uses
+ * the same fixed order:
+ *
+ * 1) The input is split into blocks of 4096 elements, and block results are
+ * combined as a balanced binary tree (pairwise summation).
+ *
+ * 2) Inside a block, element i is accumulated into lane (i % 16), and the 16
+ * lanes are then combined as a binary tree.
+ *
+ * Every ISA therefore performs exactly the same sequence of IEEE operations
+ * and returns bit-identical results, and the rounding error of a float sum
+ * grows with O(log n) rather than O(n).
+ *
+ * @note Integer sums wrap on overflow, like add<T> would for unsigned T.
+ */
+#pragma once
+
+#include "CpuDispatch.hpp"
+
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief The instruction set selected at startup for the single-argument
+ * overloads below: the best of AVX-512, AVX2 and SSE2 the CPU supports.
+ */
+cpu::Isa span_reduce_isa();
+
+std::int32_t add(std::span<const std::int32_t> values);
+std::int64_t add(std::span<const std::int64_t> values);
+float add(std::span<const float> values);
+double add(std::span<const double> values);
+
+std::int32_t max(std::span<const std::int32_t> values);
+std::int64_t max(std::span<const std::int64_t> values);
+float max(std::span<const float> values);
+double max(std::span<const double> values);
+
+// These overloads force a specific instruction set, which is how the SIMD
+// kernels are checked against the scalar path. An unsupported ISA falls back to
+// the scalar kernel.
+std::int32_t add(std::span<const std::int32_t> values, cpu::Isa isa);
+std::int64_t add(std::span<const std::int64_t> values, cpu::Isa isa);
+float add(std::span<const float> values, cpu::Isa isa);
+double add(std::span<const double> values, cpu::Isa isa);
+
+std::int32_t max(std::span<const std::int32_t> values, cpu::Isa isa);
+std::int64_t max(std::span<const std::int64_t> values, cpu::Isa isa);
+float max(std::span<const float> values, cpu::Isa isa);
+double max(std::span<const double> values, cpu::Isa isa);
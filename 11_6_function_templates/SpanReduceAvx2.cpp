@@ -0,0 +1,83 @@
+/**
+ * @file SpanReduceAvx2.cpp
+ * @author Daniel Even
+ * @brief AVX2 reduction kernels. This file is compiled with -mavx2 and must only
+ * be called after cpu::supported(cpu::Isa::avx2) has returned true.
+ * AVX2 has no 64-bit max instruction, so it is built from a compare and blend.
+ */
+#define SPAN_REDUCE_ISA avx2
+#include "SpanReduceKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+template <typename T>
+struct Avx2Int
+{
+    using value_type = T;
+    using reg = __m256i;
+    static constexpr std::size_t width = 32 / sizeof(T);
+
+    static reg load(const value_type* p) { return _mm256_loadu_si256(reinterpret_cast<const reg*>(p)); }
+    static void store(value_type* p, reg v) { _mm256_storeu_si256(reinterpret_cast<reg*>(p), v); }
+
+    static reg set1(value_type x)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm256_set1_epi32(x);
+        else
+            return _mm256_set1_epi64x(x);
+    }
+
+    static reg add(reg a, reg b)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm256_add_epi32(a, b);
+        else
+            return _mm256_add_epi64(a, b);
+    }
+
+    static reg max(reg a, reg b)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm256_max_epi32(a, b);
+        else
+            return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+    }
+};
+
+struct Avx2F32
+{
+    using value_type = float;
+    using reg = __m256;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const value_type* p) { return _mm256_loadu_ps(p); }
+    static void store(value_type* p, reg v) { _mm256_storeu_ps(p, v); }
+    static reg set1(value_type x) { return _mm256_set1_ps(x); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+};
+
+struct Avx2F64
+{
+    using value_type = double;
+    using reg = __m256d;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const value_type* p) { return _mm256_loadu_pd(p); }
+    static void store(value_type* p, reg v) { _mm256_storeu_pd(p, v); }
+    static reg set1(value_type x) { return _mm256_set1_pd(x); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+};
+
+} // namespace
+
+const BlockKernels& avx2_block_kernels()
+{
+    static constexpr BlockKernels kernels =
+        detail::make_block_kernels<Avx2Int<std::int32_t>, Avx2Int<std::int64_t>, Avx2F32, Avx2F64>();
+    return kernels;
+}
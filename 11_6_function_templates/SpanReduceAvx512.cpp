@@ -0,0 +1,83 @@
+/**
+ * @file SpanReduceAvx512.cpp
+ * @author Daniel Even
+ * @brief AVX-512 reduction kernels. This file is compiled with -mavx512f and must
+ * only be called after cpu::supported(cpu::Isa::avx512) has returned
+ * true. All sixteen lanes of a float block fit in a single register.
+ */
+#define SPAN_REDUCE_ISA avx512
+#include "SpanReduceKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+template <typename T>
+struct Avx512Int
+{
+    using value_type = T;
+    using reg = __m512i;
+    static constexpr std::size_t width = 64 / sizeof(T);
+
+    static reg load(const value_type* p) { return _mm512_loadu_si512(p); }
+    static void store(value_type* p, reg v) { _mm512_storeu_si512(p, v); }
+
+    static reg set1(value_type x)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm512_set1_epi32(x);
+        else
+            return _mm512_set1_epi64(x);
+    }
+
+    static reg add(reg a, reg b)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm512_add_epi32(a, b);
+        else
+            return _mm512_add_epi64(a, b);
+    }
+
+    static reg max(reg a, reg b)
+    {
+        if constexpr (sizeof(T) == 4)
+            return _mm512_max_epi32(a, b);
+        else
+            return _mm512_max_epi64(a, b);
+    }
+};
+
+struct Avx512F32
+{
+    using value_type = float;
+    using reg = __m512;
+    static constexpr std::size_t width = 16;
+
+    static reg load(const value_type* p) { return _mm512_loadu_ps(p); }
+    static void store(value_type* p, reg v) { _mm512_storeu_ps(p, v); }
+    static reg set1(value_type x) { return _mm512_set1_ps(x); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+};
+
+struct Avx512F64
+{
+    using value_type = double;
+    using reg = __m512d;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const value_type* p) { return _mm512_loadu_pd(p); }
+    static void store(value_type* p, reg v) { _mm512_storeu_pd(p, v); }
+    static reg set1(value_type x) { return _mm512_set1_pd(x); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+};
+
+} // namespace
+
+const BlockKernels& avx512_block_kernels()
+{
+    static constexpr BlockKernels kernels =
+        detail::make_block_kernels<Avx512Int<std::int32_t>, Avx512Int<std::int64_t>, Avx512F32, Avx512F64>();
+    return kernels;
+}
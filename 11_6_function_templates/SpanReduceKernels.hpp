@@ -0,0 +1,200 @@
+/**
+ * @file SpanReduceKernels.hpp
+ * @author Daniel Even
+ * @brief Private to the SpanReduce*.cpp files. Defines the canonical block
+ * reduction order described in SpanReduce.hpp once, so that the scalar path and
+ * every SIMD path share it.
+ *
+ * @note Each SpanReduce<Isa>.cpp file is compiled with different -m flags, and
+ * defines SPAN_REDUCE_ISA to the name of its instruction set before including
+ * this file. The kernel templates below live in an inline namespace of that
+ * name, so every instruction set gets its own copy; the linker merges
+ * identical inline functions across translation units, and could otherwise
+ * put an AVX-512 instantiation into the scalar path.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/**
+ * @brief Reduces one block of at most reduce_block elements into a single value.
+ */
+template <typename T>
+using BlockKernel = T (*)(const T* data, std::size_t count);
+
+/**
+ * @brief The kernels for one instruction set. A null entry means the ISA has
+ * no useful instruction for that operation and the scalar kernel is used.
+ */
+struct BlockKernels
+{
+    BlockKernel<std::int32_t> add_i32;
+    BlockKernel<std::int64_t> add_i64;
+    BlockKernel<float> add_f32;
+    BlockKernel<double> add_f64;
+    BlockKernel<std::int32_t> max_i32;
+    BlockKernel<std::int64_t> max_i64;
+    BlockKernel<float> max_f32;
+    BlockKernel<double> max_f64;
+};
+
+const BlockKernels& scalar_block_kernels();
+#if defined(__x86_64__) || defined(__i386__)
+const BlockKernels& sse2_block_kernels();
+const BlockKernels& avx2_block_kernels();
+const BlockKernels& avx512_block_kernels();
+#endif
+
+inline constexpr std::size_t reduce_lanes = 16;
+inline constexpr std::size_t reduce_block = 4096;
+
+#ifndef SPAN_REDUCE_ISA
+#error "SpanReduceKernels.hpp: define SPAN_REDUCE_ISA to the instruction set this file is compiled for"
+#endif
+
+namespace detail {
+inline namespace SPAN_REDUCE_ISA {
+
+/**
+ * @brief add<T> as a reduction operator. Integers are added as unsigned so that
+ * overflow wraps instead of being undefined behaviour.
+ */
+template <typename T>
+struct SumOp
+{
+    static constexpr T identity() { return T{0}; }
+
+    static T apply(T a, T b)
+    {
+        if constexpr (std::is_integral_v<T>)
+            return static_cast<T>(static_cast<std::make_unsigned_t<T>>(a) +
+                                  static_cast<std::make_unsigned_t<T>>(b));
+        else
+            return a + b;
+    }
+
+    template <typename V>
+    static typename V::reg apply(typename V::reg a, typename V::reg b)
+    {
+        return V::add(a, b);
+    }
+};
+
+/**
+ * @brief max<T> as a reduction operator. The comparison is written the way the
+ * x86 MAXPS/MAXPD instructions behave (the second operand wins ties and NaNs)
+ * so the scalar and SIMD paths agree bit for bit.
+ */
+template <typename T>
+struct MaxOp
+{
+    static constexpr T identity()
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return -std::numeric_limits<T>::infinity();
+        else
+            return std::numeric_limits<T>::lowest();
+    }
+
+    static T apply(T a, T b) { return a > b ? a : b; }
+
+    template <typename V>
+    static typename V::reg apply(typename V::reg a, typename V::reg b)
+    {
+        return V::max(a, b);
+    }
+};
+
+/**
+ * @brief Folds the tail of a block into the lanes and combines the lanes as a
+ * binary tree. The tail starts at a multiple of reduce_lanes, so tail element k
+ * belongs to lane k.
+ */
+template <typename T, typename Op>
+inline T finish_block(T (&lanes)[reduce_lanes], const T* tail, std::size_t tail_count)
+{
+    for (std::size_t k = 0; k < tail_count; ++k)
+        lanes[k] = Op::apply(lanes[k], tail[k]);
+
+    for (std::size_t stride = reduce_lanes / 2; stride > 0; stride /= 2)
+        for (std::size_t k = 0; k < stride; ++k)
+            lanes[k] = Op::apply(lanes[k], lanes[k + stride]);
+
+    return lanes[0];
+}
+
+/**
+ * @brief The reference implementation of the canonical order, one lane at a
+ * time.
+ */
+template <typename T, typename Op>
+inline T scalar_block(const T* data, std::size_t count)
+{
+    T lanes[reduce_lanes];
+    for (auto& lane : lanes)
+        lane = Op::identity();
+
+    const std::size_t full = count - count % reduce_lanes;
+    for (std::size_t i = 0; i < full; i += reduce_lanes)
+        for (std::size_t k = 0; k < reduce_lanes; ++k)
+            lanes[k] = Op::apply(lanes[k], data[i + k]);
+
+    return finish_block<T, Op>(lanes, data + full, count - full);
+}
+
+/**
+ * @brief The same order as scalar_block() with the 16 lanes held in
+ * 16 / V::width vector registers. V describes one vector type: its register
+ * type, width and load/store/set1/add/max operations.
+ */
+template <typename V, typename Op>
+inline typename V::value_type simd_block(const typename V::value_type* data,
+                                         std::size_t count)
+{
+    using T = typename V::value_type;
+    constexpr std::size_t regs = reduce_lanes / V::width;
+    static_assert(regs * V::width == reduce_lanes);
+
+    typename V::reg acc[regs];
+    for (auto& reg : acc)
+        reg = V::set1(Op::identity());
+
+    const std::size_t full = count - count % reduce_lanes;
+    for (std::size_t i = 0; i < full; i += reduce_lanes)
+        for (std::size_t r = 0; r < regs; ++r)
+            acc[r] = Op::template apply<V>(acc[r], V::load(data + i + r * V::width));
+
+    T lanes[reduce_lanes];
+    for (std::size_t r = 0; r < regs; ++r)
+        V::store(lanes + r * V::width, acc[r]);
+
+    return finish_block<T, Op>(lanes, data + full, count - full);
+}
+
+/**
+ * @brief Builds the kernel table for one ISA from its vector descriptions.
+ * Passing void for an operation leaves that entry null.
+ */
+template <typename I32, typename I64, typename F32, typename F64,
+          typename MaxI32 = I32, typename MaxI64 = I64>
+constexpr BlockKernels make_block_kernels()
+{
+    BlockKernels kernels{};
+    kernels.add_i32 = simd_block<I32, SumOp<std::int32_t>>;
+    kernels.add_i64 = simd_block<I64, SumOp<std::int64_t>>;
+    kernels.add_f32 = simd_block<F32, SumOp<float>>;
+    kernels.add_f64 = simd_block<F64, SumOp<double>>;
+    if constexpr (!std::is_void_v<MaxI32>)
+        kernels.max_i32 = simd_block<MaxI32, MaxOp<std::int32_t>>;
+    if constexpr (!std::is_void_v<MaxI64>)
+        kernels.max_i64 = simd_block<MaxI64, MaxOp<std::int64_t>>;
+    kernels.max_f32 = simd_block<F32, MaxOp<float>>;
+    kernels.max_f64 = simd_block<F64, MaxOp<double>>;
+    return kernels;
+}
+
+} // namespace SPAN_REDUCE_ISA
+} // namespace detail
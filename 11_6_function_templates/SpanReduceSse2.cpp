@@ -0,0 +1,79 @@
+/**
+ * @file SpanReduceSse2.cpp
+ * @author Daniel Even
+ * @brief SSE2 reduction kernels. SSE2 is part of the x86-64 baseline so this
+ * file needs no extra compiler flags. SSE2 has no signed 32-bit max, so it is
+ * emulated with a compare and select, and there is no 64-bit compare at all,
+ * so the 64-bit max uses the scalar kernel.
+ */
+#define SPAN_REDUCE_ISA sse2
+#include "SpanReduceKernels.hpp"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2I32
+{
+    using value_type = std::int32_t;
+    using reg = __m128i;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const value_type* p) { return _mm_loadu_si128(reinterpret_cast<const reg*>(p)); }
+    static void store(value_type* p, reg v) { _mm_storeu_si128(reinterpret_cast<reg*>(p), v); }
+    static reg set1(value_type x) { return _mm_set1_epi32(x); }
+    static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+
+    static reg max(reg a, reg b)
+    {
+        const reg a_greater = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(a_greater, a), _mm_andnot_si128(a_greater, b));
+    }
+};
+
+struct Sse2I64
+{
+    using value_type = std::int64_t;
+    using reg = __m128i;
+    static constexpr std::size_t width = 2;
+
+    static reg load(const value_type* p) { return _mm_loadu_si128(reinterpret_cast<const reg*>(p)); }
+    static void store(value_type* p, reg v) { _mm_storeu_si128(reinterpret_cast<reg*>(p), v); }
+    static reg set1(value_type x) { return _mm_set1_epi64x(x); }
+    static reg add(reg a, reg b) { return _mm_add_epi64(a, b); }
+};
+
+struct Sse2F32
+{
+    using value_type = float;
+    using reg = __m128;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const value_type* p) { return _mm_loadu_ps(p); }
+    static void store(value_type* p, reg v) { _mm_storeu_ps(p, v); }
+    static reg set1(value_type x) { return _mm_set1_ps(x); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+};
+
+struct Sse2F64
+{
+    using value_type = double;
+    using reg = __m128d;
+    static constexpr std::size_t width = 2;
+
+    static reg load(const value_type* p) { return _mm_loadu_pd(p); }
+    static void store(value_type* p, reg v) { _mm_storeu_pd(p, v); }
+    static reg set1(value_type x) { return _mm_set1_pd(x); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+};
+
+} // namespace
+
+const BlockKernels& sse2_block_kernels()
+{
+    static constexpr BlockKernels kernels =
+        detail::make_block_kernels<Sse2I32, Sse2I64, Sse2F32, Sse2F64, Sse2I32, void>();
+    return kernels;
+}
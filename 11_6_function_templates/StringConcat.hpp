@@ -0,0 +1,195 @@
+/**
+ * @file StringConcat.hpp
+ * @author Daniel Even
+ * @brief add() for strings: joins any number of pieces with one allocation and
+ * one copy per piece.
+ *
+ * The generic add<T>(a, b) takes its arguments by value and returns a + b, so
+ * add(a, add(b, c)) on std::strings copies every piece at least twice and
+ * reallocates at every step. main.cpp used to just delete add<std::string>.
+ * The overloads here take the pieces as string_views instead, which costs
+ * nothing for a std::string, a string_view or a literal. They add up the
+ * lengths first and then copy each piece exactly once into storage of the
+ * right size:
+ *
+ * 1) add(pieces...) returns a std::string, allocated once. The lengths of
+ * string literals are folded into a constant by the compiler.
+ *
+ * 2) add(resource, pieces...) allocates a std::pmr::string from a
+ * std::pmr::memory_resource, such as a std::pmr::monotonic_buffer_resource
+ * used as an arena and released once a batch of keys has been used.
+ *
+ * 3) add_to(out, pieces...) appends to an existing string, and only allocates
+ * when its capacity runs out, so a string reused for every key stops
+ * allocating after the first few.
+ *
+ * 4) SmallString<N> holds up to N characters inline and never touches the heap
+ * for a key that fits. Longer keys spill to the heap (or a memory_resource).
+ */
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <version>
+
+/**
+ * @brief Anything that can be viewed as a string without copying it.
+ */
+template <typename T>
+concept StringPiece = std::convertible_to<const T&, std::string_view>;
+
+namespace string_concat_detail {
+
+/**
+ * @brief The total length of the pieces, in one pass. For a string literal
+ * the length is computed with the constexpr char_traits::length, which the
+ * compiler folds to a constant.
+ */
+template <typename... Pieces>
+std::size_t total_length(const Pieces&... pieces)
+{
+    return (std::size_t{0} + ... + std::string_view(pieces).size());
+}
+
+/**
+ * @brief Copies the pieces one after another to 'out', which must have room
+ * for all of them, and returns the end.
+ */
+template <typename... Pieces>
+char* copy_pieces(char* out, const Pieces&... pieces)
+{
+    auto copy = [&](std::string_view piece) {
+        std::memcpy(out, piece.data(), piece.size());
+        out += piece.size();
+    };
+    (copy(pieces), ...);
+    return out;
+}
+
+/**
+ * @brief Appends the pieces to 'out' with at most one reallocation.
+ */
+template <typename String, typename... Pieces>
+void append_pieces(String& out, const Pieces&... pieces)
+{
+    const std::size_t old_size = out.size();
+    const std::size_t new_size = old_size + total_length(pieces...);
+#ifdef __cpp_lib_string_resize_and_overwrite
+    out.resize_and_overwrite(new_size, [&](char* data, std::size_t) {
+        copy_pieces(data + old_size, pieces...);
+        return new_size;
+    });
+#else
+    // Before C++23 the new characters are zeroed first, then overwritten.
+    out.resize(new_size);
+    copy_pieces(out.data() + old_size, pieces...);
+#endif
+}
+
+} // namespace string_concat_detail
+
+/**
+ * @brief The concatenation of the pieces, allocated once.
+ */
+template <StringPiece... Pieces>
+    requires(sizeof...(Pieces) > 0)
+std::string add(const Pieces&... pieces)
+{
+    std::string result;
+    string_concat_detail::append_pieces(result, pieces...);
+    return result;
+}
+
+/**
+ * @brief The concatenation of the pieces, allocated once from 'resource'.
+ */
+template <StringPiece... Pieces>
+    requires(sizeof...(Pieces) > 0)
+std::pmr::string add(std::pmr::memory_resource& resource, const Pieces&... pieces)
+{
+    std::pmr::string result(&resource);
+    string_concat_detail::append_pieces(result, pieces...);
+    return result;
+}
+
+/**
+ * @brief Appends the pieces to 'out'. Reallocates at most once, and not at all
+ * if out's capacity is large enough.
+ */
+template <typename Allocator, StringPiece... Pieces>
+void add_to(std::basic_string<char, std::char_traits<char>, Allocator>& out, const Pieces&... pieces)
+{
+    string_concat_detail::append_pieces(out, pieces...);
+}
+
+/**
+ * @brief A string that stores up to Capacity characters inline. Longer
+ * strings are stored in a std::pmr::string from the memory_resource given on
+ * construction (new/delete by default).
+ */
+template <std::size_t Capacity = 64>
+class SmallString
+{
+public:
+    SmallString() = default;
+
+    explicit SmallString(std::pmr::memory_resource& resource) : heap_(&resource) {}
+
+    template <StringPiece... Pieces>
+        requires(sizeof...(Pieces) > 0)
+    explicit SmallString(const Pieces&... pieces)
+    {
+        assign(pieces...);
+    }
+
+    /**
+     * @brief Replaces the contents with the concatenation of the pieces.
+     * The pieces must not point into this string.
+     */
+    template <StringPiece... Pieces>
+    SmallString& assign(const Pieces&... pieces)
+    {
+        const std::size_t length = string_concat_detail::total_length(pieces...);
+        if (length <= Capacity)
+        {
+            string_concat_detail::copy_pieces(inline_.data(), pieces...);
+            inline_[length] = '\0';
+            size_ = length;
+            on_heap_ = false;
+        }
+        else
+        {
+            heap_.clear();
+            string_concat_detail::append_pieces(heap_, pieces...);
+            size_ = length;
+            on_heap_ = true;
+        }
+        return *this;
+    }
+
+    const char* data() const { return on_heap_ ? heap_.data() : inline_.data(); }
+    const char* c_str() const { return data(); }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief True if the contents did not fit inline.
+     */
+    bool on_heap() const { return on_heap_; }
+
+    std::string_view view() const { return {data(), size_}; }
+    operator std::string_view() const { return view(); }
+
+    friend bool operator==(const SmallString& a, const SmallString& b) { return a.view() == b.view(); }
+
+private:
+    std::array<char, Capacity + 1> inline_{};
+    std::size_t size_ = 0;
+    bool on_heap_ = false;
+    std::pmr::string heap_;
+};
@@ -7,9 +7,36 @@
  * generated at compile time.
  * 
  * @note This covers sections 11.6 to 11.9 from learncpp.com.
+ *
+ * @note SpanReduce.hpp extends add and max with overloads that reduce a whole
+ * std::span using SIMD kernels, and parallel_reduce from Parallel.hpp applies
+ * add and max across every core. StringConcat.hpp adds strings, and
+ * ArrayExpression.hpp fuses add, mult and max over arrays into a single loop.
+ * For arrays too large for the TLB, aligned_buffer from AlignedBuffer.hpp
+ * provides memory backed by huge pages that converts to the same spans.
+ *
+ * @note Run with "--stream add|max [FILE]" to reduce the numbers in FILE (or
+ * stdin) instead of running the examples. FILE may be text, or a binary
+ * column file (see ColumnFile.hpp), which is reduced straight from the page
+ * cache. See run_stream() below.
  */
+#include <cstdint>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
 #include <type_traits> // Required to use std::common_type_t
+#include <vector>
+#include "ArrayExpression.hpp"
+#include "ColumnFile.hpp"
+#include "FunctionTemplates.hpp"
+#include "NumberStream.hpp"
+#include "OutputSink.hpp"
+#include "Parallel.hpp"
+#include "SpanReduce.hpp"
+#include "StringConcat.hpp"
 
 // Uncomment this define to see the error thrown when you use two distinct types
 // to call a templated function that calls for two of the same type.
@@ -19,40 +46,89 @@
 // will resolve the TWO_TYPES_ERROR above.
 // #define AUTO_MAX_FUNCTION
 
-/**
- * @brief This is a basic templated add function that will be 'instantiated' to
- * an actual function if it is needed. The type 'T' is a stand in for whatever
- * type might be needed.
- * 
- * @note Function template parameters can also have default values, but in this
- * case the type is now explicitly declared.
- */
-template <typename T>
-T add(const T a, const T b)
-{
-    return a + b;
-}
+// Uncomment this define to check every SIMD reduction kernel bit for bit
+// against the scalar kernel. Bandwidth is measured by cpp_concepts_bench.
+// #define VERIFY_SPAN_REDUCE
 
-/**
- * @brief This deletion tells the compiler to throw an error if a function call
- * is matched to this signature. This is a way of disallowing auto generating
- * functions that would cause errors or otherwise fail.
- */
-template <>
-std::string add(std::string a, std::string b) = delete;
+// Uncomment this define to check parallel_reduce and parallel_for against
+// serial loops on pools of several sizes, including the bit-exact results of
+// the deterministic mode. Scaling is measured by cpp_concepts_bench.
+// #define VERIFY_PARALLEL_REDUCE
 
-// This section covers function templates with multiple template types.
+// Uncomment this define to write column files of every element type, read them
+// back through the mapping, and check that damaged and truncated files are
+// rejected.
+// #define VERIFY_COLUMN_FILE
 
-/**
- * @brief This templated max function takes two parameters that MUST be of the 
- * same type. If this is violated, a compiler error will be generated (as 
- * demonstrated below). 
- */
-template <typename T>
-T max(T x, T y)
-{
-    return (x < y) ? y : x;
-}
+// Uncomment this define to allocate aligned_buffers with every kind of page
+// and NUMA placement, check their alignment and contents and reduce them, and
+// report which pages the kernel actually provided. TLB misses and bandwidth
+// are measured by cpp_concepts_bench.
+// #define VERIFY_ALIGNED_BUFFER
+
+// Uncomment this define to check every string add overload against
+// operator+, and that a SmallString that fits never allocates.
+// #define VERIFY_STRING_CONCAT
+
+// Uncomment this define to check fused array expressions against the same
+// operations evaluated one step at a time, and against add and max applied to
+// one element at a time. Fused against unfused is measured by
+// cpp_concepts_bench.
+// #define VERIFY_ARRAY_EXPRESSION
+
+#if defined(VERIFY_SPAN_REDUCE) || defined(VERIFY_PARALLEL_REDUCE)
+#include <algorithm>
+#include <cstring>
+#include <random>
+#endif // VERIFY_SPAN_REDUCE || VERIFY_PARALLEL_REDUCE
+
+#ifdef VERIFY_PARALLEL_REDUCE
+#include <numeric>
+#include <stdexcept>
+#endif // VERIFY_PARALLEL_REDUCE
+
+#ifdef VERIFY_COLUMN_FILE
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#endif // VERIFY_COLUMN_FILE
+
+#ifdef VERIFY_ALIGNED_BUFFER
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include "AlignedBuffer.hpp"
+#endif // VERIFY_ALIGNED_BUFFER
+
+#ifdef VERIFY_STRING_CONCAT
+#include <memory_resource>
+#include <random>
+#include <utility>
+#endif // VERIFY_STRING_CONCAT
+
+#ifdef VERIFY_ARRAY_EXPRESSION
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#endif // VERIFY_ARRAY_EXPRESSION
+
+// The add and max function templates, and max_abbr below, are defined in
+// FunctionTemplates.hpp, part of the cpp_concepts_core library. They only
+// accept arithmetic types, which leaves strings to the add overloads in
+// StringConcat.hpp and arrays to the ones in ArrayExpression.hpp. The common
+// numeric specializations (add<int>, max<double>, ...) are compiled once in
+// that library instead of in every file that calls them.
+//
+// add(a, b) is a basic templated add function that will be 'instantiated' to
+// an actual function if it is needed. The type 'T' is a stand in for whatever
+// type might be needed.
+//
+// max(x, y) takes two parameters that MUST be of the same type. If this is
+// violated, a compiler error will be generated (as demonstrated below).
 
 #ifdef AUTO_MAX_FUNCTION
 /**
@@ -79,37 +155,423 @@ auto max(T x, U y) -> std::common_type_t<T, U>
 }
 #endif // AUTO_MAX_FUNCTION
 
-// This section demonstrates abbreviated function templates as introduced in 
-// C++20. 
+// max_abbr(x, y) demonstrates the abbreviated function templates introduced in
+// C++20: "auto max_abbr(auto x, auto y)" is a template with one type parameter
+// per auto. This should be used in place of templated functions where
+// parameter types can be distinct.
 
+#ifdef VERIFY_SPAN_REDUCE
 /**
- * @brief This is equivalent to a templated verion of the max function seen 
- * above. This should be used in place of templated functions where parameter
- * types can be distinct. This format has no way to enforce the rule that the
- * types be the same and so the traditional templating format should be used if 
- * this is desired.
+ * @brief Compares add and max for every supported ISA against the scalar
+ * kernel. Sizes are chosen around the lane (16) and block (4096) boundaries so
+ * that the tail handling is exercised as well.
  */
-auto max_abbr(auto x, auto y)
+template <typename T>
+bool verify_span_reduce(std::mt19937_64& rng)
 {
-    return (x < y) ? y : x;
+    bool passed = true;
+    for (std::size_t count : {0, 1, 15, 16, 17, 4095, 4096, 4097, 12289, 100003})
+    {
+        std::vector<T> data(count);
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            std::uniform_real_distribution<T> dist(-1000, 1000);
+            std::generate(data.begin(), data.end(), [&] { return dist(rng); });
+        }
+        else
+        {
+            std::uniform_int_distribution<T> dist;
+            std::generate(data.begin(), data.end(), [&] { return dist(rng); });
+        }
+
+        const T expected_sum = add(std::span<const T>(data), cpu::Isa::scalar);
+        const T expected_max = max(std::span<const T>(data), cpu::Isa::scalar);
+
+        for (cpu::Isa isa : {cpu::Isa::sse2, cpu::Isa::avx2, cpu::Isa::avx512})
+        {
+            if (!cpu::supported(isa))
+                continue;
+
+            const T sum = add(std::span<const T>(data), isa);
+            const T maximum = max(std::span<const T>(data), isa);
+            if (std::memcmp(&sum, &expected_sum, sizeof(T)) != 0 ||
+                std::memcmp(&maximum, &expected_max, sizeof(T)) != 0)
+            {
+                io::out() << "MISMATCH: " << to_string(isa) << " with " << count
+                          << " elements of size " << sizeof(T) << io::endl;
+                passed = false;
+            }
+        }
+    }
+    return passed;
 }
 
-int main()
+#endif // VERIFY_SPAN_REDUCE
+
+#ifdef VERIFY_PARALLEL_REDUCE
+/**
+ * @brief Runs the checks on one pool. Pools larger than the machine are fine:
+ * they exercise stealing even on a single core.
+ */
+bool verify_parallel_reduce(parallel::ThreadPool& pool, const std::vector<std::int64_t>& integers,
+                            const std::vector<double>& reals, double deterministic_sum)
 {
-    // We can now use the 'add' function to add any types for which the add 
-    // operator is allowed! The overloaded function will be 'instantiated' on
-    // a case by case basis.
-    std::cout << "Adding integers: 1 + 2 = " << add(1, 2) << std::endl;
-    std::cout << "Adding doubles: 1.0f + 2.5f = " << add(1.0f, 2.5f) << std::endl;
-    std::cout << "Adding chars: 'A' + ' ' = " << add('A', ' ') << std::endl;
+    bool passed = true;
+    const parallel::Options options{0, false, &pool};
+
+    // Integer addition is associative, so every split gives the same answer.
+    const std::int64_t expected = std::accumulate(integers.begin(), integers.end(), std::int64_t{0});
+    passed &= parallel::parallel_reduce(integers, std::int64_t{0}, add<std::int64_t>, options) == expected;
+    passed &= parallel::parallel_reduce(integers, std::numeric_limits<std::int64_t>::lowest(),
+                                        max<std::int64_t>, options) ==
+              *std::max_element(integers.begin(), integers.end());
+
+    // The same bits whatever the pool size.
+    const double sum = parallel::parallel_reduce(reals, 0.0, [](auto... args) { return add(args...); },
+                                                 parallel::Options{0, true, &pool});
+    passed &= std::memcmp(&sum, &deterministic_sum, sizeof(sum)) == 0;
+
+    std::vector<int> visits(100003, 0);
+    parallel::parallel_for(0, visits.size(), [&](std::size_t i) { ++visits[i]; }, options);
+    passed &= std::all_of(visits.begin(), visits.end(), [](int count) { return count == 1; });
+
+    bool rethrown = false;
+    try
+    {
+        parallel::parallel_for(0, 1000, [](std::size_t i) {
+            if (i == 777)
+                throw std::runtime_error("expected");
+        }, options);
+    }
+    catch (const std::runtime_error&)
+    {
+        rethrown = true;
+    }
+    passed &= rethrown;
+
+    if (!passed)
+        io::out() << "MISMATCH with " << pool.size() << " threads" << io::endl;
+    return passed;
+}
+#endif // VERIFY_PARALLEL_REDUCE
+
+#ifdef VERIFY_COLUMN_FILE
+/**
+ * @brief Round-trips a column of T through a file, with and without checksums,
+ * then damages and truncates the file and checks that both are caught.
+ */
+template <typename T>
+bool verify_column_file(std::mt19937_64& rng, const std::filesystem::path& path)
+{
+    bool passed = true;
+    for (std::size_t count : {0, 1, 15, 16, 4097, 300'001})
+    {
+        std::vector<T> values(count);
+        for (T& value : values)
+            value = static_cast<T>(static_cast<std::int64_t>(rng()) >> 20);
+
+        for (std::size_t block : {std::size_t{0}, std::size_t{64}, io::default_checksum_block})
+        {
+            io::write_column(path.string(), std::span<const T>(values), block);
+            io::ColumnFile file(path.string());
+            const std::span<const T> mapped = file.values<T>();
+            passed &= file.size() == count && file.checksummed() == (block != 0) &&
+                      reinterpret_cast<std::uintptr_t>(mapped.data()) % io::column_alignment == 0 &&
+                      std::equal(mapped.begin(), mapped.end(), values.begin(), values.end()) &&
+                      (count == 0 || add(mapped) == add(std::span<const T>(values)));
+            file.verify();
+
+            if (count == 0)
+                continue;
+
+            // Flip a bit in the last element.
+            {
+                std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+                const auto offset = static_cast<std::streamoff>(file.header().data_offset + count * sizeof(T) - 1);
+                char byte;
+                stream.seekg(offset).read(&byte, 1);
+                byte ^= 0x10;
+                stream.seekp(offset).write(&byte, 1);
+            }
+            bool caught = block == 0;
+            try
+            {
+                io::ColumnFile(path.string()).verify();
+            }
+            catch (const std::invalid_argument&)
+            {
+                caught = true;
+            }
+
+            // Cut off the last element.
+            std::filesystem::resize_file(path, file.header().data_offset + (count - 1) * sizeof(T));
+            bool truncated = false;
+            try
+            {
+                io::ColumnFile truncated_file(path.string());
+            }
+            catch (const std::invalid_argument&)
+            {
+                truncated = true;
+            }
+            if (!caught || !truncated)
+                io::out() << "MISMATCH: damage not detected for " << count << " elements" << io::endl;
+            passed &= caught && truncated;
+        }
+    }
+    return passed;
+}
+#endif // VERIFY_COLUMN_FILE
+
+#ifdef VERIFY_ALIGNED_BUFFER
+/**
+ * @brief Fills aligned_buffers of several sizes around the huge page size
+ * and compares add and max over them with the same values in a std::vector.
+ */
+bool verify_aligned_buffer(std::mt19937_64& rng, const mem::AllocationOptions& options)
+{
+    bool passed = true;
+    for (std::size_t count : {std::size_t{0}, std::size_t{1}, std::size_t{4097}, mem::huge_page_size / 8 - 1,
+                              mem::huge_page_size / 8, 3 * mem::huge_page_size / 8 + 5})
+    {
+        std::vector<double> expected(count);
+        for (double& value : expected)
+            value = static_cast<double>(static_cast<std::int32_t>(rng()));
+
+        mem::aligned_buffer<double> buffer(count, options);
+        const bool zeroed = std::all_of(buffer.begin(), buffer.end(), [](double value) { return value == 0; });
+        std::copy(expected.begin(), expected.end(), buffer.begin());
+        const bool huge = options.pages != mem::PageKind::standard && count * sizeof(double) >= mem::huge_page_size;
+        const bool matches = buffer.size() == count &&
+                             reinterpret_cast<std::uintptr_t>(buffer.data()) % options.alignment == 0 &&
+                             (huge || buffer.pages() == mem::PageKind::standard) && zeroed &&
+                             (count == 0 || (add(buffer) == add(expected) && max(buffer) == max(expected)));
+        if (!matches)
+            io::out() << "MISMATCH: " << count << " elements with " << mem::to_string(options.pages) << io::endl;
+        passed &= matches;
+
+        if (huge)
+            io::out() << "  " << count << " doubles, asked for " << mem::to_string(options.pages) << " ("
+                << mem::to_string(options.placement) << "), got " << mem::to_string(buffer.pages()) << " ("
+                << mem::to_string(buffer.placement()) << "), "
+                << mem::transparent_huge_bytes(buffer.data(), count * sizeof(double)) / 1024
+                << " KiB in transparent huge pages" << io::endl;
+    }
+
+    using Allocator = mem::huge_page_allocator<std::int64_t>;
+    std::vector<std::int64_t, Allocator> grown{Allocator(options)};
+    for (std::int64_t i = 0; i < 1'000'000; ++i)
+        grown.push_back(i);
+    passed &= add(std::span<const std::int64_t>(grown)) == std::int64_t{999'999} * 1'000'000 / 2;
+    return passed;
+}
+
+/**
+ * @brief True if 'allocate' throws an Exception.
+ */
+template <typename Exception, typename Allocate>
+bool throws(Allocate allocate)
+{
+    try
+    {
+        allocate();
+    }
+    catch (const Exception&)
+    {
+        return true;
+    }
+    return false;
+}
+#endif // VERIFY_ALIGNED_BUFFER
+
+#ifdef VERIFY_STRING_CONCAT
+/**
+ * @brief Joins random pieces with every overload and compares the results
+ * with operator+.
+ */
+template <std::size_t... I>
+bool verify_string_concat(std::mt19937_64& rng, std::index_sequence<I...>)
+{
+    std::uniform_int_distribution<std::size_t> length(0, 40);
+    std::pmr::monotonic_buffer_resource arena;
+    bool passed = true;
+    for (int trial = 0; trial < 10'000; ++trial)
+    {
+        const std::string pieces[] = {std::string(length(rng), static_cast<char>('a' + I))...};
+        const std::string expected = (std::string() + ... + pieces[I]);
+
+        std::string appended = "prefix";
+        add_to(appended, pieces[I]...);
+        passed &= add(pieces[I]...) == expected && std::string_view(add(arena, pieces[I]...)) == expected &&
+                  appended == "prefix" + expected;
+
+        // The null resource throws on any allocation, so a key that fits
+        // proves it never went near the heap.
+        SmallString<64> small(*std::pmr::null_memory_resource());
+        if (expected.size() <= 64)
+            passed &= small.assign(pieces[I]...).view() == expected && !small.on_heap();
+
+        SmallString<16> spilled;
+        passed &= spilled.assign(pieces[I]...).view() == expected && spilled.on_heap() == (expected.size() > 16);
+    }
+    return passed;
+}
+#endif // VERIFY_STRING_CONCAT
+
+#ifdef VERIFY_ARRAY_EXPRESSION
+/**
+ * @brief Evaluates max(add(a, mult(b, 3)), c) fused, one step at a time into
+ * temporaries, and one element at a time with add and max, for random arrays
+ * of lengths around the vector widths, and checks that the results agree bit
+ * for bit. Also checks mixed element types, assigning an expression to its own
+ * operand, and that mismatched lengths are rejected.
+ */
+bool verify_array_expression(std::mt19937_64& rng)
+{
+    using array_expr::Array;
+    std::uniform_real_distribution<double> real_dist(-100.0, 100.0);
+    std::uniform_int_distribution<int> int_dist(-1000, 1000);
+    bool passed = true;
+
+    for (std::size_t count : {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 1000, 4099})
+    {
+        Array<double> a(count), b(count), c(count);
+        std::vector<int> integers(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            a[i] = real_dist(rng);
+            b[i] = real_dist(rng);
+            c[i] = real_dist(rng);
+            integers[i] = int_dist(rng);
+        }
+
+        const Array<double> fused = max(add(a, mult(b, 3)), c);
+        const Array<double> scaled = mult(b, 3);
+        const Array<double> sum = add(a, scaled);
+        const Array<double> stepwise = max(sum, c);
+        passed &= fused.size() == count &&
+                  (count == 0 || std::memcmp(fused.data(), stepwise.data(), count * sizeof(double)) == 0);
+        for (std::size_t i = 0; i < count; ++i)
+            passed &= fused[i] == max(add(a[i], b[i] * 3.0), c[i]);
+
+        // ints times a double is an expression of doubles, and ints with the
+        // default factor stay ints.
+        const Array<double> halves = mult(array_expr::view(integers), 0.5);
+        const Array<int> doubled = mult(array_expr::view(integers));
+        for (std::size_t i = 0; i < count; ++i)
+            passed &= halves[i] == integers[i] * 0.5 && doubled[i] == integers[i] * 2;
+
+        Array<double> in_place = a;
+        in_place = add(in_place, mult(in_place, in_place));
+        for (std::size_t i = 0; i < count; ++i)
+            passed &= in_place[i] == add(a[i], a[i] * a[i]);
+    }
+
+    try
+    {
+        const Array<double> a(4), b(5);
+        const Array<double> mismatched = add(a, b);
+        passed = false;
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+    return passed;
+}
+#endif // VERIFY_ARRAY_EXPRESSION
+
+/**
+ * @brief The streaming mode for column files. The whole column is a single
+ * span into the mapping, so the span overloads reduce it in one call with no
+ * copy, whatever its element type.
+ */
+int reduce_column(std::string_view operation, const std::string& path)
+{
+    const io::ColumnFile file(path);
+    return file.visit([&]<typename T>(std::span<const T> values) {
+        if (values.empty() && operation == "max")
+        {
+            std::cerr << "max: the column is empty" << std::endl;
+            return 1;
+        }
+        const T result = operation == "add" ? add(values) : max(values);
+        io::write_numbers(stdout, std::span<const T>(&result, 1));
+        return 0;
+    });
+}
+
+/**
+ * @brief The streaming mode. Reads every number from the input, one batch at a
+ * time, reduces each batch with the span overloads of add or max, and combines
+ * the batch results with the templates above. Memory use does not depend on
+ * the size of the input.
+ */
+int run_stream(int argc, char* argv[])
+{
+    const std::string_view operation = argc > 2 ? argv[2] : "";
+    if ((operation != "add" && operation != "max") || argc > 4)
+    {
+        std::cerr << "usage: " << argv[0] << " --stream add|max [FILE]" << std::endl;
+        return 2;
+    }
+
+    try
+    {
+        const std::string path = argc > 3 ? argv[3] : "-";
+        if (io::is_column_file(path))
+            return reduce_column(operation, path);
+
+        io::NumberReader reader(path);
+        std::vector<double> batch(io::default_batch);
+        double result = operation == "add" ? 0.0 : -std::numeric_limits<double>::infinity();
+        std::uint64_t count = 0;
+
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+        {
+            const std::span<const double> values(batch.data(), n);
+            result = operation == "add" ? add(result, add(values)) : max(result, max(values));
+            count += n;
+        }
+
+        if (count == 0 && operation == "max")
+        {
+            std::cerr << "max: the input contains no numbers" << std::endl;
+            return 1;
+        }
+        io::write_numbers(stdout, std::span<const double>(&result, 1));
+        return 0;
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string_view(argv[1]) == "--stream")
+        return run_stream(argc, argv);
+
+    // We can now use the 'add' function to add any arithmetic type! The
+    // overloaded function will be 'instantiated' on a case by case basis.
+    io::out() << "Adding integers: 1 + 2 = " << add(1, 2) << io::endl;
+    io::out() << "Adding doubles: 1.0f + 2.5f = " << add(1.0f, 2.5f) << io::endl;
+    io::out() << "Adding chars: 'A' + ' ' = " << add('A', ' ') << io::endl;
+
+    // Strings are added by the overloads in StringConcat.hpp instead, which
+    // take any number of pieces and build the result with one allocation.
+    const std::string user = "daniel";
+    io::out() << "Adding strings: " << add(std::string("user:"), user, ":", std::string_view("session"))
+        << io::endl;
 
     // This section uses the 'max' function to demonstrate the use of multiple
     // parameters/types.
 
     // Either of these examples will work as they both use two parameters of the
     // same type.
-    std::cout << "The maximum of 3 and 7 is " << max(3, 7) << std::endl;
-    std::cout << "The maximum of 2.2 and 2.3 is " << max(2.2, 2.3) << std::endl;
+    io::out() << "The maximum of 3 and 7 is " << max(3, 7) << io::endl;
+    io::out() << "The maximum of 2.2 and 2.3 is " << max(2.2, 2.3) << io::endl;
 
 #ifdef TWO_TYPES_ERROR
     // This attempts to call the max function with two distinct types. We might
@@ -117,18 +579,18 @@ int main()
     // type of the other, but this is not the case. A compiler error will be
     // generated here as no matching function call can be found. Templates 
     // require an EXACT match.
-    std::cout << "The max of 3 and 2.3 is " << max(3, 2.3) << std::endl;
+    io::out() << "The max of 3 and 2.3 is " << max(3, 2.3) << io::endl;
 #endif // TWO_TYPES_ERROR
 
     // We can avoid the TWO_TYPES_ERROR situation above by explicitly casting
     // the arguments into common types by using static_cast. This resolves any
     // ambiguity.
-    std::cout << "The max of 3 and 2.3 is " << max(3, static_cast<int>(2.3)) 
-        << std::endl;
+    io::out() << "The max of 3 and 2.3 is " << max(3, static_cast<int>(2.3)) 
+        << io::endl;
 
     // Alternatively, we can avoid ambiguity by explicitly stating the type of
     // templated function that we would like generated as follows:
-    std::cout << "The max of 3 and 2.3 is " << max<int>(3, 2.3) << std::endl;
+    io::out() << "The max of 3 and 2.3 is " << max<int>(3, 2.3) << io::endl;
     
     // These are workarounds though, and another way to solve this problem is to
     // create a template that allows for multiple types to begin with. Uncomment
@@ -137,5 +599,118 @@ int main()
     // This is a demonstration of the abbreviated templating format supported in 
     // C++20 and beyond. Note that it cannot enforce the usage of a single type
     // parameter.
-    std::cout << "The max of 3 and 2.3 is " << max_abbr(3, 2.3) << std::endl;
+    io::out() << "The max of 3 and 2.3 is " << max_abbr(3, 2.3) << io::endl;
+
+    // The single argument overloads from SpanReduce.hpp reduce an entire array.
+    // A std::vector converts to the matching std::span implicitly.
+    const std::vector<double> samples{1.5, 2.5, -4.0, 8.25, 3.0};
+    io::out() << "Adding a span of doubles (" << to_string(span_reduce_isa())
+        << "): " << add(samples) << io::endl;
+    io::out() << "The max of a span of doubles is " << max(samples) << io::endl;
+
+    // parallel_reduce takes add and max like any other combiner. Here the
+    // templates are given their types explicitly, so each piece is folded one
+    // pair at a time; a lambda forwarding to the whole overload set would let
+    // each piece use the span overloads above instead.
+    const std::vector<int> counts{4, 8, 15, 16, 23, 42};
+    io::out() << "Parallel sum of ints: "
+        << parallel::parallel_reduce(counts, 0, add<int>) << io::endl;
+    io::out() << "Parallel max of ints: "
+        << parallel::parallel_reduce(counts, std::numeric_limits<int>::lowest(), max<int>)
+        << io::endl;
+
+    // The array overloads from ArrayExpression.hpp build an expression instead
+    // of an array at every step, and compute the whole thing in one loop when
+    // it is assigned. No temporary arrays are allocated along the way.
+    const array_expr::Array<double> highs{1.0, 6.0, -2.0, 4.5};
+    const array_expr::Array<double> lows{0.5, -1.0, 3.0, 1.0};
+    const array_expr::Array<double> floors{2.0, 2.0, 2.0, 2.0};
+    const array_expr::Array<double> fused = max(add(highs, mult(lows, 3)), floors);
+    io::out() << "max(add(highs, mult(lows, 3)), floors) =";
+    for (double value : fused)
+        io::out() << ' ' << value;
+    io::out() << io::endl;
+
+#ifdef VERIFY_SPAN_REDUCE
+    std::mt19937_64 rng(42);
+    const bool passed = verify_span_reduce<std::int32_t>(rng) &&
+                        verify_span_reduce<std::int64_t>(rng) &&
+                        verify_span_reduce<float>(rng) &&
+                        verify_span_reduce<double>(rng);
+    io::out() << "SIMD kernels match the scalar kernel: " << (passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_SPAN_REDUCE
+
+#ifdef VERIFY_PARALLEL_REDUCE
+    std::mt19937_64 parallel_rng(7);
+    std::uniform_int_distribution<std::int64_t> integer_dist(-1'000'000, 1'000'000);
+    std::uniform_real_distribution<double> real_dist(-1e6, 1e6);
+    std::vector<std::int64_t> integers(3'000'017);
+    std::vector<double> reals(3'000'017);
+    std::generate(integers.begin(), integers.end(), [&] { return integer_dist(parallel_rng); });
+    std::generate(reals.begin(), reals.end(), [&] { return real_dist(parallel_rng); });
+
+    parallel::ThreadPool serial(1);
+    const double deterministic_sum = parallel::parallel_reduce(
+        reals, 0.0, [](auto... args) { return add(args...); }, parallel::Options{0, true, &serial});
+
+    bool parallel_passed = true;
+    for (std::size_t threads : {1, 2, 3, 8})
+    {
+        parallel::ThreadPool pool(threads);
+        for (int repeat = 0; repeat < 5; ++repeat)
+            parallel_passed &= verify_parallel_reduce(pool, integers, reals, deterministic_sum);
+    }
+    io::out() << "parallel_reduce matches the serial results: " << (parallel_passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_PARALLEL_REDUCE
+
+#ifdef VERIFY_STRING_CONCAT
+    std::mt19937_64 string_rng(13);
+    const bool string_passed = verify_string_concat(string_rng, std::make_index_sequence<1>{}) &&
+                               verify_string_concat(string_rng, std::make_index_sequence<2>{}) &&
+                               verify_string_concat(string_rng, std::make_index_sequence<3>{}) &&
+                               verify_string_concat(string_rng, std::make_index_sequence<6>{});
+    io::out() << "String add matches operator+: " << (string_passed ? "yes" : "NO") << io::endl;
+#endif // VERIFY_STRING_CONCAT
+
+#ifdef VERIFY_ARRAY_EXPRESSION
+    std::mt19937_64 expression_rng(17);
+    const bool expression_passed = verify_array_expression(expression_rng);
+    io::out() << "Fused array expressions match step-by-step evaluation: " << (expression_passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_ARRAY_EXPRESSION
+
+#ifdef VERIFY_COLUMN_FILE
+    std::mt19937_64 column_rng(11);
+    const std::filesystem::path column_path = std::filesystem::temp_directory_path() / "11_6_verify.col";
+    const bool column_passed = verify_column_file<std::int32_t>(column_rng, column_path) &&
+                               verify_column_file<std::int64_t>(column_rng, column_path) &&
+                               verify_column_file<float>(column_rng, column_path) &&
+                               verify_column_file<double>(column_rng, column_path);
+    std::filesystem::remove(column_path);
+    io::out() << "Column files round-trip and reject damage: " << (column_passed ? "yes" : "NO")
+        << io::endl;
+#endif // VERIFY_COLUMN_FILE
+
+#ifdef VERIFY_ALIGNED_BUFFER
+    std::mt19937_64 buffer_rng(23);
+    io::out() << "NUMA nodes: " << mem::numa_node_count() << ", running on node " << mem::current_numa_node()
+        << io::endl;
+    bool buffer_passed = true;
+    for (mem::PageKind pages : {mem::PageKind::standard, mem::PageKind::transparent_huge, mem::PageKind::explicit_huge})
+        for (mem::NumaPlacement placement :
+             {mem::NumaPlacement::first_touch, mem::NumaPlacement::local, mem::NumaPlacement::interleave})
+            buffer_passed &=
+                verify_aligned_buffer(buffer_rng, {.alignment = 4096, .pages = pages, .placement = placement});
+    // A size that wraps around, when multiplied by sizeof(T) or rounded up to
+    // whole pages, must throw rather than map a few bytes.
+    const bool rejected =
+        throws<std::invalid_argument>([] { mem::aligned_buffer<double> misaligned(16, {.alignment = 48}); }) &&
+        throws<std::bad_array_new_length>([] { mem::aligned_buffer<double> overflowing(SIZE_MAX / 4); }) &&
+        throws<std::bad_array_new_length>([] { mem::huge_page_allocator<double>().allocate(SIZE_MAX / 8 + 1); }) &&
+        throws<std::bad_alloc>([] { mem::aligned_buffer<char> wrapping(SIZE_MAX - 10); });
+    io::out() << "aligned_buffer allocates, falls back and reduces correctly: "
+        << (buffer_passed && rejected ? "yes" : "NO") << io::endl;
+#endif // VERIFY_ALIGNED_BUFFER
 }
\ No newline at end of file
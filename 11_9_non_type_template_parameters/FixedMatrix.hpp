@@ -0,0 +1,225 @@
+/**
+ * @file FixedMatrix.hpp
+ * @author Daniel Even
+ * @brief Small vectors and matrices whose extents are non-type template
+ * parameters: fixed_vec<T, N> and fixed_mat<T, R, C>, for the 2-, 3- and
+ * 4-vectors and 3x3 and 4x4 matrices geometry code handles millions of.
+ *
+ * Because N, R and C are template arguments, they are known while compiling,
+ * which buys three things over a matrix class with runtime extents:
+ *
+ * 1) No loops. Every operation is expanded over std::make_index_sequence into
+ * one expression per element, so a 3x3 multiply is 27 multiply-adds in a row
+ * with no counters, no branches and no trip count to guess.
+ *
+ * 2) No storage beyond the elements. A fixed_vec<float, 3> is 12 bytes, and an
+ * array of them is a plain array of floats (see SoaBatch.hpp for turning one
+ * into SIMD lanes).
+ *
+ * 3) Dimension errors are compile errors. Each operation takes the extents of
+ * both operands as separate parameters and static_asserts that they agree,
+ * so multiplying a 3x3 matrix by a 4-vector fails to compile with a message
+ * naming the operation, instead of failing at runtime or, worse, reading past
+ * the end of an array.
+ *
+ * Everything is constexpr, so the same code can fold to constants:
+ *
+ *     constexpr fixed::fixed_mat<int, 2, 2> m{{{{1, 2}}, {{3, 4}}}};
+ *     static_assert(fixed::multiply(m, fixed::fixed_vec<int, 2>{{1, 1}}) == fixed::fixed_vec<int, 2>{{3, 7}});
+ *
+ * The operations are found by argument-dependent lookup, like those of
+ * array_expr in 11_6_function_templates, so add(a, b) works unqualified.
+ */
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace fixed {
+
+/**
+ * @brief Calls f(std::integral_constant<std::size_t, I>{}) for every I in
+ * [0, N), as N separate statements rather than a loop.
+ */
+template <std::size_t N, typename F>
+constexpr void unroll(F&& f)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (f(std::integral_constant<std::size_t, I>{}), ...);
+    }(std::make_index_sequence<N>{});
+}
+
+/**
+ * @brief N values of type T. An aggregate, laid out exactly like T[N].
+ */
+template <typename T, std::size_t N>
+struct fixed_vec
+{
+    static_assert(N > 0, "fixed_vec: N must be at least 1");
+    static_assert(std::is_arithmetic_v<T>, "fixed_vec: T must be an arithmetic type");
+
+    using value_type = T;
+    static constexpr std::size_t extent = N;
+
+    T elements[N];
+
+    constexpr T& operator[](std::size_t i) { return elements[i]; }
+    constexpr const T& operator[](std::size_t i) const { return elements[i]; }
+
+    /**
+     * @brief Element I, checked while compiling.
+     */
+    template <std::size_t I>
+    constexpr T get() const
+    {
+        static_assert(I < N, "fixed_vec::get(): index out of range");
+        return elements[I];
+    }
+
+    /**
+     * @brief Every element set to 'value'.
+     */
+    static constexpr fixed_vec filled(T value)
+    {
+        fixed_vec result{};
+        unroll<N>([&](auto i) { result.elements[i] = value; });
+        return result;
+    }
+
+    friend constexpr bool operator==(const fixed_vec&, const fixed_vec&) = default;
+};
+
+/**
+ * @brief An R x C matrix, stored row by row.
+ */
+template <typename T, std::size_t R, std::size_t C>
+struct fixed_mat
+{
+    static_assert(R > 0 && C > 0, "fixed_mat: R and C must be at least 1");
+
+    using value_type = T;
+    static constexpr std::size_t rows = R;
+    static constexpr std::size_t columns = C;
+
+    fixed_vec<T, C> row[R];
+
+    constexpr T& operator()(std::size_t r, std::size_t c) { return row[r][c]; }
+    constexpr const T& operator()(std::size_t r, std::size_t c) const { return row[r][c]; }
+
+    constexpr fixed_vec<T, R> column(std::size_t c) const
+    {
+        fixed_vec<T, R> result{};
+        unroll<R>([&](auto r) { result[r] = row[r][c]; });
+        return result;
+    }
+
+    /**
+     * @brief The identity matrix. Only defined for square matrices.
+     */
+    static constexpr fixed_mat identity()
+    {
+        static_assert(R == C, "fixed_mat::identity(): the matrix must be square");
+        fixed_mat result{};
+        unroll<R>([&](auto i) { result.row[i][i] = T{1}; });
+        return result;
+    }
+
+    friend constexpr bool operator==(const fixed_mat&, const fixed_mat&) = default;
+};
+
+/**
+ * @brief Element-wise a + b.
+ */
+template <typename T, std::size_t N, std::size_t M>
+constexpr fixed_vec<T, N> add(const fixed_vec<T, N>& a, const fixed_vec<T, M>& b)
+{
+    static_assert(N == M, "add(): the vectors have different lengths");
+    fixed_vec<T, N> result{};
+    unroll<N>([&](auto i) { result[i] = a[i] + b[i]; });
+    return result;
+}
+
+template <typename T, std::size_t R, std::size_t C, std::size_t R2, std::size_t C2>
+constexpr fixed_mat<T, R, C> add(const fixed_mat<T, R, C>& a, const fixed_mat<T, R2, C2>& b)
+{
+    static_assert(R == R2 && C == C2, "add(): the matrices have different shapes");
+    fixed_mat<T, R, C> result{};
+    unroll<R>([&](auto r) { result.row[r] = add(a.row[r], b.row[r]); });
+    return result;
+}
+
+/**
+ * @brief Element-wise maximum, with the same (x < y) ? y : x as max in
+ * 11_6_function_templates.
+ */
+template <typename T, std::size_t N, std::size_t M>
+constexpr fixed_vec<T, N> max(const fixed_vec<T, N>& a, const fixed_vec<T, M>& b)
+{
+    static_assert(N == M, "max(): the vectors have different lengths");
+    fixed_vec<T, N> result{};
+    unroll<N>([&](auto i) { result[i] = (a[i] < b[i]) ? b[i] : a[i]; });
+    return result;
+}
+
+template <typename T, std::size_t R, std::size_t C, std::size_t R2, std::size_t C2>
+constexpr fixed_mat<T, R, C> max(const fixed_mat<T, R, C>& a, const fixed_mat<T, R2, C2>& b)
+{
+    static_assert(R == R2 && C == C2, "max(): the matrices have different shapes");
+    fixed_mat<T, R, C> result{};
+    unroll<R>([&](auto r) { result.row[r] = max(a.row[r], b.row[r]); });
+    return result;
+}
+
+/**
+ * @brief The dot product, summed left to right.
+ */
+template <typename T, std::size_t N, std::size_t M>
+constexpr T dot(const fixed_vec<T, N>& a, const fixed_vec<T, M>& b)
+{
+    static_assert(N == M, "dot(): the vectors have different lengths");
+    T sum = a[0] * b[0];
+    unroll<N - 1>([&](auto i) { sum += a[i + 1] * b[i + 1]; });
+    return sum;
+}
+
+/**
+ * @brief The matrix-vector product m * v.
+ */
+template <typename T, std::size_t R, std::size_t C, std::size_t N>
+constexpr fixed_vec<T, R> multiply(const fixed_mat<T, R, C>& m, const fixed_vec<T, N>& v)
+{
+    static_assert(C == N, "multiply(): the vector length must equal the number of matrix columns");
+    fixed_vec<T, R> result{};
+    unroll<R>([&](auto r) { result[r] = dot(m.row[r], v); });
+    return result;
+}
+
+/**
+ * @brief The matrix product a * b.
+ */
+template <typename T, std::size_t R, std::size_t K, std::size_t K2, std::size_t C>
+constexpr fixed_mat<T, R, C> multiply(const fixed_mat<T, R, K>& a, const fixed_mat<T, K2, C>& b)
+{
+    static_assert(K == K2, "multiply(): the columns of the left matrix must equal the rows of the right one");
+    fixed_mat<T, R, C> result{};
+    // Row r of the result is row r of a times b, i.e. the rows of b weighted by
+    // a(r, k), which keeps every step a whole-row operation.
+    unroll<R>([&](auto r) {
+        unroll<C>([&](auto c) { result.row[r][c] = a.row[r][0] * b.row[0][c]; });
+        unroll<K - 1>([&](auto k) {
+            unroll<C>([&](auto c) { result.row[r][c] += a.row[r][k + 1] * b.row[k + 1][c]; });
+        });
+    });
+    return result;
+}
+
+template <typename T, std::size_t R, std::size_t C>
+constexpr fixed_mat<T, C, R> transpose(const fixed_mat<T, R, C>& m)
+{
+    fixed_mat<T, C, R> result{};
+    unroll<C>([&](auto c) { result.row[c] = m.column(c); });
+    return result;
+}
+
+} // namespace fixed
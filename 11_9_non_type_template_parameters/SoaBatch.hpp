@@ -0,0 +1,315 @@
+/**
+ * @file SoaBatch.hpp
+ * @author Daniel Even
+ * @brief soa_batch<T, N>, many fixed_vec<T, N> stored as a struct of arrays:
+ * all x components together, then all y components, and so on.
+ *
+ * An array of fixed_vec<float, 3> (an array of structs) interleaves x, y and z,
+ * so one SIMD register loaded from it holds parts of different vectors, and
+ * a 3x3 multiply would need shuffles to line the components up. In a
+ * soa_batch, component c of vectors i to i + 7 is one contiguous load, so the
+ * fully unrolled fixed_mat arithmetic of FixedMatrix.hpp runs unchanged with
+ * each SIMD lane holding a different vector:
+ *
+ *     std::vector<fixed::fixed_vec<float, 3>> points = ...;
+ *     fixed::soa_batch<float, 3> batch(points);                 // AoS -> SoA
+ *     fixed::soa_batch<float, 3> moved = fixed::multiply(rotation, batch);
+ *     moved.to_aos(points);                                     // SoA -> AoS
+ *
+ * Each component array is padded with zeros to a multiple of 16 values, so the
+ * batch operations below run in fixed blocks of 16 lanes with no remainder
+ * loop, which lets -O2 vectorize them (see evaluate() in ArrayExpression.hpp
+ * of 11_6_function_templates for the same block structure).
+ *
+ * Converting costs more than a 3x3 transform itself, so the layout pays off
+ * when the vectors stay in a batch across many operations. Every operation
+ * also has an overload writing into an existing batch, which may be one of
+ * its operands, so a loop over batches need not allocate.
+ *
+ * @note The extents are still checked while compiling; only the number of
+ * vectors is a runtime value, and mismatches in it throw
+ * std::invalid_argument.
+ */
+#pragma once
+
+#include "FixedMatrix.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fixed {
+
+namespace detail {
+
+inline constexpr std::size_t soa_block = 16;
+
+/**
+ * @brief Calls f(j) for every lane j in [0, count), where count is a multiple
+ * of soa_block, in blocks the compiler may vectorize without overlap checks.
+ */
+template <typename F>
+inline void for_each_lane(std::size_t count, F&& f)
+{
+    for (std::size_t i = 0; i < count; i += soa_block)
+    {
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#elif defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#endif
+        for (std::size_t j = i; j < i + soa_block; ++j)
+            f(j);
+    }
+}
+
+inline void check_sizes(const char* function, std::size_t left, std::size_t right)
+{
+    if (left != right)
+        throw std::invalid_argument(std::string(function) + "(): the operands hold " + std::to_string(left) +
+                                    " and " + std::to_string(right) + " vectors");
+}
+
+} // namespace detail
+
+template <typename T, std::size_t N>
+class soa_batch
+{
+public:
+    static_assert(N > 0, "soa_batch: N must be at least 1");
+
+    using value_type = T;
+    using vector_type = fixed_vec<T, N>;
+    static constexpr std::size_t extent = N;
+
+    soa_batch() = default;
+
+    /**
+     * @brief 'size' zero vectors.
+     */
+    explicit soa_batch(std::size_t size)
+        : size_(size),
+          stride_((size + detail::soa_block - 1) / detail::soa_block * detail::soa_block),
+          values_(N * stride_, T{})
+    {
+    }
+
+    /**
+     * @brief Converts an array of structs into a batch.
+     */
+    explicit soa_batch(std::span<const vector_type> vectors) { assign(vectors); }
+
+    /**
+     * @brief Replaces the contents with 'vectors', converted from an array of
+     * structs. The storage is reused, so a batch kept across calls does not
+     * allocate once it has held the largest input.
+     */
+    void assign(std::span<const vector_type> vectors)
+    {
+        size_ = vectors.size();
+        stride_ = (size_ + detail::soa_block - 1) / detail::soa_block * detail::soa_block;
+        values_.resize(N * stride_);
+
+        T* const data = values_.data();
+        const vector_type* const in = vectors.data();
+        const std::size_t stride = stride_;
+        auto lane = [&](std::size_t j) { unroll<N>([&](auto c) { data[c * stride + j] = in[j][c]; }); };
+        const std::size_t whole = size_ / detail::soa_block * detail::soa_block;
+        detail::for_each_lane(whole, lane);
+        for (std::size_t j = whole; j < stride_; ++j)
+        {
+            if (j < size_)
+                lane(j);
+            else
+                unroll<N>([&](auto c) { data[c * stride + j] = T{}; });
+        }
+    }
+
+    std::size_t size() const { return size_; }
+
+    /**
+     * @brief Component c of every vector, followed by the zero padding, so the
+     * span holds a multiple of 16 values.
+     */
+    std::span<T> component(std::size_t c) { return {values_.data() + c * stride_, stride_}; }
+    std::span<const T> component(std::size_t c) const { return {values_.data() + c * stride_, stride_}; }
+
+    vector_type get(std::size_t i) const
+    {
+        vector_type vector{};
+        unroll<N>([&](auto c) { vector[c] = values_[c * stride_ + i]; });
+        return vector;
+    }
+
+    void set(std::size_t i, const vector_type& vector)
+    {
+        unroll<N>([&](auto c) { values_[c * stride_ + i] = vector[c]; });
+    }
+
+    /**
+     * @brief Converts the batch back into an array of structs.
+     *
+     * @throws std::invalid_argument if 'out' does not hold size() vectors.
+     */
+    void to_aos(std::span<vector_type> out) const
+    {
+        detail::check_sizes("to_aos", size_, out.size());
+        const T* const data = values_.data();
+        vector_type* const result = out.data();
+        const std::size_t stride = stride_;
+        auto lane = [&](std::size_t j) { unroll<N>([&](auto c) { result[j][c] = data[c * stride + j]; }); };
+        const std::size_t whole = size_ / detail::soa_block * detail::soa_block;
+        detail::for_each_lane(whole, lane);
+        for (std::size_t j = whole; j < size_; ++j)
+            lane(j);
+    }
+
+    std::vector<vector_type> to_aos() const
+    {
+        std::vector<vector_type> out(size_);
+        to_aos(out);
+        return out;
+    }
+
+private:
+    std::size_t size_ = 0;
+    std::size_t stride_ = 0;
+    std::vector<T> values_;
+};
+
+/**
+ * @brief The pointers to every component of 'batch', so that the lane loops
+ * index plain arrays.
+ */
+template <typename T, std::size_t N>
+std::array<const T*, N> components(const soa_batch<T, N>& batch)
+{
+    std::array<const T*, N> pointers{};
+    unroll<N>([&](auto c) { pointers[c] = batch.component(c).data(); });
+    return pointers;
+}
+
+template <typename T, std::size_t N>
+std::array<T*, N> components(soa_batch<T, N>& batch)
+{
+    std::array<T*, N> pointers{};
+    unroll<N>([&](auto c) { pointers[c] = batch.component(c).data(); });
+    return pointers;
+}
+
+/**
+ * @brief add(a[i], b[i]) into out[i] for every i. 'out' may be 'a' or 'b'.
+ *
+ * @throws std::invalid_argument if the batches differ in size.
+ */
+template <typename T, std::size_t N, std::size_t M, std::size_t K>
+void add(const soa_batch<T, N>& a, const soa_batch<T, M>& b, soa_batch<T, K>& out)
+{
+    static_assert(N == M && N == K, "add(): the vectors have different lengths");
+    detail::check_sizes("add", a.size(), b.size());
+    detail::check_sizes("add", a.size(), out.size());
+    const auto x = components(a), y = components(b);
+    const auto z = components(out);
+    detail::for_each_lane(a.component(0).size(), [&](std::size_t j) {
+        unroll<N>([&](auto c) { z[c][j] = x[c][j] + y[c][j]; });
+    });
+}
+
+template <typename T, std::size_t N, std::size_t M>
+soa_batch<T, N> add(const soa_batch<T, N>& a, const soa_batch<T, M>& b)
+{
+    soa_batch<T, N> result(a.size());
+    add(a, b, result);
+    return result;
+}
+
+/**
+ * @brief max(a[i], b[i]) into out[i] for every i. 'out' may be 'a' or 'b'.
+ *
+ * @throws std::invalid_argument if the batches differ in size.
+ */
+template <typename T, std::size_t N, std::size_t M, std::size_t K>
+void max(const soa_batch<T, N>& a, const soa_batch<T, M>& b, soa_batch<T, K>& out)
+{
+    static_assert(N == M && N == K, "max(): the vectors have different lengths");
+    detail::check_sizes("max", a.size(), b.size());
+    detail::check_sizes("max", a.size(), out.size());
+    const auto x = components(a), y = components(b);
+    const auto z = components(out);
+    detail::for_each_lane(a.component(0).size(), [&](std::size_t j) {
+        unroll<N>([&](auto c) { z[c][j] = (x[c][j] < y[c][j]) ? y[c][j] : x[c][j]; });
+    });
+}
+
+template <typename T, std::size_t N, std::size_t M>
+soa_batch<T, N> max(const soa_batch<T, N>& a, const soa_batch<T, M>& b)
+{
+    soa_batch<T, N> result(a.size());
+    max(a, b, result);
+    return result;
+}
+
+/**
+ * @brief dot(a[i], b[i]) into out[i] for every i.
+ *
+ * @throws std::invalid_argument if the batches or 'out' differ in size.
+ */
+template <typename T, std::size_t N, std::size_t M>
+void dot(const soa_batch<T, N>& a, const soa_batch<T, M>& b, std::span<T> out)
+{
+    static_assert(N == M, "dot(): the vectors have different lengths");
+    detail::check_sizes("dot", a.size(), b.size());
+    detail::check_sizes("dot", a.size(), out.size());
+    const auto x = components(a), y = components(b);
+    T* const data = out.data();
+    auto lane = [&](std::size_t j) {
+        T sum = x[0][j] * y[0][j];
+        unroll<N - 1>([&](auto c) { sum += x[c + 1][j] * y[c + 1][j]; });
+        data[j] = sum;
+    };
+    // 'out' is not padded, so the last partial block is computed separately.
+    const std::size_t whole = out.size() / detail::soa_block * detail::soa_block;
+    detail::for_each_lane(whole, lane);
+    for (std::size_t j = whole; j < out.size(); ++j)
+        lane(j);
+}
+
+/**
+ * @brief multiply(m, v[i]) into out[i] for every i: the same unrolled sums as
+ * the fixed_vec overload, with each lane holding a different vector. 'out'
+ * may be 'v'.
+ *
+ * @throws std::invalid_argument if the batches differ in size.
+ */
+template <typename T, std::size_t R, std::size_t C, std::size_t N, std::size_t K>
+void multiply(const fixed_mat<T, R, C>& m, const soa_batch<T, N>& v, soa_batch<T, K>& out)
+{
+    static_assert(C == N, "multiply(): the vector length must equal the number of matrix columns");
+    static_assert(R == K, "multiply(): the result length must equal the number of matrix rows");
+    detail::check_sizes("multiply", v.size(), out.size());
+    const auto x = components(v);
+    const auto z = components(out);
+    // A copy, so that the stores to 'out' cannot change the coefficients and
+    // they stay in registers.
+    const fixed_mat<T, R, C> coefficients = m;
+    detail::for_each_lane(v.component(0).size(), [&](std::size_t j) {
+        // Every component is read before any is written, for when out is v.
+        fixed_vec<T, C> lane{};
+        unroll<C>([&](auto c) { lane[c] = x[c][j]; });
+        const fixed_vec<T, R> result = multiply(coefficients, lane);
+        unroll<R>([&](auto r) { z[r][j] = result[r]; });
+    });
+}
+
+template <typename T, std::size_t R, std::size_t C, std::size_t N>
+soa_batch<T, R> multiply(const fixed_mat<T, R, C>& m, const soa_batch<T, N>& v)
+{
+    soa_batch<T, R> result(v.size());
+    multiply(m, v, result);
+    return result;
+}
+
+} // namespace fixed
@@ -0,0 +1,167 @@
+/**
+ * @file SqrtBatch.cpp
+ * @author Daniel Even
+ * @brief The scalar kernels, the CPUID based kernel selection, and the checks
+ * and error messages shared by every ISA.
+ */
+#include "SqrtBatch.hpp"
+#define SQRT_BATCH_ISA scalar
+#include "SqrtBatchKernels.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/**
+ * @brief There is no scalar estimate instruction worth using, so every
+ * accuracy gets the exact result here.
+ */
+template <typename T, bool Reciprocal>
+bool scalar_sqrt(const T* in, T* out, std::size_t count)
+{
+    bool inside = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const T x = in[i];
+        inside &= Reciprocal ? x > T{0} : x >= T{0};
+        out[i] = Reciprocal ? T{1} / std::sqrt(x) : std::sqrt(x);
+    }
+    return inside;
+}
+
+const SqrtKernels& kernels_for(cpu::Isa isa)
+{
+    if (!cpu::supported(isa))
+        return scalar_sqrt_kernels();
+
+    switch (isa)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case cpu::Isa::avx512:
+        return avx512_sqrt_kernels();
+    case cpu::Isa::avx2:
+        return avx2_sqrt_kernels();
+#endif
+    default:
+        return scalar_sqrt_kernels();
+    }
+}
+
+/**
+ * @brief Throws for the first value outside the domain. Only called once a
+ * kernel has reported that there is one.
+ *
+ * The input may have been overwritten by then, so the value is found from
+ * the output: every kernel computes vectors holding such a value exactly,
+ * which turns it into NaN (or an infinity, for 1 / sqrt(0)).
+ */
+template <typename T>
+[[noreturn]] void throw_domain_error(const char* function, std::span<const T> values, std::span<const T> out,
+                                     bool reciprocal)
+{
+    std::size_t i = 0;
+    while (i < out.size() && !std::isnan(out[i]) && !(reciprocal && std::isinf(out[i])))
+        ++i;
+    if (i == out.size())
+        throw std::invalid_argument(std::string(function) + "(): a value is outside the domain");
+
+    std::string message = std::string(function) + "(): values[" + std::to_string(i) + "]";
+    if (values.data() == out.data())
+        message += reciprocal ? " is not positive" : " is negative or NaN";
+    else if (std::isnan(values[i]))
+        message += " is NaN";
+    else
+        message += " = " + std::to_string(values[i]) + (reciprocal ? " is not positive" : " is negative");
+    throw std::invalid_argument(message);
+}
+
+template <typename T>
+void run(const char* function, std::span<const T> values, std::span<T> out, SqrtKernel<T> kernel, bool reciprocal)
+{
+    if (values.size() != out.size())
+        throw std::invalid_argument(std::string(function) + "(): 'out' holds " + std::to_string(out.size()) +
+                                    " values, expected " + std::to_string(values.size()));
+    if (!kernel(values.data(), out.data(), values.size()))
+        throw_domain_error(function, values, std::span<const T>(out), reciprocal);
+}
+
+std::size_t index(SqrtAccuracy accuracy)
+{
+    const auto i = static_cast<std::size_t>(accuracy);
+    if (i >= sqrt_accuracy_count)
+        throw std::invalid_argument("sqrt_batch(): unknown SqrtAccuracy");
+    return i;
+}
+
+} // namespace
+
+const SqrtKernels& scalar_sqrt_kernels()
+{
+    static constexpr SqrtKernels kernels{
+        {scalar_sqrt<float, false>, scalar_sqrt<float, false>, scalar_sqrt<float, false>},
+        {scalar_sqrt<double, false>, scalar_sqrt<double, false>, scalar_sqrt<double, false>},
+        {scalar_sqrt<float, true>, scalar_sqrt<float, true>, scalar_sqrt<float, true>},
+        {scalar_sqrt<double, true>, scalar_sqrt<double, true>, scalar_sqrt<double, true>},
+    };
+    return kernels;
+}
+
+cpu::Isa sqrt_batch_isa()
+{
+    return cpu::selected<cpu::Isa::avx512, cpu::Isa::avx2>();
+}
+
+const char* to_string(SqrtAccuracy accuracy)
+{
+    switch (accuracy)
+    {
+    case SqrtAccuracy::newton:
+        return "newton";
+    case SqrtAccuracy::estimate:
+        return "estimate";
+    default:
+        return "exact";
+    }
+}
+
+void sqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy, cpu::Isa isa)
+{
+    run("sqrt_batch", values, out, kernels_for(isa).sqrt_f32[index(accuracy)], false);
+}
+
+void sqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy, cpu::Isa isa)
+{
+    run("sqrt_batch", values, out, kernels_for(isa).sqrt_f64[index(accuracy)], false);
+}
+
+void rsqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy, cpu::Isa isa)
+{
+    run("rsqrt_batch", values, out, kernels_for(isa).rsqrt_f32[index(accuracy)], true);
+}
+
+void rsqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy, cpu::Isa isa)
+{
+    run("rsqrt_batch", values, out, kernels_for(isa).rsqrt_f64[index(accuracy)], true);
+}
+
+void sqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy)
+{
+    sqrt_batch(values, out, accuracy, sqrt_batch_isa());
+}
+
+void sqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy)
+{
+    sqrt_batch(values, out, accuracy, sqrt_batch_isa());
+}
+
+void rsqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy)
+{
+    rsqrt_batch(values, out, accuracy, sqrt_batch_isa());
+}
+
+void rsqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy)
+{
+    rsqrt_batch(values, out, accuracy, sqrt_batch_isa());
+}
@@ -0,0 +1,85 @@
+/**
+ * @file SqrtBatch.hpp
+ * @author Daniel Even
+ * @brief Square roots and reciprocal square roots of whole arrays of runtime
+ * values, the counterpart of getSqrt<D>() in main.cpp for values that are
+ * not known while compiling (vector norms, normalizing distances).
+ *
+ * Each call takes one of three accuracies:
+ *
+ * 1) exact: sqrt_batch() is correctly rounded, as std::sqrt is, and
+ * rsqrt_batch() is 1 / std::sqrt(x), rounded twice (within 1.5 ULP).
+ *
+ * 2) newton: the CPU's reciprocal square root estimate refined by one
+ * Newton-Raphson step, y = y * (1.5 - 0.5 * x * y * y), with sqrt(x) taken as
+ * x * y. The step squares the estimate's error, but for floats the rounding
+ * of the step itself then dominates: the measured relative error is about
+ * 2^-22 with either ISA (2^-21.9 with AVX2, 2^-22.4 for sqrt and 2^-22.7 for
+ * rsqrt with AVX-512), a few ULP short of a correctly rounded float. For
+ * doubles it is about 2^-23.4 with AVX2 and 2^-27.5 with AVX-512, roughly
+ * half the bits of a double.
+ *
+ * 3) estimate: the raw estimate, within 1.5 * 2^-12 with AVX2 and 2^-14 with
+ * AVX-512.
+ *
+ * The kernels are built for AVX2 and AVX-512 and picked once at runtime by
+ * CPUID, as the span reductions of 11_6_function_templates are. There is no
+ * scalar estimate instruction, so the scalar fallback computes exactly
+ * whatever the accuracy asked for. The approximate modes also fall back to
+ * the exact instruction for any vector holding a value outside the range the
+ * estimate covers (zero, infinity, subnormals, and for doubles on AVX2 anything
+ * outside the float range, since the estimate is taken in float there).
+ *
+ * Like getSqrt<D>(), whose static_assert rejects anything but D >= 0 (NaN
+ * included), the input is checked as a whole: sqrt_batch() requires every
+ * value to be >= 0 and rsqrt_batch() every value to be > 0. The check is fused
+ * into the kernels, so it costs one compare per vector.
+ *
+ * 'out' must be as long as 'values' and may be the same array, for computing
+ * in place; it must not partially overlap it.
+ */
+#pragma once
+
+#include "CpuDispatch.hpp"
+
+#include <span>
+
+/**
+ * @brief How accurate the results have to be, from slowest to fastest.
+ */
+enum class SqrtAccuracy
+{
+    exact,
+    newton,
+    estimate,
+};
+
+/**
+ * @brief The instruction set selected at startup for the overloads without
+ * a cpu::Isa: AVX-512 or AVX2 if the CPU supports one, scalar otherwise.
+ */
+cpu::Isa sqrt_batch_isa();
+
+const char* to_string(SqrtAccuracy accuracy);
+
+/**
+ * @throws std::invalid_argument if the lengths differ, or a value is negative
+ * or NaN. 'out' is unspecified then.
+ */
+void sqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy = SqrtAccuracy::exact);
+void sqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy = SqrtAccuracy::exact);
+
+/**
+ * @throws std::invalid_argument if the lengths differ, or a value is not
+ * positive (zero, negative or NaN). 'out' is unspecified then.
+ */
+void rsqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy = SqrtAccuracy::exact);
+void rsqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy = SqrtAccuracy::exact);
+
+// These overloads force a specific instruction set, which is how the kernels
+// are checked and benchmarked against each other. An unsupported ISA falls
+// back to the scalar kernels.
+void sqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy, cpu::Isa isa);
+void sqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy, cpu::Isa isa);
+void rsqrt_batch(std::span<const float> values, std::span<float> out, SqrtAccuracy accuracy, cpu::Isa isa);
+void rsqrt_batch(std::span<const double> values, std::span<double> out, SqrtAccuracy accuracy, cpu::Isa isa);
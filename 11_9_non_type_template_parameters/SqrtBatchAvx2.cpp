@@ -0,0 +1,110 @@
+/**
+ * @file SqrtBatchAvx2.cpp
+ * @author Daniel Even
+ * @brief AVX2 square root kernels. This file is compiled with -mavx2 and must
+ * only be called after cpu::supported(cpu::Isa::avx2) has returned true.
+ * AVX2 only has a float reciprocal square root estimate (vrsqrtps, 12 bits),
+ * so the double estimate is taken in float, and covers the float range only.
+ */
+#define SQRT_BATCH_ISA avx2
+#include "SqrtBatchKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2F32
+{
+    using value_type = float;
+    using reg = __m256;
+    using mask = __m256;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const value_type* p) { return _mm256_loadu_ps(p); }
+    static void store(value_type* p, reg v) { _mm256_storeu_ps(p, v); }
+    static reg set1(value_type x) { return _mm256_set1_ps(x); }
+
+    // Lanes [0, count) of a partial vector, as a mask for vmaskmovps.
+    static __m256i first(std::size_t count)
+    {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count)),
+                                  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+    static reg load_partial(const value_type* p, std::size_t count)
+    {
+        const __m256i lanes = first(count);
+        return _mm256_blendv_ps(set1(1.0f), _mm256_maskload_ps(p, lanes), _mm256_castsi256_ps(lanes));
+    }
+    static void store_partial(value_type* p, reg v, std::size_t count) { _mm256_maskstore_ps(p, first(count), v); }
+
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+    static reg sqrt(reg x) { return _mm256_sqrt_ps(x); }
+    static reg rsqrt_estimate(reg x) { return _mm256_rsqrt_ps(x); }
+
+    static bool all_in_estimate_range(reg x)
+    {
+        const reg low = _mm256_cmp_ps(x, set1(std::numeric_limits<float>::min()), _CMP_GE_OQ);
+        const reg high = _mm256_cmp_ps(x, set1(std::numeric_limits<float>::max()), _CMP_LE_OQ);
+        return _mm256_movemask_ps(_mm256_and_ps(low, high)) == 0xff;
+    }
+
+    // NaN compares unordered, so it is outside both domains.
+    static mask not_non_negative(reg x) { return _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGE_UQ); }
+    static mask not_positive(reg x) { return _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGT_UQ); }
+    static mask no_lanes() { return _mm256_setzero_ps(); }
+    static mask merge(mask a, mask b) { return _mm256_or_ps(a, b); }
+    static bool none(mask m) { return _mm256_movemask_ps(m) == 0; }
+};
+
+struct Avx2F64
+{
+    using value_type = double;
+    using reg = __m256d;
+    using mask = __m256d;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const value_type* p) { return _mm256_loadu_pd(p); }
+    static void store(value_type* p, reg v) { _mm256_storeu_pd(p, v); }
+    static reg set1(value_type x) { return _mm256_set1_pd(x); }
+
+    static __m256i first(std::size_t count)
+    {
+        return _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(count)), _mm256_setr_epi64x(0, 1, 2, 3));
+    }
+    static reg load_partial(const value_type* p, std::size_t count)
+    {
+        const __m256i lanes = first(count);
+        return _mm256_blendv_pd(set1(1.0), _mm256_maskload_pd(p, lanes), _mm256_castsi256_pd(lanes));
+    }
+    static void store_partial(value_type* p, reg v, std::size_t count) { _mm256_maskstore_pd(p, first(count), v); }
+
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+    static reg sqrt(reg x) { return _mm256_sqrt_pd(x); }
+    static reg rsqrt_estimate(reg x) { return _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x))); }
+
+    // The estimate is taken in float, so x has to be a normal float.
+    static bool all_in_estimate_range(reg x)
+    {
+        const reg low = _mm256_cmp_pd(x, set1(std::numeric_limits<float>::min()), _CMP_GE_OQ);
+        const reg high = _mm256_cmp_pd(x, set1(std::numeric_limits<float>::max()), _CMP_LE_OQ);
+        return _mm256_movemask_pd(_mm256_and_pd(low, high)) == 0xf;
+    }
+
+    static mask not_non_negative(reg x) { return _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NGE_UQ); }
+    static mask not_positive(reg x) { return _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NGT_UQ); }
+    static mask no_lanes() { return _mm256_setzero_pd(); }
+    static mask merge(mask a, mask b) { return _mm256_or_pd(a, b); }
+    static bool none(mask m) { return _mm256_movemask_pd(m) == 0; }
+};
+
+} // namespace
+
+const SqrtKernels& avx2_sqrt_kernels()
+{
+    static constexpr SqrtKernels kernels = detail::make_sqrt_kernels<Avx2F32, Avx2F64>();
+    return kernels;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file SqrtBatchAvx512.cpp
+ * @author Daniel Even
+ * @brief AVX-512 square root kernels. This file is compiled with -mavx512f and
+ * must only be called after cpu::supported(cpu::Isa::avx512) has returned
+ * true. vrsqrt14ps/pd give a 14-bit estimate for floats and doubles alike, and
+ * the last partial vector is handled with masked loads and stores.
+ */
+#define SQRT_BATCH_ISA avx512
+#include "SqrtBatchKernels.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512F32
+{
+    using value_type = float;
+    using reg = __m512;
+    using mask = __mmask16;
+    static constexpr std::size_t width = 16;
+
+    static reg load(const value_type* p) { return _mm512_loadu_ps(p); }
+    static void store(value_type* p, reg v) { _mm512_storeu_ps(p, v); }
+    static reg set1(value_type x) { return _mm512_set1_ps(x); }
+
+    static mask first(std::size_t count) { return static_cast<mask>((1u << count) - 1); }
+    static reg load_partial(const value_type* p, std::size_t count)
+    {
+        return _mm512_mask_loadu_ps(set1(1.0f), first(count), p);
+    }
+    static void store_partial(value_type* p, reg v, std::size_t count) { _mm512_mask_storeu_ps(p, first(count), v); }
+
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+    static reg sqrt(reg x) { return _mm512_sqrt_ps(x); }
+    static reg rsqrt_estimate(reg x) { return _mm512_rsqrt14_ps(x); }
+
+    static bool all_in_estimate_range(reg x)
+    {
+        const mask low = _mm512_cmp_ps_mask(x, set1(std::numeric_limits<float>::min()), _CMP_GE_OQ);
+        return _mm512_mask_cmp_ps_mask(low, x, set1(std::numeric_limits<float>::max()), _CMP_LE_OQ) == 0xffff;
+    }
+
+    // NaN compares unordered, so it is outside both domains.
+    static mask not_non_negative(reg x) { return _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_NGE_UQ); }
+    static mask not_positive(reg x) { return _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_NGT_UQ); }
+    static mask no_lanes() { return 0; }
+    static mask merge(mask a, mask b) { return a | b; }
+    static bool none(mask m) { return m == 0; }
+};
+
+struct Avx512F64
+{
+    using value_type = double;
+    using reg = __m512d;
+    using mask = __mmask8;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const value_type* p) { return _mm512_loadu_pd(p); }
+    static void store(value_type* p, reg v) { _mm512_storeu_pd(p, v); }
+    static reg set1(value_type x) { return _mm512_set1_pd(x); }
+
+    static mask first(std::size_t count) { return static_cast<mask>((1u << count) - 1); }
+    static reg load_partial(const value_type* p, std::size_t count)
+    {
+        return _mm512_mask_loadu_pd(set1(1.0), first(count), p);
+    }
+    static void store_partial(value_type* p, reg v, std::size_t count) { _mm512_mask_storeu_pd(p, first(count), v); }
+
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+    static reg sqrt(reg x) { return _mm512_sqrt_pd(x); }
+    static reg rsqrt_estimate(reg x) { return _mm512_rsqrt14_pd(x); }
+
+    static bool all_in_estimate_range(reg x)
+    {
+        const mask low = _mm512_cmp_pd_mask(x, set1(std::numeric_limits<double>::min()), _CMP_GE_OQ);
+        return _mm512_mask_cmp_pd_mask(low, x, set1(std::numeric_limits<double>::max()), _CMP_LE_OQ) == 0xff;
+    }
+
+    static mask not_non_negative(reg x) { return _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_NGE_UQ); }
+    static mask not_positive(reg x) { return _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_NGT_UQ); }
+    static mask no_lanes() { return 0; }
+    static mask merge(mask a, mask b) { return a | b; }
+    static bool none(mask m) { return m == 0; }
+};
+
+} // namespace
+
+const SqrtKernels& avx512_sqrt_kernels()
+{
+    static constexpr SqrtKernels kernels = detail::make_sqrt_kernels<Avx512F32, Avx512F64>();
+    return kernels;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file SqrtBatchKernels.hpp
+ * @author Daniel Even
+ * @brief Private to the SqrtBatch*.cpp files. Defines the kernel loop once,
+ * over a description of one vector type, so that every ISA shares the domain
+ * check, the Newton step and the fallback to the exact instruction.
+ *
+ * @note Each SqrtBatch<Isa>.cpp file is compiled with different -m flags, and
+ * defines SQRT_BATCH_ISA to the name of its instruction set before including
+ * this file. The templates below live in an inline namespace of that name, so
+ * every instruction set keeps its own copy.
+ */
+#pragma once
+
+#include "SqrtBatch.hpp"
+
+#include <cstddef>
+#include <limits>
+
+/**
+ * @brief Computes 'count' results from 'in' to 'out'. Returns false if any
+ * input was outside the domain, in which case 'out' is unspecified.
+ */
+template <typename T>
+using SqrtKernel = bool (*)(const T* in, T* out, std::size_t count);
+
+inline constexpr std::size_t sqrt_accuracy_count = 3;
+
+/**
+ * @brief The kernels for one instruction set, indexed by SqrtAccuracy.
+ */
+struct SqrtKernels
+{
+    SqrtKernel<float> sqrt_f32[sqrt_accuracy_count];
+    SqrtKernel<double> sqrt_f64[sqrt_accuracy_count];
+    SqrtKernel<float> rsqrt_f32[sqrt_accuracy_count];
+    SqrtKernel<double> rsqrt_f64[sqrt_accuracy_count];
+};
+
+const SqrtKernels& scalar_sqrt_kernels();
+#if defined(__x86_64__) || defined(__i386__)
+const SqrtKernels& avx2_sqrt_kernels();
+const SqrtKernels& avx512_sqrt_kernels();
+#endif
+
+#ifndef SQRT_BATCH_ISA
+#error "SqrtBatchKernels.hpp: define SQRT_BATCH_ISA to the instruction set this file is compiled for"
+#endif
+
+namespace detail {
+inline namespace SQRT_BATCH_ISA {
+
+/**
+ * @brief The loop for one vector type V, which provides its register and
+ * mask types, width, load/store of whole and partial vectors, the exact
+ * sqrt, the reciprocal square root estimate, and the compares below.
+ *
+ * A partial vector at the end is loaded with 1.0 in its missing lanes, which
+ * is inside every domain and estimate range, so the tail takes the same path
+ * as every other vector.
+ */
+template <typename V, bool Reciprocal, SqrtAccuracy Accuracy>
+inline bool simd_sqrt(const typename V::value_type* in, typename V::value_type* out, std::size_t count)
+{
+    using reg = typename V::reg;
+
+    auto compute = [](reg x) {
+        if constexpr (Accuracy != SqrtAccuracy::exact)
+        {
+            // Vectors with a value the estimate does not cover are rare, and
+            // computed exactly.
+            if (V::all_in_estimate_range(x))
+            {
+                reg y = V::rsqrt_estimate(x);
+                if constexpr (Accuracy == SqrtAccuracy::newton)
+                {
+                    // y * (1.5 - 0.5 * x * y * y)
+                    const reg half_x = V::mul(V::set1(0.5), x);
+                    y = V::mul(y, V::sub(V::set1(1.5), V::mul(half_x, V::mul(y, y))));
+                }
+                return Reciprocal ? y : V::mul(x, y);
+            }
+        }
+        const reg root = V::sqrt(x);
+        return Reciprocal ? V::div(V::set1(1.0), root) : root;
+    };
+
+    typename V::mask outside = V::no_lanes();
+    std::size_t i = 0;
+    for (; i + V::width <= count; i += V::width)
+    {
+        const reg x = V::load(in + i);
+        outside = V::merge(outside, Reciprocal ? V::not_positive(x) : V::not_non_negative(x));
+        V::store(out + i, compute(x));
+    }
+    if (i < count)
+    {
+        const reg x = V::load_partial(in + i, count - i);
+        outside = V::merge(outside, Reciprocal ? V::not_positive(x) : V::not_non_negative(x));
+        V::store_partial(out + i, compute(x), count - i);
+    }
+    return V::none(outside);
+}
+
+/**
+ * @brief Builds the kernel table for one ISA from its vector descriptions.
+ */
+template <typename F32, typename F64>
+constexpr SqrtKernels make_sqrt_kernels()
+{
+    return SqrtKernels{
+        {simd_sqrt<F32, false, SqrtAccuracy::exact>, simd_sqrt<F32, false, SqrtAccuracy::newton>,
+         simd_sqrt<F32, false, SqrtAccuracy::estimate>},
+        {simd_sqrt<F64, false, SqrtAccuracy::exact>, simd_sqrt<F64, false, SqrtAccuracy::newton>,
+         simd_sqrt<F64, false, SqrtAccuracy::estimate>},
+        {simd_sqrt<F32, true, SqrtAccuracy::exact>, simd_sqrt<F32, true, SqrtAccuracy::newton>,
+         simd_sqrt<F32, true, SqrtAccuracy::estimate>},
+        {simd_sqrt<F64, true, SqrtAccuracy::exact>, simd_sqrt<F64, true, SqrtAccuracy::newton>,
+         simd_sqrt<F64, true, SqrtAccuracy::estimate>},
+    };
+}
+
+} // namespace SQRT_BATCH_ISA
+} // namespace detail
@@ -0,0 +1,807 @@
+/**
+ * @file StaticFormat.hpp
+ * @author Daniel Even
+ * @brief Formatting of template arguments while compiling, so that printing a
+ * value that is already a constant costs one fwrite() of bytes that were
+ * rendered by the compiler.
+ *
+ * The format string is itself a template argument, as a fixed_string, and
+ * uses the replacement fields and format specs of std::format:
+ *
+ *     static_print<"status: {} items, load {:.2f}\n", 42, 0.75>();
+ *     static_print<"flags: {:#010b}\n", 5>();
+ *
+ * static_formatted<Format, Values...> is the rendered text, a fixed_string
+ * stored in the binary. Malformed format strings, unsupported specs and
+ * missing arguments are compile errors, as with std::format.
+ *
+ * Specs are [[fill]align][sign][#][0][width][.precision][type]:
+ *
+ * 1) Integers take the types d, x, X, b, B, o and c. Chars print as
+ * characters unless given an integer type, and bools as true and false.
+ *
+ * 2) Floating point values take f, e and g (and F, E, G). Every digit is
+ * exact: the binary value is expanded with big integer arithmetic and rounded
+ * half to even, which is what printf does. Without a type a float prints like
+ * "g", i.e. like std::cout << value does. (std::format would print the
+ * shortest round-trip form instead.) The precision is limited to 40.
+ *
+ * 3) fixed_strings print as text; a precision truncates them.
+ *
+ * 4) A literal class type prints if it has a member
+ * "constexpr void format(static_format::Sink& out) const" that writes to the
+ * sink, with Sink::put() and static_format::write(). Width and alignment are
+ * applied around whatever it writes.
+ */
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include <unistd.h>
+
+/**
+ * @brief A string that can be passed as a template argument. N excludes the
+ * terminating '\0'.
+ */
+template <std::size_t N>
+struct fixed_string
+{
+    char chars[N + 1]{};
+
+    constexpr fixed_string() = default;
+
+    constexpr fixed_string(const char (&text)[N + 1])
+    {
+        std::copy_n(text, N + 1, chars);
+    }
+
+    static constexpr std::size_t size() { return N; }
+    constexpr const char* data() const { return chars; }
+    constexpr std::string_view view() const { return {chars, N}; }
+    constexpr operator std::string_view() const { return view(); }
+};
+
+template <std::size_t M>
+fixed_string(const char (&)[M]) -> fixed_string<M - 1>;
+
+namespace static_format {
+
+/**
+ * @brief Where formatted text goes. Every value is formatted twice, once to
+ * measure it (with no buffer) and once to write it, so formatting code must
+ * write the same thing both times.
+ */
+class Sink
+{
+public:
+    constexpr explicit Sink(char* out = nullptr) : out_(out) {}
+
+    constexpr void put(char c)
+    {
+        if (out_ != nullptr)
+            out_[size_] = c;
+        ++size_;
+    }
+
+    constexpr void put(std::string_view text)
+    {
+        for (char c : text)
+            put(c);
+    }
+
+    constexpr void put(char c, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            put(c);
+    }
+
+    constexpr std::size_t size() const { return size_; }
+
+private:
+    char* out_;
+    std::size_t size_ = 0;
+};
+
+struct Spec
+{
+    char fill = ' ';
+    // '<', '>', '^', or 0 for the type's default.
+    char align = 0;
+    // '-', '+' or ' '.
+    char sign = '-';
+    bool alternate = false;
+    bool zero_pad = false;
+    std::size_t width = 0;
+    // -1 if none was given.
+    int precision = -1;
+    // 0 if none was given.
+    char type = 0;
+};
+
+namespace detail {
+
+constexpr bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+constexpr bool is_align(char c)
+{
+    return c == '<' || c == '>' || c == '^';
+}
+
+constexpr std::size_t parse_number(std::string_view text, std::size_t& i)
+{
+    std::size_t value = 0;
+    while (i < text.size() && is_digit(text[i]))
+    {
+        value = value * 10 + static_cast<std::size_t>(text[i++] - '0');
+        if (value > 1000)
+            throw std::invalid_argument("static_format: width or precision too large");
+    }
+    return value;
+}
+
+constexpr Spec parse_spec(std::string_view text)
+{
+    Spec spec;
+    std::size_t i = 0;
+    if (text.size() >= 2 && is_align(text[1]))
+    {
+        spec.fill = text[0];
+        spec.align = text[1];
+        i = 2;
+    }
+    else if (!text.empty() && is_align(text[0]))
+    {
+        spec.align = text[0];
+        i = 1;
+    }
+    if (i < text.size() && (text[i] == '+' || text[i] == '-' || text[i] == ' '))
+        spec.sign = text[i++];
+    if (i < text.size() && text[i] == '#')
+    {
+        spec.alternate = true;
+        ++i;
+    }
+    if (i < text.size() && text[i] == '0')
+    {
+        spec.zero_pad = true;
+        ++i;
+    }
+    spec.width = parse_number(text, i);
+    if (i < text.size() && text[i] == '.')
+    {
+        ++i;
+        if (i == text.size() || !is_digit(text[i]))
+            throw std::invalid_argument("static_format: '.' must be followed by a precision");
+        spec.precision = static_cast<int>(parse_number(text, i));
+    }
+    if (i < text.size())
+        spec.type = text[i++];
+    if (i != text.size())
+        throw std::invalid_argument("static_format: malformed format spec");
+    return spec;
+}
+
+/**
+ * @brief Writes 'body' padded to the spec's width. 'body' is called twice:
+ * once to measure it and once to write it.
+ */
+template <typename Body>
+constexpr void pad(Sink& out, const Spec& spec, char default_align, Body&& body)
+{
+    Sink measure;
+    body(measure);
+    const std::size_t padding = spec.width > measure.size() ? spec.width - measure.size() : 0;
+    const char align = spec.align ? spec.align : default_align;
+    const std::size_t before = align == '>' ? padding : align == '^' ? padding / 2 : 0;
+    out.put(spec.fill, before);
+    body(out);
+    out.put(spec.fill, padding - before);
+}
+
+/**
+ * @brief Writes a number as sign, prefix and digits, padded either with zeros
+ * between the prefix and the digits or with the fill character outside.
+ */
+constexpr void put_number(Sink& out, const Spec& spec, char sign, std::string_view prefix, std::string_view digits)
+{
+    const std::size_t length = (sign ? 1 : 0) + prefix.size() + digits.size();
+    if (spec.zero_pad && !spec.align)
+    {
+        if (sign)
+            out.put(sign);
+        out.put(prefix);
+        out.put('0', spec.width > length ? spec.width - length : 0);
+        out.put(digits);
+        return;
+    }
+    pad(out, spec, '>', [&](Sink& sink) {
+        if (sign)
+            sink.put(sign);
+        sink.put(prefix);
+        sink.put(digits);
+    });
+}
+
+constexpr char sign_for(bool negative, const Spec& spec)
+{
+    return negative ? '-' : spec.sign == '-' ? 0 : spec.sign;
+}
+
+template <std::integral T>
+constexpr void format_integer(Sink& out, T value, const Spec& spec)
+{
+    unsigned base = 10;
+    std::string_view prefix;
+    bool upper = false;
+    switch (spec.type)
+    {
+    case 0:
+    case 'd': break;
+    case 'x': base = 16; prefix = "0x"; break;
+    case 'X': base = 16; prefix = "0X"; upper = true; break;
+    case 'b': base = 2; prefix = "0b"; break;
+    case 'B': base = 2; prefix = "0B"; break;
+    case 'o': base = 8; prefix = "0"; break;
+    default: throw std::invalid_argument("static_format: invalid type for an integer");
+    }
+    if (spec.precision >= 0)
+        throw std::invalid_argument("static_format: integers take no precision");
+
+    using Unsigned = std::make_unsigned_t<T>;
+    const bool negative = value < 0;
+    Unsigned magnitude = negative ? Unsigned(Unsigned{0} - static_cast<Unsigned>(value)) : static_cast<Unsigned>(value);
+
+    char digits[sizeof(T) * 8];
+    std::size_t count = 0;
+    do
+    {
+        const auto digit = static_cast<unsigned>(magnitude % base);
+        digits[sizeof(digits) - ++count] = static_cast<char>(digit < 10 ? '0' + digit : (upper ? 'A' : 'a') + digit - 10);
+        magnitude /= static_cast<Unsigned>(base);
+    } while (magnitude != 0);
+
+    if (!spec.alternate || (base == 8 && count == 1 && digits[sizeof(digits) - 1] == '0'))
+        prefix = {};
+    put_number(out, spec, sign_for(negative, spec), prefix,
+               std::string_view(digits + sizeof(digits) - count, count));
+}
+
+/**
+ * @brief An unsigned integer of up to 2304 bits, with just the operations
+ * needed to print a double exactly.
+ */
+class BigInt
+{
+public:
+    constexpr explicit BigInt(std::uint64_t value)
+    {
+        limbs_[0] = static_cast<std::uint32_t>(value);
+        limbs_[1] = static_cast<std::uint32_t>(value >> 32);
+        size_ = limbs_[1] ? 2 : limbs_[0] ? 1 : 0;
+    }
+
+    constexpr bool is_zero() const { return size_ == 0; }
+    constexpr bool is_odd() const { return size_ != 0 && (limbs_[0] & 1); }
+
+    constexpr void multiply(std::uint32_t factor)
+    {
+        std::uint64_t carry = 0;
+        for (int i = 0; i < size_; ++i)
+        {
+            const std::uint64_t product = std::uint64_t{limbs_[i]} * factor + carry;
+            limbs_[i] = static_cast<std::uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry)
+            push(static_cast<std::uint32_t>(carry));
+    }
+
+    /**
+     * @brief Divides in place and returns the remainder.
+     */
+    constexpr std::uint32_t divide(std::uint32_t divisor)
+    {
+        std::uint64_t remainder = 0;
+        for (int i = size_ - 1; i >= 0; --i)
+        {
+            const std::uint64_t current = (remainder << 32) | limbs_[i];
+            limbs_[i] = static_cast<std::uint32_t>(current / divisor);
+            remainder = current % divisor;
+        }
+        trim();
+        return static_cast<std::uint32_t>(remainder);
+    }
+
+    constexpr void shift_left(int bits)
+    {
+        const int limbs = bits / 32;
+        const int rest = bits % 32;
+        if (size_ == 0)
+            return;
+        if (rest != 0)
+        {
+            std::uint32_t carry = 0;
+            for (int i = 0; i < size_; ++i)
+            {
+                const std::uint32_t next = limbs_[i] >> (32 - rest);
+                limbs_[i] = (limbs_[i] << rest) | carry;
+                carry = next;
+            }
+            if (carry)
+                push(carry);
+        }
+        if (limbs != 0)
+        {
+            check(size_ + limbs);
+            for (int i = size_ - 1; i >= 0; --i)
+                limbs_[i + limbs] = limbs_[i];
+            for (int i = 0; i < limbs; ++i)
+                limbs_[i] = 0;
+            size_ += limbs;
+        }
+    }
+
+    /**
+     * @brief Shifts right and returns true if any bit shifted out was set.
+     */
+    constexpr bool shift_right(int bits)
+    {
+        bool sticky = false;
+        const int limbs = std::min(bits / 32, size_);
+        const int rest = bits % 32;
+        for (int i = 0; i < limbs; ++i)
+            sticky |= limbs_[i] != 0;
+        for (int i = 0; i + limbs < size_; ++i)
+            limbs_[i] = limbs_[i + limbs];
+        size_ -= limbs;
+        if (rest != 0 && size_ != 0)
+        {
+            sticky |= (limbs_[0] & ((std::uint32_t{1} << rest) - 1)) != 0;
+            for (int i = 0; i < size_; ++i)
+                limbs_[i] = (limbs_[i] >> rest) | (i + 1 < size_ ? limbs_[i + 1] << (32 - rest) : 0);
+        }
+        trim();
+        return sticky;
+    }
+
+    constexpr void increment()
+    {
+        for (int i = 0; i < size_; ++i)
+        {
+            if (++limbs_[i] != 0)
+                return;
+        }
+        push(1);
+    }
+
+    /**
+     * @brief Writes the decimal digits to 'out', which must hold 700 chars,
+     * and returns how many there are.
+     */
+    constexpr std::size_t to_decimal(char* out) const
+    {
+        BigInt rest = *this;
+        char reversed[700];
+        std::size_t count = 0;
+        do
+        {
+            std::uint32_t chunk = rest.divide(1'000'000'000);
+            for (int i = 0; i < 9 && (chunk != 0 || !rest.is_zero() || i == 0); ++i)
+            {
+                reversed[count++] = static_cast<char>('0' + chunk % 10);
+                chunk /= 10;
+            }
+        } while (!rest.is_zero());
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = reversed[count - 1 - i];
+        return count;
+    }
+
+private:
+    static constexpr int capacity = 72;
+
+    constexpr void check(int size) const
+    {
+        if (size > capacity)
+            throw std::invalid_argument("static_format: number too large");
+    }
+
+    constexpr void push(std::uint32_t limb)
+    {
+        check(size_ + 1);
+        limbs_[size_++] = limb;
+    }
+
+    constexpr void trim()
+    {
+        while (size_ > 0 && limbs_[size_ - 1] == 0)
+            --size_;
+    }
+
+    std::uint32_t limbs_[capacity]{};
+    int size_ = 0;
+};
+
+/**
+ * @brief A finite double as mantissa * 2^exponent.
+ */
+struct Decomposed
+{
+    std::uint64_t mantissa;
+    int exponent;
+    bool negative;
+};
+
+constexpr Decomposed decompose(double value)
+{
+    const auto bits = std::bit_cast<std::uint64_t>(value);
+    const auto biased = static_cast<int>((bits >> 52) & 0x7FF);
+    const std::uint64_t fraction = bits & ((std::uint64_t{1} << 52) - 1);
+    if (biased == 0)
+        return {fraction, -1074, (bits >> 63) != 0};
+    return {fraction | (std::uint64_t{1} << 52), biased - 1075, (bits >> 63) != 0};
+}
+
+/**
+ * @brief mantissa * 2^exponent * 10^scale, rounded half to even to an
+ * integer. Rounding looks at one extra bit (the half) and at whether anything
+ * below it was non-zero.
+ */
+constexpr BigInt round_scaled(const Decomposed& d, int scale)
+{
+    BigInt value(d.mantissa);
+    value.shift_left(1);
+    if (d.exponent > 0)
+        value.shift_left(d.exponent);
+    for (int i = 0; i < scale; ++i)
+        value.multiply(10);
+
+    bool sticky = false;
+    if (d.exponent < 0)
+        sticky |= value.shift_right(-d.exponent);
+    for (int i = 0; i > scale; --i)
+        sticky |= value.divide(10) != 0;
+
+    const bool half = value.is_odd();
+    value.shift_right(1);
+    if (half && (sticky || value.is_odd()))
+        value.increment();
+    return value;
+}
+
+/**
+ * @brief Digits with 'precision' of them after the decimal point. The point
+ * is left out if there are none after it, unless 'alternate' is set.
+ */
+constexpr std::size_t fixed_digits(const Decomposed& d, int precision, bool alternate, char* out)
+{
+    const auto fraction = static_cast<std::size_t>(precision);
+    char digits[700];
+    const std::size_t count = round_scaled(d, precision).to_decimal(digits);
+
+    // Zeros in front, so that there is at least one digit before the point.
+    const std::size_t zeros = count <= fraction ? fraction + 1 - count : 0;
+    const std::size_t total = zeros + count;
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < total; ++i)
+    {
+        if (i == total - fraction)
+            out[length++] = '.';
+        out[length++] = i < zeros ? '0' : digits[i - zeros];
+    }
+    if (fraction == 0 && alternate)
+        out[length++] = '.';
+    return length;
+}
+
+/**
+ * @brief precision + 1 significant digits and the decimal exponent of the
+ * first one.
+ */
+constexpr int exponent_digits(const Decomposed& d, int precision, char* digits)
+{
+    if (d.mantissa == 0)
+    {
+        for (int i = 0; i <= precision; ++i)
+            digits[i] = '0';
+        return 0;
+    }
+
+    // floor(log10(value)), possibly off by one, corrected below.
+    const int binary = static_cast<int>(std::bit_width(d.mantissa)) - 1 + d.exponent;
+    int exponent = static_cast<int>((binary * 78913LL) >> 18);
+    for (;;)
+    {
+        const std::size_t count = round_scaled(d, precision - exponent).to_decimal(digits);
+        if (count == static_cast<std::size_t>(precision) + 1)
+            return exponent;
+        // 9.99... can round up to 10.0, which has one digit too many.
+        exponent += count > static_cast<std::size_t>(precision) + 1 ? 1 : -1;
+    }
+}
+
+constexpr std::size_t put_exponent_form(const char* digits, int precision, int exponent, bool alternate,
+                                        char e, char* out)
+{
+    std::size_t length = 0;
+    out[length++] = digits[0];
+    if (precision > 0 || alternate)
+        out[length++] = '.';
+    for (int i = 1; i <= precision; ++i)
+        out[length++] = digits[i];
+    out[length++] = e;
+    out[length++] = exponent < 0 ? '-' : '+';
+    const int magnitude = exponent < 0 ? -exponent : exponent;
+    if (magnitude >= 100)
+        out[length++] = static_cast<char>('0' + magnitude / 100);
+    out[length++] = static_cast<char>('0' + magnitude / 10 % 10);
+    out[length++] = static_cast<char>('0' + magnitude % 10);
+    return length;
+}
+
+/**
+ * @brief Removes trailing zeros after the decimal point, and the point itself
+ * if nothing is left after it, from out[begin, end). Returns the new end.
+ */
+constexpr std::size_t strip_zeros(char* out, std::size_t begin, std::size_t end)
+{
+    std::size_t point = end;
+    for (std::size_t i = begin; i < end; ++i)
+        if (out[i] == '.')
+            point = i;
+    if (point == end)
+        return end;
+    std::size_t last = end;
+    while (last > point + 1 && out[last - 1] == '0')
+        --last;
+    if (last == point + 1)
+        last = point;
+    return last;
+}
+
+constexpr void format_float(Sink& out, double value, const Spec& spec)
+{
+    if (spec.precision > 40)
+        throw std::invalid_argument("static_format: a precision above 40 is not supported");
+
+    char type = spec.type ? spec.type : 'g';
+    const bool upper = type == 'F' || type == 'E' || type == 'G';
+    if (upper)
+        type = static_cast<char>(type - 'A' + 'a');
+    if (type != 'f' && type != 'e' && type != 'g')
+        throw std::invalid_argument("static_format: invalid type for a floating point value");
+
+    const auto bits = std::bit_cast<std::uint64_t>(value);
+    const bool negative = (bits >> 63) != 0;
+    if (((bits >> 52) & 0x7FF) == 0x7FF)
+    {
+        const bool nan = (bits & ((std::uint64_t{1} << 52) - 1)) != 0;
+        Spec text_spec = spec;
+        text_spec.zero_pad = false;
+        put_number(out, text_spec, sign_for(negative && !nan, spec), {},
+                   nan ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf"));
+        return;
+    }
+
+    const Decomposed d = decompose(value);
+    char text[800];
+    std::size_t length = 0;
+    int precision = spec.precision < 0 ? 6 : spec.precision;
+
+    if (type == 'f')
+        length = fixed_digits(d, precision, spec.alternate, text);
+    else if (type == 'e')
+    {
+        char digits[700];
+        const int exponent = exponent_digits(d, precision, digits);
+        length = put_exponent_form(digits, precision, exponent, spec.alternate, upper ? 'E' : 'e', text);
+    }
+    else
+    {
+        // %g: the exponent form's exponent X decides. Fixed if -4 <= X < P.
+        if (precision == 0)
+            precision = 1;
+        char digits[700];
+        const int exponent = exponent_digits(d, precision - 1, digits);
+        if (exponent >= -4 && exponent < precision)
+        {
+            length = fixed_digits(d, precision - 1 - exponent, spec.alternate, text);
+            if (!spec.alternate)
+                length = strip_zeros(text, 0, length);
+        }
+        else
+        {
+            length = put_exponent_form(digits, precision - 1, exponent, spec.alternate, upper ? 'E' : 'e', text);
+            if (!spec.alternate)
+            {
+                std::size_t e = 0;
+                while (text[e] != 'e' && text[e] != 'E')
+                    ++e;
+                const std::size_t kept = strip_zeros(text, 0, e);
+                for (std::size_t i = e; i < length; ++i)
+                    text[kept + i - e] = text[i];
+                length -= e - kept;
+            }
+        }
+    }
+
+    put_number(out, spec, sign_for(negative, spec), {}, std::string_view(text, length));
+}
+
+template <typename T>
+concept SelfFormatting = requires(const T& value, Sink& sink) { value.format(sink); };
+
+template <typename T>
+constexpr void format_value(Sink& out, const T& value, const Spec& spec)
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        if (spec.type && spec.type != 's')
+            format_integer(out, static_cast<int>(value), spec);
+        else
+            pad(out, spec, '<', [&](Sink& sink) { sink.put(value ? "true" : "false"); });
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        if (spec.type && spec.type != 'c')
+            format_integer(out, value, spec);
+        else
+            pad(out, spec, '<', [&](Sink& sink) { sink.put(value); });
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        if (spec.type == 'c')
+        {
+            Spec char_spec = spec;
+            char_spec.type = 0;
+            format_value(out, static_cast<char>(value), char_spec);
+        }
+        else
+            format_integer(out, value, spec);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+        format_float(out, static_cast<double>(value), spec);
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+    {
+        if (spec.type && spec.type != 's')
+            throw std::invalid_argument("static_format: invalid type for a string");
+        std::string_view text = value;
+        if (spec.precision >= 0)
+            text = text.substr(0, static_cast<std::size_t>(spec.precision));
+        pad(out, spec, '<', [&](Sink& sink) { sink.put(text); });
+    }
+    else if constexpr (SelfFormatting<T>)
+        pad(out, spec, '<', [&](Sink& sink) { value.format(sink); });
+    else
+        static_assert(SelfFormatting<T>, "static_format: this type has no format(Sink&) member");
+}
+
+template <auto... Values>
+constexpr void format_argument(Sink& out, std::size_t index, const Spec& spec)
+{
+    std::size_t i = 0;
+    ((i++ == index ? format_value(out, Values, spec) : void()), ...);
+}
+
+template <auto... Values>
+constexpr void format_all(Sink& out, std::string_view format)
+{
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < format.size(); ++i)
+    {
+        const char c = format[i];
+        if (c == '}')
+        {
+            if (i + 1 == format.size() || format[i + 1] != '}')
+                throw std::invalid_argument("static_format: unmatched '}'");
+            out.put('}');
+            ++i;
+        }
+        else if (c != '{')
+            out.put(c);
+        else if (i + 1 < format.size() && format[i + 1] == '{')
+        {
+            out.put('{');
+            ++i;
+        }
+        else
+        {
+            const std::size_t close = format.find('}', i);
+            if (close == std::string_view::npos)
+                throw std::invalid_argument("static_format: unmatched '{'");
+            const std::string_view field = format.substr(i + 1, close - i - 1);
+            const std::size_t colon = field.find(':');
+            const std::string_view id = field.substr(0, colon);
+
+            std::size_t index = next++;
+            if (!id.empty())
+            {
+                std::size_t at = 0;
+                index = parse_number(id, at);
+                if (at != id.size())
+                    throw std::invalid_argument("static_format: malformed argument index");
+            }
+            if (index >= sizeof...(Values))
+                throw std::invalid_argument("static_format: not enough arguments for the format string");
+
+            format_argument<Values...>(out, index, parse_spec(colon == std::string_view::npos ? "" : field.substr(colon + 1)));
+            i = close;
+        }
+    }
+}
+
+template <fixed_string Format, auto... Values>
+consteval auto render()
+{
+    constexpr std::size_t size = [] {
+        Sink measure;
+        format_all<Values...>(measure, Format.view());
+        return measure.size();
+    }();
+
+    fixed_string<size> result;
+    Sink sink(result.chars);
+    format_all<Values...>(sink, Format.view());
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Formats one value into a sink with a format spec (the part after the
+ * ':' in a replacement field), for use in format() members.
+ */
+template <typename T>
+constexpr void write(Sink& out, const T& value, std::string_view spec = {})
+{
+    detail::format_value(out, value, detail::parse_spec(spec));
+}
+
+} // namespace static_format
+
+/**
+ * @brief The text of Format with Values substituted, rendered while compiling.
+ */
+template <fixed_string Format, auto... Values>
+inline constexpr auto static_formatted = static_format::detail::render<Format, Values...>();
+
+/**
+ * @brief Prints the pre-rendered text with a single fwrite().
+ */
+template <fixed_string Format, auto... Values>
+void static_print(std::FILE* out = stdout)
+{
+    constexpr const auto& text = static_formatted<Format, Values...>;
+    std::fwrite(text.data(), 1, text.size(), out);
+}
+
+/**
+ * @brief Writes the pre-rendered text straight to a file descriptor, without
+ * going through stdio. Anything still buffered in stdout is not flushed first,
+ * so mixing the two can reorder output. Returns false if the write fails.
+ */
+template <fixed_string Format, auto... Values>
+bool static_write(int fd)
+{
+    constexpr const auto& text = static_formatted<Format, Values...>;
+    std::size_t written = 0;
+    while (written < text.size())
+    {
+        const ssize_t n = ::write(fd, text.data() + written, text.size() - written);
+        if (n <= 0)
+            return false;
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
@@ -16,9 +16,49 @@
  * 
  * The primary use case for non-type template parameters is to pass a constexpr
  * to a function. This allows for the use of static_assert of parameters.
+ *
+ * ConstexprMath.hpp takes this further: since the math functions there are
+ * constexpr, getSqrt<D>() is evaluated entirely at compile time, and whole
+ * lookup tables can be generated from a function and a range passed as
+ * template arguments.
+ *
+ * StaticFormat.hpp does the same for printing: print<N>() and print_auto<N>()
+ * format N while compiling, so all that is left at runtime is copying bytes
+ * stored in the binary to the output.
+ *
+ * @note Run with "--stream [FILE]" to print the square root of every number in
+ * FILE (or stdin), with the same domain check getSqrt<D>() makes at compile
+ * time made at runtime instead. Parsing, the square roots, formatting and
+ * writing run as a Pipeline (see Pipeline.hpp), one thread each. See
+ * run_stream() below.
+ *
+ * @note SqrtBatch.hpp is the runtime counterpart of getSqrt<D>(): square
+ * roots and reciprocal square roots of whole arrays with AVX2 or AVX-512,
+ * exactly or to a chosen accuracy, with the same domain check.
+ *
+ * @note FixedMatrix.hpp puts non-type template parameters to work as extents:
+ * fixed_vec<T, N> and fixed_mat<T, R, C> operations are unrolled completely
+ * and reject mismatched dimensions with a static_assert. SoaBatch.hpp stores
+ * many such vectors as a struct of arrays, so the same operations run with
+ * one vector per SIMD lane.
  */
 #include <iostream>
 #include <cmath>
+#include <cstdio>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FixedMatrix.hpp"
+#include "NonTypeTemplates.hpp"
+#include "NumberStream.hpp"
+#include "OutputSink.hpp"
+#include "Pipeline.hpp"
+#include "SoaBatch.hpp"
+#include "SqrtBatch.hpp"
+#include "StaticFormat.hpp"
 
 // We want to enforce the usage of C++20 in this section.
 #if __cplusplus < 202002L
@@ -33,74 +73,857 @@
 // conversion is not automatically allowed for a function template parameter.
 // #define DEMO_TYPE_CONVERSION_ERROR
 
+// Uncomment this section to demonstrate the static_assert (at compile time)
+// when a 3x3 matrix is multiplied by a vector of length 4.
+// #define DEMO_EXTENT_MISMATCH_ERROR
+
+// Uncomment this section to measure the ULP error of every function in
+// ConstexprMath.hpp against <cmath>.
+// #define VERIFY_CONSTEXPR_MATH
+
+// Uncomment this section to compare the output of StaticFormat.hpp against
+// snprintf for a few thousand values.
+// #define VERIFY_STATIC_FORMAT
+
+// Uncomment this section to check sqrt_batch() and rsqrt_batch() from
+// SqrtBatch.hpp against long double square roots on every instruction set and
+// accuracy, and check that out-of-domain input is rejected.
+// #define VERIFY_SQRT_BATCH
+
+// Uncomment this section to check every fixed_vec and fixed_mat operation in
+// FixedMatrix.hpp, and every soa_batch operation in SoaBatch.hpp, against
+// plain loops over runtime extents.
+// #define VERIFY_FIXED_EXTENT
+
+// Uncomment this section to check SpscQueue and Pipeline from several threads:
+// values arrive in order through capacity-1 queues with both sides sleeping,
+// close() drains, cancel() wakes a blocked side, and a throwing stage stops
+// the pipeline. Build with -fsanitize=thread as well to check for data races.
+// #define VERIFY_PIPELINE
+
+#ifdef VERIFY_CONSTEXPR_MATH
+#include <bit>
+#include <cstdint>
+#include <random>
+#endif // VERIFY_CONSTEXPR_MATH
+
+#ifdef VERIFY_STATIC_FORMAT
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#endif // VERIFY_STATIC_FORMAT
+
+#ifdef VERIFY_SQRT_BATCH
+#include <algorithm>
+#include <limits>
+#include <random>
+#endif // VERIFY_SQRT_BATCH
+
+#ifdef VERIFY_FIXED_EXTENT
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#endif // VERIFY_FIXED_EXTENT
+
+#ifdef VERIFY_PIPELINE
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#endif // VERIFY_PIPELINE
+
 /**
  * @brief A trivial example of using an integer as a function template parameter. 
+ * N is formatted while compiling, so printing it is a single copy.
  */
 template <int N>
 void print()
 {
-    std::cout << N << std::endl;
+    io::out() << static_formatted<"{}", N>.view() << io::endl;
 }
 
+// getSqrt<D>() is an example of how to use function template parameters
+// instead of function parameters as a workaround on the restriction against
+// using constexpr parameters. It is defined in NonTypeTemplates.hpp, part of
+// the cpp_concepts_core library, and static_asserts that D is non-negative.
+
 /**
- * @brief This function is an example of how to use function template parameters
- * instead of function parameters as a workaround on the restriction against
- * using constexpr parameters.
+ * @brief Since C++17, the auto keyword may be used in place of an actual type
+ * in order to indicate the the compiler should determine the type.
  */
-template <double D>
-double getSqrt()
+template <auto N>
+void print_auto()
 {
-    static_assert(D >= 0.0, "getSqrt(): D must be non-negative");
+    io::out() << static_formatted<"{}", N>.view() << io::endl;
+}
+
+/**
+ * @brief Since C++20 a literal class type can be a template parameter too.
+ * format() lets print_auto<N>() print one.
+ */
+struct Version
+{
+    int major;
+    int minor;
+    int patch;
 
-    if constexpr (D >= 0)
-        return std::sqrt(D);
+    constexpr void format(static_format::Sink& out) const
+    {
+        static_format::write(out, major);
+        out.put('.');
+        static_format::write(out, minor);
+        out.put('.');
+        static_format::write(out, patch);
+    }
+};
 
-    return 0.0;
+#ifdef VERIFY_CONSTEXPR_MATH
+/**
+ * @brief Distance between two doubles in units in the last place.
+ */
+std::uint64_t ulp_distance(double a, double b)
+{
+    if (a == b || (a != a && b != b))
+        return 0;
+
+    auto ordered = [](double x) {
+        const auto bits = std::bit_cast<std::int64_t>(x);
+        return bits < 0 ? std::numeric_limits<std::int64_t>::min() - bits : bits;
+    };
+    const std::int64_t ia = ordered(a);
+    const std::int64_t ib = ordered(b);
+    return ia > ib ? static_cast<std::uint64_t>(ia) - ib : static_cast<std::uint64_t>(ib) - ia;
 }
 
 /**
- * @brief Since C++17, the auto keyword may be used in place of an actual type
- * in order to indicate the the compiler should determine the type.
+ * @brief Reports the largest ULP error of 'ours' against 'reference' over one
+ * million uniformly distributed arguments in [lo, hi].
  */
-template <auto N>
-void print_auto()
+template <typename Ours, typename Reference>
+void verify(const char* name, Ours ours, Reference reference, double lo, double hi)
 {
-    std::cout << N << std::endl;
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> dist(lo, hi);
+    std::uint64_t worst = 0;
+    double worst_x = 0.0;
+    for (int i = 0; i < 1'000'000; ++i)
+    {
+        const double x = dist(rng);
+        const std::uint64_t error = ulp_distance(ours(x), reference(x));
+        if (error > worst)
+        {
+            worst = error;
+            worst_x = x;
+        }
+    }
+    io::out() << name << " on [" << lo << ", " << hi << "]: max " << worst
+              << " ULP (at " << worst_x << ")" << io::endl;
 }
+#endif // VERIFY_CONSTEXPR_MATH
 
-int main()
+#ifdef VERIFY_STATIC_FORMAT
+/**
+ * @brief 512 doubles spread over the whole finite range, from a constexpr
+ * xorshift generator, so that they can be template arguments.
+ */
+constexpr auto format_samples = [] {
+    std::array<double, 512> samples{};
+    std::uint64_t state = 0x9E3779B97F4A7C15;
+    for (double& sample : samples)
+    {
+        do
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            sample = std::bit_cast<double>(state);
+        } while (sample != sample || sample - sample != 0.0);
+    }
+    // Some round numbers, and values whose last digit rounds half to even.
+    samples[0] = 0.0;
+    samples[1] = -0.0;
+    samples[2] = 0.5;
+    samples[3] = 2.5;
+    samples[4] = 0.125;
+    samples[5] = 1e300;
+    samples[6] = 5e-324;
+    samples[7] = 9.9999999;
+    return samples;
+}();
+
+/**
+ * @brief Compares static_formatted<Format, sample> against snprintf(Printf,
+ * sample) for every sample, and returns the number of mismatches.
+ */
+template <fixed_string Format, fixed_string Printf, std::size_t... I>
+int verify_static_format(std::index_sequence<I...>)
+{
+    int mismatches = 0;
+    auto check = [&](std::string_view ours, double sample) {
+        char expected[512];
+        const int length = std::snprintf(expected, sizeof(expected), Printf.data(), sample);
+        if (ours != std::string_view(expected, static_cast<std::size_t>(length)))
+        {
+            if (mismatches++ < 5)
+                io::out() << "  " << Format.data() << ": \"" << ours << "\" instead of \"" << expected << "\"" << io::endl;
+        }
+    };
+    (check(static_formatted<Format, format_samples[I]>.view(), format_samples[I]), ...);
+    io::out() << Format.data() << " against " << Printf.data() << ": " << mismatches << " mismatches in "
+              << sizeof...(I) << " values" << io::endl;
+    return mismatches;
+}
+#endif // VERIFY_STATIC_FORMAT
+
+#ifdef VERIFY_SQRT_BATCH
+/**
+ * @brief The largest relative error each accuracy may have: one rounding for
+ * exact, and for the approximate modes what the estimate instruction
+ * guarantees (2^-11 for vrsqrtps, 2^-14 for vrsqrt14ps), squared by the
+ * Newton step, plus a few roundings.
+ */
+template <typename T>
+long double sqrt_batch_bound(cpu::Isa isa, SqrtAccuracy accuracy)
+{
+    const long double rounding = std::numeric_limits<T>::epsilon();
+    if (isa == cpu::Isa::scalar || accuracy == SqrtAccuracy::exact)
+        return rounding;
+    const long double estimate = isa == cpu::Isa::avx2 ? 0x1p-11L : 0x1p-14L;
+    if (accuracy == SqrtAccuracy::estimate)
+        return estimate;
+    return std::max(2.0L * estimate * estimate, 4.0L * rounding);
+}
+
+/**
+ * @brief Checks sqrt_batch() or rsqrt_batch() for one type on one ISA and at
+ * one accuracy, over 100003 values spread across all exponents (so the last
+ * vector is partial) and the edges of the domain. Returns the number of
+ * failures.
+ */
+template <typename T, bool Reciprocal>
+int verify_sqrt_batch(cpu::Isa isa, SqrtAccuracy accuracy)
+{
+    using limits = std::numeric_limits<T>;
+    std::mt19937_64 rng(18);
+    std::uniform_real_distribution<long double> exponent(limits::min_exponent - limits::digits,
+                                                         limits::max_exponent);
+    std::vector<T> values(100003);
+    for (T& value : values)
+        value = static_cast<T>(std::exp2(exponent(rng)));
+    const T edges[] = {limits::denorm_min(), limits::min(), T{1}, limits::max(), limits::infinity(), T{0}};
+    std::copy(std::begin(edges), std::end(edges) - (Reciprocal ? 1 : 0), values.begin() + 11);
+
+    std::vector<T> results(values.size());
+    if constexpr (Reciprocal)
+        rsqrt_batch(std::span<const T>(values), std::span<T>(results), accuracy, isa);
+    else
+        sqrt_batch(std::span<const T>(values), std::span<T>(results), accuracy, isa);
+
+    int failures = 0;
+    long double worst = 0.0L;
+    const long double bound = sqrt_batch_bound<T>(isa, accuracy);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        const long double root = std::sqrt(static_cast<long double>(values[i]));
+        const T expected = static_cast<T>(Reciprocal ? 1.0L / root : root);
+        long double error = 0.0L;
+        if (expected != results[i])
+        {
+            // Results of subnormal magnitude are measured in absolute terms.
+            error = std::fabs((static_cast<long double>(results[i]) - expected) /
+                              std::max<long double>(std::fabs(expected), limits::min()));
+        }
+        if (!(error <= bound) && failures++ < 3)
+            io::out() << "  " << values[i] << ": " << results[i] << " instead of " << expected << io::endl;
+        worst = std::max(worst, error);
+    }
+    io::out() << (Reciprocal ? "rsqrt_batch<" : "sqrt_batch<") << (sizeof(T) == 4 ? "float" : "double") << "> "
+              << to_string(isa) << " " << to_string(accuracy) << ": max relative error 2^"
+              << (worst > 0.0L ? static_cast<double>(std::log2(worst)) : -limits::infinity()) << ", "
+              << (failures == 0 ? "ok" : "FAILED") << io::endl;
+    return failures;
+}
+
+/**
+ * @brief Checks that out-of-domain input and mismatched lengths are rejected,
+ * also when computing in place. Returns the number of failures.
+ */
+int verify_sqrt_batch_errors()
 {
+    int failures = 0;
+    auto expect_throw = [&failures](const char* what, auto call) {
+        try
+        {
+            call();
+            io::out() << "  " << what << " did not throw" << io::endl;
+            ++failures;
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    };
+
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+        for (SqrtAccuracy accuracy : {SqrtAccuracy::exact, SqrtAccuracy::estimate})
+        {
+            std::vector<double> values(37, 4.0);
+            values[29] = -0.5;
+            expect_throw("sqrt of -0.5", [&] {
+                std::vector<double> out(values.size());
+                sqrt_batch(std::span<const double>(values), std::span<double>(out), accuracy, isa);
+            });
+            expect_throw("sqrt of -0.5 in place", [&] {
+                std::vector<double> copy = values;
+                sqrt_batch(std::span<const double>(copy), std::span<double>(copy), accuracy, isa);
+            });
+            values[29] = std::numeric_limits<double>::quiet_NaN();
+            expect_throw("sqrt of NaN", [&] {
+                std::vector<double> out(values.size());
+                sqrt_batch(std::span<const double>(values), std::span<double>(out), accuracy, isa);
+            });
+            std::vector<float> floats(37, 4.0f);
+            floats[36] = 0.0f;
+            expect_throw("rsqrt of 0 in place", [&] {
+                rsqrt_batch(std::span<const float>(floats), std::span<float>(floats), accuracy, isa);
+            });
+        }
+    }
+    expect_throw("mismatched lengths", [] {
+        std::vector<float> values(8, 1.0f);
+        std::vector<float> out(7);
+        sqrt_batch(std::span<const float>(values), std::span<float>(out));
+    });
+    return failures;
+}
+
+void verify_sqrt_batch()
+{
+    int failures = 0;
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+        for (SqrtAccuracy accuracy : {SqrtAccuracy::exact, SqrtAccuracy::newton, SqrtAccuracy::estimate})
+        {
+            failures += verify_sqrt_batch<float, false>(isa, accuracy);
+            failures += verify_sqrt_batch<double, false>(isa, accuracy);
+            failures += verify_sqrt_batch<float, true>(isa, accuracy);
+            failures += verify_sqrt_batch<double, true>(isa, accuracy);
+        }
+    }
+    failures += verify_sqrt_batch_errors();
+    io::out() << "sqrt_batch (selected ISA " << to_string(sqrt_batch_isa()) << "): " << failures << " failures"
+              << io::endl;
+}
+#endif // VERIFY_SQRT_BATCH
+
+#ifdef VERIFY_FIXED_EXTENT
+/**
+ * @brief A matrix of small random integers stored as T, so that every sum
+ * below is exact and the results can be compared with ==.
+ */
+template <typename T, std::size_t R, std::size_t C>
+fixed::fixed_mat<T, R, C> random_fixed_mat(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> value(-100, 100);
+    fixed::fixed_mat<T, R, C> m{};
+    for (std::size_t r = 0; r < R; ++r)
+        for (std::size_t c = 0; c < C; ++c)
+            m(r, c) = static_cast<T>(value(rng));
+    return m;
+}
+
+template <typename T, std::size_t N>
+fixed::fixed_vec<T, N> random_fixed_vec(std::mt19937& rng)
+{
+    return random_fixed_mat<T, 1, N>(rng).row[0];
+}
+
+/**
+ * @brief Checks every fixed_vec and fixed_mat operation for one shape against
+ * loops whose bounds are only known at runtime. Returns the number of
+ * failures.
+ */
+template <typename T, std::size_t R, std::size_t C>
+int verify_fixed_extent(std::mt19937& rng)
+{
+    bool vector_ok = true, add_ok = true, max_ok = true, transpose_ok = true, mat_vec_ok = true, mat_mat_ok = true;
+    for (int trial = 0; trial < 1000; ++trial)
+    {
+        const auto a = random_fixed_mat<T, R, C>(rng), b = random_fixed_mat<T, R, C>(rng);
+        const auto c = random_fixed_mat<T, C, R>(rng);
+        const auto v = random_fixed_vec<T, C>(rng), w = random_fixed_vec<T, C>(rng);
+        const auto sum = add(a, b), larger = max(a, b);
+        const auto transposed = transpose(a);
+        const auto av = multiply(a, v);
+        const auto ac = multiply(a, c);
+        const auto vw_sum = add(v, w), vw_max = max(v, w);
+
+        // The extents, as values the loops below cannot be unrolled over.
+        volatile std::size_t rows_value = R, columns_value = C;
+        const std::size_t rows = rows_value, columns = columns_value;
+
+        T vw_dot = 0;
+        for (std::size_t k = 0; k < columns; ++k)
+        {
+            vw_dot += v[k] * w[k];
+            vector_ok &= vw_sum[k] == v[k] + w[k] && vw_max[k] == std::max(v[k], w[k]);
+        }
+        vector_ok &= dot(v, w) == vw_dot;
+
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            T row_dot = 0;
+            for (std::size_t k = 0; k < columns; ++k)
+            {
+                add_ok &= sum(r, k) == a(r, k) + b(r, k);
+                max_ok &= larger(r, k) == std::max(a(r, k), b(r, k));
+                transpose_ok &= transposed(k, r) == a(r, k);
+                row_dot += a(r, k) * v[k];
+            }
+            mat_vec_ok &= av[r] == row_dot;
+
+            for (std::size_t j = 0; j < rows; ++j)
+            {
+                T product = 0;
+                for (std::size_t k = 0; k < columns; ++k)
+                    product += a(r, k) * c(k, j);
+                mat_mat_ok &= ac(r, j) == product;
+            }
+        }
+    }
+
+    int failures = 0;
+    auto check = [&failures](bool passed, const char* what) {
+        if (!passed)
+        {
+            ++failures;
+            io::out() << "fixed_mat<" << R << ", " << C << ">: " << what << " is wrong" << io::endl;
+        }
+    };
+    check(vector_ok, "add, max or dot of vectors");
+    check(add_ok, "add");
+    check(max_ok, "max");
+    check(transpose_ok, "transpose");
+    check(mat_vec_ok, "multiply(mat, vec)");
+    check(mat_mat_ok, "multiply(mat, mat)");
+    return failures;
+}
+
+/**
+ * @brief Checks that a soa_batch of 'size' vectors converts to and from an
+ * array of structs unchanged, and that every batch operation gives the same
+ * results as the fixed_vec operation applied to each vector. Returns the
+ * number of failures.
+ */
+template <typename T, std::size_t N>
+int verify_soa_batch(std::mt19937& rng, std::size_t size)
+{
+    std::vector<fixed::fixed_vec<T, N>> a(size), b(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        a[i] = random_fixed_vec<T, N>(rng);
+        b[i] = random_fixed_vec<T, N>(rng);
+    }
+    const auto rotation = random_fixed_mat<T, N, N>(rng);
+    const auto projection = random_fixed_mat<T, 2, N>(rng);
+
+    const fixed::soa_batch<T, N> batch_a(a), batch_b(b);
+    const auto sum = add(batch_a, batch_b).to_aos();
+    const auto larger = max(batch_a, batch_b).to_aos();
+    const auto rotated = multiply(rotation, batch_a).to_aos();
+    const auto projected = multiply(projection, batch_a).to_aos();
+    std::vector<T> dots(size);
+    dot(batch_a, batch_b, std::span<T>(dots));
+
+    bool round_trip_ok = batch_a.to_aos() == a, add_ok = true, max_ok = true, dot_ok = true, multiply_ok = true;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        add_ok &= sum[i] == add(a[i], b[i]);
+        max_ok &= larger[i] == max(a[i], b[i]);
+        dot_ok &= dots[i] == dot(a[i], b[i]);
+        multiply_ok &= rotated[i] == multiply(rotation, a[i]) && projected[i] == multiply(projection, a[i]);
+    }
+
+    bool size_check_ok = false;
+    try
+    {
+        add(batch_a, fixed::soa_batch<T, N>(size + 1));
+    }
+    catch (const std::invalid_argument&)
+    {
+        size_check_ok = true;
+    }
+
+    int failures = 0;
+    auto check = [&failures, size](bool passed, const char* what) {
+        if (!passed)
+        {
+            ++failures;
+            io::out() << "soa_batch<" << N << "> of " << size << ": " << what << " is wrong" << io::endl;
+        }
+    };
+    check(round_trip_ok, "the AoS round trip");
+    check(add_ok, "add");
+    check(max_ok, "max");
+    check(dot_ok, "dot");
+    check(multiply_ok, "multiply");
+    check(size_check_ok, "the size check");
+    return failures;
+}
+
+void verify_fixed_extent()
+{
+    std::mt19937 rng(20);
+    int failures = 0;
+    failures += verify_fixed_extent<int, 1, 1>(rng);
+    failures += verify_fixed_extent<int, 2, 2>(rng);
+    failures += verify_fixed_extent<int, 3, 3>(rng);
+    failures += verify_fixed_extent<int, 4, 4>(rng);
+    failures += verify_fixed_extent<int, 2, 3>(rng);
+    failures += verify_fixed_extent<double, 3, 4>(rng);
+    failures += verify_fixed_extent<float, 4, 4>(rng);
+    // Sizes around the 16 lane blocks, including none and a partial last one.
+    for (std::size_t size : {0, 1, 15, 16, 17, 1000})
+    {
+        failures += verify_soa_batch<float, 2>(rng, size);
+        failures += verify_soa_batch<float, 3>(rng, size);
+        failures += verify_soa_batch<double, 4>(rng, size);
+        failures += verify_soa_batch<int, 3>(rng, size);
+    }
+    io::out() << "fixed_vec, fixed_mat and soa_batch: " << failures << " failures" << io::endl;
+}
+#endif // VERIFY_FIXED_EXTENT
+
+#ifdef VERIFY_PIPELINE
+/**
+ * @brief Pushes 0 .. count - 1 through 'queue' from another thread and checks
+ * they arrive in order. With 'slow_consumer', the consumer pauses now and
+ * then so that the producer finds the queue full and goes to sleep, and the
+ * producer pauses so that the consumer sleeps on an empty one.
+ */
+int check_queue_order(parallel::SpscQueue<std::uint64_t>& queue, std::uint64_t count, bool slow_consumer)
+{
+    std::thread producer([&] {
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            std::uint64_t value = i;
+            queue.push(value);
+            if (!slow_consumer && i % 4096 == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        queue.close();
+    });
+    int failures = 0;
+    std::uint64_t expected = 0;
+    std::uint64_t value = 0;
+    while (queue.pop(value))
+    {
+        failures += value != expected++;
+        if (slow_consumer && expected % 4096 == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    producer.join();
+    return failures + (expected != count);
+}
+
+void verify_pipeline()
+{
+    int failures = 0;
+    constexpr std::uint64_t count = 200000;
+
+    for (bool slow_consumer : {false, true})
+    {
+        parallel::SpscQueue<std::uint64_t> queue(1);
+        failures += check_queue_order(queue, count, slow_consumer);
+    }
+
+    // Batches that own memory are moved through, not copied.
+    {
+        parallel::SpscQueue<std::vector<std::uint64_t>> queue(2);
+        std::thread producer([&] {
+            for (std::uint64_t i = 0; i < 1000; ++i)
+            {
+                std::vector<std::uint64_t> batch(64, i);
+                queue.push(batch);
+            }
+            queue.close();
+        });
+        std::vector<std::uint64_t> batch;
+        std::uint64_t expected = 0;
+        while (queue.pop(batch))
+            failures += batch.size() != 64 || batch.front() != expected++ || batch.back() != batch.front();
+        producer.join();
+        failures += expected != 1000;
+    }
+
+    // cancel() wakes a consumer asleep on an empty queue and a producer asleep
+    // on a full one.
+    {
+        parallel::SpscQueue<std::uint64_t> empty(1);
+        parallel::SpscQueue<std::uint64_t> full(1);
+        std::uint64_t value = 0;
+        full.push(value);
+        bool popped = true;
+        bool pushed = true;
+        std::thread consumer([&] { popped = empty.pop(value); });
+        std::thread producer([&] {
+            std::uint64_t more = 1;
+            pushed = full.push(more);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        empty.cancel();
+        full.cancel();
+        consumer.join();
+        producer.join();
+        failures += popped + pushed;
+    }
+
+    // A whole pipeline with single-batch queues, in order.
+    {
+        parallel::Pipeline pipeline(parallel::PipelineOptions{.queue_capacity = 1});
+        std::uint64_t expected = 0;
+        pipeline
+            .source("count",
+                    [next = std::uint64_t{0}]() mutable -> std::optional<std::uint64_t> {
+                        if (next == count)
+                            return std::nullopt;
+                        return next++;
+                    })
+            .then("double", [](std::uint64_t value) { return 2 * value; })
+            .sink("check", [&](std::uint64_t value) {
+                failures += value != 2 * expected;
+                ++expected;
+            });
+        pipeline.run();
+        failures += expected != count;
+    }
+
+    // A stage that throws stops every other stage, and run() rethrows.
+    {
+        parallel::Pipeline pipeline(parallel::PipelineOptions{.queue_capacity = 1});
+        pipeline
+            .source("count",
+                    [next = std::uint64_t{0}]() mutable -> std::optional<std::uint64_t> { return next++; })
+            .then("fail",
+                  [](std::uint64_t value) {
+                      if (value == 5000)
+                          throw std::runtime_error("stage failed");
+                      return value;
+                  })
+            .sink("drop", [](std::uint64_t) {});
+        bool threw = false;
+        try
+        {
+            pipeline.run();
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        failures += !threw;
+    }
+
+    io::out() << "SpscQueue and Pipeline: " << failures << " failures" << io::endl;
+}
+#endif // VERIFY_PIPELINE
+
+/**
+ * @brief The streaming mode. The operands of getSqrt<D>() have to be known at
+ * compile time, so this takes the square roots of the input one batch at a
+ * time with sqrt_batch() instead, and writes them one per line. Memory use does
+ * not depend on the size of the input.
+ *
+ * The work is split into four stages on four threads, connected by queues a
+ * few batches long: while one batch is being written, the next is formatted,
+ * the one after that square rooted, and the one after that parsed. Set
+ * CPP_CONCEPTS_PIPELINE_STATS to see how long each stage took.
+ *
+ * @throws std::invalid_argument where getSqrt<D>() would fail its
+ * static_assert, i.e. for a negative number or NaN.
+ */
+int run_stream(int argc, char* argv[])
+{
+    if (argc > 3)
+    {
+        std::cerr << "usage: " << argv[0] << " --stream [FILE]" << std::endl;
+        return 2;
+    }
+
+    try
+    {
+        io::NumberReader reader(argc > 2 ? argv[2] : "-");
+
+        parallel::Pipeline pipeline;
+        pipeline
+            .source("parse",
+                    [&reader]() -> parallel::Generator<std::vector<double>> {
+                        for (;;)
+                        {
+                            std::vector<double> batch(io::default_batch);
+                            const std::size_t n = reader.read(std::span<double>(batch));
+                            if (n == 0)
+                                co_return;
+                            batch.resize(n);
+                            co_yield std::move(batch);
+                        }
+                    })
+            .then("getSqrt",
+                  [](std::vector<double> batch) {
+                      // Not in place, so that an error can name the value.
+                      std::vector<double> roots(batch.size());
+                      sqrt_batch(std::span<const double>(batch), std::span<double>(roots));
+                      return roots;
+                  })
+            .then("format",
+                  [](std::vector<double> batch) {
+                      std::string text;
+                      io::format_numbers(std::span<const double>(batch), text);
+                      return text;
+                  })
+            .sink("write", [](std::string text) { std::fwrite(text.data(), 1, text.size(), stdout); });
+        pipeline.run();
+        return 0;
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string_view(argv[1]) == "--stream")
+        return run_stream(argc, argv);
+
     // The integer parameter is passed in to the function template section
     // instead of the function parameter section.
-    std::cout << "Printing the integer 5: ";
+    io::out() << "Printing the integer 5: ";
     print<5>();
 
     // We can also see here that implicit casting can be performed on function
     // template parameters in certain cases.
-    std::cout << "Printing the character 'a': ";
+    io::out() << "Printing the character 'a': ";
     print<'a'>();
 
     // We do the same here for the getSqrt function.
-    std::cout << "The square root of 5 is " << getSqrt<5.0>() << std::endl;
+    io::out() << "The square root of 5 is " << getSqrt<5.0>() << io::endl;
+
+    // Because getSqrt is now constexpr all the way down, its result can be
+    // used anywhere a constant expression is required.
+    static_assert(getSqrt<4.0>() == 2.0);
+
+    // A lookup table for sin over one period is generated while compiling. At
+    // runtime, lookup() just interpolates between two precomputed entries.
+    using SinTable = constexpr_math::LookupTable<constexpr_math::sin, 0.0, 6.283185307179586, 1024>;
+    io::out() << "sin(1.0) from a " << SinTable::size << " entry table is "
+        << SinTable::lookup(1.0) << io::endl;
 
 #ifdef DEMO_TYPE_CONVERSION_ERROR
     // Note here that if a constexpr int is passed where a constexpr double is
     // expected, a promotion will not occur and an error will be generated.
-    std::cout << "The square root of 5 is " << getSqrt<5>() << std::endl;
+    io::out() << "The square root of 5 is " << getSqrt<5>() << io::endl;
 #endif // DEMO_TYPE_CONVERSION_ERROR
 
 #ifdef DEMO_STATIC_ASSERT_ERROR
     // This should fail the static assert in the getSqrt function which can be
     // checked at compile time because function template arguments must be
     // constexpr.
-    std::cout << "The square root of -5 is " << getSqrt<-5.0>() << std::endl;
+    io::out() << "The square root of -5 is " << getSqrt<-5.0>() << io::endl;
 #endif // DEMO_STATIC_ASSERT_ERROR
 
     // This section demonstrates the use of a function template with a non-type
     // parameter specified with the type auto. In the example the type is 
     // deduced by the compiler.
-    std::cout << "Printing the integer 5: ";
+    io::out() << "Printing the integer 5: ";
     print_auto<5>();
-    std::cout << "Printing the character 'c': ";
+    io::out() << "Printing the character 'c': ";
     print_auto<'c'>();
+
+    // Literal class types and floating point values work with auto as well,
+    // and all of them are formatted while compiling.
+    io::out() << "Printing the version 1.2.3: ";
+    print_auto<Version{1, 2, 3}>();
+    io::out() << "Printing the double 0.1: ";
+    print_auto<0.1>();
+
+    // The format strings take std::format's format specs.
+    io::out() << static_formatted<"{} in hex is {:#010x}, pi is about {:.4f}, and 2^-10 is {:e}", 48879, 48879, 3.14159265, 0.0009765625>.view()
+        << io::endl;
+    static_assert(static_formatted<"[{:^9}]", Version{10, 0, 1}>.view() == "[ 10.0.1  ]");
+    static_assert(static_formatted<"{:+.3e}", 1e-5>.view() == "+1.000e-05");
+
+    // The extents of fixed_vec and fixed_mat are template arguments, so every
+    // operation is unrolled into one expression per element, and works in
+    // constant expressions too.
+    constexpr fixed::fixed_mat<int, 2, 3> shear{{{{1, 0, 2}}, {{0, 1, 3}}}};
+    constexpr fixed::fixed_vec<int, 3> point{{4, 5, 1}};
+    static_assert(multiply(shear, point) == fixed::fixed_vec<int, 2>{{6, 8}});
+    static_assert(multiply(shear, transpose(shear)) == fixed::fixed_mat<int, 2, 2>{{{{5, 6}}, {{6, 10}}}});
+    const fixed::fixed_vec<int, 2> moved = multiply(shear, point);
+    io::out() << "Shearing (4, 5) gives (" << moved[0] << ", " << moved[1] << ")" << io::endl;
+
+#ifdef DEMO_EXTENT_MISMATCH_ERROR
+    // A 3x3 matrix times a vector of length 4 fails the static_assert in
+    // multiply(), naming the mismatch, before the program ever runs.
+    io::out() << multiply(fixed::fixed_mat<int, 3, 3>::identity(), fixed::fixed_vec<int, 4>{})[0] << io::endl;
+#endif // DEMO_EXTENT_MISMATCH_ERROR
+
+#ifdef VERIFY_CONSTEXPR_MATH
+    namespace cm = constexpr_math;
+    verify("sqrt", cm::sqrt, [](double x) { return std::sqrt(x); }, 0.0, 1e300);
+    verify("sqrt", cm::sqrt, [](double x) { return std::sqrt(x); }, 0.0, 1e-300);
+    verify("rsqrt", cm::rsqrt, [](double x) { return 1.0 / std::sqrt(x); }, 1e-300, 1e300);
+    verify("exp", cm::exp, [](double x) { return std::exp(x); }, -708.0, 709.0);
+    verify("exp", cm::exp, [](double x) { return std::exp(x); }, -1.0, 1.0);
+    verify("log", cm::log, [](double x) { return std::log(x); }, 1e-300, 1e300);
+    verify("log", cm::log, [](double x) { return std::log(x); }, 0.5, 2.0);
+    verify("sin", cm::sin, [](double x) { return std::sin(x); }, -10.0, 10.0);
+    verify("sin", cm::sin, [](double x) { return std::sin(x); }, -1e5, 1e5);
+    verify("cos", cm::cos, [](double x) { return std::cos(x); }, -10.0, 10.0);
+    verify("cos", cm::cos, [](double x) { return std::cos(x); }, -1e5, 1e5);
+    verify("sin", cm::sin, [](double x) { return std::sin(x); }, -1e22, 1e22);
+    verify("cos", cm::cos, [](double x) { return std::cos(x); }, -1e22, 1e22);
+    verify("sin", cm::sin, [](double x) { return std::sin(x); }, -1e300, 1e300);
+    verify("cos", cm::cos, [](double x) { return std::cos(x); }, -1e300, 1e300);
+    // Where the Cody-Waite reduction used to break down, and the double
+    // closest to a multiple of pi/2 (where glibc's own cos is 8 ULP off the
+    // correctly rounded -0x1.14ae72e6ba22fp-61 that cm::cos returns).
+    for (double x : {1e18, 5e18, 1e19, 1e300, -1e300, 6381956970095103.0 * 0x1p797, 1.7976931348623157e308})
+    {
+        io::out() << "sin(" << x << "): " << ulp_distance(cm::sin(x), std::sin(x)) << " ULP, cos(" << x
+                  << "): " << ulp_distance(cm::cos(x), std::cos(x)) << " ULP" << io::endl;
+    }
+    static_assert(cm::sin(1e300) > -1.0 && cm::sin(1e300) < 1.0);
+    io::out() << "SinTable interpolation error: " << SinTable::max_interpolation_error()
+        << io::endl;
+#endif // VERIFY_CONSTEXPR_MATH
+
+#ifdef VERIFY_STATIC_FORMAT
+    constexpr auto samples = std::make_index_sequence<format_samples.size()>();
+    verify_static_format<"{}", "%g">(samples);
+    verify_static_format<"{:.17g}", "%.17g">(samples);
+    verify_static_format<"{:.40e}", "%.40e">(samples);
+    verify_static_format<"{:.3f}", "%.3f">(samples);
+    verify_static_format<"{:+#012.5G}", "%+#012.5G">(samples);
+    verify_static_format<"{:#.0f}", "%#.0f">(samples);
+#endif // VERIFY_STATIC_FORMAT
+
+#ifdef VERIFY_SQRT_BATCH
+    verify_sqrt_batch();
+#endif // VERIFY_SQRT_BATCH
+
+#ifdef VERIFY_FIXED_EXTENT
+    verify_fixed_extent();
+#endif // VERIFY_FIXED_EXTENT
+
+#ifdef VERIFY_PIPELINE
+    verify_pipeline();
+#endif // VERIFY_PIPELINE
 }
\ No newline at end of file
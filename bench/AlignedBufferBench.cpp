@@ -0,0 +1,187 @@
+/**
+ * @file AlignedBufferBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for AlignedBuffer.hpp in util: the add reduction from 11_6
+ * and the FixedMultiplier batch from 11_5 over 256 MiB arrays, and a sum of
+ * 1M elements gathered at random from one, each with the memory from
+ * std::vector and from aligned_buffer with standard, transparent huge and
+ * explicit huge pages. Run with --counters for the dTLB misses per pass.
+ *
+ * The "huge MiB" metric is how much of the array was actually backed by huge
+ * pages, since every request falls back when the pages are not available
+ * (explicit huge pages need /proc/sys/vm/nr_hugepages to be raised first).
+ */
+#include "AlignedBuffer.hpp"
+#include "Benchmark.hpp"
+#include "ConstantMult.hpp"
+#include "SpanReduce.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Far beyond the reach of any TLB with 4 KiB pages (256 MiB / 4 KiB = 65536
+// entries), and within reach of a second level TLB with 2 MiB pages.
+constexpr std::size_t array_bytes = std::size_t{256} << 20;
+constexpr std::size_t gather_count = std::size_t{1} << 20;
+
+/**
+ * @brief Where an array's memory comes from: std::vector, or aligned_buffer
+ * with these options.
+ */
+struct Source
+{
+    const char* name;
+    std::optional<mem::AllocationOptions> options;
+};
+
+const Source sources[] = {
+    {"std::vector", std::nullopt},
+    {"standard pages", mem::AllocationOptions{.pages = mem::PageKind::standard}},
+    {"transparent huge pages", mem::AllocationOptions{.pages = mem::PageKind::transparent_huge}},
+    {"transparent huge pages, interleaved",
+     mem::AllocationOptions{.pages = mem::PageKind::transparent_huge, .placement = mem::NumaPlacement::interleave}},
+    {"explicit huge pages", mem::AllocationOptions{.pages = mem::PageKind::explicit_huge}},
+};
+
+/**
+ * @brief An array of T from one Source. The vector is filled so that its
+ * pages are faulted in, as aligned_buffer prefaults its own.
+ */
+template <typename T>
+class Storage
+{
+public:
+    Storage(const Source& source, std::size_t count)
+    {
+        if (source.options)
+        {
+            buffer_ = mem::aligned_buffer<T>(count, *source.options);
+            values_ = buffer_;
+        }
+        else
+        {
+            vector_.assign(count, T{});
+            values_ = vector_;
+        }
+    }
+
+    std::span<T> values() const { return values_; }
+
+    /**
+     * @brief The bytes of the array backed by huge pages, in MiB.
+     */
+    double huge_mib() const
+    {
+        const std::size_t bytes = buffer_.pages() == mem::PageKind::explicit_huge
+                                      ? values_.size_bytes()
+                                      : mem::transparent_huge_bytes(values_.data(), values_.size_bytes());
+        return static_cast<double>(bytes) / (1 << 20);
+    }
+
+private:
+    std::vector<T> vector_;
+    mem::aligned_buffer<T> buffer_;
+    std::span<T> values_;
+};
+
+/**
+ * @brief The array of T for 'source', kept from one call to the next so that
+ * the samples of a benchmark do not each map and fault in 256 MiB. Only one
+ * source per T is alive at a time.
+ */
+template <typename T>
+const Storage<T>& storage_for(const Source& source)
+{
+    static const Source* current = nullptr;
+    static std::unique_ptr<Storage<T>> storage;
+    if (current != &source)
+    {
+        storage.reset();
+        storage = std::make_unique<Storage<T>>(source, array_bytes / sizeof(T));
+        current = &source;
+    }
+    return *storage;
+}
+
+void reduce(bench::State& state, const Source& source)
+{
+    const Storage<double>& storage = storage_for<double>(source);
+    const std::span<const double> values = storage.values();
+    state.set_bytes_per_iteration(static_cast<double>(values.size_bytes()));
+    for (auto _ : state)
+    {
+        double sum = add(values);
+        bench::do_not_optimize(sum);
+    }
+    state.set_metric("huge MiB", storage.huge_mib());
+}
+
+void multiply(bench::State& state, const Source& source)
+{
+    // In place, so that one array is read and written.
+    const Storage<std::int32_t>& storage = storage_for<std::int32_t>(source);
+    const std::span<std::int32_t> values = storage.values();
+    const FixedMultiplier multiplier(3);
+    state.set_bytes_per_iteration(2.0 * static_cast<double>(values.size_bytes()));
+    for (auto _ : state)
+    {
+        multiplier.mult(values, values);
+        bench::clobber_memory();
+    }
+    state.set_metric("huge MiB", storage.huge_mib());
+}
+
+void gather(bench::State& state, const Source& source)
+{
+    const Storage<double>& storage = storage_for<double>(source);
+    const std::span<const double> values = storage.values();
+    static const std::vector<std::uint32_t> indices = [count = values.size()] {
+        std::mt19937 rng(22);
+        std::uniform_int_distribution<std::uint32_t> index(0, static_cast<std::uint32_t>(count - 1));
+        std::vector<std::uint32_t> out(gather_count);
+        for (auto& i : out)
+            i = index(rng);
+        return out;
+    }();
+    state.set_items_per_iteration(static_cast<double>(indices.size()));
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (std::uint32_t i : indices)
+            sum += values[i];
+        bench::do_not_optimize(sum);
+    }
+    state.set_metric("huge MiB", storage.huge_mib());
+}
+
+bool register_aligned_buffer_benchmarks()
+{
+    for (const Source& source : sources)
+    {
+        const std::string name = source.name;
+        // std::vector is the baseline of the others.
+        const std::string baseline = &source == &sources[0] ? "" : sources[0].name;
+        bench::Registration("util/aligned_buffer/add 256 MiB/" + name,
+                            [&source](bench::State& state) { reduce(state, source); },
+                            baseline.empty() ? "" : "util/aligned_buffer/add 256 MiB/" + baseline);
+        bench::Registration("util/aligned_buffer/mult 256 MiB/" + name,
+                            [&source](bench::State& state) { multiply(state, source); },
+                            baseline.empty() ? "" : "util/aligned_buffer/mult 256 MiB/" + baseline);
+        bench::Registration("util/aligned_buffer/gather 1M of 256 MiB/" + name,
+                            [&source](bench::State& state) { gather(state, source); },
+                            baseline.empty() ? "" : "util/aligned_buffer/gather 1M of 256 MiB/" + baseline);
+    }
+    return true;
+}
+
+const bool aligned_buffer_registered = register_aligned_buffer_benchmarks();
+
+} // namespace
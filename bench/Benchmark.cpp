@@ -0,0 +1,454 @@
+/**
+ * @file Benchmark.cpp
+ * @author Daniel Even
+ * @brief The benchmark runner: registration, iteration calibration, statistics,
+ * CPU pinning, perf_event_open counters and the JSON report.
+ */
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+/**
+ * @brief One perf_event_open file descriptor per hardware event. Events are
+ * opened independently rather than as a group so that a PMU that lacks one of
+ * them still reports the others; unavailable events stay at -1.
+ */
+class PerfCounters
+{
+public:
+    static constexpr std::size_t event_count = 5;
+
+    PerfCounters()
+    {
+#ifdef __linux__
+        constexpr std::uint64_t dtlb_read_miss =
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const std::pair<std::uint32_t, std::uint64_t> events[event_count] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, dtlb_read_miss},
+        };
+
+        for (std::size_t i = 0; i < event_count; ++i)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int fd : fds_)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool any_available() const
+    {
+        return std::any_of(std::begin(fds_), std::end(fds_), [](int fd) { return fd >= 0; });
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    CounterValues stop()
+    {
+        double values[event_count] = {-1, -1, -1, -1, -1};
+#ifdef __linux__
+        for (std::size_t i = 0; i < event_count; ++i)
+        {
+            if (fds_[i] < 0)
+                continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t count = 0;
+            if (read(fds_[i], &count, sizeof(count)) == sizeof(count))
+                values[i] = static_cast<double>(count);
+        }
+#endif
+        return CounterValues{values[0], values[1], values[2], values[3], values[4]};
+    }
+
+private:
+    int fds_[event_count] = {-1, -1, -1, -1, -1};
+};
+
+namespace {
+
+std::uint64_t now_ns()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+struct Entry
+{
+    std::string name;
+    Function function;
+    std::string baseline;
+};
+
+std::vector<Entry>& registry()
+{
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+struct Options
+{
+    double min_time = 0.01;
+    int samples = 20;
+    int warmup = 2;
+    int cpu = -1;
+    bool counters = false;
+    std::string filter;
+    std::string output;
+};
+
+struct Summary
+{
+    std::string name;
+    std::uint64_t iterations = 0;
+    std::vector<double> ns_per_iteration;
+    double bytes_per_iteration = 0;
+    double items_per_iteration = 0;
+    std::vector<std::pair<std::string, double>> metrics;
+    CounterValues counters;
+    std::string baseline;
+    double speedup = 0;
+};
+
+void print_usage(const char* program)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--filter SUBSTRING] [--min-time SECONDS] [--samples N]\n"
+                 "          [--warmup N] [--cpu N] [--counters] [--out FILE]\n",
+                 program);
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+
+        const char* v = nullptr;
+        if (arg == "--counters")
+            options.counters = true;
+        else if (arg == "--filter" && (v = value()))
+            options.filter = v;
+        else if (arg == "--min-time" && (v = value()))
+            options.min_time = std::atof(v);
+        else if (arg == "--samples" && (v = value()))
+            options.samples = std::max(1, std::atoi(v));
+        else if (arg == "--warmup" && (v = value()))
+            options.warmup = std::max(0, std::atoi(v));
+        else if (arg == "--cpu" && (v = value()))
+            options.cpu = std::atoi(v);
+        else if (arg == "--out" && (v = value()))
+            options.output = v;
+        else
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool pin_to_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/**
+ * @brief Doubles (or scales) the iteration count until a single run lasts at
+ * least min_time seconds.
+ */
+std::uint64_t calibrate(const Function& function, double min_time)
+{
+    const double target_ns = min_time * 1e9;
+    std::uint64_t iterations = 1;
+    while (true)
+    {
+        State state(iterations, nullptr);
+        function(state);
+        const double elapsed = state.elapsed_ns();
+        if (elapsed >= target_ns || iterations >= (std::uint64_t{1} << 40))
+            return iterations;
+
+        const double scale = elapsed > 0 ? target_ns / elapsed * 1.2 : 100.0;
+        iterations = static_cast<std::uint64_t>(
+            static_cast<double>(iterations) * std::clamp(scale, 2.0, 100.0));
+    }
+}
+
+Summary run_benchmark(const Entry& entry, const Options& options, PerfCounters* counters)
+{
+    Summary summary;
+    summary.name = entry.name;
+    summary.iterations = calibrate(entry.function, options.min_time);
+
+    for (int i = 0; i < options.warmup; ++i)
+    {
+        State state(summary.iterations, nullptr);
+        entry.function(state);
+    }
+
+    std::vector<CounterValues> counter_samples;
+    for (int i = 0; i < options.samples; ++i)
+    {
+        State state(summary.iterations, counters);
+        entry.function(state);
+        summary.ns_per_iteration.push_back(state.elapsed_ns() / summary.iterations);
+        summary.bytes_per_iteration = state.bytes_per_iteration();
+        summary.items_per_iteration = state.items_per_iteration();
+        summary.metrics = state.metrics();
+        if (counters)
+            counter_samples.push_back(state.counters());
+    }
+
+    // Counters are reported per iteration, as the median over samples.
+    if (!counter_samples.empty())
+    {
+        auto median_of = [&](double CounterValues::*member) {
+            std::vector<double> values;
+            for (const auto& sample : counter_samples)
+                values.push_back(sample.*member);
+            std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+            const double median = values[values.size() / 2];
+            return median < 0 ? -1.0 : median / summary.iterations;
+        };
+        summary.counters = CounterValues{
+            median_of(&CounterValues::cycles), median_of(&CounterValues::instructions),
+            median_of(&CounterValues::cache_misses), median_of(&CounterValues::branch_misses),
+            median_of(&CounterValues::dtlb_misses)};
+    }
+
+    return summary;
+}
+
+double percentile(std::vector<double> sorted, double q)
+{
+    const double position = q * (sorted.size() - 1);
+    const auto lower = static_cast<std::size_t>(position);
+    const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (position - lower) * (sorted[upper] - sorted[lower]);
+}
+
+std::string json_escape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void write_json(std::FILE* out, const Options& options, bool pinned, bool counters,
+                const std::vector<Summary>& summaries)
+{
+    char date[32] = "";
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::fprintf(out, "{\n  \"context\": {\n");
+    std::fprintf(out, "    \"date\": \"%s\",\n", date);
+    std::fprintf(out, "    \"min_time_s\": %g,\n", options.min_time);
+    std::fprintf(out, "    \"samples\": %d,\n", options.samples);
+    std::fprintf(out, "    \"cpu\": %d,\n", pinned ? options.cpu : -1);
+    std::fprintf(out, "    \"counters\": %s\n", counters ? "true" : "false");
+    std::fprintf(out, "  },\n  \"benchmarks\": [");
+
+    for (std::size_t i = 0; i < summaries.size(); ++i)
+    {
+        const Summary& s = summaries[i];
+        std::vector<double> sorted = s.ns_per_iteration;
+        std::sort(sorted.begin(), sorted.end());
+        const double median = percentile(sorted, 0.5);
+
+        std::fprintf(out, "%s\n    {\n", i ? "," : "");
+        std::fprintf(out, "      \"name\": \"%s\",\n", json_escape(s.name).c_str());
+        std::fprintf(out, "      \"iterations\": %llu,\n",
+                     static_cast<unsigned long long>(s.iterations));
+        std::fprintf(out,
+                     "      \"ns_per_iteration\": {\"min\": %.4f, \"p10\": %.4f, "
+                     "\"median\": %.4f, \"p90\": %.4f, \"max\": %.4f}",
+                     sorted.front(), percentile(sorted, 0.1), median,
+                     percentile(sorted, 0.9), sorted.back());
+        if (s.bytes_per_iteration > 0)
+            std::fprintf(out, ",\n      \"bytes_per_second\": %.6g",
+                         s.bytes_per_iteration / median * 1e9);
+        if (s.items_per_iteration > 0)
+            std::fprintf(out, ",\n      \"items_per_second\": %.6g",
+                         s.items_per_iteration / median * 1e9);
+        if (!s.metrics.empty())
+        {
+            std::fprintf(out, ",\n      \"metrics\": {");
+            for (std::size_t m = 0; m < s.metrics.size(); ++m)
+                std::fprintf(out, "%s\"%s\": %.6g", m ? ", " : "", json_escape(s.metrics[m].first).c_str(),
+                             s.metrics[m].second);
+            std::fprintf(out, "}");
+        }
+        if (s.speedup > 0)
+            std::fprintf(out, ",\n      \"speedup\": {\"baseline\": \"%s\", \"value\": %.4f}",
+                         json_escape(s.baseline).c_str(), s.speedup);
+        if (counters)
+        {
+            std::fprintf(out,
+                         ",\n      \"counters_per_iteration\": {\"cycles\": %.4g, "
+                         "\"instructions\": %.4g, \"cache_misses\": %.4g, "
+                         "\"branch_misses\": %.4g, \"dtlb_misses\": %.4g}",
+                         s.counters.cycles, s.counters.instructions,
+                         s.counters.cache_misses, s.counters.branch_misses,
+                         s.counters.dtlb_misses);
+        }
+        std::fprintf(out, "\n    }");
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+}
+
+} // namespace
+
+void State::start_timer()
+{
+    if (counters_)
+        counters_->start();
+    start_ns_ = now_ns();
+}
+
+void State::stop_timer()
+{
+    elapsed_ns_ = static_cast<double>(now_ns() - start_ns_);
+    if (counters_)
+        counter_values_ = counters_->stop();
+}
+
+Registration::Registration(std::string name, Function function, std::string baseline)
+{
+    registry().push_back(Entry{std::move(name), std::move(function), std::move(baseline)});
+}
+
+int run_main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+        return 1;
+
+    const bool pinned = options.cpu >= 0 && pin_to_cpu(options.cpu);
+    if (options.cpu >= 0 && !pinned)
+        std::fprintf(stderr, "warning: could not pin to CPU %d\n", options.cpu);
+
+    PerfCounters perf;
+    PerfCounters* counters = nullptr;
+    if (options.counters)
+    {
+        if (perf.any_available())
+            counters = &perf;
+        else
+            std::fprintf(stderr, "warning: perf_event_open is unavailable, counters disabled\n");
+    }
+
+    std::vector<Summary> summaries;
+    for (const Entry& entry : registry())
+    {
+        if (entry.name.find(options.filter) == std::string::npos)
+            continue;
+
+        Summary summary = run_benchmark(entry, options, counters);
+        std::vector<double> sorted = summary.ns_per_iteration;
+        std::sort(sorted.begin(), sorted.end());
+        const double median = percentile(sorted, 0.5);
+
+        for (const Summary& earlier : summaries)
+        {
+            if (entry.baseline.empty() || earlier.name != entry.baseline)
+                continue;
+            std::vector<double> baseline = earlier.ns_per_iteration;
+            std::sort(baseline.begin(), baseline.end());
+            summary.baseline = entry.baseline;
+            summary.speedup = percentile(baseline, 0.5) / median;
+        }
+
+        std::fprintf(stderr, "%-50s %14.3f ns (p10 %.3f, p90 %.3f)", entry.name.c_str(), median,
+                     percentile(sorted, 0.1), percentile(sorted, 0.9));
+        if (summary.speedup > 0)
+            std::fprintf(stderr, " %.2fx", summary.speedup);
+        for (const auto& [name, value] : summary.metrics)
+            std::fprintf(stderr, " %s=%.4g", name.c_str(), value);
+        std::fprintf(stderr, "\n");
+        summaries.push_back(std::move(summary));
+    }
+
+    std::FILE* out = stdout;
+    if (!options.output.empty() && !(out = std::fopen(options.output.c_str(), "w")))
+    {
+        std::fprintf(stderr, "error: could not open %s\n", options.output.c_str());
+        return 1;
+    }
+    write_json(out, options, pinned, counters != nullptr, summaries);
+    if (out != stdout)
+        std::fclose(out);
+
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,209 @@
+/**
+ * @file Benchmark.hpp
+ * @author Daniel Even
+ * @brief A small, self-contained micro-benchmark harness for the examples. It
+ * has no dependencies beyond the standard library and Linux system calls.
+ *
+ * A benchmark is a function taking a bench::State that runs its hot operation
+ * once per iteration of a range-for loop over the state:
+ *
+ *     void add_ints(bench::State& state)
+ *     {
+ *         int a = 1, b = 2;
+ *         for (auto _ : state)
+ *         {
+ *             bench::do_not_optimize(a);
+ *             bench::do_not_optimize(add(a, b));
+ *         }
+ *     }
+ *     BENCHMARK("11_6/add<int>", add_ints);
+ *
+ * The runner (see Benchmark.cpp) calibrates the iteration count so that each
+ * sample takes roughly --min-time seconds, discards warmup samples, and
+ * reports the min, median, p10, p90 and max time per iteration as JSON, plus
+ * a speedup for benchmarks registered with a baseline, and any metrics the
+ * benchmark set itself (such as the error of an approximation).
+ * Optionally it pins itself to a CPU (--cpu) and reads hardware counters with
+ * perf_event_open (--counters).
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @brief Tells the compiler that 'value' is used, so the computation producing
+ * it cannot be removed. The non-const overload also makes the compiler assume
+ * the value may have changed, so it cannot be hoisted out of the loop.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void do_not_optimize(T& value)
+{
+    asm volatile("" : "+m,r"(value) : : "memory");
+}
+
+/**
+ * @brief Forces all pending writes to memory to be treated as observable.
+ */
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+class PerfCounters;
+
+/**
+ * @brief Hardware counter totals for one sample. A value of -1 means the
+ * counter could not be read.
+ */
+struct CounterValues
+{
+    double cycles = -1;
+    double instructions = -1;
+    double cache_misses = -1;
+    double branch_misses = -1;
+    double dtlb_misses = -1;
+};
+
+/**
+ * @brief Passed to every benchmark. Iterating over it runs the timed loop; the
+ * timer starts at begin() and stops when the loop finishes.
+ */
+class State
+{
+public:
+    State(std::uint64_t iterations, PerfCounters* counters)
+        : iterations_(iterations), counters_(counters)
+    {
+    }
+
+    /**
+     * @brief What iterating over a State yields. It carries nothing, and is
+     * marked so that the unused loop variable of 'for (auto _ : state)' does
+     * not warn.
+     */
+    struct [[maybe_unused]] Iteration
+    {
+    };
+
+    class Iterator
+    {
+    public:
+        Iterator(State* state, std::uint64_t remaining) : state_(state), remaining_(remaining) {}
+
+        bool operator!=(const Iterator&)
+        {
+            if (remaining_ != 0)
+                return true;
+            state_->stop_timer();
+            return false;
+        }
+
+        Iterator& operator++()
+        {
+            --remaining_;
+            return *this;
+        }
+
+        Iteration operator*() const { return {}; }
+
+    private:
+        State* state_;
+        std::uint64_t remaining_;
+    };
+
+    Iterator begin()
+    {
+        start_timer();
+        return Iterator(this, iterations_);
+    }
+
+    Iterator end() { return Iterator(this, 0); }
+
+    std::uint64_t iterations() const { return iterations_; }
+
+    /**
+     * @brief Lets the report include a throughput figure in bytes per second.
+     */
+    void set_bytes_per_iteration(double bytes) { bytes_per_iteration_ = bytes; }
+
+    /**
+     * @brief Lets the report include a throughput figure in items per second.
+     */
+    void set_items_per_iteration(double items) { items_per_iteration_ = items; }
+
+    /**
+     * @brief Adds a named figure of the benchmark's own to the report, such as
+     * the error of an approximation. Setting the same name again replaces it.
+     */
+    void set_metric(const std::string& name, double value)
+    {
+        for (auto& metric : metrics_)
+        {
+            if (metric.first == name)
+            {
+                metric.second = value;
+                return;
+            }
+        }
+        metrics_.emplace_back(name, value);
+    }
+
+    double elapsed_ns() const { return elapsed_ns_; }
+    double bytes_per_iteration() const { return bytes_per_iteration_; }
+    double items_per_iteration() const { return items_per_iteration_; }
+    const CounterValues& counters() const { return counter_values_; }
+    const std::vector<std::pair<std::string, double>>& metrics() const { return metrics_; }
+
+private:
+    void start_timer();
+    void stop_timer();
+
+    std::uint64_t iterations_;
+    PerfCounters* counters_;
+    std::uint64_t start_ns_ = 0;
+    double elapsed_ns_ = 0;
+    double bytes_per_iteration_ = 0;
+    double items_per_iteration_ = 0;
+    CounterValues counter_values_;
+    std::vector<std::pair<std::string, double>> metrics_;
+};
+
+using Function = std::function<void(State&)>;
+
+/**
+ * @brief Adds a benchmark to the global list. Used through BENCHMARK.
+ *
+ * If 'baseline' names a benchmark registered earlier, the report also gives
+ * this benchmark's speedup over it (baseline median / this median), as long
+ * as both were selected by --filter.
+ */
+struct Registration
+{
+    Registration(std::string name, Function function, std::string baseline = {});
+};
+
+/**
+ * @brief Parses the command line, runs every registered benchmark whose name
+ * contains --filter, and writes the JSON report.
+ */
+int run_main(int argc, char** argv);
+
+} // namespace bench
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+#define BENCHMARK(name, ...)                                                   \
+    static const ::bench::Registration BENCHMARK_CONCAT(benchmark_registration_, __LINE__)(name, __VA_ARGS__)
@@ -0,0 +1,131 @@
+/**
+ * @file DefaultArgumentBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for 11_5_default_arguments: a call that relies on a default
+ * argument against one that spells it out, the compile-time mult<K> and
+ * divide<K>, and the FixedMultiplier/FixedDivisor batch kernels against plain
+ * loops.
+ */
+#include "Benchmark.hpp"
+#include "ConstantMult.hpp"
+#include "DefaultArguments.hpp"
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// mult is defined in the cpp_concepts_core library, out of line, so a real
+// call is measured. The default argument is filled in at the call site, so
+// mult(x) and mult(x, 2) should compile to identical calls.
+
+constexpr std::size_t batch_size = 4096;
+
+void default_argument(bench::State& state)
+{
+    int x = 21;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(x);
+        int product = mult(x);
+        bench::do_not_optimize(product);
+    }
+}
+
+void explicit_argument(bench::State& state)
+{
+    int x = 21;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(x);
+        int product = mult(x, 2);
+        bench::do_not_optimize(product);
+    }
+}
+
+std::vector<std::int32_t> make_batch()
+{
+    std::vector<std::int32_t> values(batch_size);
+    std::iota(values.begin(), values.end(), -static_cast<std::int32_t>(batch_size / 2));
+    return values;
+}
+
+template <typename Kernel>
+void batch(bench::State& state, Kernel kernel)
+{
+    const std::vector<std::int32_t> in = make_batch();
+    std::vector<std::int32_t> out(in.size());
+    state.set_items_per_iteration(batch_size);
+    for (auto _ : state)
+    {
+        kernel(in, out);
+        bench::clobber_memory();
+    }
+}
+
+// The divisor is hidden from the optimizer so the plain loops really divide by
+// a runtime value.
+std::int32_t runtime_value(std::int32_t value)
+{
+    bench::do_not_optimize(value);
+    return value;
+}
+
+void loop_mult(bench::State& state)
+{
+    const std::int32_t k = runtime_value(7);
+    batch(state, [k](const auto& in, auto& out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = in[i] * k;
+    });
+}
+
+void fixed_multiplier(bench::State& state)
+{
+    const FixedMultiplier multiplier(runtime_value(7));
+    batch(state, [&](const auto& in, auto& out) { multiplier.mult(in, out); });
+}
+
+void template_mult(bench::State& state)
+{
+    batch(state, [](const auto& in, auto& out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = ::mult<7>(in[i]);
+    });
+}
+
+void loop_divide(bench::State& state)
+{
+    const std::int32_t d = runtime_value(7);
+    batch(state, [d](const auto& in, auto& out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = in[i] / d;
+    });
+}
+
+void fixed_divisor(bench::State& state)
+{
+    const FixedDivisor divisor(runtime_value(7));
+    batch(state, [&](const auto& in, auto& out) { divisor.divide(in, out); });
+}
+
+void template_divide(bench::State& state)
+{
+    batch(state, [](const auto& in, auto& out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = ::divide<7>(in[i]);
+    });
+}
+
+BENCHMARK("11_5/mult(x) default argument", default_argument);
+BENCHMARK("11_5/mult(x, 2) explicit argument", explicit_argument);
+
+BENCHMARK("11_5/batch/multiply by runtime 7 loop", loop_mult);
+BENCHMARK("11_5/batch/FixedMultiplier(7)", fixed_multiplier);
+BENCHMARK("11_5/batch/mult<7>", template_mult);
+BENCHMARK("11_5/batch/divide by runtime 7 loop", loop_divide);
+BENCHMARK("11_5/batch/FixedDivisor(7)", fixed_divisor);
+BENCHMARK("11_5/batch/divide<7>", template_divide);
+
+} // namespace
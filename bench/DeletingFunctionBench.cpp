@@ -0,0 +1,131 @@
+/**
+ * @file DeletingFunctionBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for 11_4_deleting_functions: convert() in each mode against
+ * a plain loop over the scalar reference casts, for the conversions that have
+ * SIMD kernels and one that does not.
+ */
+#include "Benchmark.hpp"
+#include "NumericConvert.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t batch_size = 4096;
+
+template <typename From>
+std::vector<From> make_batch()
+{
+    // Mostly in range for the narrower types, with some values that are not.
+    std::vector<From> values(batch_size);
+    for (std::size_t i = 0; i < batch_size; ++i)
+        values[i] = static_cast<From>((static_cast<std::int64_t>(i) * 37 % 1000 - 500) * (i % 7 == 0 ? 1000 : 1));
+    return values;
+}
+
+template <typename From, typename To, typename Kernel>
+void batch(bench::State& state, Kernel kernel)
+{
+    const std::vector<From> in = make_batch<From>();
+    std::vector<To> out(in.size());
+    state.set_items_per_iteration(batch_size);
+    state.set_bytes_per_iteration(batch_size * (sizeof(From) + sizeof(To)));
+    for (auto _ : state)
+    {
+        kernel(std::span(in), std::span(out));
+        bench::clobber_memory();
+    }
+}
+
+template <typename From, typename To>
+void loop_saturate(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = numeric::saturate_cast<To>(in[i]);
+    });
+}
+
+template <typename From, typename To>
+void convert_saturate(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) { numeric::convert(in, out, numeric::saturate); });
+}
+
+template <typename From, typename To>
+void loop_truncate(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = numeric::truncate_cast<To>(in[i]);
+    });
+}
+
+template <typename From, typename To>
+void convert_truncate(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) { numeric::convert(in, out, numeric::truncate); });
+}
+
+// make_batch has values that do not fit, which would make the checked mode
+// throw, so it is measured on values that all fit.
+template <typename From, typename To>
+void convert_checked_fitting(bench::State& state)
+{
+    std::vector<From> in(batch_size);
+    for (std::size_t i = 0; i < batch_size; ++i)
+        in[i] = static_cast<From>(static_cast<std::int64_t>(i % 200) - 100);
+    std::vector<To> out(in.size());
+    state.set_items_per_iteration(batch_size);
+    state.set_bytes_per_iteration(batch_size * (sizeof(From) + sizeof(To)));
+    for (auto _ : state)
+    {
+        numeric::convert(std::span(in), std::span(out), numeric::checked);
+        bench::clobber_memory();
+    }
+}
+
+template <typename From, typename To>
+void convert_lossless(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) { numeric::convert(in, out); });
+}
+
+template <typename From, typename To>
+void loop_lossless(bench::State& state)
+{
+    batch<From, To>(state, [](auto in, auto out) {
+        for (std::size_t i = 0; i < in.size(); ++i)
+            out[i] = static_cast<To>(in[i]);
+    });
+}
+
+using std::int8_t, std::int16_t, std::int32_t, std::int64_t;
+
+BENCHMARK("11_4/int32->int16/saturate_cast loop", loop_saturate<int32_t, int16_t>);
+BENCHMARK("11_4/int32->int16/convert saturate", convert_saturate<int32_t, int16_t>);
+BENCHMARK("11_4/int32->int16/truncate_cast loop", loop_truncate<int32_t, int16_t>);
+BENCHMARK("11_4/int32->int16/convert truncate", convert_truncate<int32_t, int16_t>);
+BENCHMARK("11_4/int32->int16/convert checked", convert_checked_fitting<int32_t, int16_t>);
+
+BENCHMARK("11_4/int32->int8/saturate_cast loop", loop_saturate<int32_t, int8_t>);
+BENCHMARK("11_4/int32->int8/convert saturate", convert_saturate<int32_t, int8_t>);
+
+BENCHMARK("11_4/float->int32/saturate_cast loop", loop_saturate<float, int32_t>);
+BENCHMARK("11_4/float->int32/convert saturate", convert_saturate<float, int32_t>);
+BENCHMARK("11_4/float->int32/convert checked", convert_checked_fitting<float, int32_t>);
+
+BENCHMARK("11_4/double->float/saturate_cast loop", loop_saturate<double, float>);
+BENCHMARK("11_4/double->float/convert saturate", convert_saturate<double, float>);
+
+BENCHMARK("11_4/int16->int32/static_cast loop", loop_lossless<int16_t, int32_t>);
+BENCHMARK("11_4/int16->int32/convert", convert_lossless<int16_t, int32_t>);
+
+// No SIMD kernel: shows the cost of the scalar fallback.
+BENCHMARK("11_4/int64->int32/saturate_cast loop", loop_saturate<int64_t, int32_t>);
+BENCHMARK("11_4/int64->int32/convert saturate", convert_saturate<int64_t, int32_t>);
+
+} // namespace
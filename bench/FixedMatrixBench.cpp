@@ -0,0 +1,223 @@
+/**
+ * @file FixedMatrixBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for FixedMatrix.hpp and SoaBatch.hpp in
+ * 11_9_non_type_template_parameters: fixed_mat products against the same
+ * loops over extents only known at runtime, and transforming a few thousand
+ * 3- and 4-vectors one at a time (array of structs) against a soa_batch, with
+ * and without converting to and from the batch.
+ */
+#include "Benchmark.hpp"
+#include "FixedMatrix.hpp"
+#include "SoaBatch.hpp"
+
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace {
+
+// 12288 3-vectors of float take 144 KiB, which fits in L2 with the result.
+constexpr std::size_t point_count = 12288;
+
+/**
+ * @brief A matrix whose extents are ordinary members, as a generic matrix
+ * class would store them.
+ */
+struct RuntimeMatrix
+{
+    std::size_t rows;
+    std::size_t columns;
+    std::vector<float> values;
+
+    float operator()(std::size_t r, std::size_t c) const { return values[r * columns + c]; }
+};
+
+template <std::size_t R, std::size_t C>
+fixed::fixed_mat<float, R, C> sample_matrix()
+{
+    fixed::fixed_mat<float, R, C> m{};
+    for (std::size_t r = 0; r < R; ++r)
+        for (std::size_t c = 0; c < C; ++c)
+            m(r, c) = 0.25f * static_cast<float>(r + 1) - 0.125f * static_cast<float>(c);
+    return m;
+}
+
+template <std::size_t R, std::size_t C>
+RuntimeMatrix runtime_matrix(const fixed::fixed_mat<float, R, C>& m)
+{
+    RuntimeMatrix result{R, C, std::vector<float>(R * C)};
+    for (std::size_t r = 0; r < R; ++r)
+        for (std::size_t c = 0; c < C; ++c)
+            result.values[r * C + c] = m(r, c);
+    return result;
+}
+
+/**
+ * @brief a * b, for extents read from the matrices at runtime. 'out' must
+ * already have the right shape.
+ */
+void runtime_multiply(const RuntimeMatrix& a, const RuntimeMatrix& b, RuntimeMatrix& out)
+{
+    for (std::size_t r = 0; r < a.rows; ++r)
+    {
+        for (std::size_t c = 0; c < b.columns; ++c)
+        {
+            float sum = 0.0f;
+            for (std::size_t k = 0; k < a.columns; ++k)
+                sum += a(r, k) * b(k, c);
+            out.values[r * out.columns + c] = sum;
+        }
+    }
+}
+
+template <std::size_t N>
+const std::vector<fixed::fixed_vec<float, N>>& sample_points()
+{
+    static const std::vector<fixed::fixed_vec<float, N>> points = [] {
+        std::mt19937 rng(20);
+        std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+        std::vector<fixed::fixed_vec<float, N>> out(point_count);
+        for (auto& point : out)
+            for (std::size_t c = 0; c < N; ++c)
+                point[c] = coordinate(rng);
+        return out;
+    }();
+    return points;
+}
+
+template <std::size_t N>
+void mat_mat_runtime(bench::State& state)
+{
+    RuntimeMatrix a = runtime_matrix(sample_matrix<N, N>());
+    RuntimeMatrix b = runtime_matrix(sample_matrix<N, N>());
+    RuntimeMatrix out{N, N, std::vector<float>(N * N)};
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a.rows);
+        runtime_multiply(a, b, out);
+        bench::do_not_optimize(out.values.data());
+        bench::clobber_memory();
+    }
+}
+
+template <std::size_t N>
+void mat_mat_fixed(bench::State& state)
+{
+    fixed::fixed_mat<float, N, N> a = sample_matrix<N, N>();
+    const fixed::fixed_mat<float, N, N> b = sample_matrix<N, N>();
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        fixed::fixed_mat<float, N, N> out = multiply(a, b);
+        bench::do_not_optimize(out);
+    }
+}
+
+/**
+ * @brief The transform a generic matrix class would do: every point through
+ * loops over the runtime extents.
+ */
+template <std::size_t N>
+void transform_runtime(bench::State& state)
+{
+    const RuntimeMatrix m = runtime_matrix(sample_matrix<N, N>());
+    const auto& points = sample_points<N>();
+    std::vector<fixed::fixed_vec<float, N>> out(points.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            for (std::size_t r = 0; r < m.rows; ++r)
+            {
+                float sum = 0.0f;
+                for (std::size_t c = 0; c < m.columns; ++c)
+                    sum += m(r, c) * points[i][c];
+                out[i][r] = sum;
+            }
+        }
+        bench::do_not_optimize(out.data());
+        bench::clobber_memory();
+    }
+    state.set_items_per_iteration(static_cast<double>(points.size()));
+}
+
+template <std::size_t N>
+void transform_fixed_aos(bench::State& state)
+{
+    const auto m = sample_matrix<N, N>();
+    const auto& points = sample_points<N>();
+    std::vector<fixed::fixed_vec<float, N>> out(points.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < points.size(); ++i)
+            out[i] = multiply(m, points[i]);
+        bench::do_not_optimize(out.data());
+        bench::clobber_memory();
+    }
+    state.set_items_per_iteration(static_cast<double>(points.size()));
+}
+
+/**
+ * @brief The points are already in a soa_batch, as they would be if the
+ * program kept them that way.
+ */
+template <std::size_t N>
+void transform_soa(bench::State& state)
+{
+    const auto m = sample_matrix<N, N>();
+    const fixed::soa_batch<float, N> batch(std::span<const fixed::fixed_vec<float, N>>(sample_points<N>()));
+    fixed::soa_batch<float, N> out(batch.size());
+    for (auto _ : state)
+    {
+        multiply(m, batch, out);
+        bench::do_not_optimize(out.component(0).data());
+        bench::clobber_memory();
+    }
+    state.set_items_per_iteration(static_cast<double>(batch.size()));
+}
+
+/**
+ * @brief The points start and end as an array of structs, so the conversions
+ * are included.
+ */
+template <std::size_t N>
+void transform_soa_round_trip(bench::State& state)
+{
+    const auto m = sample_matrix<N, N>();
+    const auto& points = sample_points<N>();
+    std::vector<fixed::fixed_vec<float, N>> out(points.size());
+    fixed::soa_batch<float, N> batch;
+    for (auto _ : state)
+    {
+        batch.assign(points);
+        multiply(m, batch, batch);
+        batch.to_aos(out);
+        bench::do_not_optimize(out.data());
+        bench::clobber_memory();
+    }
+    state.set_items_per_iteration(static_cast<double>(points.size()));
+}
+
+BENCHMARK("11_9/fixed/mat3 * mat3/runtime extents", mat_mat_runtime<3>);
+BENCHMARK("11_9/fixed/mat3 * mat3/fixed_mat", mat_mat_fixed<3>, "11_9/fixed/mat3 * mat3/runtime extents");
+BENCHMARK("11_9/fixed/mat4 * mat4/runtime extents", mat_mat_runtime<4>);
+BENCHMARK("11_9/fixed/mat4 * mat4/fixed_mat", mat_mat_fixed<4>, "11_9/fixed/mat4 * mat4/runtime extents");
+
+BENCHMARK("11_9/fixed/mat3 * vec3 x12288/runtime extents", transform_runtime<3>);
+BENCHMARK("11_9/fixed/mat3 * vec3 x12288/fixed_vec AoS", transform_fixed_aos<3>,
+          "11_9/fixed/mat3 * vec3 x12288/runtime extents");
+BENCHMARK("11_9/fixed/mat3 * vec3 x12288/soa_batch", transform_soa<3>,
+          "11_9/fixed/mat3 * vec3 x12288/runtime extents");
+BENCHMARK("11_9/fixed/mat3 * vec3 x12288/soa_batch with conversions", transform_soa_round_trip<3>,
+          "11_9/fixed/mat3 * vec3 x12288/runtime extents");
+BENCHMARK("11_9/fixed/mat4 * vec4 x12288/runtime extents", transform_runtime<4>);
+BENCHMARK("11_9/fixed/mat4 * vec4 x12288/fixed_vec AoS", transform_fixed_aos<4>,
+          "11_9/fixed/mat4 * vec4 x12288/runtime extents");
+BENCHMARK("11_9/fixed/mat4 * vec4 x12288/soa_batch", transform_soa<4>,
+          "11_9/fixed/mat4 * vec4 x12288/runtime extents");
+BENCHMARK("11_9/fixed/mat4 * vec4 x12288/soa_batch with conversions", transform_soa_round_trip<4>,
+          "11_9/fixed/mat4 * vec4 x12288/runtime extents");
+
+} // namespace
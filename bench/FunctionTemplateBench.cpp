@@ -0,0 +1,403 @@
+/**
+ * @file FunctionTemplateBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for 11_6_function_templates: the pairwise add<T>/max<T>
+ * templates, the SIMD span reductions for every ISA at sizes that fit in L1,
+ * in L2 and only in DRAM, parallel_reduce at 1, 2, 4 ... N threads, and the
+ * string add overloads from StringConcat.hpp against operator+ chains and
+ * std::ostringstream, and fused array expressions from ArrayExpression.hpp
+ * against the same expressions evaluated one step at a time.
+ */
+#include "ArrayExpression.hpp"
+#include "Benchmark.hpp"
+#include "FunctionTemplates.hpp"
+#include "Parallel.hpp"
+#include "SpanReduce.hpp"
+#include "StringConcat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename T>
+void pair_add(bench::State& state)
+{
+    T a = T(1), b = T(2);
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        T sum = add(a, b);
+        bench::do_not_optimize(sum);
+    }
+}
+
+template <typename T>
+void pair_max(bench::State& state)
+{
+    T a = T(1), b = T(2);
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        T larger = max(a, b);
+        bench::do_not_optimize(larger);
+    }
+}
+
+void pair_max_abbr(bench::State& state)
+{
+    int a = 3;
+    double b = 2.3;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        auto larger = max_abbr(a, b);
+        bench::do_not_optimize(larger);
+    }
+}
+
+template <typename T, bool Sum>
+void span_reduce(bench::State& state, cpu::Isa isa, std::size_t count)
+{
+    const std::vector<T> data(count, T{1});
+    state.set_bytes_per_iteration(static_cast<double>(count * sizeof(T)));
+    for (auto _ : state)
+    {
+        T result = Sum ? add(std::span<const T>(data), isa) : max(std::span<const T>(data), isa);
+        bench::do_not_optimize(result);
+    }
+}
+
+/**
+ * @brief Registers add and max for one element type at each size and for each
+ * ISA the CPU supports.
+ */
+template <typename T>
+bool register_span_reduce(const char* type_name)
+{
+    const std::pair<const char*, std::size_t> sizes[] = {
+        {"L1", 16 * 1024 / sizeof(T)},
+        {"L2", 512 * 1024 / sizeof(T)},
+        {"DRAM", 64 * 1024 * 1024 / sizeof(T)},
+    };
+
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::sse2, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+
+        for (const auto& [size_name, count] : sizes)
+        {
+            const std::string suffix = std::string(type_name) + "/" + to_string(isa) + "/" + size_name;
+            bench::Registration("11_6/span add/" + suffix,
+                                [isa, count = count](bench::State& state) { span_reduce<T, true>(state, isa, count); });
+            bench::Registration("11_6/span max/" + suffix,
+                                [isa, count = count](bench::State& state) { span_reduce<T, false>(state, isa, count); });
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief The array for the scaling benchmarks, shared between them and built on
+ * first use. Its length defaults to 2^24 doubles (128 MB) and can be set with
+ * CPP_CONCEPTS_BENCH_REDUCE_COUNT, e.g. to 1000000000 on a large machine.
+ */
+const std::vector<double>& parallel_reduce_data()
+{
+    static const std::vector<double> data = [] {
+        std::size_t count = std::size_t{1} << 24;
+        if (const char* value = std::getenv("CPP_CONCEPTS_BENCH_REDUCE_COUNT"))
+            count = std::strtoull(value, nullptr, 10);
+        return std::vector<double>(count, 1.0);
+    }();
+    return data;
+}
+
+void parallel_reduce_add(bench::State& state, std::size_t threads, bool deterministic)
+{
+    const std::vector<double>& data = parallel_reduce_data();
+    parallel::ThreadPool pool(threads);
+    const parallel::Options options{0, deterministic, &pool};
+
+    // Each piece goes to the SIMD span reduction and the pieces are combined
+    // with add<double>. The global span overload is hidden by the local add
+    // template, hence the qualified name.
+    struct Combiner
+    {
+        double operator()(double a, double b) const { return add(a, b); }
+        double operator()(std::span<const double> values) const { return ::add(values); }
+    } combiner;
+
+    state.set_bytes_per_iteration(static_cast<double>(data.size() * sizeof(double)));
+    for (auto _ : state)
+    {
+        double sum = parallel::parallel_reduce(data, 0.0, combiner, options);
+        bench::do_not_optimize(sum);
+    }
+}
+
+/**
+ * @brief Registers the reduction at every power of two up to the hardware
+ * thread count, plus the count itself, each reporting its speedup over one
+ * thread.
+ */
+bool register_parallel_reduce()
+{
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    for (bool deterministic : {false, true})
+    {
+        const std::string prefix = std::string("11_6/parallel_reduce add<double>/") +
+                                   (deterministic ? "deterministic/" : "adaptive/");
+        for (std::size_t threads : counts)
+        {
+            bench::Registration(prefix + "threads:" + std::to_string(threads),
+                                [threads, deterministic](bench::State& state) {
+                                    parallel_reduce_add(state, threads, deterministic);
+                                },
+                                threads == 1 ? std::string() : prefix + "threads:1");
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief The pieces of 256 cache keys of the form "tenant-N:user-id:session",
+ * about 30 characters each: too long for std::string's inline buffer.
+ */
+struct KeyPieces
+{
+    static constexpr std::size_t count = 256;
+
+    std::vector<std::string> tenants;
+    std::vector<std::string> users;
+
+    KeyPieces()
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            tenants.push_back("tenant-" + std::to_string(i % 17));
+            users.push_back(std::to_string(10'000'000 + i * 7'919));
+        }
+    }
+};
+
+const KeyPieces& key_pieces()
+{
+    static const KeyPieces pieces;
+    return pieces;
+}
+
+// The global string add overloads are hidden by the local add template, hence
+// the qualified names below.
+void keys_operator_plus(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            std::string key = pieces.tenants[i] + ":" + pieces.users[i] + ":" + "session";
+            bench::do_not_optimize(key);
+        }
+    }
+}
+
+void keys_ostringstream(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            std::ostringstream stream;
+            stream << pieces.tenants[i] << ":" << pieces.users[i] << ":" << "session";
+            std::string key = stream.str();
+            bench::do_not_optimize(key);
+        }
+    }
+}
+
+void keys_add(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            std::string key = ::add(pieces.tenants[i], ":", pieces.users[i], ":", "session");
+            bench::do_not_optimize(key);
+        }
+    }
+}
+
+// A batch of keys from an arena on the stack, released after every batch.
+void keys_add_arena(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    std::array<std::byte, 64 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            std::pmr::string key = ::add(arena, pieces.tenants[i], ":", pieces.users[i], ":", "session");
+            bench::do_not_optimize(key);
+        }
+        arena.release();
+    }
+}
+
+void keys_add_to(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    std::string key;
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            key.clear();
+            ::add_to(key, pieces.tenants[i], ":", pieces.users[i], ":", "session");
+            bench::do_not_optimize(key);
+        }
+    }
+}
+
+void keys_small_string(bench::State& state)
+{
+    const KeyPieces& pieces = key_pieces();
+    state.set_items_per_iteration(KeyPieces::count);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < KeyPieces::count; ++i)
+        {
+            SmallString<64> key(pieces.tenants[i], ":", pieces.users[i], ":", "session");
+            bench::do_not_optimize(key);
+        }
+    }
+}
+
+/**
+ * @brief The arrays for max(add(a, mult(b, 3)), c), 'count' elements each.
+ */
+struct ExpressionArrays
+{
+    explicit ExpressionArrays(std::size_t count) : a(count, 1.0), b(count, 2.0), c(count, 5.0), result(count) {}
+
+    array_expr::Array<double> a, b, c, result;
+};
+
+// Each step is assigned to a new Array, as it would be if add, mult and max
+// each returned an array: two temporaries allocated and three passes.
+void expression_unfused(bench::State& state, std::size_t count)
+{
+    ExpressionArrays arrays(count);
+    state.set_bytes_per_iteration(static_cast<double>(4 * count * sizeof(double)));
+    for (auto _ : state)
+    {
+        const array_expr::Array<double> scaled = array_expr::mult(arrays.b, 3);
+        const array_expr::Array<double> sum = array_expr::add(arrays.a, scaled);
+        arrays.result = array_expr::max(sum, arrays.c);
+        bench::clobber_memory();
+    }
+}
+
+// The same three passes into temporaries allocated once.
+void expression_unfused_reused(bench::State& state, std::size_t count)
+{
+    ExpressionArrays arrays(count);
+    array_expr::Array<double> scaled(count), sum(count);
+    state.set_bytes_per_iteration(static_cast<double>(4 * count * sizeof(double)));
+    for (auto _ : state)
+    {
+        scaled = array_expr::mult(arrays.b, 3);
+        sum = array_expr::add(arrays.a, scaled);
+        arrays.result = array_expr::max(sum, arrays.c);
+        bench::clobber_memory();
+    }
+}
+
+void expression_fused(bench::State& state, std::size_t count)
+{
+    ExpressionArrays arrays(count);
+    state.set_bytes_per_iteration(static_cast<double>(4 * count * sizeof(double)));
+    for (auto _ : state)
+    {
+        arrays.result = array_expr::max(array_expr::add(arrays.a, array_expr::mult(arrays.b, 3)), arrays.c);
+        bench::clobber_memory();
+    }
+}
+
+/**
+ * @brief Registers the three ways of evaluating the expression at sizes where
+ * its four arrays fit in L1, L2 and L3, and where they only fit in DRAM.
+ * Bytes are counted as if each array were touched once, so the rate is that
+ * of the expression, not of the memory system.
+ */
+bool register_array_expression()
+{
+    const std::pair<const char*, std::size_t> sizes[] = {
+        {"L1", 16 * 1024 / (4 * sizeof(double))},
+        {"L2", 512 * 1024 / (4 * sizeof(double))},
+        {"L3", 8 * 1024 * 1024 / (4 * sizeof(double))},
+        {"DRAM", 256 * 1024 * 1024 / (4 * sizeof(double))},
+    };
+
+    for (const auto& [size_name, count] : sizes)
+    {
+        const std::string prefix = std::string("11_6/array expression/") + size_name + "/";
+        bench::Registration(prefix + "unfused",
+                            [count = count](bench::State& state) { expression_unfused(state, count); });
+        bench::Registration(prefix + "unfused, reused temporaries",
+                            [count = count](bench::State& state) { expression_unfused_reused(state, count); },
+                            prefix + "unfused");
+        bench::Registration(prefix + "fused",
+                            [count = count](bench::State& state) { expression_fused(state, count); },
+                            prefix + "unfused");
+    }
+    return true;
+}
+
+BENCHMARK("11_6/add<int>", pair_add<int>);
+BENCHMARK("11_6/add<double>", pair_add<double>);
+BENCHMARK("11_6/max<int>", pair_max<int>);
+BENCHMARK("11_6/max<double>", pair_max<double>);
+BENCHMARK("11_6/max_abbr(int, double)", pair_max_abbr);
+
+const bool span_reduce_registered = register_span_reduce<std::int32_t>("int32") &&
+                                    register_span_reduce<std::int64_t>("int64") &&
+                                    register_span_reduce<float>("float") &&
+                                    register_span_reduce<double>("double");
+
+const bool parallel_reduce_registered = register_parallel_reduce();
+
+BENCHMARK("11_6/string keys/operator+", keys_operator_plus);
+BENCHMARK("11_6/string keys/ostringstream", keys_ostringstream, "11_6/string keys/operator+");
+BENCHMARK("11_6/string keys/add", keys_add, "11_6/string keys/operator+");
+BENCHMARK("11_6/string keys/add arena", keys_add_arena, "11_6/string keys/operator+");
+BENCHMARK("11_6/string keys/add_to reused", keys_add_to, "11_6/string keys/operator+");
+BENCHMARK("11_6/string keys/SmallString<64>", keys_small_string, "11_6/string keys/operator+");
+
+const bool array_expression_registered = register_array_expression();
+
+} // namespace
@@ -0,0 +1,201 @@
+/**
+ * @file MemoizeBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for Memoize.hpp in util: mult from 11_5 and the runtime
+ * constexpr_math::sqrt behind getSqrt<D>() in 11_9, called directly, through
+ * memo::memoize, and through a std::unordered_map behind a std::mutex, with
+ * 1M arguments drawn from a Zipf distribution over 1M distinct keys, at 1, 2,
+ * 4 ... N threads.
+ *
+ * The cache holds 64K results, so how often the popular keys stay cached
+ * (the "hit rate" metric) depends on the eviction as much as on the skew.
+ */
+#include "Benchmark.hpp"
+#include "ConstexprMath.hpp"
+#include "DefaultArguments.hpp"
+#include "Memoize.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t distinct_keys = std::size_t{1} << 20;
+constexpr std::size_t calls = std::size_t{1} << 20;
+constexpr std::size_t cache_capacity = std::size_t{1} << 16;
+
+/**
+ * @brief 'calls' keys in [0, distinct_keys), key k drawn with a probability
+ * proportional to 1 / (k + 1)^exponent. Drawn once, so that the sampling is
+ * not timed.
+ */
+std::vector<std::uint32_t> zipf_keys(double exponent)
+{
+    std::vector<double> cumulative(distinct_keys);
+    double total = 0;
+    for (std::size_t k = 0; k < distinct_keys; ++k)
+        cumulative[k] = total += 1.0 / std::pow(static_cast<double>(k + 1), exponent);
+
+    std::mt19937_64 rng(23);
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<std::uint32_t> keys(calls);
+    for (auto& key : keys)
+        key = static_cast<std::uint32_t>(std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng)) -
+                                         cumulative.begin());
+    return keys;
+}
+
+const std::vector<std::uint32_t>& keys_for(double exponent)
+{
+    static const std::vector<std::uint32_t> skewed = zipf_keys(1.0);
+    static const std::vector<std::uint32_t> flatter = zipf_keys(0.8);
+    return exponent == 1.0 ? skewed : flatter;
+}
+
+/**
+ * @brief The reference the cache has to beat: one map, one lock.
+ */
+template <typename Key, typename Value, typename F>
+class LockedMemo
+{
+public:
+    explicit LockedMemo(F function) : function_(function) {}
+
+    Value operator()(Key key)
+    {
+        {
+            const std::scoped_lock lock(mutex_);
+            if (const auto found = values_.find(key); found != values_.end())
+                return found->second;
+        }
+        const Value value = function_(key);
+        const std::scoped_lock lock(mutex_);
+        values_.emplace(key, value);
+        return value;
+    }
+
+private:
+    F function_;
+    std::mutex mutex_;
+    std::unordered_map<Key, Value> values_;
+};
+
+enum class Mode
+{
+    direct,
+    memoize,
+    locked_map,
+};
+
+/**
+ * @brief Calls f(key) for every key, split evenly over 'threads' threads.
+ */
+template <typename Call>
+double run_calls(parallel::ThreadPool& pool, std::size_t threads, const std::vector<std::uint32_t>& keys, Call& call)
+{
+    std::vector<double> sums(threads);
+    parallel::parallel_for(
+        0, threads,
+        [&](std::size_t t) {
+            double sum = 0;
+            const std::size_t begin = keys.size() * t / threads;
+            const std::size_t end = keys.size() * (t + 1) / threads;
+            for (std::size_t i = begin; i < end; ++i)
+                sum += call(keys[i]);
+            sums[t] = sum;
+        },
+        parallel::Options{1, false, &pool});
+    double total = 0;
+    for (double sum : sums)
+        total += sum;
+    return total;
+}
+
+template <typename F>
+void memoized_calls(bench::State& state, F function, Mode mode, double exponent, std::size_t threads)
+{
+    using Value = decltype(function(std::uint32_t{}));
+    const std::vector<std::uint32_t>& keys = keys_for(exponent);
+    parallel::ThreadPool pool(threads);
+    memo::memoize cached(function, cache_capacity);
+    LockedMemo<std::uint32_t, Value, F> locked(function);
+
+    // One pass beforehand, so that every sample sees a warm cache.
+    auto call = [&](std::uint32_t key) -> Value {
+        switch (mode)
+        {
+        case Mode::memoize:
+            return cached(key);
+        case Mode::locked_map:
+            return locked(key);
+        default:
+            return function(key);
+        }
+    };
+    run_calls(pool, threads, keys, call);
+    cached.reset_stats();
+
+    state.set_items_per_iteration(static_cast<double>(keys.size()));
+    for (auto _ : state)
+    {
+        double sum = run_calls(pool, threads, keys, call);
+        bench::do_not_optimize(sum);
+    }
+    if (mode == Mode::memoize)
+        state.set_metric("hit rate", cached.stats().hit_rate());
+}
+
+/**
+ * @brief Registers direct calls, memoize and the locked map for one function
+ * at every power of two up to the hardware thread count, plus the count
+ * itself. Each is compared with direct calls on as many threads.
+ */
+template <typename F>
+bool register_memoized(const std::string& name, F function)
+{
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    for (double exponent : {1.0, 0.8})
+    {
+        const std::string prefix = "util/memoize/" + name + "/zipf " + (exponent == 1.0 ? "1.0" : "0.8") + "/";
+        for (std::size_t threads : counts)
+        {
+            const std::string suffix = "/threads:" + std::to_string(threads);
+            bench::Registration(prefix + "direct" + suffix, [=](bench::State& state) {
+                memoized_calls(state, function, Mode::direct, exponent, threads);
+            });
+            bench::Registration(
+                prefix + "memoize" + suffix,
+                [=](bench::State& state) { memoized_calls(state, function, Mode::memoize, exponent, threads); },
+                prefix + "direct" + suffix);
+            bench::Registration(
+                prefix + "mutex + unordered_map" + suffix,
+                [=](bench::State& state) { memoized_calls(state, function, Mode::locked_map, exponent, threads); },
+                prefix + "direct" + suffix);
+        }
+    }
+    return true;
+}
+
+const bool mult_registered = register_memoized("mult", [](std::uint32_t key) {
+    return mult(static_cast<int>(key), 3);
+});
+
+const bool sqrt_registered = register_memoized("constexpr_math::sqrt", [](std::uint32_t key) {
+    return constexpr_math::sqrt(static_cast<double>(key) + 0.5);
+});
+
+} // namespace
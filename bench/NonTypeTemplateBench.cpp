@@ -0,0 +1,130 @@
+/**
+ * @file NonTypeTemplateBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for 11_9_non_type_template_parameters: getSqrt<D>(), which
+ * now folds to a constant, against square roots of runtime values, and the
+ * compile-time lookup tables from ConstexprMath.hpp against <cmath>, and
+ * printing with static_print<>() from StaticFormat.hpp against std::ostream and
+ * fprintf. Printing goes to /dev/null, so only the formatting and the stdio
+ * buffering are measured, not a terminal.
+ */
+#include "Benchmark.hpp"
+#include "NonTypeTemplates.hpp"
+#include "StaticFormat.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+namespace {
+
+using SinTable = constexpr_math::LookupTable<constexpr_math::sin, 0.0, 6.283185307179586, 1024>;
+
+template <typename Function>
+void unary(bench::State& state, Function function)
+{
+    double x = 5.0;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(x);
+        double result = function(x);
+        bench::do_not_optimize(result);
+    }
+}
+
+void nttp_get_sqrt(bench::State& state)
+{
+    for (auto _ : state)
+    {
+        double result = getSqrt<5.0>();
+        bench::do_not_optimize(result);
+    }
+}
+
+std::FILE* null_file()
+{
+    static std::FILE* const file = std::fopen("/dev/null", "w");
+    return file;
+}
+
+std::ostream& null_stream()
+{
+    static std::ofstream stream("/dev/null");
+    return stream;
+}
+
+// The old print<N>(), which formats N at runtime and flushes every line.
+void print_ostream_endl(bench::State& state)
+{
+    std::ostream& out = null_stream();
+    for (auto _ : state)
+        out << 5 << std::endl;
+}
+
+void print_ostream(bench::State& state)
+{
+    std::ostream& out = null_stream();
+    for (auto _ : state)
+        out << 5 << '\n';
+}
+
+void print_static(bench::State& state)
+{
+    std::FILE* out = null_file();
+    for (auto _ : state)
+        static_print<"{}\n", 5>(out);
+}
+
+void status_ostream(bench::State& state)
+{
+    std::ostream& out = null_stream();
+    for (auto _ : state)
+        out << "status: " << 42 << " items, load " << std::fixed << std::setprecision(2) << 0.75 << '\n';
+}
+
+void status_fprintf(bench::State& state)
+{
+    std::FILE* out = null_file();
+    for (auto _ : state)
+        std::fprintf(out, "status: %d items, load %.2f\n", 42, 0.75);
+}
+
+void status_static(bench::State& state)
+{
+    std::FILE* out = null_file();
+    for (auto _ : state)
+        static_print<"status: {} items, load {:.2f}\n", 42, 0.75>(out);
+}
+
+BENCHMARK("11_9/getSqrt<5.0>()", nttp_get_sqrt);
+BENCHMARK("11_9/std::sqrt(x)", [](bench::State& state) {
+    unary(state, [](double x) { return std::sqrt(x); });
+});
+BENCHMARK("11_9/constexpr_math::sqrt(x) at runtime", [](bench::State& state) {
+    unary(state, [](double x) { return constexpr_math::sqrt(x); });
+});
+BENCHMARK("11_9/std::sin(x)", [](bench::State& state) {
+    unary(state, [](double x) { return std::sin(x); });
+});
+BENCHMARK("11_9/constexpr_math::sin(x) at runtime", [](bench::State& state) {
+    unary(state, [](double x) { return constexpr_math::sin(x); });
+});
+BENCHMARK("11_9/SinTable::lookup(x)", [](bench::State& state) {
+    unary(state, [](double x) { return SinTable::lookup(x); });
+});
+BENCHMARK("11_9/std::exp(x)", [](bench::State& state) {
+    unary(state, [](double x) { return std::exp(x); });
+});
+BENCHMARK("11_9/constexpr_math::exp(x) at runtime", [](bench::State& state) {
+    unary(state, [](double x) { return constexpr_math::exp(x); });
+});
+BENCHMARK("11_9/print/ostream << N << endl", print_ostream_endl);
+BENCHMARK("11_9/print/ostream << N << '\\n'", print_ostream, "11_9/print/ostream << N << endl");
+BENCHMARK("11_9/print/static_print<N>", print_static, "11_9/print/ostream << N << endl");
+BENCHMARK("11_9/status line/ostream", status_ostream);
+BENCHMARK("11_9/status line/fprintf", status_fprintf, "11_9/status line/ostream");
+BENCHMARK("11_9/status line/static_print", status_static, "11_9/status line/ostream");
+
+} // namespace
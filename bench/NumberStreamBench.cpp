@@ -0,0 +1,241 @@
+/**
+ * @file NumberStreamBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for util/NumberStream.hpp and util/ColumnFile.hpp, the
+ * streaming input modes of the example executables: parse throughput of
+ * NumberReader from memory, from an mmap'd file and from a pipe-like read()
+ * loop, against an istringstream baseline, the whole "--stream add" path of
+ * 11_6 including the reduction, and reductions over a mapped column file
+ * against reading the same file into the heap first.
+ */
+#include "Benchmark.hpp"
+#include "ColumnFile.hpp"
+#include "NumberStream.hpp"
+#include "SpanReduce.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// About 32 MB of text: far more than the caches, and quick to generate.
+constexpr std::size_t text_numbers = std::size_t{1} << 22;
+
+/**
+ * @brief Newline-separated random numbers: integers in [-10^6, 10^6], or
+ * doubles of every magnitude from 10^-3 to 10^6 in shortest form.
+ */
+template <typename T>
+const std::string& text()
+{
+    static const std::string result = [] {
+        std::mt19937_64 rng(3);
+        std::string out;
+        char buffer[32];
+        for (std::size_t i = 0; i < text_numbers; ++i)
+        {
+            T value;
+            if constexpr (std::is_integral_v<T>)
+                value = std::uniform_int_distribution<T>(-1'000'000, 1'000'000)(rng);
+            else
+                value = std::pow(T{10}, std::uniform_real_distribution<T>(-3, 6)(rng));
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+            out.push_back('\n');
+        }
+        return out;
+    }();
+    return result;
+}
+
+/**
+ * @brief The double text written to a temporary file, which is removed when
+ * the benchmarks exit.
+ */
+const std::string& text_file()
+{
+    struct File
+    {
+        std::string path;
+
+        File() : path((std::filesystem::temp_directory_path() / "cpp_concepts_bench_numbers.txt").string())
+        {
+            std::ofstream(path, std::ios::binary) << text<double>();
+        }
+        ~File() { std::filesystem::remove(path); }
+    };
+    static const File file;
+    return file.path;
+}
+
+template <typename T>
+void parse_memory(bench::State& state)
+{
+    const std::string& input = text<T>();
+    std::vector<T> batch(io::default_batch);
+    state.set_bytes_per_iteration(static_cast<double>(input.size()));
+    for (auto _ : state)
+    {
+        io::NumberReader reader = io::NumberReader::from_memory(input);
+        while (const std::size_t n = reader.read(std::span<T>(batch)))
+            bench::do_not_optimize(batch[n - 1]);
+    }
+}
+
+void parse_mmap(bench::State& state)
+{
+    const std::string& path = text_file();
+    std::vector<double> batch(io::default_batch);
+    state.set_bytes_per_iteration(static_cast<double>(text<double>().size()));
+    for (auto _ : state)
+    {
+        io::NumberReader reader(path);
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+            bench::do_not_optimize(batch[n - 1]);
+    }
+}
+
+// stdin is a pipe in the usual "zcat log.gz | exe --stream add" case, which is
+// read in blocks. Reading the file through stdin exercises the same path.
+void parse_blocks(bench::State& state)
+{
+    const std::string& path = text_file();
+    std::vector<double> batch(io::default_batch);
+    state.set_bytes_per_iteration(static_cast<double>(text<double>().size()));
+    for (auto _ : state)
+    {
+        if (std::freopen(path.c_str(), "rb", stdin) == nullptr)
+            return;
+        io::NumberReader reader("-");
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+            bench::do_not_optimize(batch[n - 1]);
+    }
+}
+
+void parse_istream(bench::State& state)
+{
+    const std::string& input = text<double>();
+    state.set_bytes_per_iteration(static_cast<double>(input.size()));
+    for (auto _ : state)
+    {
+        std::istringstream stream(input);
+        double value;
+        while (stream >> value)
+            bench::do_not_optimize(value);
+    }
+}
+
+void stream_add(bench::State& state)
+{
+    const std::string& input = text<double>();
+    std::vector<double> batch(io::default_batch);
+    state.set_bytes_per_iteration(static_cast<double>(input.size()));
+    for (auto _ : state)
+    {
+        io::NumberReader reader = io::NumberReader::from_memory(input);
+        double total = 0.0;
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+            total += add(std::span<const double>(batch.data(), n));
+        bench::do_not_optimize(total);
+    }
+}
+
+/**
+ * @brief A column of 2^24 doubles (128 MB) with checksums, in a temporary
+ * file that is removed when the benchmarks exit.
+ */
+const std::string& column_file()
+{
+    struct File
+    {
+        std::string path;
+
+        File() : path((std::filesystem::temp_directory_path() / "cpp_concepts_bench_column.col").string())
+        {
+            std::vector<double> values(std::size_t{1} << 24);
+            std::mt19937_64 rng(5);
+            std::uniform_real_distribution<double> dist(-1.0, 1.0);
+            for (double& value : values)
+                value = dist(rng);
+            io::write_column(path, std::span<const double>(values));
+        }
+        ~File() { std::filesystem::remove(path); }
+    };
+    static const File file;
+    return file.path;
+}
+
+// What the mapping saves: reading the column into a heap buffer first.
+void column_add_read(bench::State& state)
+{
+    const std::string& path = column_file();
+    const io::ColumnFile probe(path);
+    const std::size_t count = probe.size();
+    const auto offset = static_cast<off_t>(probe.header().data_offset);
+    state.set_bytes_per_iteration(static_cast<double>(count * sizeof(double)));
+    for (auto _ : state)
+    {
+        std::vector<double> values(count);
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        char* cursor = reinterpret_cast<char*>(values.data());
+        std::size_t left = count * sizeof(double);
+        for (off_t at = offset; left > 0;)
+        {
+            const ssize_t n = ::pread(fd, cursor, left, at);
+            if (n <= 0)
+                break;
+            cursor += n;
+            at += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+        double sum = add(std::span<const double>(values));
+        bench::do_not_optimize(sum);
+    }
+}
+
+void column_add_mmap(bench::State& state)
+{
+    const std::string& path = column_file();
+    state.set_bytes_per_iteration(static_cast<double>(io::ColumnFile(path).size() * sizeof(double)));
+    for (auto _ : state)
+    {
+        const io::ColumnFile file(path);
+        double sum = add(file.values<double>());
+        bench::do_not_optimize(sum);
+    }
+}
+
+void column_verify(bench::State& state)
+{
+    const io::ColumnFile file(column_file());
+    state.set_bytes_per_iteration(static_cast<double>(file.size() * sizeof(double)));
+    for (auto _ : state)
+    {
+        file.verify();
+        bench::clobber_memory();
+    }
+}
+
+BENCHMARK("io/parse/double/istringstream", parse_istream);
+BENCHMARK("io/parse/double/memory", parse_memory<double>, "io/parse/double/istringstream");
+BENCHMARK("io/parse/double/mmap", parse_mmap, "io/parse/double/istringstream");
+BENCHMARK("io/parse/double/read blocks", parse_blocks, "io/parse/double/istringstream");
+BENCHMARK("io/parse/int32/memory", parse_memory<std::int32_t>);
+BENCHMARK("io/parse/int64/memory", parse_memory<std::int64_t>);
+BENCHMARK("io/stream add/double", stream_add);
+BENCHMARK("io/column add/double/read into heap", column_add_read);
+BENCHMARK("io/column add/double/mmap", column_add_mmap, "io/column add/double/read into heap");
+BENCHMARK("io/column verify/double", column_verify);
+
+} // namespace
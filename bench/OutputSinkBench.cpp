@@ -0,0 +1,72 @@
+/**
+ * @file OutputSinkBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for util/OutputSink.hpp: printing a typical example line
+ * ("add(1, 2) = 3") with std::endl, with '\n', and through an OutputSink with
+ * each flush policy. Everything goes to /dev/null, so what is measured is the
+ * formatting and the system calls, not a terminal. Each iteration is one line.
+ */
+#include "Benchmark.hpp"
+#include "OutputSink.hpp"
+
+#include <fstream>
+#include <ostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+int null_fd()
+{
+    static const int fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    return fd;
+}
+
+template <typename Line>
+void print_lines(bench::State& state, Line line)
+{
+    int a = 1;
+    int b = 2;
+    state.set_items_per_iteration(1);
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        line(a, b, a + b);
+    }
+}
+
+void ostream_endl(bench::State& state)
+{
+    std::ofstream out("/dev/null");
+    print_lines(state, [&](int a, int b, int sum) { out << "add(" << a << ", " << b << ") = " << sum << std::endl; });
+}
+
+void ostream_newline(bench::State& state)
+{
+    std::ofstream out("/dev/null");
+    print_lines(state, [&](int a, int b, int sum) { out << "add(" << a << ", " << b << ") = " << sum << '\n'; });
+}
+
+void sink(bench::State& state, io::OutputOptions options)
+{
+    io::OutputSink out(null_fd(), options);
+    print_lines(state, [&](int a, int b, int sum) { out << "add(" << a << ", " << b << ") = " << sum << io::endl; });
+}
+
+BENCHMARK("io/output/ostream << endl", ostream_endl);
+BENCHMARK("io/output/ostream << '\\n'", ostream_newline, "io/output/ostream << endl");
+BENCHMARK("io/output/OutputSink line", [](bench::State& state) {
+    sink(state, {.policy = io::FlushPolicy::line});
+}, "io/output/ostream << endl");
+BENCHMARK("io/output/OutputSink size", [](bench::State& state) {
+    sink(state, {.policy = io::FlushPolicy::size});
+}, "io/output/ostream << endl");
+BENCHMARK("io/output/OutputSink time", [](bench::State& state) {
+    sink(state, {.policy = io::FlushPolicy::time});
+}, "io/output/ostream << endl");
+BENCHMARK("io/output/OutputSink background", [](bench::State& state) {
+    sink(state, {.policy = io::FlushPolicy::size, .background = true});
+}, "io/output/ostream << endl");
+
+} // namespace
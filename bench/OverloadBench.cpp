@@ -0,0 +1,516 @@
+/**
+ * @file OverloadBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for 11_2_function_overload_differentiation: the cost of
+ * calling each kind of overload, and the variadic template add_all() against
+ * the va_list based add_va() for 4 to 256 arguments, the Multimethod
+ * dispatch table against std::visit and virtual double dispatch, and the
+ * getters of ConcurrentOverloadClass.hpp against mutex-guarded ones at 1, 2,
+ * 4 ... N threads.
+ */
+#include "Benchmark.hpp"
+#include "ConcurrentOverloadClass.hpp"
+#include "MultiDispatch.hpp"
+#include "VariadicAdd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+// The overloads in main.cpp print a line on every call, which would swamp the
+// cost of the call itself, so these are the same overloads without the
+// logging. They are kept out of line so that a real call is measured.
+[[gnu::noinline]] int add(int num1, int num2)
+{
+    return num1 + num2;
+}
+
+[[gnu::noinline]] int add(int num1, int num2, int num3)
+{
+    return num1 + num2 + num3;
+}
+
+[[gnu::noinline]] float add(float num1, float num2)
+{
+    return num1 + num2;
+}
+
+void overload_int_int(bench::State& state)
+{
+    int a = 1, b = 2;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        int sum = add(a, b);
+        bench::do_not_optimize(sum);
+    }
+}
+
+void overload_int_int_int(bench::State& state)
+{
+    int a = 1, b = 2, c = 3;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        bench::do_not_optimize(c);
+        int sum = add(a, b, c);
+        bench::do_not_optimize(sum);
+    }
+}
+
+void overload_float_float(bench::State& state)
+{
+    float a = 1.0f, b = 2.0f;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        float sum = add(a, b);
+        bench::do_not_optimize(sum);
+    }
+}
+
+// add('c', 'd') resolves to add(int, int) by promotion; the promotion itself
+// happens at the call site.
+void overload_char_promotion(bench::State& state)
+{
+    char a = 'c', b = 'd';
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(a);
+        bench::do_not_optimize(b);
+        int sum = add(a, b);
+        bench::do_not_optimize(sum);
+    }
+}
+
+template <std::size_t N>
+std::array<int, N> make_values()
+{
+    std::array<int, N> values{};
+    std::iota(values.begin(), values.end(), 1);
+    return values;
+}
+
+template <std::size_t N>
+void variadic_add_all(bench::State& state)
+{
+    auto values = make_values<N>();
+    state.set_items_per_iteration(N);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        for (auto _ : state)
+        {
+            bench::do_not_optimize(values);
+            auto sum = add_all(values[I]...);
+            bench::do_not_optimize(sum);
+        }
+    }(std::make_index_sequence<N>{});
+}
+
+template <std::size_t N>
+void variadic_add_va(bench::State& state)
+{
+    auto values = make_values<N>();
+    state.set_items_per_iteration(N);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        for (auto _ : state)
+        {
+            bench::do_not_optimize(values);
+            int sum = add_va(static_cast<int>(N), values[I]...);
+            bench::do_not_optimize(sum);
+        }
+    }(std::make_index_sequence<N>{});
+}
+
+// Runtime dispatch: adds pairs of values whose types are picked at random, so
+// the branch predictor cannot learn which overload comes next. The overloads
+// are chosen so that every combination of the five types resolves.
+namespace dispatch {
+
+[[gnu::noinline]] int add(int num1, int num2)
+{
+    return num1 + num2;
+}
+
+[[gnu::noinline]] double add(double num1, double num2)
+{
+    return num1 + num2;
+}
+
+[[gnu::noinline]] double add(int num1, double num2)
+{
+    return num1 + num2;
+}
+
+[[gnu::noinline]] double add(double num1, int num2)
+{
+    return num1 + num2;
+}
+
+using Dynamic = DynamicValue<bool, char, int, float, double>;
+using DynamicAdd = Multimethod<Dynamic, 2,
+                               static_cast<int (*)(int, int)>(add),
+                               static_cast<double (*)(double, double)>(add),
+                               static_cast<double (*)(int, double)>(add),
+                               static_cast<double (*)(double, int)>(add)>;
+
+static_assert([] {
+    for (std::size_t a = 0; a < Dynamic::type_count; ++a)
+        for (std::size_t b = 0; b < Dynamic::type_count; ++b)
+            if (DynamicAdd::selected({a, b}) < 0)
+                return false;
+    return true;
+}());
+
+using Number = std::variant<bool, char, int, float, double>;
+
+/**
+ * @brief The classic double dispatch: add() dispatches on the left operand's
+ * type, and hands its value to add_with() on the right operand, which
+ * dispatches on the right operand's type.
+ */
+struct Dyn
+{
+    virtual ~Dyn() = default;
+    virtual Number add(const Dyn& rhs) const = 0;
+    virtual Number add_with(bool lhs) const = 0;
+    virtual Number add_with(char lhs) const = 0;
+    virtual Number add_with(int lhs) const = 0;
+    virtual Number add_with(float lhs) const = 0;
+    virtual Number add_with(double lhs) const = 0;
+};
+
+template <typename T>
+struct DynOf final : Dyn
+{
+    explicit DynOf(T v) : value(v) {}
+
+    Number add(const Dyn& rhs) const override { return rhs.add_with(value); }
+    Number add_with(bool lhs) const override { return dispatch::add(lhs, value); }
+    Number add_with(char lhs) const override { return dispatch::add(lhs, value); }
+    Number add_with(int lhs) const override { return dispatch::add(lhs, value); }
+    Number add_with(float lhs) const override { return dispatch::add(lhs, value); }
+    Number add_with(double lhs) const override { return dispatch::add(lhs, value); }
+
+    T value;
+};
+
+constexpr std::size_t value_count = 1024;
+
+/**
+ * @brief Calls make(value) for value_count values of random types, always the
+ * same sequence.
+ */
+template <typename Make>
+void generate(Make&& make)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> type(0, 4);
+    std::uniform_int_distribution<int> small(0, 100);
+    for (std::size_t i = 0; i < value_count; ++i)
+    {
+        const int v = small(rng);
+        switch (type(rng))
+        {
+        case 0: make(v % 2 == 0); break;
+        case 1: make(static_cast<char>(v)); break;
+        case 2: make(v); break;
+        case 3: make(static_cast<float>(v) + 0.5f); break;
+        default: make(static_cast<double>(v) + 0.25); break;
+        }
+    }
+}
+
+void multimethod(bench::State& state)
+{
+    std::vector<Dynamic> values;
+    generate([&](auto v) { values.emplace_back(v); });
+    state.set_items_per_iteration(value_count - 1);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i + 1 < value_count; ++i)
+        {
+            Dynamic sum = DynamicAdd::call(values[i], values[i + 1]);
+            bench::do_not_optimize(sum);
+        }
+    }
+}
+
+void variant_visit(bench::State& state)
+{
+    std::vector<Number> values;
+    generate([&](auto v) { values.emplace_back(v); });
+    state.set_items_per_iteration(value_count - 1);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i + 1 < value_count; ++i)
+        {
+            Number sum = std::visit([](auto a, auto b) -> Number { return add(a, b); }, values[i], values[i + 1]);
+            bench::do_not_optimize(sum);
+        }
+    }
+}
+
+void virtual_double_dispatch(bench::State& state)
+{
+    std::vector<std::unique_ptr<Dyn>> values;
+    generate([&](auto v) { values.push_back(std::make_unique<DynOf<decltype(v)>>(v)); });
+    state.set_items_per_iteration(value_count - 1);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i + 1 < value_count; ++i)
+        {
+            Number sum = values[i]->add(*values[i + 1]);
+            bench::do_not_optimize(sum);
+        }
+    }
+}
+
+} // namespace dispatch
+
+namespace contention {
+
+/**
+ * @brief Runs op(thread) 'batch' times on each of 'threads' threads per
+ * iteration, the calling thread being thread 0, so that items per second is
+ * the total throughput of all threads.
+ */
+template <typename Op>
+void contended(bench::State& state, std::size_t threads, Op op)
+{
+    constexpr int batch = 4096;
+    std::atomic<std::uint64_t> generation{0};
+    std::atomic<std::size_t> finished{0};
+    std::atomic<bool> stop{false};
+    auto run_batch = [&](std::size_t thread) {
+        for (int i = 0; i < batch; ++i)
+            op(thread);
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            std::uint64_t seen = 0;
+            for (;;)
+            {
+                generation.wait(seen, std::memory_order_acquire);
+                seen = generation.load(std::memory_order_acquire);
+                if (stop.load(std::memory_order_acquire))
+                    return;
+                run_batch(t);
+                finished.fetch_add(1, std::memory_order_release);
+                finished.notify_one();
+            }
+        });
+
+    state.set_items_per_iteration(static_cast<double>(threads * batch));
+    for (auto _ : state)
+    {
+        finished.store(0, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+        run_batch(0);
+        for (std::size_t done; (done = finished.load(std::memory_order_acquire)) != threads - 1;)
+            finished.wait(done, std::memory_order_acquire);
+    }
+
+    stop.store(true, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// OverloadClass with the usual fix for sharing it: a mutex in both getters.
+class alignas(concurrent::cache_line) MutexNumber
+{
+public:
+    int get_number() const
+    {
+        std::lock_guard lock(mutex_);
+        return number_;
+    }
+
+    void add(int delta)
+    {
+        std::lock_guard lock(mutex_);
+        number_ += delta;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    int number_ = 0;
+};
+
+class alignas(concurrent::cache_line) SharedMutexNumber
+{
+public:
+    int get_number() const
+    {
+        std::shared_lock lock(mutex_);
+        return number_;
+    }
+
+    void add(int delta)
+    {
+        std::unique_lock lock(mutex_);
+        number_ += delta;
+    }
+
+private:
+    mutable std::shared_mutex mutex_;
+    int number_ = 0;
+};
+
+template <typename Number>
+int read(const Number& number)
+{
+    return number.get_number();
+}
+
+template <typename Number>
+void write(Number& number)
+{
+    if constexpr (std::is_same_v<Number, concurrent::ConcurrentOverloadClass>)
+        number.get_number() += 1;
+    else
+        number.add(1);
+}
+
+template <typename Number>
+void reads(bench::State& state, std::size_t threads)
+{
+    Number number;
+    contended(state, threads, [&](std::size_t) {
+        int value = read(std::as_const(number));
+        bench::do_not_optimize(value);
+    });
+}
+
+// The last thread writes while all the others read.
+template <typename Number>
+void reads_one_writer(bench::State& state, std::size_t threads)
+{
+    Number number;
+    contended(state, threads, [&](std::size_t thread) {
+        if (thread == threads - 1)
+            write(number);
+        else
+        {
+            int value = read(std::as_const(number));
+            bench::do_not_optimize(value);
+        }
+    });
+}
+
+void adds_mutex(bench::State& state, std::size_t threads)
+{
+    MutexNumber number;
+    contended(state, threads, [&](std::size_t) { number.add(1); });
+}
+
+void adds_atomic(bench::State& state, std::size_t threads)
+{
+    alignas(concurrent::cache_line) std::atomic<std::int64_t> number{0};
+    contended(state, threads, [&](std::size_t) { number.fetch_add(1, std::memory_order_relaxed); });
+}
+
+void adds_sharded(bench::State& state, std::size_t threads)
+{
+    concurrent::ShardedOverloadClass number;
+    contended(state, threads, [&](std::size_t) { ++number.get_number(); });
+}
+
+/**
+ * @brief Registers every variant at every power of two up to the hardware
+ * thread count, plus the count itself. Each reports its speedup over the
+ * mutex variant at one thread, so linear scaling shows up as a speedup that
+ * grows with the thread count.
+ */
+bool register_contention()
+{
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    using Variant = void (*)(bench::State&, std::size_t);
+    struct Group
+    {
+        const char* name;
+        std::vector<std::pair<const char*, Variant>> variants;
+        std::size_t min_threads;
+    };
+    const Group groups[] = {
+        {"reads",
+         {{"mutex", reads<MutexNumber>},
+          {"shared_mutex", reads<SharedMutexNumber>},
+          {"SeqLock", reads<concurrent::ConcurrentOverloadClass>}},
+         1},
+        {"reads, one writer",
+         {{"mutex", reads_one_writer<MutexNumber>},
+          {"shared_mutex", reads_one_writer<SharedMutexNumber>},
+          {"SeqLock", reads_one_writer<concurrent::ConcurrentOverloadClass>}},
+         2},
+        {"adds", {{"mutex", adds_mutex}, {"atomic", adds_atomic}, {"ShardedCounter", adds_sharded}}, 1},
+    };
+
+    for (const Group& group : groups)
+    {
+        const std::string prefix = std::string("11_2/contention/") + group.name + "/";
+        std::string baseline;
+        for (const auto& [variant, function] : group.variants)
+        {
+            for (std::size_t threads : counts)
+            {
+                if (threads < group.min_threads)
+                    continue;
+                const std::string name = prefix + variant + "/threads:" + std::to_string(threads);
+                bench::Registration(name, [threads, function](bench::State& state) { function(state, threads); },
+                                    baseline);
+                if (baseline.empty())
+                    baseline = name;
+            }
+        }
+    }
+    return true;
+}
+
+const bool contention_registered = register_contention();
+
+} // namespace contention
+
+BENCHMARK("11_2/overload/add(int, int)", overload_int_int);
+BENCHMARK("11_2/overload/add(int, int, int)", overload_int_int_int);
+BENCHMARK("11_2/overload/add(float, float)", overload_float_float);
+BENCHMARK("11_2/overload/add(char, char) via promotion", overload_char_promotion);
+
+BENCHMARK("11_2/add_all/4", variadic_add_all<4>);
+BENCHMARK("11_2/add_va/4", variadic_add_va<4>);
+BENCHMARK("11_2/add_all/16", variadic_add_all<16>);
+BENCHMARK("11_2/add_va/16", variadic_add_va<16>);
+BENCHMARK("11_2/add_all/64", variadic_add_all<64>);
+BENCHMARK("11_2/add_va/64", variadic_add_va<64>);
+BENCHMARK("11_2/add_all/256", variadic_add_all<256>);
+BENCHMARK("11_2/add_va/256", variadic_add_va<256>);
+
+BENCHMARK("11_2/dispatch/std::visit", dispatch::variant_visit);
+BENCHMARK("11_2/dispatch/virtual double dispatch", dispatch::virtual_double_dispatch, "11_2/dispatch/std::visit");
+BENCHMARK("11_2/dispatch/Multimethod", dispatch::multimethod, "11_2/dispatch/std::visit");
+
+} // namespace
@@ -0,0 +1,175 @@
+/**
+ * @file PipelineBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for util/Pipeline.hpp and util/SpscQueue.hpp: passing
+ * values between two threads one at a time and in batches, and the "--stream"
+ * path of 11_9 (parse, square root, format, write) run serially against the
+ * same stages as a Pipeline. The output is only counted, so the write stage
+ * costs nothing and what is measured is the overlap of the other three.
+ */
+#include "Benchmark.hpp"
+#include "NumberStream.hpp"
+#include "Pipeline.hpp"
+#include "SpscQueue.hpp"
+#include "SqrtBatch.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// About 8 MB of text.
+constexpr std::size_t stream_numbers = std::size_t{1} << 19;
+
+const std::string& stream_text()
+{
+    static const std::string text = [] {
+        std::mt19937_64 rng(5);
+        std::uniform_real_distribution<double> dist(0.0, 1e6);
+        std::string out;
+        char buffer[32];
+        for (std::size_t i = 0; i < stream_numbers; ++i)
+        {
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), dist(rng)).ptr);
+            out.push_back('\n');
+        }
+        return out;
+    }();
+    return text;
+}
+
+constexpr std::size_t transfer_count = std::size_t{1} << 20;
+
+/**
+ * @brief Sends transfer_count values from a producer thread to the calling
+ * thread through an SpscQueue, one per push.
+ */
+void spsc_values(bench::State& state)
+{
+    state.set_items_per_iteration(static_cast<double>(transfer_count));
+    for (auto _ : state)
+    {
+        parallel::SpscQueue<std::uint64_t> queue(1024);
+        std::thread producer([&queue] {
+            for (std::uint64_t i = 0; i < transfer_count; ++i)
+                queue.push(i);
+            queue.close();
+        });
+
+        std::uint64_t sum = 0;
+        std::uint64_t value = 0;
+        while (queue.pop(value))
+            sum += value;
+        producer.join();
+        bench::do_not_optimize(sum);
+    }
+}
+
+/**
+ * @brief The same values in batches of 1024, eight batches to the queue.
+ */
+void spsc_batches(bench::State& state)
+{
+    constexpr std::size_t batch_size = 1024;
+    state.set_items_per_iteration(static_cast<double>(transfer_count));
+    for (auto _ : state)
+    {
+        parallel::SpscQueue<std::vector<std::uint64_t>> queue(8);
+        std::thread producer([&queue] {
+            for (std::uint64_t i = 0; i < transfer_count;)
+            {
+                std::vector<std::uint64_t> batch(batch_size);
+                for (std::uint64_t& value : batch)
+                    value = i++;
+                queue.push(batch);
+            }
+            queue.close();
+        });
+
+        std::uint64_t sum = 0;
+        std::vector<std::uint64_t> batch;
+        while (queue.pop(batch))
+        {
+            for (std::uint64_t value : batch)
+                sum += value;
+        }
+        producer.join();
+        bench::do_not_optimize(sum);
+    }
+}
+
+void stream_serial(bench::State& state)
+{
+    const std::string& text = stream_text();
+    state.set_bytes_per_iteration(static_cast<double>(text.size()));
+    for (auto _ : state)
+    {
+        io::NumberReader reader = io::NumberReader::from_memory(text);
+        std::vector<double> batch(io::default_batch);
+        std::vector<double> roots(io::default_batch);
+        std::string formatted;
+        std::size_t written = 0;
+        while (const std::size_t n = reader.read(std::span<double>(batch)))
+        {
+            const std::span<double> values(roots.data(), n);
+            sqrt_batch(std::span<const double>(batch.data(), n), values);
+            io::format_numbers(std::span<const double>(values), formatted);
+            written += formatted.size();
+        }
+        bench::do_not_optimize(written);
+    }
+}
+
+void stream_pipeline(bench::State& state)
+{
+    const std::string& text = stream_text();
+    state.set_bytes_per_iteration(static_cast<double>(text.size()));
+    for (auto _ : state)
+    {
+        io::NumberReader reader = io::NumberReader::from_memory(text);
+        std::size_t written = 0;
+
+        parallel::Pipeline pipeline;
+        pipeline
+            .source("parse",
+                    [&reader]() -> parallel::Generator<std::vector<double>> {
+                        for (;;)
+                        {
+                            std::vector<double> batch(io::default_batch);
+                            const std::size_t n = reader.read(std::span<double>(batch));
+                            if (n == 0)
+                                co_return;
+                            batch.resize(n);
+                            co_yield std::move(batch);
+                        }
+                    })
+            .then("getSqrt",
+                  [](std::vector<double> batch) {
+                      std::vector<double> roots(batch.size());
+                      sqrt_batch(std::span<const double>(batch), std::span<double>(roots));
+                      return roots;
+                  })
+            .then("format",
+                  [](std::vector<double> batch) {
+                      std::string formatted;
+                      io::format_numbers(std::span<const double>(batch), formatted);
+                      return formatted;
+                  })
+            .sink("write", [&written](std::string formatted) { written += formatted.size(); });
+        pipeline.run();
+        bench::do_not_optimize(written);
+    }
+}
+
+BENCHMARK("parallel/spsc queue/1 value per push", spsc_values);
+BENCHMARK("parallel/spsc queue/1024 values per push", spsc_batches, "parallel/spsc queue/1 value per push");
+BENCHMARK("parallel/pipeline/sqrt stream/serial", stream_serial);
+BENCHMARK("parallel/pipeline/sqrt stream/4 stages", stream_pipeline, "parallel/pipeline/sqrt stream/serial");
+
+} // namespace
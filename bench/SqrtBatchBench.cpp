@@ -0,0 +1,122 @@
+/**
+ * @file SqrtBatchBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for SqrtBatch.hpp in 11_9_non_type_template_parameters:
+ * sqrt_batch() and rsqrt_batch() for each type, instruction set and accuracy,
+ * over an array that fits in L1. Every benchmark also reports "max_ulp", the
+ * largest error of its results in units in the last place, measured against a
+ * long double reference, so the speed of each accuracy can be weighed against
+ * what it gives up.
+ */
+#include "Benchmark.hpp"
+#include "SqrtBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t batch_count = 4096;
+
+/**
+ * @brief Values spread evenly over the exponents from 1e-30 to 1e30, inside
+ * the range every kernel estimates instead of computing exactly.
+ */
+template <typename T>
+const std::vector<T>& batch_values()
+{
+    static const std::vector<T> values = [] {
+        std::mt19937_64 rng(18);
+        std::uniform_real_distribution<double> exponent(-30.0, 30.0);
+        std::vector<T> out(batch_count);
+        for (T& value : out)
+            value = static_cast<T>(std::pow(10.0, exponent(rng)));
+        return out;
+    }();
+    return values;
+}
+
+/**
+ * @brief The largest error of 'results' in ULPs of T.
+ */
+template <typename T, bool Reciprocal>
+double max_ulp(std::span<const T> values, std::span<const T> results)
+{
+    double worst = 0.0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        const long double root = std::sqrt(static_cast<long double>(values[i]));
+        const long double reference = Reciprocal ? 1.0L / root : root;
+        const long double ulp =
+            std::ldexp(1.0L, std::ilogb(static_cast<T>(reference)) - (std::numeric_limits<T>::digits - 1));
+        worst = std::max(worst, static_cast<double>(std::fabs(results[i] - reference) / ulp));
+    }
+    return worst;
+}
+
+template <typename T, bool Reciprocal>
+void sqrt_batch_bench(bench::State& state, cpu::Isa isa, SqrtAccuracy accuracy)
+{
+    const std::vector<T>& values = batch_values<T>();
+    std::vector<T> results(values.size());
+    auto run = [&] {
+        if constexpr (Reciprocal)
+            rsqrt_batch(std::span<const T>(values), std::span<T>(results), accuracy, isa);
+        else
+            sqrt_batch(std::span<const T>(values), std::span<T>(results), accuracy, isa);
+    };
+
+    run();
+    state.set_metric("max_ulp", max_ulp<T, Reciprocal>(values, results));
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+    for (auto _ : state)
+    {
+        run();
+        bench::do_not_optimize(results.data());
+        bench::clobber_memory();
+    }
+}
+
+/**
+ * @brief Registers one operation for one type, for each ISA the CPU supports
+ * and each accuracy, against the exact scalar kernel.
+ */
+template <typename T, bool Reciprocal>
+bool register_sqrt_batch(const char* type_name)
+{
+    const std::string prefix = std::string("11_9/") + (Reciprocal ? "rsqrt_batch/" : "sqrt_batch/") + type_name + "/";
+    const std::string baseline = prefix + "scalar/exact";
+
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+
+        for (SqrtAccuracy accuracy : {SqrtAccuracy::exact, SqrtAccuracy::newton, SqrtAccuracy::estimate})
+        {
+            // The scalar kernels compute every accuracy exactly.
+            if (isa == cpu::Isa::scalar && accuracy != SqrtAccuracy::exact)
+                continue;
+
+            const std::string name = prefix + to_string(isa) + "/" + to_string(accuracy);
+            bench::Registration(
+                name,
+                [isa, accuracy](bench::State& state) { sqrt_batch_bench<T, Reciprocal>(state, isa, accuracy); },
+                name == baseline ? "" : baseline);
+        }
+    }
+    return true;
+}
+
+const bool sqrt_batch_registered = register_sqrt_batch<float, false>("float") &&
+                                   register_sqrt_batch<double, false>("double") &&
+                                   register_sqrt_batch<float, true>("float") &&
+                                   register_sqrt_batch<double, true>("double");
+
+} // namespace
@@ -0,0 +1,219 @@
+/**
+ * @file WideIntBench.cpp
+ * @author Daniel Even
+ * @brief Benchmarks for WideInt.hpp, WideSum.hpp and BigAccumulator.hpp in
+ * 11_2_function_overload_differentiation: one add of wide_int against
+ * __int128, and summing an array of 65536 int64_t or int32_t values exactly,
+ * element by element into __int128, wide::int128, big_accumulator and a naive
+ * big integer, and as a whole with big_accumulator and with wide::sum() on
+ * each instruction set.
+ */
+#include "Benchmark.hpp"
+#include "BigAccumulator.hpp"
+#include "WideInt.hpp"
+#include "WideSum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+__extension__ typedef __int128 reference_int128;
+
+// 65536 int64_t values take 512 KiB, which fits in L2.
+constexpr std::size_t value_count = 65536;
+
+template <typename T>
+const std::vector<T>& sample_values()
+{
+    static const std::vector<T> values = [] {
+        std::mt19937_64 rng(21);
+        std::vector<T> out(value_count);
+        for (T& value : out)
+            value = static_cast<T>(rng());
+        return out;
+    }();
+    return values;
+}
+
+/**
+ * @brief The big integer a first attempt would write: 32-bit digits in a
+ * vector, two's complement, with the carry found by adding in 64 bits, and
+ * every value sign-extended over all the digits.
+ */
+class NaiveBigInt
+{
+public:
+    explicit NaiveBigInt(std::size_t digits) : digits_(digits, 0) {}
+
+    void add(std::int64_t value)
+    {
+        const auto bits = static_cast<std::uint64_t>(value);
+        const std::uint32_t extension = value < 0 ? 0xffffffffu : 0;
+        std::uint64_t carry = 0;
+        for (std::size_t i = 0; i < digits_.size(); ++i)
+        {
+            const std::uint32_t digit = i == 0 ? static_cast<std::uint32_t>(bits)
+                                      : i == 1 ? static_cast<std::uint32_t>(bits >> 32)
+                                               : extension;
+            const std::uint64_t sum = std::uint64_t{digits_[i]} + digit + carry;
+            digits_[i] = static_cast<std::uint32_t>(sum);
+            carry = sum >> 32;
+        }
+    }
+
+    std::uint32_t digit(std::size_t i) const { return digits_[i]; }
+
+private:
+    std::vector<std::uint32_t> digits_;
+};
+
+// Both add benchmarks time one add in a dependent chain, so that the sum stays
+// in registers; passing a wide_int through do_not_optimize() each iteration
+// would time a store and a reload instead.
+void add_int128_reference(bench::State& state)
+{
+    reference_int128 sum = static_cast<reference_int128>(INT64_MAX) * 3;
+    std::int64_t step = 12345;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(step);
+        sum = sum + step;
+    }
+    bench::do_not_optimize(sum);
+}
+
+template <std::size_t Bits>
+void add_wide(bench::State& state)
+{
+    wide::wide_int<Bits> sum = wide::wide_int<Bits>{INT64_MAX} + INT64_MAX;
+    std::int64_t step = 12345;
+    for (auto _ : state)
+    {
+        bench::do_not_optimize(step);
+        sum = add(sum, wide::wide_int<Bits>{step});
+    }
+    bench::do_not_optimize(sum);
+}
+
+template <typename T>
+void sum_int128_reference(bench::State& state)
+{
+    const auto& values = sample_values<T>();
+    for (auto _ : state)
+    {
+        reference_int128 sum = 0;
+        for (T value : values)
+            sum += value;
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+template <typename T>
+void sum_wide_int128(bench::State& state)
+{
+    const auto& values = sample_values<T>();
+    for (auto _ : state)
+    {
+        wide::int128 sum;
+        for (T value : values)
+            sum += value;
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+void sum_naive(bench::State& state)
+{
+    const auto& values = sample_values<std::int64_t>();
+    for (auto _ : state)
+    {
+        // Four 32-bit digits, the same 128 bits as the other accumulators.
+        NaiveBigInt sum(4);
+        for (std::int64_t value : values)
+            sum.add(value);
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+void sum_big_accumulator(bench::State& state)
+{
+    const auto& values = sample_values<std::int64_t>();
+    for (auto _ : state)
+    {
+        wide::big_accumulator sum;
+        for (std::int64_t value : values)
+            sum += value;
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+void sum_big_accumulator_span(bench::State& state)
+{
+    const auto& values = sample_values<std::int64_t>();
+    for (auto _ : state)
+    {
+        wide::big_accumulator sum;
+        sum += std::span<const std::int64_t>(values);
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+template <typename T>
+void sum_wide_span(bench::State& state, cpu::Isa isa)
+{
+    const auto& values = sample_values<T>();
+    for (auto _ : state)
+    {
+        wide::int128 sum = wide::sum(std::span<const T>(values), isa);
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(static_cast<double>(values.size()));
+}
+
+/**
+ * @brief Registers the wide::sum() benchmarks for T on every instruction set
+ * this CPU supports, with the __int128 loop as the baseline.
+ */
+template <typename T>
+bool register_wide_sum(const std::string& prefix)
+{
+    for (cpu::Isa isa : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512})
+    {
+        if (!cpu::supported(isa))
+            continue;
+        bench::Registration(
+            prefix + "wide::sum/" + to_string(isa), [isa](bench::State& state) { sum_wide_span<T>(state, isa); },
+            prefix + "__int128");
+    }
+    return true;
+}
+
+BENCHMARK("11_2/wide/add/__int128", add_int128_reference);
+BENCHMARK("11_2/wide/add/add(int128, int128)", add_wide<128>, "11_2/wide/add/__int128");
+BENCHMARK("11_2/wide/add/add(int256, int256)", add_wide<256>, "11_2/wide/add/__int128");
+
+BENCHMARK("11_2/wide/sum int64_t x65536/__int128", sum_int128_reference<std::int64_t>);
+BENCHMARK("11_2/wide/sum int64_t x65536/wide::int128", sum_wide_int128<std::int64_t>,
+          "11_2/wide/sum int64_t x65536/__int128");
+BENCHMARK("11_2/wide/sum int64_t x65536/naive big integer", sum_naive, "11_2/wide/sum int64_t x65536/__int128");
+BENCHMARK("11_2/wide/sum int64_t x65536/big_accumulator", sum_big_accumulator,
+          "11_2/wide/sum int64_t x65536/__int128");
+BENCHMARK("11_2/wide/sum int64_t x65536/big_accumulator += span", sum_big_accumulator_span,
+          "11_2/wide/sum int64_t x65536/__int128");
+const bool wide_sum_i64_registered = register_wide_sum<std::int64_t>("11_2/wide/sum int64_t x65536/");
+
+BENCHMARK("11_2/wide/sum int32_t x65536/__int128", sum_int128_reference<std::int32_t>);
+BENCHMARK("11_2/wide/sum int32_t x65536/wide::int128", sum_wide_int128<std::int32_t>,
+          "11_2/wide/sum int32_t x65536/__int128");
+const bool wide_sum_i32_registered = register_wide_sum<std::int32_t>("11_2/wide/sum int32_t x65536/");
+
+} // namespace
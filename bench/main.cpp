@@ -0,0 +1,13 @@
+/**
+ * @file main.cpp
+ * @author Daniel Even
+ * @brief Entry point of cpp_concepts_bench. The benchmarks themselves register
+ * themselves from the *Bench.cpp files, one per example directory. Run with
+ * --help for the available options.
+ */
+#include "Benchmark.hpp"
+
+int main(int argc, char** argv)
+{
+    return bench::run_main(argc, argv);
+}
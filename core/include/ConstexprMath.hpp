@@ -0,0 +1,501 @@
+/**
+ * @file ConstexprMath.hpp
+ * @author Daniel Even
+ * @brief constexpr versions of sqrt, rsqrt, exp, log, sin and cos, plus a
+ * lookup table generator that uses them to build tables while compiling. The
+ * <cmath> functions are not constexpr in C++20, which is why getSqrt<D>() (see
+ * NonTypeTemplates.hpp) still had to call std::sqrt at runtime even though D
+ * is a compile-time constant.
+ *
+ * Every function is written with nothing but arithmetic and std::bit_cast so
+ * that it can run during constant evaluation. They can be called at runtime as
+ * well, but the <cmath> versions will be faster there.
+ *
+ * Accuracy, measured against <cmath> over 10^6 random arguments per function
+ * (define VERIFY_CONSTEXPR_MATH in 11_9's main.cpp to repeat the measurement):
+ *
+ * | function | domain                 | max error |
+ * |----------|------------------------|-----------|
+ * | sqrt     | x >= 0                 | 1 ULP     |
+ * | rsqrt    | x > 0                  | 2 ULP     |
+ * | exp      | normal results         | 1 ULP     |
+ * | log      | x > 0                  | 2 ULP     |
+ * | sin, cos | |x| <= 10              | 1 ULP     |
+ * | sin, cos | all finite x           | 2 ULP     |
+ *
+ * sin and cos reduce |x| < 1e5 by pi/2 with a three-part Cody-Waite
+ * reduction, and larger arguments with a Payne-Hanek reduction against 1216
+ * bits of 2/pi, so that even sin(1e300) is reduced exactly.
+ */
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace constexpr_math {
+
+namespace detail {
+
+inline constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+inline constexpr double inf = std::numeric_limits<double>::infinity();
+
+// ln(2) split so that k * ln2_hi is exact for |k| < 2^11.
+inline constexpr double ln2_hi = 6.93147180369123816490e-01;
+inline constexpr double ln2_lo = 1.90821492927058770002e-10;
+inline constexpr double log2e = 1.44269504088896338700e+00;
+
+// pi/2 split into three parts so that k * pio2_1 and k * pio2_2 are exact for
+// |k| < 2^20 (fdlibm's constants).
+inline constexpr double pio2_1 = 1.57079632673412561417e+00;
+inline constexpr double pio2_2 = 6.07710050630396597660e-11;
+inline constexpr double pio2_3 = 2.02226624879595063154e-21;
+inline constexpr double two_over_pi = 6.36619772367581382433e-01;
+
+// pi/2 as a sum of two doubles, for turning the reduced fraction back into
+// radians.
+inline constexpr double pio2_hi = 1.57079632679489655800e+00;
+inline constexpr double pio2_lo = 6.12323399573676603587e-17;
+
+// Past this, q * pio2_1 is no longer exact and Cody-Waite loses accuracy.
+inline constexpr double cody_waite_limit = 1e5;
+
+// The bits of 2/pi after the binary point (2/pi = 0.a2f9836e...), most
+// significant first: enough for the largest double, whose exponent needs bits
+// up to 971 + 191.
+inline constexpr std::uint64_t two_over_pi_bits[] = {
+    0xa2f9836e4e441529, 0xfc2757d1f534ddc0, 0xdb6295993c439041, 0xfe5163abdebbc561, 0xb7246e3a424dd2e0,
+    0x06492eea09d1921c, 0xfe1deb1cb129a73e, 0xe88235f52ebb4484, 0xe99c7026b45f7e41, 0x3991d639835339f4,
+    0x9c845f8bbdf9283b, 0x1ff897ffde05980f, 0xef2f118b5a0a6d1f, 0x6d367ecf27cb09b7, 0x4f463f669e5fea2d,
+    0x7527bac7ebe5f17b, 0x3d0739f78a5292ea, 0x6bfb5fb11f8d5d08, 0x56033046fc7b6bab,
+};
+
+constexpr bool is_nan(double x) { return x != x; }
+
+/**
+ * @brief Rounds to the nearest integer, halfway cases away from zero.
+ */
+constexpr double round_nearest(double x)
+{
+    return static_cast<double>(static_cast<std::int64_t>(x + (x >= 0.0 ? 0.5 : -0.5)));
+}
+
+/**
+ * @brief 2^k for a normal exponent, built straight from the IEEE bit pattern.
+ */
+constexpr double pow2(int k)
+{
+    return std::bit_cast<double>(static_cast<std::uint64_t>(k + 1023) << 52);
+}
+
+/**
+ * @brief x * 2^k, stepping through the normal range for very large or very
+ * small k.
+ */
+constexpr double scale(double x, int k)
+{
+    while (k > 1023)
+    {
+        x *= pow2(1023);
+        k -= 1023;
+    }
+    while (k < -1022)
+    {
+        x *= pow2(-1022);
+        k += 1022;
+    }
+    return x * pow2(k);
+}
+
+/**
+ * @brief 1 / n! for the Taylor series below.
+ */
+constexpr double inverse_factorial(int n)
+{
+    double factorial = 1.0;
+    for (int i = 2; i <= n; ++i)
+        factorial *= i;
+    return 1.0 / factorial;
+}
+
+/**
+ * @brief sin(r) for |r| <= pi/4. The series is truncated after r^21, where the
+ * next term is below 2^-80 relative to the result.
+ */
+constexpr double sin_kernel(double r)
+{
+    const double r2 = r * r;
+    double p = 0.0;
+    for (int n = 21; n >= 3; n -= 2)
+        p = ((n / 2) % 2 ? -inverse_factorial(n) : inverse_factorial(n)) + r2 * p;
+    return r + r * r2 * p;
+}
+
+/**
+ * @brief cos(r) for |r| <= pi/4, truncated after r^20.
+ */
+constexpr double cos_kernel(double r)
+{
+    const double r2 = r * r;
+    double p = 0.0;
+    for (int n = 20; n >= 2; n -= 2)
+        p = ((n / 2) % 2 ? -inverse_factorial(n) : inverse_factorial(n)) + r2 * p;
+    return 1.0 + r2 * p;
+}
+
+/**
+ * @brief The 64 bits of 2/pi starting at bit 'first' after the binary point,
+ * counting from 1. Bits before the binary point (first < 1) are zero.
+ */
+constexpr std::uint64_t two_over_pi_window(int first)
+{
+    constexpr int words = static_cast<int>(std::size(two_over_pi_bits));
+    auto word = [](int i) { return i >= 0 && i < words ? two_over_pi_bits[i] : std::uint64_t{0}; };
+
+    const int offset = first - 1;
+    if (offset < 0)
+        return offset <= -64 ? 0 : word(0) >> -offset;
+    const int shift = offset % 64;
+    const std::uint64_t high = word(offset / 64) << shift;
+    return shift == 0 ? high : high | word(offset / 64 + 1) >> (64 - shift);
+}
+
+/**
+ * @brief The 128-bit product a * b as {high, low}, from 32-bit halves so that
+ * it works in constant evaluation on every compiler.
+ */
+constexpr void multiply_64(std::uint64_t a, std::uint64_t b, std::uint64_t& high, std::uint64_t& low)
+{
+    const std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    const std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+    const std::uint64_t lo_lo = a_lo * b_lo;
+    const std::uint64_t hi_lo = a_hi * b_lo;
+    const std::uint64_t lo_hi = a_lo * b_hi;
+    const std::uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + (lo_hi & 0xffffffff);
+    low = (middle << 32) | (lo_lo & 0xffffffff);
+    high = a_hi * b_hi + (hi_lo >> 32) + (lo_hi >> 32) + (middle >> 32);
+}
+
+/**
+ * @brief Payne-Hanek reduction of a finite x >= cody_waite_limit.
+ *
+ * With x = m * 2^e for an integer m < 2^53, x * 2/pi is the sum of
+ * m * b_i * 2^(e - i) over the bits b_i of 2/pi. The terms with i <= e - 2 are
+ * multiples of 4 and do not change the quadrant, so only the 192 bits from
+ * i = e - 1 on are multiplied by m; the result has 2 bits before the binary
+ * point (the quadrant) and 190 after it. The bits of 2/pi beyond those change
+ * it by less than 2^-137, and no double lies closer than about 2^-61 to a
+ * multiple of pi/2, so the top 128 bits of the fraction that are kept hold
+ * more than 64 significant bits.
+ */
+constexpr int reduce_pio2_large(double x, double& r)
+{
+    const std::uint64_t bits = std::bit_cast<std::uint64_t>(x);
+    const std::uint64_t m = (bits & ((std::uint64_t{1} << 52) - 1)) | (std::uint64_t{1} << 52);
+    const int e = static_cast<int>(bits >> 52) - 1075;
+
+    const std::uint64_t w0 = two_over_pi_window(e - 1);
+    const std::uint64_t w1 = two_over_pi_window(e + 63);
+    const std::uint64_t w2 = two_over_pi_window(e + 127);
+
+    // m * (w0:w1:w2) mod 2^192, as r0:r1:r2.
+    std::uint64_t carry = 0;
+    std::uint64_t r2 = 0;
+    multiply_64(m, w2, carry, r2);
+    std::uint64_t high = 0;
+    std::uint64_t r1 = 0;
+    multiply_64(m, w1, high, r1);
+    r1 += carry;
+    carry = high + (r1 < carry ? 1 : 0);
+    const std::uint64_t r0 = m * w0 + carry;
+
+    // The quadrant, and the top 128 bits of the fraction as f_hi:f_lo.
+    int quadrant = static_cast<int>(r0 >> 62);
+    std::uint64_t f_hi = (r0 << 2) | (r1 >> 62);
+    std::uint64_t f_lo = (r1 << 2) | (r2 >> 62);
+    double sign = 1.0;
+    if (f_hi >> 63)
+    {
+        // Round to the nearest quadrant: the fraction becomes f - 1 < 0.
+        ++quadrant;
+        sign = -1.0;
+        f_hi = ~f_hi;
+        f_lo = ~f_lo + 1;
+        if (f_lo == 0)
+            ++f_hi;
+    }
+
+    // The fraction as a sum of two doubles. f_hi < 2^63, so converting it
+    // and back is exact apart from the rounding, which goes into the low part.
+    constexpr double two_64 = 18446744073709551616.0;
+    const double high_part = static_cast<double>(f_hi);
+    const auto rounding = static_cast<std::int64_t>(f_hi - static_cast<std::uint64_t>(high_part));
+    const double fraction_hi = high_part / two_64;
+    const double fraction_lo = (static_cast<double>(rounding) + static_cast<double>(f_lo) / two_64) / two_64;
+
+    r = sign * (fraction_hi * pio2_hi + (fraction_hi * pio2_lo + fraction_lo * pio2_hi));
+    return quadrant & 3;
+}
+
+/**
+ * @brief Reduces a finite x to r in [-pi/4, pi/4] and returns the quadrant
+ * (x / (pi/2)) mod 4.
+ */
+constexpr int reduce_pio2(double x, double& r)
+{
+    if (x >= cody_waite_limit || x <= -cody_waite_limit)
+    {
+        const int quadrant = reduce_pio2_large(x < 0.0 ? -x : x, r);
+        if (x > 0.0)
+            return quadrant;
+        r = -r;
+        return -quadrant & 3;
+    }
+    const double q = round_nearest(x * two_over_pi);
+    r = ((x - q * pio2_1) - q * pio2_2) - q * pio2_3;
+    return static_cast<int>(static_cast<std::int64_t>(q) & 3);
+}
+
+} // namespace detail
+
+/**
+ * @brief Square root by Newton's method. The starting guess halves the exponent
+ * directly in the bit pattern, after which the iteration decreases
+ * monotonically; it stops on the first step that does not improve.
+ */
+constexpr double sqrt(double x)
+{
+    if (detail::is_nan(x) || x < 0.0)
+        return detail::nan;
+    if (x == 0.0 || x == detail::inf)
+        return x;
+
+    const std::uint64_t bits = std::bit_cast<std::uint64_t>(x);
+    double y = std::bit_cast<double>((bits >> 1) + (std::uint64_t{1023} << 51));
+
+    // One step from any positive guess lands above the root.
+    y = 0.5 * (y + x / y);
+    for (int i = 0; i < 64; ++i)
+    {
+        const double next = 0.5 * (y + x / y);
+        if (next >= y)
+            break;
+        y = next;
+    }
+
+    // Newton's method can stop one ULP above the closest root, so also try the
+    // next double down.
+    const double below = std::bit_cast<double>(std::bit_cast<std::uint64_t>(y) - 1);
+    const double error = y * y - x;
+    const double error_below = below * below - x;
+    return (error_below < 0.0 ? -error_below : error_below) <
+                   (error < 0.0 ? -error : error)
+               ? below
+               : y;
+}
+
+/**
+ * @brief Reciprocal square root.
+ */
+constexpr double rsqrt(double x)
+{
+    return 1.0 / constexpr_math::sqrt(x);
+}
+
+/**
+ * @brief e^x. x is reduced to k * ln(2) + r with |r| <= ln(2)/2, e^r is
+ * summed as a Taylor series up to r^14, and the result is scaled by 2^k.
+ */
+constexpr double exp(double x)
+{
+    if (detail::is_nan(x))
+        return x;
+    if (x > 709.782712893384)
+        return detail::inf;
+    if (x < -745.1332191019412)
+        return 0.0;
+
+    const double k = detail::round_nearest(x * detail::log2e);
+    const double r = (x - k * detail::ln2_hi) - k * detail::ln2_lo;
+
+    double p = 1.0;
+    for (int n = 14; n >= 1; --n)
+        p = 1.0 + r * p / n;
+
+    return detail::scale(p, static_cast<int>(k));
+}
+
+/**
+ * @brief Natural logarithm. x is split into m * 2^e with m in [sqrt(1/2),
+ * sqrt(2)), and log(m) = 2 atanh(s) with s = (m - 1) / (m + 1) is summed as an
+ * odd series in s, which converges quickly because |s| < 0.172.
+ */
+constexpr double log(double x)
+{
+    if (detail::is_nan(x) || x < 0.0)
+        return detail::nan;
+    if (x == 0.0)
+        return -detail::inf;
+    if (x == detail::inf)
+        return x;
+
+    int e = 0;
+    if (x < std::numeric_limits<double>::min())
+    {
+        x *= detail::pow2(54);
+        e = -54;
+    }
+
+    const std::uint64_t bits = std::bit_cast<std::uint64_t>(x);
+    e += static_cast<int>((bits >> 52) & 0x7ff) - 1023;
+    double m = std::bit_cast<double>((bits & ((std::uint64_t{1} << 52) - 1)) |
+                                     (std::uint64_t{1023} << 52));
+    if (m > 1.41421356237309504880)
+    {
+        m *= 0.5;
+        ++e;
+    }
+
+    const double s = (m - 1.0) / (m + 1.0);
+    const double s2 = s * s;
+    double t = 0.0;
+    for (int n = 27; n >= 3; n -= 2)
+        t = 1.0 / n + s2 * t;
+
+    // 2 atanh(s) = 2s + 2s * s^2 * t, keeping the large 2s term separate.
+    const double log_m = 2.0 * s + 2.0 * s * s2 * t;
+    return e * detail::ln2_hi + (log_m + e * detail::ln2_lo);
+}
+
+/**
+ * @brief Sine, accurate to 2 ULP for every finite x.
+ */
+constexpr double sin(double x)
+{
+    if (detail::is_nan(x) || x == detail::inf || x == -detail::inf)
+        return detail::nan;
+
+    double r = 0.0;
+    switch (detail::reduce_pio2(x, r))
+    {
+    case 0:
+        return detail::sin_kernel(r);
+    case 1:
+        return detail::cos_kernel(r);
+    case 2:
+        return -detail::sin_kernel(r);
+    default:
+        return -detail::cos_kernel(r);
+    }
+}
+
+/**
+ * @brief Cosine, accurate to 2 ULP for every finite x.
+ */
+constexpr double cos(double x)
+{
+    if (detail::is_nan(x) || x == detail::inf || x == -detail::inf)
+        return detail::nan;
+
+    double r = 0.0;
+    switch (detail::reduce_pio2(x, r))
+    {
+    case 0:
+        return detail::cos_kernel(r);
+    case 1:
+        return -detail::sin_kernel(r);
+    case 2:
+        return -detail::cos_kernel(r);
+    default:
+        return detail::sin_kernel(r);
+    }
+}
+
+/**
+ * @brief Samples F at N evenly spaced points covering [Lo, Hi], endpoints
+ * included. Because F, Lo, Hi and N are all template arguments this can only
+ * ever be evaluated at compile time.
+ */
+template <auto F, double Lo, double Hi, std::size_t N>
+    requires std::invocable<decltype(F), double>
+consteval std::array<double, N> generate_table()
+{
+    static_assert(N >= 2, "generate_table(): N must be at least 2");
+    static_assert(Lo < Hi, "generate_table(): Lo must be less than Hi");
+
+    std::array<double, N> table{};
+    for (std::size_t i = 0; i < N; ++i)
+        table[i] = F(Lo + (Hi - Lo) * static_cast<double>(i) / (N - 1));
+    return table;
+}
+
+/**
+ * @brief A compile-time baked table of F over [Lo, Hi] with a runtime lookup
+ * that linearly interpolates between neighbouring entries. The table itself is
+ * a static constexpr array, so it is emitted into read-only data and no
+ * evaluation of F happens at runtime.
+ *
+ * The entries are as accurate as F (see the table at the top of this file).
+ * The lookup adds interpolation error, which is bounded by
+ * h^2 / 8 * max|F''| for a step h and can be measured for a particular table
+ * with max_interpolation_error().
+ */
+template <auto F, double Lo, double Hi, std::size_t N>
+    requires std::invocable<decltype(F), double>
+class LookupTable
+{
+public:
+    static constexpr double lower = Lo;
+    static constexpr double upper = Hi;
+    static constexpr std::size_t size = N;
+    static constexpr double step = (Hi - Lo) / (N - 1);
+
+    static constexpr std::array<double, N> values = generate_table<F, Lo, Hi, N>();
+
+    /**
+     * @brief Interpolated F(x). Arguments outside [Lo, Hi] are clamped to the
+     * nearest endpoint.
+     */
+    static constexpr double lookup(double x)
+    {
+        if (!(x > Lo))
+            return values.front();
+        if (!(x < Hi))
+            return values.back();
+
+        const double position = (x - Lo) * inverse_step;
+        std::size_t i = static_cast<std::size_t>(position);
+        if (i > N - 2)
+            i = N - 2;
+        const double fraction = position - static_cast<double>(i);
+        return values[i] + fraction * (values[i + 1] - values[i]);
+    }
+
+    /**
+     * @brief The largest absolute difference between lookup() and F over
+     * 'samples' evenly spaced points per table interval.
+     */
+    static constexpr double max_interpolation_error(std::size_t samples = 8)
+    {
+        double worst = 0.0;
+        for (std::size_t i = 0; i + 1 < N; ++i)
+        {
+            for (std::size_t s = 1; s < samples; ++s)
+            {
+                const double x = Lo + step * (i + static_cast<double>(s) / samples);
+                const double error = lookup(x) - F(x);
+                worst = error < 0.0 ? (-error > worst ? -error : worst)
+                                    : (error > worst ? error : worst);
+            }
+        }
+        return worst;
+    }
+
+private:
+    static constexpr double inverse_step = (N - 1) / (Hi - Lo);
+};
+
+} // namespace constexpr_math
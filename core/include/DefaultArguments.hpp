@@ -0,0 +1,18 @@
+/**
+ * @file DefaultArguments.hpp
+ * @author Daniel Even
+ * @brief The mult function from 11_5_default_arguments, shared with the
+ * benchmarks. It is defined in DefaultArguments.cpp, so every call is a real
+ * call unless link time optimization is enabled.
+ */
+#pragma once
+
+/**
+ * @brief A trivial multiplication function to demonstrate the use of a default
+ * argument
+ *
+ * @note The default value can be supplied here or in the function definition,
+ * but not in both. It is filled in at the call site, which is why it has to
+ * be on this declaration: DefaultArguments.cpp cannot supply it to callers.
+ */
+int mult(int num1, int num2 = 2);
@@ -0,0 +1,91 @@
+/**
+ * @file FunctionTemplates.hpp
+ * @author Daniel Even
+ * @brief The add, max and max_abbr function templates from
+ * 11_6_function_templates, shared with the benchmarks and the other examples.
+ *
+ * The common numeric specializations are instantiated once, in
+ * FunctionTemplates.cpp, and declared extern below, so a translation unit that
+ * calls add<int> or max<double> does not compile its own copy. Calls with any
+ * other type instantiate the template as usual.
+ *
+ * @note add and max are declared inline on purpose. GCC never instantiates an
+ * extern specialization of a non-inline template, not even to inline it, so
+ * every add<int> would become a call. For an inline one it still inlines
+ * where that pays off, and only skips emitting the out-of-line copy.
+ */
+#pragma once
+
+#include <type_traits>
+
+/**
+ * @brief This is a basic templated add function that will be 'instantiated' to
+ * an actual function if it is needed. The type 'T' is a stand in for whatever
+ * type might be needed.
+ *
+ * @note Function template parameters can also have default values, but in this
+ * case the type is now explicitly declared.
+ *
+ * @note Only arithmetic types are accepted. This template would copy two
+ * strings by value and then allocate a third for the result, so it used to be
+ * disabled by deleting its std::string specialization:
+ *
+ *     template <>
+ *     std::string add(std::string a, std::string b) = delete;
+ *
+ * A deleted specialization still takes part in overload resolution, though,
+ * and wins over any other add for two std::strings. The constraint removes this
+ * template from consideration altogether, so those calls go to the
+ * allocation-free add(pieces...) in StringConcat.hpp instead, and array
+ * expressions to array_expr::add.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+inline T add(const T a, const T b)
+{
+    return a + b;
+}
+
+/**
+ * @brief This templated max function takes two parameters that MUST be of the
+ * same type. If this is violated, a compiler error will be generated (see
+ * TWO_TYPES_ERROR in 11_6's main.cpp).
+ *
+ * @note Two array expressions of the same type would match an unconstrained
+ * template better than array_expr::max, which is why only arithmetic types
+ * are accepted here as well.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+inline T max(T x, T y)
+{
+    return (x < y) ? y : x;
+}
+
+/**
+ * @brief This is equivalent to a templated verion of the max function seen
+ * above. This should be used in place of templated functions where parameter
+ * types can be distinct. This format has no way to enforce the rule that the
+ * types be the same and so the traditional templating format should be used if
+ * this is desired.
+ *
+ * @note Its return type is deduced, and an explicit instantiation declaration
+ * does not stop such a function from being instantiated, so max_abbr has no
+ * extern specializations below.
+ */
+auto max_abbr(auto x, auto y)
+{
+    return (x < y) ? y : x;
+}
+
+extern template int add<int>(int, int);
+extern template long add<long>(long, long);
+extern template long long add<long long>(long long, long long);
+extern template float add<float>(float, float);
+extern template double add<double>(double, double);
+
+extern template int max<int>(int, int);
+extern template long max<long>(long, long);
+extern template long long max<long long>(long long, long long);
+extern template float max<float>(float, float);
+extern template double max<double>(double, double);
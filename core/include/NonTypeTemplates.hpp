@@ -0,0 +1,31 @@
+/**
+ * @file NonTypeTemplates.hpp
+ * @author Daniel Even
+ * @brief getSqrt<D>() from 11_9_non_type_template_parameters, shared with the
+ * benchmarks.
+ *
+ * @note getSqrt<D>() folds to a constant, so there is nothing to instantiate
+ * ahead of time: every specialization is a different D, and none of them
+ * leaves any code behind.
+ */
+#pragma once
+
+#include "ConstexprMath.hpp"
+
+/**
+ * @brief This function is an example of how to use function template parameters
+ * instead of function parameters as a workaround on the restriction against
+ * using constexpr parameters.
+ */
+template <double D>
+constexpr double getSqrt()
+{
+    static_assert(D >= 0.0, "getSqrt(): D must be non-negative");
+
+    // std::sqrt is not constexpr, so constexpr_math::sqrt is used instead. The
+    // whole call now folds to a constant.
+    if constexpr (D >= 0)
+        return constexpr_math::sqrt(D);
+
+    return 0.0;
+}
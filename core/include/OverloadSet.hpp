@@ -0,0 +1,41 @@
+/**
+ * @file OverloadSet.hpp
+ * @author Daniel Even
+ * @brief The overloaded add functions from
+ * 11_2_function_overload_differentiation. Each one reports which version was
+ * called, so they live in their own namespace: next to the add template from
+ * FunctionTemplates.hpp, add(1, 2) would otherwise quietly pick one of these.
+ * Bring them in with "using namespace overload_set;".
+ *
+ * @note Every overload is instrumented with TRACE_SCOPE. Configure with
+ * -DENABLE_TRACING=ON to print per-overload call counts and latencies at exit;
+ * see Trace.hpp for details.
+ */
+#pragma once
+
+namespace overload_set {
+
+/**
+ * @brief A trivial function that will be overloaded in the following examples.
+ */
+int add(int num1, int num2);
+
+/**
+ * @brief A trivial function to force the compiler to overload based on the
+ * number of parameters used.
+ */
+int add(int num1, int num2, int num3);
+
+/**
+ * @brief A trivial function to force the compiler to overload based on the
+ * type of parameters used.
+ */
+float add(float num1, float num2);
+
+/**
+ * @brief This demonstrates the compilers ability to differentiate ellipses from
+ * standard parameters
+ */
+int add(int num1, ...);
+
+} // namespace overload_set
@@ -0,0 +1,12 @@
+/**
+ * @file DefaultArguments.cpp
+ * @author Daniel Even
+ * @brief The definition of mult. Repeating the default argument here would be
+ * an error, since the declaration in DefaultArguments.hpp already has it.
+ */
+#include "DefaultArguments.hpp"
+
+int mult(int num1, int num2)
+{
+    return num1 * num2;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file FunctionTemplates.cpp
+ * @author Daniel Even
+ * @brief The one place the extern specializations of add and max are
+ * instantiated.
+ */
+#include "FunctionTemplates.hpp"
+
+template int add<int>(int, int);
+template long add<long>(long, long);
+template long long add<long long>(long long, long long);
+template float add<float>(float, float);
+template double add<double>(double, double);
+
+template int max<int>(int, int);
+template long max<long>(long, long);
+template long long max<long long>(long long, long long);
+template float max<float>(float, float);
+template double max<double>(double, double);
@@ -0,0 +1,53 @@
+/**
+ * @file OverloadSet.cpp
+ * @author Daniel Even
+ * @brief The definitions of the add overloads.
+ */
+#include "OverloadSet.hpp"
+
+#include <cstdarg>
+#include "OutputSink.hpp"
+#include "Trace.hpp"
+
+namespace overload_set {
+
+int add(int num1, int num2)
+{
+    TRACE_SCOPE("add(int, int)");
+    io::out() << "First add version called!" << io::endl;
+    return num1 + num2;
+}
+
+int add(int num1, int num2, int num3)
+{
+    TRACE_SCOPE("add(int, int, int)");
+    io::out() << "Second add version called! (Overloaded based on number of parameters)" << io::endl;
+    return num1 + num2 + num3;
+}
+
+float add(float num1, float num2)
+{
+    TRACE_SCOPE("add(float, float)");
+    io::out() << "Third add version called! (Overloaded based on type of parameters)" << io::endl;
+    return num1 + num2;
+}
+
+int add(int count, ...)
+{
+    TRACE_SCOPE("add(int, ...)");
+    io::out() << "Fifth add version called! (The variable argument list type)" << io::endl;
+    va_list list;
+    va_start(list, count);
+    int sum = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        sum += va_arg(list, int);
+    }
+
+    va_end(list);
+
+    return sum;
+}
+
+} // namespace overload_set
@@ -16,15 +16,22 @@ set(CMAKE_CXX_STANDARD_REQUIRED True)
 set(EXECUTABLE_NAME ${PROJECT_NAME})
 set(EXECUTABLE_TARGET ${EXECUTABLE_NAME}_exe)
 
-# Add source files here
+# Reusable code goes in the library, which the executable and the benchmarks
+# link. Make it an INTERFACE library if it only has headers.
 add_library(${PROJECT_NAME}
-    main.cpp
+    add_library_sources_here.cpp
 )
 
+target_include_directories(${PROJECT_NAME} PUBLIC ${CMAKE_CURRENT_SOURCE_DIR})
+target_link_libraries(${PROJECT_NAME} PUBLIC cpp_concepts_util cpp_concepts_core)
+
+# Add source files here. main.cpp is only compiled into the executable.
 add_executable(${EXECUTABLE_TARGET}
     main.cpp
 )
 
+target_link_libraries(${EXECUTABLE_TARGET} PRIVATE ${PROJECT_NAME})
+
 # This is a custom build command to move the executable to a common location
 # after the build is completed for conveniences sake.
 add_custom_command(TARGET ${EXECUTABLE_TARGET} POST_BUILD
@@ -0,0 +1,288 @@
+/**
+ * @file AlignedBuffer.hpp
+ * @author Daniel Even
+ * @brief aligned_buffer<T> and huge_page_allocator<T>, memory for the large
+ * arrays the add, max and mult kernels stream through, mapped directly with
+ * mmap so that it can be backed by 2 MiB pages and placed on chosen NUMA
+ * nodes.
+ *
+ * With 4 KiB pages, a 1 GiB array needs 262144 TLB entries, far more than any
+ * TLB holds, so a pass over it misses the TLB once per page. With 2 MiB pages
+ * it needs 512. The pages can come from two places:
+ *
+ * - Explicit huge pages (MAP_HUGETLB) come from the pool the administrator
+ *   reserved in /proc/sys/vm/nr_hugepages, and are guaranteed once mapped.
+ * - Transparent huge pages are ordinary memory that the kernel backs with
+ *   2 MiB pages when it can, after madvise(MADV_HUGEPAGE) on a 2 MiB aligned
+ *   range.
+ *
+ * On a machine with several NUMA nodes, a page lives on the node of the
+ * thread that first wrote to it, so an array filled by one thread and read
+ * by another may be read across the interconnect. NumaPlacement::local binds
+ * the pages to the allocating thread's node, and interleave spreads them
+ * round-robin over every node, which suits arrays that all threads read.
+ *
+ * Every request degrades instead of failing: explicit huge pages fall back to
+ * transparent ones, transparent ones to standard pages, and a placement the
+ * kernel refuses to the default first touch. pages() and placement() report
+ * what was actually used:
+ *
+ *     mem::aligned_buffer<double> values(1 << 27, {.pages = mem::PageKind::explicit_huge});
+ *     double sum = add(values);
+ *
+ * @note Linux only, like ColumnFile.hpp.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace mem {
+
+/**
+ * @brief The size of a huge page on x86-64.
+ */
+inline constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+enum class PageKind
+{
+    standard,
+    transparent_huge,
+    explicit_huge,
+};
+
+enum class NumaPlacement
+{
+    // Left to the kernel: each page goes to the node of the thread that
+    // first writes to it.
+    first_touch,
+    // Bound to the NUMA node of the allocating thread.
+    local,
+    // Spread round-robin over every node.
+    interleave,
+};
+
+struct AllocationOptions
+{
+    /**
+     * @brief A power of two. Memory is always at least page aligned.
+     */
+    std::size_t alignment = 64;
+
+    /**
+     * @brief The pages to try first. Allocations smaller than huge_page_size
+     * always use standard pages.
+     */
+    PageKind pages = PageKind::transparent_huge;
+
+    NumaPlacement placement = NumaPlacement::local;
+
+    /**
+     * @brief Writes to every page from the allocating thread, so that the
+     * page faults (and, with first_touch, the placement) happen now rather
+     * than inside the first kernel that reads the memory.
+     */
+    bool prefault = true;
+
+    friend bool operator==(const AllocationOptions&, const AllocationOptions&) = default;
+};
+
+/**
+ * @brief One mapping made by allocate_pages().
+ */
+struct PageAllocation
+{
+    void* data = nullptr;
+    // The length of the mapping, which is what free_pages() unmaps.
+    std::size_t mapped_bytes = 0;
+    PageKind pages = PageKind::standard;
+    NumaPlacement placement = NumaPlacement::first_touch;
+};
+
+/**
+ * @brief Maps at least 'bytes' bytes of zeroed memory, falling back as
+ * described at the top of this file.
+ *
+ * @throws std::invalid_argument if options.alignment is not a power of two.
+ * @throws std::bad_alloc if even standard pages cannot be mapped, or 'bytes'
+ * or options.alignment is too large to be mapped at all.
+ */
+PageAllocation allocate_pages(std::size_t bytes, const AllocationOptions& options = {});
+
+/**
+ * @brief The length allocate_pages(bytes, options) maps, whatever pages it
+ * ends up using.
+ */
+std::size_t mapped_size(std::size_t bytes, const AllocationOptions& options);
+
+/**
+ * @brief Unmaps memory from allocate_pages().
+ */
+void free_pages(void* data, std::size_t mapped_bytes) noexcept;
+
+/**
+ * @brief How many bytes of the mappings that overlap [data, data + bytes) are
+ * currently backed by transparent huge pages, from /proc/self/smaps. The
+ * kernel merges adjacent mappings with the same flags, so this can include
+ * neighbouring memory. 0 if smaps cannot be read.
+ */
+std::size_t transparent_huge_bytes(const void* data, std::size_t bytes);
+
+/**
+ * @brief The number of online NUMA nodes; 1 on a machine without NUMA.
+ */
+int numa_node_count();
+
+/**
+ * @brief The NUMA node of the CPU the calling thread is running on.
+ */
+int current_numa_node();
+
+const char* to_string(PageKind pages);
+const char* to_string(NumaPlacement placement);
+
+namespace detail {
+
+/**
+ * @brief The size in bytes of 'count' objects of type T.
+ *
+ * @throws std::bad_array_new_length if it does not fit in a std::size_t, as
+ * new T[count] would.
+ */
+template <typename T>
+std::size_t array_bytes(std::size_t count)
+{
+    if (count > SIZE_MAX / sizeof(T))
+        throw std::bad_array_new_length();
+    return count * sizeof(T);
+}
+
+} // namespace detail
+
+/**
+ * @brief A fixed-size array of T in memory from allocate_pages(). The
+ * elements start out zero. Move-only, like std::unique_ptr<T[]>.
+ */
+template <typename T>
+class aligned_buffer
+{
+public:
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "aligned_buffer: T must be trivially copyable and destructible, since its elements start out as "
+                  "zero bytes and are never destroyed");
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    aligned_buffer() = default;
+
+    /**
+     * @throws std::invalid_argument if options.alignment is not a power of two.
+     * @throws std::bad_array_new_length if count * sizeof(T) overflows.
+     * @throws std::bad_alloc if the memory cannot be mapped.
+     */
+    explicit aligned_buffer(std::size_t count, const AllocationOptions& options = {})
+        : allocation_(allocate_pages(detail::array_bytes<T>(count), options)), size_(count)
+    {
+    }
+
+    aligned_buffer(aligned_buffer&& other) noexcept
+        : allocation_(std::exchange(other.allocation_, {})), size_(std::exchange(other.size_, 0))
+    {
+    }
+
+    aligned_buffer& operator=(aligned_buffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            free_pages(allocation_.data, allocation_.mapped_bytes);
+            allocation_ = std::exchange(other.allocation_, {});
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    aligned_buffer(const aligned_buffer&) = delete;
+    aligned_buffer& operator=(const aligned_buffer&) = delete;
+
+    ~aligned_buffer() { free_pages(allocation_.data, allocation_.mapped_bytes); }
+
+    T* data() { return static_cast<T*>(allocation_.data); }
+    const T* data() const { return static_cast<const T*>(allocation_.data); }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T& operator[](std::size_t i) { return data()[i]; }
+    const T& operator[](std::size_t i) const { return data()[i]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size_; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size_; }
+
+    operator std::span<T>() { return {data(), size_}; }
+    operator std::span<const T>() const { return {data(), size_}; }
+
+    /**
+     * @brief The pages actually used, after any fallback.
+     */
+    PageKind pages() const { return allocation_.pages; }
+
+    /**
+     * @brief The placement actually applied, after any fallback.
+     */
+    NumaPlacement placement() const { return allocation_.placement; }
+
+private:
+    PageAllocation allocation_;
+    std::size_t size_ = 0;
+};
+
+/**
+ * @brief A standard allocator over allocate_pages(), for containers that have
+ * to grow, such as std::vector<T, huge_page_allocator<T>>. Each allocation
+ * is its own mapping, so this only pays off for large ones.
+ */
+template <typename T>
+class huge_page_allocator
+{
+public:
+    using value_type = T;
+
+    huge_page_allocator() = default;
+    explicit huge_page_allocator(const AllocationOptions& options) : options_(options) {}
+
+    template <typename U>
+    huge_page_allocator(const huge_page_allocator<U>& other) : options_(other.options())
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(allocate_pages(detail::array_bytes<T>(count), options_).data);
+    }
+
+    void deallocate(T* data, std::size_t count) noexcept
+    {
+        free_pages(data, mapped_size(count * sizeof(T), options_));
+    }
+
+    const AllocationOptions& options() const { return options_; }
+
+    template <typename U>
+    friend bool operator==(const huge_page_allocator& a, const huge_page_allocator<U>& b)
+    {
+        return a.options() == b.options();
+    }
+
+private:
+    AllocationOptions options_;
+};
+
+} // namespace mem
@@ -0,0 +1,256 @@
+/**
+ * @file ColumnFile.hpp
+ * @author Daniel Even
+ * @brief A binary file format for a single column of numbers, read through
+ * mmap so that the reduction kernels run straight out of the page cache with
+ * no copy and no heap.
+ *
+ * A column file is a 64-byte ColumnHeader, the elements, and optionally one
+ * checksum per fixed-size block of the elements:
+ *
+ *     [ColumnHeader][padding][count * element_size bytes][padding][checksums]
+ *                           ^ data_offset, a multiple of 64
+ *
+ * Everything is little endian. Since mmap returns page-aligned memory and the
+ * data starts at a multiple of 64, every column is cache-line aligned.
+ *
+ * ColumnWriter writes a column in one pass with constant memory, however long
+ * it is. ColumnFile maps it read-only (with MADV_SEQUENTIAL), validates the
+ * header, and hands out std::span<const T> views:
+ *
+ *     io::ColumnFile file("prices.col");
+ *     double sum = add(file.values<double>());
+ *
+ * Checksums are only compared by ColumnFile::verify(), since that reads the
+ * whole file. The checksum is a fast non-cryptographic 64-bit hash, for
+ * catching truncated or damaged files, not tampering.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace io {
+
+enum class ColumnType : std::uint8_t
+{
+    int32 = 1,
+    int64 = 2,
+    float32 = 3,
+    float64 = 4,
+};
+
+/**
+ * @brief The element types a column can hold. These are also the element
+ * types the span reductions in 11_6 are defined for.
+ */
+template <typename T>
+concept ColumnElement = std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::int64_t> ||
+                        std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template <ColumnElement T>
+inline constexpr ColumnType column_type_of = std::is_same_v<T, std::int32_t> ? ColumnType::int32
+                                             : std::is_same_v<T, std::int64_t> ? ColumnType::int64
+                                             : std::is_same_v<T, float>        ? ColumnType::float32
+                                                                               : ColumnType::float64;
+
+/**
+ * @brief The alignment of the data, in bytes.
+ */
+inline constexpr std::size_t column_alignment = 64;
+
+/**
+ * @brief The default checksum block: 1 MiB.
+ */
+inline constexpr std::size_t default_checksum_block = std::size_t{1} << 20;
+
+/**
+ * @brief The header at the start of every column file.
+ */
+struct ColumnHeader
+{
+    static constexpr std::array<char, 8> expected_magic{'C', 'P', 'P', 'C', 'O', 'L', '\r', '\n'};
+    static constexpr std::uint16_t current_version = 1;
+
+    std::array<char, 8> magic;
+    std::uint16_t version;
+    ColumnType type;
+    std::uint8_t element_size;
+    std::uint32_t alignment;
+    std::uint64_t count;
+    std::uint64_t data_offset;
+    // Bytes of data per checksum, or 0 if the file has no checksums.
+    std::uint64_t checksum_block;
+    std::uint64_t checksum_offset;
+    // column_checksum() of this header with header_checksum set to 0.
+    std::uint64_t header_checksum;
+    std::uint64_t reserved;
+};
+
+static_assert(sizeof(ColumnHeader) == 64 && std::is_trivially_copyable_v<ColumnHeader>);
+
+/**
+ * @brief The checksum used for the header and the data blocks.
+ */
+std::uint64_t column_checksum(std::span<const std::byte> bytes);
+
+/**
+ * @brief Writes a column file in one pass. Elements are buffered one checksum
+ * block at a time, so memory use does not depend on the length of the column.
+ * The header is written last, so a file whose writer never finished is
+ * rejected by ColumnFile.
+ */
+class ColumnWriter
+{
+public:
+    /**
+     * @brief Creates (or truncates) the file at 'path'. 'checksum_block' is
+     * the number of data bytes per checksum, a multiple of 64, or 0 for no
+     * checksums.
+     *
+     * @throws std::system_error if the file cannot be created.
+     * @throws std::invalid_argument if checksum_block is not a multiple of 64.
+     */
+    ColumnWriter(const std::string& path, ColumnType type, std::size_t checksum_block = default_checksum_block);
+
+    ColumnWriter(const ColumnWriter&) = delete;
+    ColumnWriter& operator=(const ColumnWriter&) = delete;
+
+    /**
+     * @brief Closes the file if close() was not called. Errors are ignored.
+     */
+    ~ColumnWriter();
+
+    /**
+     * @throws std::invalid_argument if T is not the column's type.
+     * @throws std::system_error if writing fails.
+     */
+    template <ColumnElement T>
+    void append(std::span<const T> values)
+    {
+        if (column_type_of<T> != type_)
+            throw std::invalid_argument("ColumnWriter: the values do not have the column's type");
+        append_bytes(std::as_bytes(values));
+        count_ += values.size();
+    }
+
+    /**
+     * @brief Writes the checksums and the header and closes the file.
+     *
+     * @throws std::system_error if writing fails.
+     */
+    void close();
+
+private:
+    void append_bytes(std::span<const std::byte> bytes);
+    void flush_block();
+
+    int fd_ = -1;
+    ColumnType type_;
+    std::size_t checksum_block_;
+    std::size_t block_size_;
+    std::unique_ptr<std::byte[]> block_;
+    std::size_t block_used_ = 0;
+    std::uint64_t count_ = 0;
+    std::uint64_t data_bytes_ = 0;
+    std::unique_ptr<std::uint64_t[]> checksums_;
+    std::size_t checksum_count_ = 0;
+    std::size_t checksum_capacity_ = 0;
+};
+
+/**
+ * @brief Writes 'values' as a complete column file.
+ */
+template <ColumnElement T>
+void write_column(const std::string& path, std::span<const T> values,
+                  std::size_t checksum_block = default_checksum_block)
+{
+    ColumnWriter writer(path, column_type_of<T>, checksum_block);
+    writer.append(values);
+    writer.close();
+}
+
+/**
+ * @brief True if the file at 'path' starts like a column file. Does not
+ * validate the rest of the header.
+ */
+bool is_column_file(const std::string& path);
+
+/**
+ * @brief A column file mapped read-only.
+ */
+class ColumnFile
+{
+public:
+    /**
+     * @throws std::system_error if the file cannot be opened or mapped.
+     * @throws std::invalid_argument if it is not a valid column file.
+     */
+    explicit ColumnFile(const std::string& path);
+
+    ColumnFile(ColumnFile&& other) noexcept;
+    ColumnFile& operator=(ColumnFile&& other) noexcept;
+    ColumnFile(const ColumnFile&) = delete;
+    ColumnFile& operator=(const ColumnFile&) = delete;
+    ~ColumnFile();
+
+    const ColumnHeader& header() const { return header_; }
+    ColumnType type() const { return header_.type; }
+    std::uint64_t size() const { return header_.count; }
+    bool checksummed() const { return header_.checksum_block != 0; }
+
+    /**
+     * @brief The whole column, 64-byte aligned, straight from the mapping.
+     *
+     * @throws std::invalid_argument if T is not the column's type.
+     */
+    template <ColumnElement T>
+    std::span<const T> values() const
+    {
+        if (column_type_of<T> != header_.type)
+            throw std::invalid_argument("ColumnFile: the column does not hold this type");
+        const T* data = std::assume_aligned<column_alignment>(reinterpret_cast<const T*>(data_));
+        return {data, static_cast<std::size_t>(header_.count)};
+    }
+
+    /**
+     * @brief Calls f with values<T>() for whichever T the column holds, and
+     * returns what f returns.
+     */
+    template <typename F>
+    decltype(auto) visit(F&& f) const
+    {
+        switch (header_.type)
+        {
+        case ColumnType::int32: return std::forward<F>(f)(values<std::int32_t>());
+        case ColumnType::int64: return std::forward<F>(f)(values<std::int64_t>());
+        case ColumnType::float32: return std::forward<F>(f)(values<float>());
+        default: return std::forward<F>(f)(values<double>());
+        }
+    }
+
+    /**
+     * @brief Compares every block against its checksum. Does nothing for a
+     * file without checksums.
+     *
+     * @throws std::invalid_argument naming the first damaged block.
+     */
+    void verify() const;
+
+private:
+    void release() noexcept;
+
+    const std::byte* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    const std::byte* data_ = nullptr;
+    ColumnHeader header_{};
+};
+
+} // namespace io
@@ -0,0 +1,58 @@
+/**
+ * @file CpuDispatch.hpp
+ * @author Daniel Even
+ * @brief The instruction sets the SIMD kernels in the examples are built for,
+ * and the CPUID checks that pick one at runtime. Each set of kernels (the span
+ * reductions in 11_6, sqrt_batch in 11_9, wide::sum in 11_2, and the AVX2
+ * paths of 11_4 and 11_5) compiles its files with the matching -m flags and
+ * asks this header which of them the CPU can run:
+ *
+ *     cpu::Isa reduce_isa() { return cpu::selected<cpu::Isa::avx512, cpu::Isa::avx2, cpu::Isa::sse2>(); }
+ *
+ * A caller that forces a particular Isa (to check or benchmark the kernels
+ * against each other) should check supported() first; the kernel sets fall
+ * back to scalar for one that is not.
+ */
+#pragma once
+
+#include <initializer_list>
+
+namespace cpu {
+
+enum class Isa
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+};
+
+/**
+ * @brief True if this CPU (and this build) can run code for 'isa'. scalar is
+ * always supported.
+ */
+bool supported(Isa isa);
+
+/**
+ * @brief The first of 'candidates', best first, that is supported, or
+ * Isa::scalar if none is.
+ */
+Isa best_supported(std::initializer_list<Isa> candidates);
+
+/**
+ * @brief best_supported({Candidates...}), queried once per set of candidates
+ * and cached for the rest of the run.
+ */
+template <Isa... Candidates>
+Isa selected()
+{
+    static const Isa isa = best_supported({Candidates...});
+    return isa;
+}
+
+/**
+ * @brief "scalar", "sse2", "avx2" or "avx512".
+ */
+const char* to_string(Isa isa);
+
+} // namespace cpu
@@ -0,0 +1,543 @@
+/**
+ * @file Memoize.hpp
+ * @author Daniel Even
+ * @brief memoize<F>, a wrapper that remembers the results of a pure function,
+ * on top of ConcurrentCache, a fixed-capacity cache that any number of
+ * threads can read without taking a lock.
+ *
+ *     memo::memoize cached_mult([](int num1, int num2) { return mult(num1, num2); }, 4096);
+ *     int product = cached_mult(10, 3); // computed
+ *     product = cached_mult(10, 3);     // found in the cache
+ *
+ * (mult itself is an overload set, which cannot be deduced as F; a function
+ * pointer or a lambda can.)
+ *
+ * The arguments are hashed as one tuple. The function has to be pure, since a
+ * result may be computed more than once (two threads missing on the same
+ * arguments both compute it) and is never recomputed while it stays cached.
+ *
+ * Layout: the cache is split into shards by the top bits of the hash, and
+ * each shard is an open-addressing table in which a key may live in any of
+ * the 8 slots after its home slot (its probe window). A lookup therefore
+ * reads at most 8 slots, which usually share two cache lines, and stops at
+ * the first empty one.
+ *
+ * Eviction is CLOCK inside the probe window: a lookup that finds its key
+ * marks the slot as referenced, and an insert into a full window sweeps from
+ * the shard's clock hand, clearing referenced slots, and replaces the first
+ * slot that was not referenced. A key that is used over and over keeps its
+ * slot, and a key that is looked up once is the first to go.
+ *
+ * Reads never wait. Every slot carries a sequence number that is odd while
+ * the slot is being rewritten (a seqlock): a reader copies the slot and
+ * checks the sequence number before and after, and a slot that was being
+ * rewritten simply does not count as holding the key. Writes, which only
+ * happen on a miss, take the shard's mutex. For this, the key and value types
+ * must be trivially copyable, so that a copy torn by a concurrent write can
+ * be thrown away.
+ *
+ * The hit, miss and eviction counters are split into one cache line per
+ * thread, so that counting does not put every thread that hits the same hot
+ * key on the same cache line, and a thread adds to its own counters without
+ * an atomic read-modify-write.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace memo {
+
+/**
+ * @brief A snapshot of the counters of a ConcurrentCache.
+ */
+struct CacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+
+    double hit_rate() const
+    {
+        const std::uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+namespace detail {
+
+/**
+ * @brief The splitmix64 finalizer. std::hash of an integer is the integer
+ * itself, whose low bits pick the slot and whose high bits pick the shard,
+ * so both need to depend on every bit of the key.
+ */
+constexpr std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+    return x;
+}
+
+inline constexpr std::size_t counter_stripes = 64;
+
+/**
+ * @brief A counter stripe owned by one thread for as long as it lives. Only
+ * the owner writes to its stripe, so it can count with a plain load and
+ * store instead of an atomic read-modify-write. A thread that finds all of
+ * them taken gets index counter_stripes, the stripe shared by everybody.
+ */
+class StripeLease
+{
+public:
+    StripeLease()
+    {
+        std::uint64_t taken = in_use().load(std::memory_order_relaxed);
+        do
+        {
+            index = static_cast<std::size_t>(std::countr_one(taken));
+            if (index == counter_stripes)
+                return;
+        } while (!in_use().compare_exchange_weak(taken, taken | (std::uint64_t{1} << index),
+                                                 std::memory_order_acquire, std::memory_order_relaxed));
+    }
+
+    ~StripeLease()
+    {
+        // Release, so that the next owner sees the counts of this one.
+        if (index != counter_stripes)
+            in_use().fetch_and(~(std::uint64_t{1} << index), std::memory_order_release);
+    }
+
+    StripeLease(const StripeLease&) = delete;
+    StripeLease& operator=(const StripeLease&) = delete;
+
+    std::size_t index = counter_stripes;
+
+private:
+    static_assert(counter_stripes == 64, "StripeLease: one bit per stripe in a std::uint64_t");
+
+    static std::atomic<std::uint64_t>& in_use()
+    {
+        static std::atomic<std::uint64_t> stripes{0};
+        return stripes;
+    }
+};
+
+inline std::size_t owned_stripe()
+{
+    thread_local const StripeLease lease;
+    return lease.index;
+}
+
+/**
+ * @brief A tuple that stays trivially copyable when its elements are (which
+ * std::tuple does not promise), for use as a cache key.
+ */
+template <typename... Ts>
+struct packed_args;
+
+template <>
+struct packed_args<>
+{
+    friend bool operator==(const packed_args&, const packed_args&) = default;
+};
+
+template <typename T, typename... Ts>
+struct packed_args<T, Ts...>
+{
+    T head;
+    packed_args<Ts...> tail;
+
+    friend bool operator==(const packed_args&, const packed_args&) = default;
+};
+
+constexpr packed_args<> pack()
+{
+    return {};
+}
+
+template <typename T, typename... Ts>
+constexpr packed_args<T, Ts...> pack(const T& head, const Ts&... tail)
+{
+    return {head, pack(tail...)};
+}
+
+template <typename... Ts>
+struct packed_args_hash
+{
+    std::size_t operator()(const packed_args<Ts...>& args) const { return combine(args, 0); }
+
+private:
+    template <typename... Us>
+    static std::size_t combine(const packed_args<Us...>& args, std::size_t seed)
+    {
+        if constexpr (sizeof...(Us) == 0)
+            return seed;
+        else
+            // The cache mixes the result, so a multiply is enough to make the
+            // order of the arguments matter.
+            return combine(args.tail,
+                           (seed ^ std::hash<std::decay_t<decltype(args.head)>>{}(args.head)) * 0x9e3779b97f4a7c15);
+    }
+};
+
+/**
+ * @brief The signature R(Args...) of a function pointer or of a class with
+ * one non-template operator().
+ */
+template <typename F>
+struct signature_of : signature_of<decltype(&F::operator())>
+{
+};
+
+template <typename R, typename... Args>
+struct signature_of<R (*)(Args...)>
+{
+    using type = R(Args...);
+};
+
+template <typename R, typename... Args>
+struct signature_of<R (*)(Args...) noexcept> : signature_of<R (*)(Args...)>
+{
+};
+
+template <typename C, typename R, typename... Args>
+struct signature_of<R (C::*)(Args...) const> : signature_of<R (*)(Args...)>
+{
+};
+
+template <typename C, typename R, typename... Args>
+struct signature_of<R (C::*)(Args...) const noexcept> : signature_of<R (*)(Args...)>
+{
+};
+
+template <typename C, typename R, typename... Args>
+struct signature_of<R (C::*)(Args...)> : signature_of<R (*)(Args...)>
+{
+};
+
+} // namespace detail
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ConcurrentCache
+{
+    static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+                  "ConcurrentCache: the key and value types must be trivially copyable, so that lookups can copy "
+                  "them out of a slot without a lock");
+
+public:
+    /**
+     * @brief The number of slots a key may occupy, starting at its home slot.
+     */
+    static constexpr std::size_t probe_window = 8;
+
+    /**
+     * @param capacity The number of entries, rounded up to a power of two.
+     * @param shards Rounded up to a power of two. 0 picks 4 per hardware
+     * thread, as long as each shard keeps at least 64 slots.
+     *
+     * @throws std::invalid_argument if capacity is 0.
+     */
+    explicit ConcurrentCache(std::size_t capacity, std::size_t shards = 0, Hash hash = Hash())
+        : hash_(std::move(hash))
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("ConcurrentCache: the capacity must be at least 1");
+        const std::size_t slots = std::bit_ceil(std::max(capacity, probe_window));
+        if (shards == 0)
+            shards = std::max<std::size_t>(1, std::thread::hardware_concurrency()) * 4;
+        shards = std::min(std::bit_ceil(shards), std::max<std::size_t>(1, slots / 64));
+
+        shard_count_ = shards;
+        shard_shift_ = shards == 1 ? 0 : 64 - std::countr_zero(shards);
+        slot_mask_ = slots / shards - 1;
+        shards_ = std::make_unique<Shard[]>(shards);
+        for (std::size_t i = 0; i < shards; ++i)
+            shards_[i].slots = std::make_unique<Slot[]>(slots / shards);
+    }
+
+    ConcurrentCache(const ConcurrentCache&) = delete;
+    ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+    /**
+     * @brief Copies the value cached for 'key' to 'value' and returns true, or
+     * returns false. Never takes a lock. Does not count as a hit or a miss.
+     */
+    bool find(const Key& key, Value& value) const
+    {
+        const std::uint64_t hash = hash_of(key);
+        const Shard& shard = shard_for(hash);
+        const std::uint32_t tag = tag_of(hash);
+        for (std::size_t i = 0; i < probe_window; ++i)
+        {
+            const Slot& slot = shard.slots[(hash + i) & slot_mask_];
+            const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before == 0)
+                return false;
+            if ((before & 1) != 0 || slot.tag.load(std::memory_order_relaxed) != tag)
+                continue;
+
+            const Entry entry = slot.read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before || !(entry.key == key))
+                continue;
+
+            // Only written when it changes, so that threads hitting the same
+            // hot key do not keep taking its cache line from each other.
+            if (slot.referenced.load(std::memory_order_relaxed) == 0)
+                slot.referenced.store(1, std::memory_order_relaxed);
+            value = entry.value;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Caches 'value' for 'key', evicting an entry from the key's probe
+     * window if it is full. Does nothing if the key is already cached.
+     */
+    void insert(const Key& key, const Value& value)
+    {
+        const std::uint64_t hash = hash_of(key);
+        Shard& shard = shard_for(hash);
+        const std::uint32_t tag = tag_of(hash);
+        const std::scoped_lock lock(shard.mutex);
+
+        Slot* target = nullptr;
+        for (std::size_t i = 0; i < probe_window && !target; ++i)
+        {
+            Slot& slot = shard.slots[(hash + i) & slot_mask_];
+            if (slot.sequence.load(std::memory_order_relaxed) == 0)
+                target = &slot;
+            else if (slot.tag.load(std::memory_order_relaxed) == tag && slot.read().key == key)
+                return;
+        }
+
+        if (!target)
+        {
+            // Every slot gets a second chance, so the sweep ends within two
+            // turns of the window.
+            for (;;)
+            {
+                Slot& slot = shard.slots[(hash + shard.hand) & slot_mask_];
+                shard.hand = (shard.hand + 1) % probe_window;
+                if (slot.referenced.load(std::memory_order_relaxed) == 0)
+                {
+                    target = &slot;
+                    break;
+                }
+                slot.referenced.store(0, std::memory_order_relaxed);
+            }
+            count(&Counters::evictions);
+        }
+        target->write(tag, Entry{key, value});
+    }
+
+    /**
+     * @brief The cached value for 'key', or compute() stored in the cache.
+     * compute() runs without any lock held.
+     */
+    template <typename Compute>
+    Value get_or_compute(const Key& key, Compute&& compute)
+    {
+        Value value;
+        if (find(key, value))
+        {
+            count(&Counters::hits);
+            return value;
+        }
+        count(&Counters::misses);
+        value = std::forward<Compute>(compute)();
+        insert(key, value);
+        return value;
+    }
+
+    /**
+     * @brief The counters summed over every thread. Consistent once the
+     * threads using the cache have stopped.
+     */
+    CacheStats stats() const
+    {
+        CacheStats total;
+        for (const Counters& stripe : counters_)
+        {
+            total.hits += stripe.hits.load(std::memory_order_relaxed);
+            total.misses += stripe.misses.load(std::memory_order_relaxed);
+            total.evictions += stripe.evictions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * @brief Only while no thread is using the cache: a thread adds to its
+     * own counters with a plain store, which would undo a reset made
+     * meanwhile.
+     */
+    void reset_stats()
+    {
+        for (Counters& stripe : counters_)
+        {
+            stripe.hits.store(0, std::memory_order_relaxed);
+            stripe.misses.store(0, std::memory_order_relaxed);
+            stripe.evictions.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t capacity() const { return shard_count_ * (slot_mask_ + 1); }
+    std::size_t shard_count() const { return shard_count_; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+    };
+
+    static constexpr std::size_t entry_words = (sizeof(Entry) + 7) / 8;
+
+    struct Slot
+    {
+        // 0 while the slot has never been written, odd while it is being
+        // written.
+        std::atomic<std::uint32_t> sequence{0};
+        std::atomic<std::uint32_t> tag{0};
+        mutable std::atomic<std::uint8_t> referenced{0};
+        std::atomic<std::uint64_t> words[entry_words] = {};
+
+        Entry read() const
+        {
+            std::uint64_t copy[entry_words];
+            for (std::size_t i = 0; i < entry_words; ++i)
+                copy[i] = words[i].load(std::memory_order_relaxed);
+            Entry entry;
+            std::memcpy(&entry, copy, sizeof(Entry));
+            return entry;
+        }
+
+        /**
+         * @brief Shard mutex held.
+         */
+        void write(std::uint32_t new_tag, const Entry& entry)
+        {
+            std::uint64_t copy[entry_words] = {};
+            std::memcpy(copy, &entry, sizeof(Entry));
+            const std::uint32_t before = sequence.load(std::memory_order_relaxed);
+            sequence.store(before + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            tag.store(new_tag, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < entry_words; ++i)
+                words[i].store(copy[i], std::memory_order_relaxed);
+            referenced.store(0, std::memory_order_relaxed);
+            sequence.store(before + 2, std::memory_order_release);
+        }
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        // The offset in the probe window the next eviction sweep starts at.
+        std::size_t hand = 0;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    struct alignas(64) Counters
+    {
+        std::atomic<std::uint64_t> hits{0};
+        std::atomic<std::uint64_t> misses{0};
+        std::atomic<std::uint64_t> evictions{0};
+    };
+
+    std::uint64_t hash_of(const Key& key) const { return detail::mix(static_cast<std::uint64_t>(hash_(key))); }
+
+    static std::uint32_t tag_of(std::uint64_t hash) { return static_cast<std::uint32_t>(hash >> 16); }
+
+    const Shard& shard_for(std::uint64_t hash) const { return shards_[shard_shift_ == 0 ? 0 : hash >> shard_shift_]; }
+    Shard& shard_for(std::uint64_t hash) { return shards_[shard_shift_ == 0 ? 0 : hash >> shard_shift_]; }
+
+    void count(std::atomic<std::uint64_t> Counters::*counter)
+    {
+        const std::size_t stripe = detail::owned_stripe();
+        std::atomic<std::uint64_t>& value = counters_[stripe].*counter;
+        if (stripe == detail::counter_stripes)
+            value.fetch_add(1, std::memory_order_relaxed);
+        else
+            value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    Hash hash_;
+    std::size_t shard_count_ = 0;
+    int shard_shift_ = 0;
+    std::size_t slot_mask_ = 0;
+    std::unique_ptr<Shard[]> shards_;
+    // One stripe per thread that holds a detail::StripeLease, and a last one
+    // shared by any others.
+    Counters counters_[detail::counter_stripes + 1];
+};
+
+/**
+ * @brief Wraps a function pointer or a callable with one non-template
+ * operator() and caches its results by argument. Default arguments do not
+ * carry over, so memoize(mult) takes both of mult's arguments.
+ */
+template <typename F, typename Signature = typename detail::signature_of<F>::type>
+class memoize;
+
+template <typename F, typename R, typename... Args>
+class memoize<F, R(Args...)>
+{
+public:
+    using key_type = detail::packed_args<std::decay_t<Args>...>;
+    using result_type = std::decay_t<R>;
+
+    static_assert(!std::is_void_v<R>, "memoize: the function must return a value");
+
+    /**
+     * @param capacity The number of results to keep; see ConcurrentCache.
+     */
+    explicit memoize(F function, std::size_t capacity = 4096, std::size_t shards = 0)
+        : function_(std::move(function)), cache_(capacity, shards)
+    {
+    }
+
+    result_type operator()(Args... args)
+    {
+        return cache_.get_or_compute(detail::pack(static_cast<const std::decay_t<Args>&>(args)...),
+                                     [&] { return std::invoke(function_, args...); });
+    }
+
+    CacheStats stats() const { return cache_.stats(); }
+    void reset_stats() { cache_.reset_stats(); }
+    const ConcurrentCache<key_type, result_type, detail::packed_args_hash<std::decay_t<Args>...>>& cache() const
+    {
+        return cache_;
+    }
+
+private:
+    F function_;
+    ConcurrentCache<key_type, result_type, detail::packed_args_hash<std::decay_t<Args>...>> cache_;
+};
+
+template <typename F>
+memoize(F) -> memoize<F>;
+
+template <typename F>
+memoize(F, std::size_t) -> memoize<F>;
+
+template <typename F>
+memoize(F, std::size_t, std::size_t) -> memoize<F>;
+
+} // namespace memo
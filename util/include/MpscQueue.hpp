@@ -0,0 +1,93 @@
+/**
+ * @file MpscQueue.hpp
+ * @author Daniel Even
+ * @brief An intrusive lock-free queue for many producers and one consumer.
+ *
+ * This is Dmitry Vyukov's intrusive MPSC node-based queue: push() is a single
+ * atomic exchange, so producers never wait for each other or for the
+ * consumer, and pop() takes no locks either. The elements are linked through
+ * an MpscNode they inherit from; the queue never allocates or frees them.
+ *
+ * A push that has exchanged the head but not yet linked its node in is not
+ * visible to pop() until it finishes, so pop() can return nullptr while the
+ * queue is briefly non-empty. Consumers that sleep must therefore be woken by
+ * something the producer does after push() returns.
+ */
+#pragma once
+
+#include <atomic>
+
+namespace parallel {
+
+struct MpscNode
+{
+    std::atomic<MpscNode*> next{nullptr};
+};
+
+/**
+ * @brief T must derive from MpscNode.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief Any thread.
+     */
+    void push(T* item) { push_node(item); }
+
+    /**
+     * @brief Consumer only. Returns the oldest element, or nullptr if there is
+     * none (or the only one is still being pushed).
+     */
+    T* pop()
+    {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_)
+        {
+            if (next == nullptr)
+                return nullptr;
+            tail_ = tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr)
+        {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire))
+            return nullptr;
+
+        // 'tail' is the last element. Put the stub behind it so it can be
+        // unlinked without racing the next push.
+        push_node(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        return nullptr;
+    }
+
+private:
+    void push_node(MpscNode* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* previous = head_.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Producers only touch head_, the consumer mostly tail_.
+    alignas(64) std::atomic<MpscNode*> head_;
+    alignas(64) MpscNode* tail_;
+    MpscNode stub_;
+};
+
+} // namespace parallel
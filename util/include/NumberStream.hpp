@@ -0,0 +1,138 @@
+/**
+ * @file NumberStream.hpp
+ * @author Daniel Even
+ * @brief Streaming numeric input for the example executables, fast enough to
+ * push multi-gigabyte text logs through the kernels.
+ *
+ * NumberReader parses whitespace- or comma-separated numbers with
+ * std::from_chars, straight out of the input bytes:
+ *
+ * 1) A regular file is mmap'd whole (with MADV_SEQUENTIAL), so parsing reads
+ * the page cache directly and nothing is copied.
+ *
+ * 2) Anything else (a pipe, a terminal, stdin) is read() in 1 MiB blocks. A
+ * number that straddles two blocks is moved to the front of the buffer before
+ * the next block is read behind it.
+ *
+ * read() fills a caller-supplied span, so the caller decides the batch size
+ * and memory stays constant however large the input is:
+ *
+ *     io::NumberReader reader(path);
+ *     std::vector<double> batch(io::default_batch);
+ *     while (std::size_t n = reader.read(std::span(batch)))
+ *         total = add(total, add(std::span<const double>(batch.data(), n)));
+ *
+ * write_numbers() is the matching output half: it formats a whole batch with
+ * std::to_chars and hands it to the FILE in one fwrite(). format_numbers()
+ * does the formatting alone, for callers that write somewhere else (or on
+ * another thread).
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace io {
+
+/**
+ * @brief A batch size that keeps a batch of doubles inside L2.
+ */
+inline constexpr std::size_t default_batch = 16384;
+
+class NumberReader
+{
+public:
+    /**
+     * @brief Reads the file at 'path', or stdin if path is "-".
+     *
+     * @throws std::system_error if the file cannot be opened.
+     */
+    explicit NumberReader(const std::string& path);
+
+    /**
+     * @brief Parses 'text' in place. The text must outlive the reader.
+     */
+    static NumberReader from_memory(std::string_view text);
+
+    NumberReader(NumberReader&& other) noexcept;
+    NumberReader& operator=(NumberReader&& other) noexcept;
+    NumberReader(const NumberReader&) = delete;
+    NumberReader& operator=(const NumberReader&) = delete;
+    ~NumberReader();
+
+    /**
+     * @brief Parses up to out.size() numbers into 'out' and returns how many
+     * were parsed. 0 means the input is exhausted. Defined for int32_t,
+     * int64_t, float and double.
+     *
+     * @throws std::invalid_argument if the input contains something that is
+     * not a number, or a number longer than 256 bytes that runs past the end
+     * of a read() block, naming its byte offset.
+     * @throws std::range_error if a number does not fit in T.
+     */
+    template <typename T>
+    std::size_t read(std::span<T> out);
+
+    /**
+     * @brief The number of input bytes parsed so far.
+     */
+    std::uint64_t bytes_read() const { return consumed_ + static_cast<std::uint64_t>(cursor_ - begin_); }
+
+    /**
+     * @brief True if the input is mmap'd rather than read in blocks.
+     */
+    bool mapped() const { return map_ != nullptr; }
+
+private:
+    NumberReader() = default;
+
+    /**
+     * @brief Keeps the unparsed bytes from cursor_ on and reads the next block
+     * behind them. Returns false once nothing more can be read.
+     */
+    bool refill();
+
+    /**
+     * @brief Skips separators, refilling as needed. Returns false at the end of
+     * the input.
+     */
+    bool skip_separators();
+
+    void release() noexcept;
+
+    const char* begin_ = nullptr;
+    const char* cursor_ = nullptr;
+    const char* end_ = nullptr;
+    std::uint64_t consumed_ = 0;
+
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    bool eof_ = true;
+
+    void* map_ = nullptr;
+    std::size_t map_size_ = 0;
+
+    std::unique_ptr<char[]> buffer_;
+};
+
+/**
+ * @brief Writes 'values' to 'out', one per line, with a single fwrite(). Floats
+ * use the shortest representation that reads back to the same value. Defined
+ * for the same types as NumberReader::read().
+ */
+template <typename T>
+void write_numbers(std::FILE* out, std::span<const T> values);
+
+/**
+ * @brief Formats 'values' as write_numbers() does, replacing the contents of
+ * 'text'. Defined for the same types.
+ */
+template <typename T>
+void format_numbers(std::span<const T> values, std::string& text);
+
+} // namespace io
@@ -0,0 +1,242 @@
+/**
+ * @file OutputSink.hpp
+ * @author Daniel Even
+ * @brief Buffered text output that writes many lines per system call, for the
+ * examples' std::cout << ... << std::endl lines.
+ *
+ * std::endl flushes, so every line printed with it costs a write(2). An
+ * OutputSink collects text in a per-thread buffer instead and writes it with
+ * writev(2) when its FlushPolicy says so:
+ *
+ *     io::OutputSink out(io::stdout_fd, {.policy = io::FlushPolicy::size});
+ *     out << "add(1, 2) = " << add(1, 2) << io::endl;
+ *
+ * 1) Each thread appends to its own chain of fixed-size blocks, so writers on
+ * different threads never contend. The policy is checked at the end of each
+ * line, and a thread's batch is written contiguously, so lines from different
+ * threads never tear (though they interleave in batches, not line by line).
+ *
+ * 2) A flush writes all of a thread's blocks with one writev() (several if
+ * there are more than IOV_MAX of them).
+ *
+ * 3) With OutputOptions::background, the flushing thread does not write:
+ * it pushes its blocks onto a lock-free MPSC queue, and a writer thread
+ * gathers everything queued by all threads into as few writev() calls as
+ * possible. flush() still waits until its data has been written.
+ *
+ * io::out() is the sink the examples print to. The CPP_CONCEPTS_OUTPUT
+ * environment variable picks its policy: "line" (the default, one write per
+ * line as with std::endl), "size", "time", "explicit" or "background".
+ * With CPP_CONCEPTS_OUTPUT_STATS set, its line, byte and syscall counts are
+ * printed to stderr at exit.
+ */
+#pragma once
+
+#include "MpscQueue.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace io {
+
+inline constexpr int stdout_fd = STDOUT_FILENO;
+
+namespace detail {
+
+// Defined in OutputSink.cpp.
+struct OutputBlock;
+struct ThreadBuffer;
+
+} // namespace detail
+
+enum class FlushPolicy
+{
+    // Write at the end of every line, as std::endl does.
+    line,
+    // Write once a thread has flush_bytes buffered.
+    size,
+    // Write once the oldest buffered line is flush_interval old, or flush_bytes
+    // are buffered. Time is only checked at the end of a line; a thread that
+    // stops printing keeps its last lines until flush() or destruction.
+    time,
+    // Write only on flush(), flush_all() or destruction. Memory use grows with
+    // the output.
+    explicit_only,
+};
+
+struct OutputOptions
+{
+    FlushPolicy policy = FlushPolicy::size;
+    // The size of the blocks the text is collected in.
+    std::size_t block_size = std::size_t{16} << 10;
+    std::size_t flush_bytes = std::size_t{256} << 10;
+    std::chrono::milliseconds flush_interval{100};
+    // Hand batches to a writer thread instead of writing on the caller's.
+    bool background = false;
+};
+
+struct OutputStats
+{
+    std::uint64_t lines = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t syscalls = 0;
+};
+
+class OutputSink
+{
+public:
+    /**
+     * @brief Writes to 'fd', which is not closed on destruction.
+     *
+     * @throws std::invalid_argument if block_size is 0.
+     */
+    explicit OutputSink(int fd = stdout_fd, const OutputOptions& options = {});
+
+    /**
+     * @brief Writes whatever is still buffered, as flush_all() does. Errors
+     * are ignored.
+     */
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void write(std::string_view text);
+
+    void put(char c) { write(std::string_view(&c, 1)); }
+
+    /**
+     * @brief Writes '\n', counts a line, and flushes if the policy says so.
+     */
+    void end_line();
+
+    /**
+     * @brief Writes the calling thread's buffered text and waits until it has
+     * been written, in background mode too.
+     *
+     * @throws std::system_error if writing fails (in background mode, if any
+     * earlier background write failed).
+     */
+    void flush();
+
+    /**
+     * @brief Writes every thread's buffered text. The other threads must not
+     * be writing to the sink at the same time, e.g. because they were joined.
+     */
+    void flush_all();
+
+    /**
+     * @brief Totals over all threads. 'bytes' and 'syscalls' only count what
+     * has been written so far.
+     */
+    OutputStats stats() const;
+
+    const OutputOptions& options() const;
+
+    OutputSink& operator<<(std::string_view text)
+    {
+        write(text);
+        return *this;
+    }
+
+    OutputSink& operator<<(const char* text) { return *this << std::string_view(text); }
+
+    OutputSink& operator<<(char c)
+    {
+        put(c);
+        return *this;
+    }
+
+    /**
+     * @brief Numbers print as std::ostream prints them by default: bools as 0
+     * and 1, signed and unsigned chars as characters, floating point values
+     * with 6 significant digits as "%g" does.
+     */
+    template <typename T>
+        requires std::is_arithmetic_v<T> && (!std::is_same_v<T, char>)
+    OutputSink& operator<<(T value)
+    {
+        if constexpr (sizeof(T) == 1 && !std::is_same_v<T, bool>)
+            return *this << static_cast<char>(value);
+        else
+        {
+            char text[32];
+            std::to_chars_result result;
+            if constexpr (std::is_same_v<T, bool>)
+                result = std::to_chars(text, text + sizeof(text), static_cast<int>(value));
+            else if constexpr (std::is_floating_point_v<T>)
+                result = std::to_chars(text, text + sizeof(text), value, std::chars_format::general, 6);
+            else
+                result = std::to_chars(text, text + sizeof(text), value);
+            write(std::string_view(text, static_cast<std::size_t>(result.ptr - text)));
+            return *this;
+        }
+    }
+
+    OutputSink& operator<<(OutputSink& (*manipulator)(OutputSink&)) { return manipulator(*this); }
+
+private:
+    using Block = detail::OutputBlock;
+
+    detail::ThreadBuffer& local();
+    Block* new_block();
+    void recycle(Block* chain);
+    void flush(detail::ThreadBuffer& buffer, bool wait);
+    void write_chains(Block* const* chains, std::size_t count);
+    void writer_loop();
+
+    int fd_;
+    OutputOptions options_;
+    std::uint64_t id_;
+
+    // Per-thread buffers, found through a one-entry thread_local cache.
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<detail::ThreadBuffer>>> buffers_;
+
+    // Blocks are reused rather than freed.
+    std::mutex pool_mutex_;
+    std::vector<std::unique_ptr<Block>> blocks_;
+    std::vector<Block*> free_;
+
+    // Foreground writes hold this, so that batches stay contiguous.
+    std::mutex write_mutex_;
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> syscalls_{0};
+    std::atomic<int> error_{0};
+
+    // The background writer's side.
+    parallel::MpscQueue<Block> queue_;
+    std::atomic<std::uint64_t> submitted_{0};
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread writer_;
+};
+
+/**
+ * @brief The line end for OutputSink, as std::endl is for std::ostream.
+ */
+inline OutputSink& endl(OutputSink& out)
+{
+    out.end_line();
+    return out;
+}
+
+/**
+ * @brief The process-wide sink on stdout, configured from CPP_CONCEPTS_OUTPUT.
+ * Flushed at exit.
+ */
+OutputSink& out();
+
+} // namespace io
@@ -0,0 +1,224 @@
+/**
+ * @file Parallel.hpp
+ * @author Daniel Even
+ * @brief parallel_for and parallel_reduce on top of ThreadPool::join().
+ *
+ * Both split their range in half recursively. How far they split adapts to
+ * the load, using the scheme from Rayon: a range starts out allowed to split
+ * about log2(threads) times, and whenever a half is stolen by an idle thread
+ * its allowance is topped back up. Balanced work therefore ends up in roughly
+ * one piece per thread, while uneven work keeps getting divided for as long as
+ * somebody is hungry. Options::grain puts a floor under the piece size.
+ *
+ * parallel_reduce takes any associative combiner callable as combiner(T, T),
+ * which includes the add<T> and max<T> function templates from 11_6:
+ *
+ *     double sum = parallel::parallel_reduce(values, 0.0, add<double>);
+ *
+ * If the combiner can also be called with a std::span<const T> (like the SIMD
+ * span overloads in SpanReduce.hpp), each piece is handed to it whole instead
+ * of being folded one element at a time.
+ *
+ * Because the split points depend on which halves get stolen, a floating point
+ * reduction can round differently from run to run. Setting
+ * Options::deterministic reduces fixed-size blocks instead and combines their
+ * results in a fixed pairwise order, which gives the same bits for any thread
+ * count and any schedule, at the cost of a buffer of per-block results.
+ */
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace parallel {
+
+struct Options
+{
+    /**
+     * @brief The smallest piece worth handing to another thread. 0 picks a
+     * default: 1 index for parallel_for and 4096 elements for parallel_reduce.
+     * In deterministic mode this is also the block size, and 0 means 16384.
+     */
+    std::size_t grain = 0;
+
+    /**
+     * @brief See the top of this file.
+     */
+    bool deterministic = false;
+
+    /**
+     * @brief nullptr means ThreadPool::global().
+     */
+    ThreadPool* pool = nullptr;
+};
+
+namespace detail {
+
+inline constexpr std::size_t default_reduce_grain = 4096;
+inline constexpr std::size_t default_deterministic_block = 16384;
+
+/**
+ * @brief Decides whether a range may be split further.
+ */
+class Splitter
+{
+public:
+    Splitter(std::size_t threads, std::size_t grain) : threads_(threads), splits_(threads), grain_(grain) {}
+
+    bool try_split(std::size_t length, bool migrated)
+    {
+        if (length / 2 < grain_)
+            return false;
+        if (migrated)
+        {
+            // A thief took this half, so there are idle threads: allow it to
+            // be split at least as much as a fresh range.
+            splits_ = std::max(threads_, splits_ / 2);
+            return true;
+        }
+        if (splits_ > 0)
+        {
+            splits_ /= 2;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::size_t threads_;
+    std::size_t splits_;
+    std::size_t grain_;
+};
+
+template <typename Body>
+void for_range(ThreadPool& pool, std::size_t begin, std::size_t end, Splitter splitter,
+               bool migrated, Body& body)
+{
+    if (splitter.try_split(end - begin, migrated))
+    {
+        const std::size_t middle = begin + (end - begin) / 2;
+        pool.join([&] { for_range(pool, begin, middle, splitter, false, body); },
+                  [&](bool stolen) { for_range(pool, middle, end, splitter, stolen, body); });
+        return;
+    }
+
+    if constexpr (std::is_invocable_v<Body&, std::size_t, std::size_t>)
+        body(begin, end);
+    else
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            body(i);
+    }
+}
+
+/**
+ * @brief Folds one piece. Uses the combiner's span overload if it has one.
+ */
+template <typename T, typename Combiner>
+T reduce_piece(std::span<const T> piece, const T& identity, Combiner& combiner)
+{
+    if (piece.empty())
+        return identity;
+
+    if constexpr (std::is_invocable_r_v<T, Combiner&, std::span<const T>>)
+        return combiner(identity, static_cast<T>(combiner(piece)));
+    else
+    {
+        T result = identity;
+        for (const T& value : piece)
+            result = combiner(result, value);
+        return result;
+    }
+}
+
+template <typename T, typename Combiner>
+T reduce_range(ThreadPool& pool, std::span<const T> values, Splitter splitter, bool migrated,
+               const T& identity, Combiner& combiner)
+{
+    if (!splitter.try_split(values.size(), migrated))
+        return reduce_piece(values, identity, combiner);
+
+    const std::size_t middle = values.size() / 2;
+    T left = identity;
+    T right = identity;
+    pool.join(
+        [&] { left = reduce_range(pool, values.first(middle), splitter, false, identity, combiner); },
+        [&](bool stolen) {
+            right = reduce_range(pool, values.subspan(middle), splitter, stolen, identity, combiner);
+        });
+    return combiner(left, right);
+}
+
+} // namespace detail
+
+/**
+ * @brief Calls body for every index in [begin, end), in parallel. body may take
+ * either a single index, or a (begin, end) pair for a whole piece at once.
+ */
+template <typename Body>
+    requires std::invocable<Body&, std::size_t> || std::invocable<Body&, std::size_t, std::size_t>
+void parallel_for(std::size_t begin, std::size_t end, Body&& body, const Options& options = {})
+{
+    if (begin >= end)
+        return;
+
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::global();
+    const std::size_t grain = std::max<std::size_t>(options.grain, 1);
+    detail::for_range(pool, begin, end, detail::Splitter(pool.size(), grain), false, body);
+}
+
+/**
+ * @brief Combines every element of 'range' with 'combiner', starting from
+ * 'identity', in parallel. combiner must be associative and identity must be
+ * its neutral element (0 for add, the lowest value for max).
+ */
+template <std::ranges::contiguous_range Range, typename T, typename Combiner>
+    requires std::same_as<std::ranges::range_value_t<Range>, T> &&
+             std::is_invocable_r_v<T, Combiner&, T, T>
+T parallel_reduce(Range&& range, T identity, Combiner combiner, const Options& options = {})
+{
+    const std::span<const T> values(std::ranges::data(range), std::ranges::size(range));
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::global();
+
+    if (!options.deterministic)
+    {
+        const std::size_t grain = options.grain ? options.grain : detail::default_reduce_grain;
+        return detail::reduce_range(pool, values, detail::Splitter(pool.size(), grain), false,
+                                    identity, combiner);
+    }
+
+    // Fixed blocks, reduced in any order, then combined in a fixed order.
+    const std::size_t block = options.grain ? options.grain : detail::default_deterministic_block;
+    const std::size_t blocks = (values.size() + block - 1) / block;
+    if (blocks == 0)
+        return identity;
+
+    std::vector<T> partials(blocks, identity);
+    parallel_for(
+        0, blocks,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const std::size_t offset = i * block;
+                partials[i] = detail::reduce_piece(
+                    values.subspan(offset, std::min(block, values.size() - offset)), identity, combiner);
+            }
+        },
+        Options{1, false, &pool});
+
+    for (std::size_t width = 1; width < blocks; width *= 2)
+    {
+        for (std::size_t i = 0; i + width < blocks; i += 2 * width)
+            partials[i] = combiner(partials[i], partials[i + width]);
+    }
+    return partials.front();
+}
+
+} // namespace parallel
@@ -0,0 +1,558 @@
+/**
+ * @file Pipeline.hpp
+ * @author Daniel Even
+ * @brief A pipeline of stages, each on its own thread, connected by bounded
+ * SpscQueues, so that reading, computing and writing overlap.
+ *
+ * Run one after the other, parse -> compute -> format -> write takes as long
+ * as all four stages added up. Here each stage runs on a thread of its own
+ * and passes whole batches to the next one, so once the pipeline is full it
+ * takes as long as its slowest stage:
+ *
+ *     parallel::Pipeline pipeline;
+ *     pipeline.source("parse", [&]() -> parallel::Generator<Batch> { ... co_yield batch; ... })
+ *         .then("sqrt", [](Batch batch) { ...; return batch; })
+ *         .then("format", [](Batch batch) { return format(batch); })
+ *         .sink("write", [](std::string text) { ... });
+ *     pipeline.run();
+ *
+ * 1) A stage is either a plain callable or a C++20 coroutine. A plain source
+ * returns std::optional<T> and ends the stream with std::nullopt; a plain
+ * stage maps one batch to one batch; a sink consumes them. A coroutine source
+ * returns a Generator<T> and co_yields its batches, and a coroutine stage
+ * takes an Input<T>& to loop over and co_yields as many or as few batches as
+ * it likes, which suits stages that keep state between batches.
+ *
+ * 2) Stages are linked by SpscQueues of PipelineOptions::queue_capacity
+ * batches. A stage that gets ahead of the next one waits for room, so memory
+ * stays bounded and a slow stage throttles everything upstream of it.
+ *
+ * 3) Stage i is pinned to the i-th CPU the process may run on (round robin),
+ * so stages do not migrate between cores and take their caches with them.
+ *
+ * 4) Every stage records StageMetrics: the batches and items it handled, and
+ * how its time split between its own work (busy), waiting for input
+ * (starved) and waiting for room downstream (blocked), plus the depth of its
+ * input queue. The stage with the most busy time is the bottleneck; the ones
+ * before it show up as blocked and the ones after it as starved. With the
+ * CPP_CONCEPTS_PIPELINE_STATS environment variable set, run() prints them to
+ * stderr.
+ *
+ * If a stage throws, every queue is cancelled, the other stages stop at
+ * their next push or pop, and run() rethrows the first exception.
+ */
+#pragma once
+
+#include "SpscQueue.hpp"
+
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace parallel {
+
+/**
+ * @brief A coroutine that produces a sequence of T with co_yield, one at a
+ * time as the caller iterates over it. Nothing runs until begin().
+ */
+template <typename T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        Generator get_return_object() { return Generator(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        // The yielded object lives until the coroutine is resumed, so the
+        // caller can move from it in between.
+        std::suspend_always yield_value(T& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+
+        std::suspend_always yield_value(T&& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        // co_await is not for generators.
+        void await_transform() = delete;
+
+        T* current = nullptr;
+        std::exception_ptr error;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator
+    {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(Handle handle) : handle_(handle) {}
+
+        T& operator*() const { return *handle_.promise().current; }
+
+        iterator& operator++()
+        {
+            resume(handle_);
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.handle_.done(); }
+
+    private:
+        Handle handle_;
+    };
+
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    Generator& operator=(Generator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    ~Generator()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    /**
+     * @brief Runs the coroutine up to its first co_yield.
+     *
+     * @throws whatever the coroutine throws, here or from operator++.
+     */
+    iterator begin()
+    {
+        resume(handle_);
+        return iterator(handle_);
+    }
+
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(Handle handle) : handle_(handle) {}
+
+    static void resume(Handle handle)
+    {
+        handle.resume();
+        if (handle.promise().error)
+            std::rethrow_exception(std::exchange(handle.promise().error, {}));
+    }
+
+    Handle handle_;
+};
+
+struct PipelineOptions
+{
+    // The batches each queue holds before its producer has to wait.
+    std::size_t queue_capacity = 4;
+    // Pin each stage's thread to a CPU of its own (round robin if there are
+    // more stages than CPUs).
+    bool pin = true;
+};
+
+struct StageMetrics
+{
+    std::string name;
+    // The CPU the stage was pinned to, or -1.
+    int cpu = -1;
+    // Produced by a source, consumed by every other stage. Items are the
+    // batches' size()s, for batch types that have one.
+    std::uint64_t batches = 0;
+    std::uint64_t items = 0;
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds starved{0};
+    std::chrono::nanoseconds blocked{0};
+    // Of the stage's input queue (0 for a source), seen at each pop.
+    std::size_t queue_capacity = 0;
+    double mean_queue_depth = 0.0;
+    std::size_t max_queue_depth = 0;
+
+    /**
+     * @brief The rate the stage would run at if it never had to wait.
+     */
+    double items_per_second() const
+    {
+        return busy.count() > 0 ? static_cast<double>(items) * 1e9 / static_cast<double>(busy.count()) : 0.0;
+    }
+};
+
+namespace pipeline_detail {
+
+template <typename T>
+std::uint64_t item_count(const T& batch)
+{
+    if constexpr (requires { batch.size(); })
+        return static_cast<std::uint64_t>(batch.size());
+    else
+        return 1;
+}
+
+template <typename T>
+struct is_generator : std::false_type
+{
+};
+
+template <typename T>
+struct is_generator<Generator<T>> : std::true_type
+{
+    using value_type = T;
+};
+
+/**
+ * @brief Pushes to a queue, adding the time spent waiting for room to the
+ * stage's 'blocked' time.
+ */
+template <typename T>
+bool push(SpscQueue<T>& queue, T& value, StageMetrics& metrics)
+{
+    if (queue.try_push(value))
+        return true;
+    const auto start = std::chrono::steady_clock::now();
+    const bool pushed = queue.push(value);
+    metrics.blocked += std::chrono::steady_clock::now() - start;
+    return pushed;
+}
+
+} // namespace pipeline_detail
+
+/**
+ * @brief A stage's input: a range over the batches arriving from the previous
+ * stage, which ends when that stage has finished (or the pipeline is
+ * cancelled). Popping records the stage's metrics.
+ */
+template <typename T>
+class Input
+{
+public:
+    Input(SpscQueue<T>& queue, StageMetrics& metrics) : queue_(queue), metrics_(metrics)
+    {
+        metrics_.queue_capacity = queue.capacity();
+    }
+
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    ~Input()
+    {
+        if (metrics_.batches != 0)
+            metrics_.mean_queue_depth = static_cast<double>(depth_sum_) / static_cast<double>(metrics_.batches);
+    }
+
+    /**
+     * @brief Waits for the next batch. Returns false at the end of the input.
+     */
+    bool next(T& out)
+    {
+        const std::size_t depth = queue_.size();
+        if (!queue_.try_pop(out))
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const bool popped = queue_.pop(out);
+            metrics_.starved += std::chrono::steady_clock::now() - start;
+            if (!popped)
+                return false;
+        }
+        depth_sum_ += depth;
+        if (depth > metrics_.max_queue_depth)
+            metrics_.max_queue_depth = depth;
+        ++metrics_.batches;
+        metrics_.items += pipeline_detail::item_count(out);
+        return true;
+    }
+
+    class iterator
+    {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(Input* input) : input_(input) { ++*this; }
+
+        T& operator*() const { return input_->current_; }
+
+        iterator& operator++()
+        {
+            if (!input_->next(input_->current_))
+                input_ = nullptr;
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.input_ == nullptr; }
+
+    private:
+        Input* input_ = nullptr;
+    };
+
+    iterator begin() { return iterator(this); }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    SpscQueue<T>& queue_;
+    StageMetrics& metrics_;
+    T current_{};
+    std::uint64_t depth_sum_ = 0;
+};
+
+namespace pipeline_detail {
+
+/**
+ * @brief True for a coroutine stage, which takes an Input<T>& and returns a
+ * Generator.
+ */
+template <typename F, typename T>
+constexpr bool is_coroutine_stage()
+{
+    if constexpr (std::is_invocable_v<F&, Input<T>&>)
+        return is_generator<std::invoke_result_t<F&, Input<T>&>>::value;
+    else
+        return false;
+}
+
+} // namespace pipeline_detail
+
+template <typename T>
+class Flow;
+
+class Pipeline
+{
+public:
+    explicit Pipeline(const PipelineOptions& options = {}) : options_(options) {}
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /**
+     * @brief Adds the first stage: a callable returning a Generator<T>, or one
+     * returning std::optional<T>, which is called until it returns nullopt.
+     */
+    template <typename F>
+    auto source(std::string name, F stage);
+
+    /**
+     * @brief Runs every stage on its own thread and waits for all of them.
+     *
+     * @throws std::invalid_argument if the pipeline does not end in a sink, or
+     * has already run.
+     * @throws the first exception thrown by a stage.
+     */
+    void run();
+
+    /**
+     * @brief One entry per stage, in order. Complete once run() has returned.
+     */
+    const std::vector<StageMetrics>& metrics() const { return metrics_; }
+
+    /**
+     * @brief The metrics as a table, one line per stage, with the bottleneck
+     * marked.
+     */
+    std::string report() const;
+
+private:
+    template <typename T>
+    friend class Flow;
+
+    struct Channel
+    {
+        virtual ~Channel() = default;
+        virtual void cancel() = 0;
+    };
+
+    template <typename T>
+    struct TypedChannel final : Channel
+    {
+        explicit TypedChannel(std::size_t capacity) : queue(capacity) {}
+        void cancel() override { queue.cancel(); }
+
+        SpscQueue<T> queue;
+    };
+
+    template <typename T>
+    SpscQueue<T>& add_channel()
+    {
+        auto channel = std::make_unique<TypedChannel<T>>(options_.queue_capacity);
+        SpscQueue<T>& queue = channel->queue;
+        channels_.push_back(std::move(channel));
+        return queue;
+    }
+
+    void add_stage(std::string name, std::function<void(StageMetrics&)> body)
+    {
+        StageMetrics metrics;
+        metrics.name = std::move(name);
+        metrics_.push_back(std::move(metrics));
+        stages_.push_back(std::move(body));
+    }
+
+    /**
+     * @brief Runs stage 'index' on the calling thread.
+     */
+    void run_stage(std::size_t index);
+
+    PipelineOptions options_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::vector<std::function<void(StageMetrics&)>> stages_;
+    std::vector<StageMetrics> metrics_;
+    bool complete_ = false;
+    bool ran_ = false;
+
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+/**
+ * @brief The end of a pipeline under construction, producing batches of T.
+ * Returned by Pipeline::source() and then(); add the next stage to it.
+ */
+template <typename T>
+class Flow
+{
+public:
+    /**
+     * @brief Adds a stage: a callable taking a T and returning the next
+     * stage's batch, or a coroutine taking an Input<T>& and returning a
+     * Generator of them.
+     */
+    template <typename F>
+    auto then(std::string name, F stage)
+    {
+        SpscQueue<T>& input = *queue_;
+        if constexpr (pipeline_detail::is_coroutine_stage<F, T>())
+        {
+            using U = typename pipeline_detail::is_generator<std::invoke_result_t<F&, Input<T>&>>::value_type;
+            SpscQueue<U>& output = pipeline_->add_channel<U>();
+            pipeline_->add_stage(std::move(name), [&input, &output, stage = std::move(stage)](StageMetrics& metrics) mutable {
+                Input<T> batches(input, metrics);
+                for (U& result : stage(batches))
+                {
+                    if (!pipeline_detail::push(output, result, metrics))
+                        return;
+                }
+                output.close();
+            });
+            return Flow<U>(*pipeline_, output);
+        }
+        else
+        {
+            using U = std::invoke_result_t<F&, T&&>;
+            static_assert(!std::is_void_v<U>, "Pipeline: use sink() for a stage that returns nothing");
+            SpscQueue<U>& output = pipeline_->add_channel<U>();
+            pipeline_->add_stage(std::move(name), [&input, &output, stage = std::move(stage)](StageMetrics& metrics) mutable {
+                Input<T> batches(input, metrics);
+                for (T& batch : batches)
+                {
+                    U result = stage(std::move(batch));
+                    if (!pipeline_detail::push(output, result, metrics))
+                        return;
+                }
+                output.close();
+            });
+            return Flow<U>(*pipeline_, output);
+        }
+    }
+
+    /**
+     * @brief Adds the last stage, a callable taking a T.
+     */
+    template <typename F>
+        requires std::invocable<F&, T&&>
+    void sink(std::string name, F stage)
+    {
+        SpscQueue<T>& input = *queue_;
+        pipeline_->add_stage(std::move(name), [&input, stage = std::move(stage)](StageMetrics& metrics) mutable {
+            Input<T> batches(input, metrics);
+            for (T& batch : batches)
+                stage(std::move(batch));
+        });
+        pipeline_->complete_ = true;
+    }
+
+private:
+    friend class Pipeline;
+
+    template <typename U>
+    friend class Flow;
+
+    Flow(Pipeline& pipeline, SpscQueue<T>& queue) : pipeline_(&pipeline), queue_(&queue) {}
+
+    Pipeline* pipeline_;
+    SpscQueue<T>* queue_;
+};
+
+template <typename F>
+auto Pipeline::source(std::string name, F stage)
+{
+    using Result = std::invoke_result_t<F&>;
+    if constexpr (pipeline_detail::is_generator<Result>::value)
+    {
+        using T = typename pipeline_detail::is_generator<Result>::value_type;
+        SpscQueue<T>& output = add_channel<T>();
+        add_stage(std::move(name), [&output, stage = std::move(stage)](StageMetrics& metrics) mutable {
+            for (T& batch : stage())
+            {
+                ++metrics.batches;
+                metrics.items += pipeline_detail::item_count(batch);
+                if (!pipeline_detail::push(output, batch, metrics))
+                    return;
+            }
+            output.close();
+        });
+        return Flow<T>(*this, output);
+    }
+    else
+    {
+        static_assert(requires(Result result) { *result; result.has_value(); },
+                      "Pipeline: a source returns a Generator<T> or a std::optional<T>");
+        using T = std::remove_cvref_t<decltype(*std::declval<Result&>())>;
+        SpscQueue<T>& output = add_channel<T>();
+        add_stage(std::move(name), [&output, stage = std::move(stage)](StageMetrics& metrics) mutable {
+            while (Result batch = stage())
+            {
+                ++metrics.batches;
+                metrics.items += pipeline_detail::item_count(*batch);
+                if (!pipeline_detail::push(output, *batch, metrics))
+                    return;
+            }
+            output.close();
+        });
+        return Flow<T>(*this, output);
+    }
+}
+
+} // namespace parallel
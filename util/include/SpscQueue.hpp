@@ -0,0 +1,246 @@
+/**
+ * @file SpscQueue.hpp
+ * @author Daniel Even
+ * @brief A bounded lock-free ring buffer for one producer and one consumer,
+ * the link between two stages of a Pipeline.
+ *
+ * 1) The producer only writes tail_ and the consumer only writes head_, and
+ * each sits on its own cache line. Each side also keeps a private copy of the
+ * other side's index and only reloads it when the copy says the queue is full
+ * (or empty). The sleep flags and wake-up counters of 3) sit on two more
+ * lines, which are only written when a side goes to sleep or is woken. So
+ * while neither side sleeps, a push or pop that does not have to wait reads
+ * the other side's sleep flag from a line that stays shared in both caches,
+ * and touches no cache line the other thread is writing.
+ *
+ * 2) The capacity is fixed. push() on a full queue waits until the consumer
+ * makes room, which is how a slow stage holds back the stages before it
+ * (backpressure) instead of letting the queue grow without bound.
+ *
+ * 3) A side that has to wait spins briefly and then sleeps with
+ * std::atomic::wait on a wake-up counter of its own. The other side only
+ * bumps the counter and notifies when a sleeper has announced itself, so the
+ * fast path never makes a system call.
+ *
+ * close() is called by the producer once it has pushed everything; pop()
+ * then drains the queue and returns false. cancel() may be called by any
+ * thread, and makes every push() and pop() return false at once.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace parallel {
+
+/**
+ * @brief T must be default constructible and movable. Moved-from slots keep
+ * their value until overwritten, so a T that owns memory (a batch) keeps it
+ * alive for one lap of the ring at most.
+ */
+template <typename T>
+class SpscQueue
+{
+    static_assert(std::is_default_constructible_v<T> && std::is_move_assignable_v<T>,
+                  "SpscQueue: T must be default constructible and move assignable");
+
+public:
+    /**
+     * @param capacity Rounded up to a power of two.
+     *
+     * @throws std::invalid_argument if capacity is 0.
+     */
+    explicit SpscQueue(std::size_t capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("SpscQueue: the capacity must be at least 1");
+        std::size_t rounded = 1;
+        while (rounded < capacity)
+            rounded *= 2;
+        mask_ = rounded - 1;
+        slots_ = std::make_unique<T[]>(rounded);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Producer only. Returns false without waiting if the queue is
+     * full, in which case 'value' is left alone.
+     */
+    bool try_push(T& value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_)
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_)
+                return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        if (consumer_sleeping_.load(std::memory_order_seq_cst))
+            wake(consumer_wake_);
+        return true;
+    }
+
+    /**
+     * @brief Consumer only. Returns false without waiting if the queue is
+     * empty.
+     */
+    bool try_pop(T& out)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_)
+        {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_)
+                return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        if (producer_sleeping_.load(std::memory_order_seq_cst))
+            wake(producer_wake_);
+        return true;
+    }
+
+    /**
+     * @brief Producer only. Waits while the queue is full. Returns false if
+     * the queue was cancelled, in which case 'value' was not pushed.
+     */
+    bool push(T& value)
+    {
+        for (int spins = 0; !try_push(value); ++spins)
+        {
+            if (cancelled())
+                return false;
+            if (spins < spins_before_sleep)
+            {
+                relax(spins);
+                continue;
+            }
+            // Announce the sleep before the last look at head_, so that a pop
+            // in between either is seen here or sees the flag and wakes us.
+            producer_sleeping_.store(true, std::memory_order_seq_cst);
+            const std::uint32_t epoch = producer_wake_.load(std::memory_order_seq_cst);
+            const std::size_t head = head_.load(std::memory_order_seq_cst);
+            if (tail_.load(std::memory_order_relaxed) - head > mask_ && !cancelled())
+                producer_wake_.wait(epoch, std::memory_order_seq_cst);
+            producer_sleeping_.store(false, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Consumer only. Waits while the queue is empty. Returns false once
+     * the queue is closed and drained, or cancelled.
+     */
+    bool pop(T& out)
+    {
+        for (int spins = 0; !try_pop(out); ++spins)
+        {
+            if (cancelled())
+                return false;
+            // close() comes after the last push, so an empty closed queue is
+            // done only if it is still empty after seeing the close.
+            if (closed_.load(std::memory_order_acquire))
+                return try_pop(out);
+            if (spins < spins_before_sleep)
+            {
+                relax(spins);
+                continue;
+            }
+            consumer_sleeping_.store(true, std::memory_order_seq_cst);
+            const std::uint32_t epoch = consumer_wake_.load(std::memory_order_seq_cst);
+            const std::size_t tail = tail_.load(std::memory_order_seq_cst);
+            if (head_.load(std::memory_order_relaxed) == tail && !closed_.load(std::memory_order_seq_cst) &&
+                !cancelled())
+                consumer_wake_.wait(epoch, std::memory_order_seq_cst);
+            consumer_sleeping_.store(false, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Producer only. No more values will be pushed.
+     */
+    void close()
+    {
+        closed_.store(true, std::memory_order_seq_cst);
+        wake(consumer_wake_);
+    }
+
+    /**
+     * @brief Any thread. Wakes both sides and makes them give up.
+     */
+    void cancel()
+    {
+        cancelled_.store(true, std::memory_order_seq_cst);
+        wake(consumer_wake_);
+        wake(producer_wake_);
+    }
+
+    bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief The number of values in the queue. Exact from either side, a
+     * snapshot from anywhere else.
+     */
+    std::size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    static constexpr int spins_before_sleep = 256;
+
+    static void relax(int spins)
+    {
+        if (spins < 64)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        else
+            std::this_thread::yield();
+    }
+
+    static void wake(std::atomic<std::uint32_t>& counter)
+    {
+        counter.fetch_add(1, std::memory_order_seq_cst);
+        counter.notify_one();
+    }
+
+    // The consumer's line.
+    alignas(64) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_ = 0;
+
+    // The producer's line.
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_ = 0;
+
+    // Read on every push (pop), written only when the consumer (producer)
+    // goes to sleep or is woken.
+    alignas(64) std::atomic<bool> consumer_sleeping_{false};
+    std::atomic<std::uint32_t> consumer_wake_{0};
+
+    alignas(64) std::atomic<bool> producer_sleeping_{false};
+    std::atomic<std::uint32_t> producer_wake_{0};
+
+    // Written once each.
+    alignas(64) std::atomic<bool> closed_{false};
+    std::atomic<bool> cancelled_{false};
+    std::size_t mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+};
+
+} // namespace parallel
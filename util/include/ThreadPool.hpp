@@ -0,0 +1,301 @@
+/**
+ * @file ThreadPool.hpp
+ * @author Daniel Even
+ * @brief A work-stealing thread pool built around a single fork-join primitive,
+ * join(a, b), which runs a and b potentially in parallel and returns once both
+ * have finished.
+ *
+ * 1) Every worker owns a Chase-Lev deque (WorkStealingDeque below). join()
+ * pushes b onto the bottom of the calling worker's deque, runs a inline, and
+ * then pops b back off if nobody stole it in the meantime. Idle workers steal
+ * from the top of a random victim's deque, so they take the oldest, and
+ * therefore largest, piece of outstanding work.
+ *
+ * 2) The thread that calls into the pool from outside takes the place of
+ * worker 0 for the duration of the call, so a pool of N threads starts N - 1
+ * background threads and a pool of 1 thread runs everything inline. Only one
+ * outside thread can use a pool at a time; others wait their turn.
+ *
+ * 3) Idle workers spin briefly and then sleep on an atomic counter that is
+ * bumped whenever work is pushed while someone is asleep.
+ *
+ * Exceptions thrown by either side of a join() are rethrown from join() once
+ * both sides have finished. The parallel algorithms built on top of this live
+ * in Parallel.hpp.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace parallel {
+
+class ThreadPool;
+
+/**
+ * @brief A unit of work that can sit in a deque. Tasks are owned by whoever
+ * pushed them (join() keeps them on its stack), so the deque only ever stores
+ * pointers.
+ */
+class Task
+{
+public:
+    /**
+     * @brief Runs the task. 'migrated' is true if it runs on a different
+     * thread than the one that pushed it, i.e. it was stolen.
+     */
+    virtual void execute(bool migrated) = 0;
+
+protected:
+    ~Task() = default;
+};
+
+/**
+ * @brief The lock-free deque from Chase and Lev, "Dynamic Circular
+ * Work-Stealing Deque" (SPAA 2005), with the memory orderings from Le, Pop,
+ * Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+ * Memory Models" (PPoPP 2013).
+ *
+ * The owning thread pushes and pops at the bottom; any thread may steal from
+ * the top. The buffer grows when full. Old buffers may still be read by a
+ * concurrent steal, so they are kept until the deque is destroyed.
+ */
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(std::size_t capacity = 256);
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Owner only.
+     */
+    void push(Task* task);
+
+    /**
+     * @brief Owner only. Returns the most recently pushed task, or nullptr if
+     * the deque is empty or a thief took the last task first.
+     */
+    Task* pop();
+
+    /**
+     * @brief Any thread. Returns the oldest task, or nullptr if the deque is
+     * empty or another thief won the race for it.
+     */
+    Task* steal();
+
+    /**
+     * @brief A snapshot that may be out of date by the time it returns.
+     */
+    bool empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Buffer
+    {
+        explicit Buffer(std::int64_t capacity)
+            : capacity(capacity), mask(capacity - 1), slots(new std::atomic<Task*>[capacity])
+        {
+        }
+
+        Task* get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, Task* task) { slots[i & mask].store(task, std::memory_order_relaxed); }
+
+        std::int64_t capacity;
+        std::int64_t mask;
+        std::unique_ptr<std::atomic<Task*>[]> slots;
+    };
+
+    Buffer* grow(Buffer* buffer, std::int64_t bottom, std::int64_t top);
+
+    // top_ is written by thieves and bottom_ by the owner; keeping them on
+    // separate cache lines stops every push from invalidating the thieves.
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+class ThreadPool
+{
+public:
+    /**
+     * @param threads The total number of threads that work on a call into the
+     * pool, including the caller. 0 means std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief The pool used when no other pool is given. Its size comes from the
+     * CPP_CONCEPTS_THREADS environment variable if set, otherwise from
+     * std::thread::hardware_concurrency().
+     */
+    static ThreadPool& global();
+
+    std::size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief Runs a() and b() potentially in parallel. b receives a bool that
+     * is true if it was stolen by another thread; this is what lets the
+     * algorithms in Parallel.hpp adapt their grain size.
+     */
+    template <typename A, typename B>
+    void join(A&& a, B&& b);
+
+private:
+    struct Worker;
+
+    template <typename F>
+    class JoinTask final : public Task
+    {
+    public:
+        explicit JoinTask(F& function) : function_(function) {}
+
+        void execute(bool migrated) override
+        {
+            try
+            {
+                function_(migrated);
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+            done_.store(true, std::memory_order_release);
+        }
+
+        const std::atomic<bool>& done() const { return done_; }
+        const std::exception_ptr& error() const { return error_; }
+
+    private:
+        F& function_;
+        std::exception_ptr error_;
+        std::atomic<bool> done_{false};
+    };
+
+    /**
+     * @brief The worker the calling thread is acting as in this pool, or
+     * nullptr if it is not part of the pool.
+     */
+    Worker* current_worker() const;
+
+    /**
+     * @brief Makes the calling thread worker 0 while f runs.
+     */
+    template <typename F>
+    void run_as_member(F&& f);
+
+    /**
+     * @brief Used by run_as_member: takes over worker 0 and returns whatever
+     * worker the thread was acting as before, to be handed back to
+     * leave_worker().
+     */
+    Worker* enter_as_worker_zero();
+    void leave_worker(Worker* previous);
+
+    void push(Worker& worker, Task* task);
+
+    /**
+     * @brief Runs other tasks until 'task' is done, preferring to pop it back
+     * off the worker's own deque.
+     */
+    void wait_for(Worker& worker, Task* task, const std::atomic<bool>& done);
+
+    /**
+     * @brief Tries to steal one task from another worker and run it.
+     */
+    bool steal_and_run(Worker& worker);
+
+    void worker_loop(std::size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex outside_caller_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<std::uint32_t> sleepers_{0};
+    std::atomic<std::uint32_t> wake_epoch_{0};
+
+    static thread_local Worker* current_;
+};
+
+/**
+ * @brief Per-thread state. The deque has its own cache-line alignment; the rest
+ * is only touched by the owner.
+ */
+struct ThreadPool::Worker
+{
+    Worker(ThreadPool& pool, std::size_t index)
+        : pool(pool), index(index), rng(static_cast<std::uint32_t>(index) * 2654435761u + 1)
+    {
+    }
+
+    WorkStealingDeque deque;
+    ThreadPool& pool;
+    std::size_t index;
+    std::uint32_t rng;
+};
+
+template <typename A, typename B>
+void ThreadPool::join(A&& a, B&& b)
+{
+    Worker* worker = current_worker();
+    if (worker == nullptr)
+    {
+        run_as_member([&] { join(a, b); });
+        return;
+    }
+
+    using Function = std::remove_reference_t<B>;
+    JoinTask<Function> task(b);
+    push(*worker, &task);
+
+    // The task lives on this stack frame, so it must finish before unwinding
+    // even if a() throws.
+    try
+    {
+        a();
+    }
+    catch (...)
+    {
+        wait_for(*worker, &task, task.done());
+        throw;
+    }
+    wait_for(*worker, &task, task.done());
+
+    if (task.error())
+        std::rethrow_exception(task.error());
+}
+
+template <typename F>
+void ThreadPool::run_as_member(F&& f)
+{
+    std::lock_guard<std::mutex> lock(outside_caller_);
+    Worker* previous = enter_as_worker_zero();
+    try
+    {
+        f();
+    }
+    catch (...)
+    {
+        leave_worker(previous);
+        throw;
+    }
+    leave_worker(previous);
+}
+
+} // namespace parallel
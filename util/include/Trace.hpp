@@ -0,0 +1,135 @@
+/**
+ * @file Trace.hpp
+ * @author Daniel Even
+ * @brief A small instrumentation surface for the example functions. Placing
+ * TRACE_SCOPE("name") at the top of a function records:
+ *
+ * 1) A per-site call count.
+ *
+ * 2) A per-site latency histogram with power-of-two buckets, measured in TSC
+ * ticks on x86 and clock_gettime() nanoseconds elsewhere. Ticks are converted
+ * to nanoseconds when the summary is printed at exit.
+ *
+ * 3) Optionally, one trace event per call written into a lock-free ring buffer
+ * owned by the calling thread. A background thread drains every ring and the
+ * events are dumped as CSV, or as Chrome trace JSON if the file name ends in
+ * ".json". Events are only collected when the CPP_CONCEPTS_TRACE_FILE
+ * environment variable names an output file.
+ *
+ * Everything is compiled in only when CPP_CONCEPTS_TRACE is defined (configure
+ * with -DENABLE_TRACING=ON). Otherwise TRACE_SCOPE expands to nothing and the
+ * instrumented functions compile to exactly the same code as before.
+ */
+#pragma once
+
+#ifdef CPP_CONCEPTS_TRACE
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace trace {
+
+/**
+ * @brief Reads the cheapest monotonic clock available.
+ */
+inline std::uint64_t now() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1'000'000'000u + ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief The statistics for a single instrumented function. Sites are
+ * function-local statics that link themselves into a global list on
+ * construction and are never unlinked, so they must stay trivially
+ * destructible to remain readable by the exit-time dump.
+ */
+struct Site
+{
+    static constexpr std::size_t bucket_count = 64;
+
+    explicit Site(const char* name) noexcept;
+
+    /**
+     * @brief Counts one call that took 'ticks'. Bucket i holds durations whose
+     * bit width is i, i.e. [2^(i-1), 2^i).
+     */
+    void record(std::uint64_t ticks) noexcept
+    {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t bucket = ticks ? 64 - __builtin_clzll(ticks) : 0;
+        histogram[bucket < bucket_count ? bucket : bucket_count - 1]
+            .fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const char* name;
+    std::atomic<std::uint64_t> calls{0};
+    std::array<std::atomic<std::uint64_t>, bucket_count> histogram{};
+    Site* next = nullptr;
+};
+
+/**
+ * @brief Pushes a completed call into the calling thread's ring buffer. Does
+ * nothing unless event collection was requested at startup.
+ */
+void emit(const Site& site, std::uint64_t start, std::uint64_t ticks) noexcept;
+
+/**
+ * @brief True if CPP_CONCEPTS_TRACE_FILE was set when the process started.
+ */
+bool events_enabled() noexcept;
+
+/**
+ * @brief RAII timer created by TRACE_SCOPE.
+ */
+class Scope
+{
+public:
+    explicit Scope(Site& site) noexcept : site_(site), start_(now()) {}
+
+    ~Scope()
+    {
+        const std::uint64_t ticks = now() - start_;
+        site_.record(ticks);
+        if (events_enabled())
+            emit(site_, start_, ticks);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Site& site_;
+    std::uint64_t start_;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#define TRACE_SCOPE(name)                                                      \
+    static ::trace::Site TRACE_CONCAT(trace_site_, __LINE__){name};            \
+    const ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)                  \
+    {                                                                          \
+        TRACE_CONCAT(trace_site_, __LINE__)                                    \
+    }
+
+#else
+
+#define TRACE_SCOPE(name) static_cast<void>(0)
+
+#endif // CPP_CONCEPTS_TRACE
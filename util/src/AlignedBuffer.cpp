@@ -0,0 +1,302 @@
+/**
+ * @file AlignedBuffer.cpp
+ * @author Daniel Even
+ * @brief The mappings behind aligned_buffer: huge pages with their fallbacks,
+ * the NUMA policy (set with the mbind system call directly, so there is no
+ * dependency on libnuma), and reading back what the kernel did.
+ */
+#include "AlignedBuffer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#endif
+
+namespace mem {
+
+namespace {
+
+std::size_t page_size()
+{
+    static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+std::size_t round_up(std::size_t bytes, std::size_t multiple)
+{
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+bool wants_huge_pages(std::size_t bytes, const AllocationOptions& options)
+{
+    return options.pages != PageKind::standard && bytes >= huge_page_size;
+}
+
+/**
+ * @brief The online nodes, from a list such as "0-1,4" in
+ * /sys/devices/system/node/online. Just node 0 if it cannot be read.
+ */
+const std::vector<int>& online_nodes()
+{
+    static const std::vector<int> nodes = [] {
+        std::vector<int> result;
+        std::ifstream file("/sys/devices/system/node/online");
+        std::string range;
+        while (std::getline(file, range, ','))
+        {
+            int first = 0;
+            int last = 0;
+            const int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (fields < 1)
+                continue;
+            for (int node = first; node <= (fields == 2 ? last : first); ++node)
+                result.push_back(node);
+        }
+        if (result.empty())
+            result.push_back(0);
+        return result;
+    }();
+    return nodes;
+}
+
+/**
+ * @brief Sets the NUMA policy of a mapping before any of it is touched.
+ * Returns the placement in effect afterwards.
+ */
+NumaPlacement apply_placement(void* data, std::size_t bytes, NumaPlacement placement)
+{
+    // On a single node every placement is the same, so skip the system call.
+    if (placement == NumaPlacement::first_touch || numa_node_count() == 1)
+        return placement;
+#if defined(__linux__) && defined(SYS_mbind)
+    std::vector<unsigned long> mask;
+    const auto set_node = [&mask](int node) {
+        constexpr int bits = 8 * sizeof(unsigned long);
+        mask.resize(std::max(mask.size(), static_cast<std::size_t>(node / bits + 1)), 0);
+        mask[static_cast<std::size_t>(node / bits)] |= 1ul << (node % bits);
+    };
+    int mode = MPOL_PREFERRED;
+    if (placement == NumaPlacement::local)
+    {
+        set_node(current_numa_node());
+    }
+    else
+    {
+        mode = MPOL_INTERLEAVE;
+        for (int node : online_nodes())
+            set_node(node);
+    }
+    // The kernel reads maxnode - 1 bits of the mask.
+    const unsigned long max_node = mask.size() * 8 * sizeof(unsigned long) + 1;
+    if (::syscall(SYS_mbind, data, bytes, mode, mask.data(), max_node, 0) == 0)
+        return placement;
+#else
+    static_cast<void>(data);
+    static_cast<void>(bytes);
+#endif
+    return NumaPlacement::first_touch;
+}
+
+/**
+ * @brief Maps 'length' bytes at a multiple of 'alignment' by mapping more
+ * and unmapping the ends. Returns nullptr on failure.
+ */
+void* map_aligned(std::size_t length, std::size_t alignment)
+{
+    const std::size_t extra = alignment > page_size() ? alignment - page_size() : 0;
+    void* mapping = ::mmap(nullptr, length + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    const auto start = reinterpret_cast<std::uintptr_t>(mapping);
+    const std::uintptr_t aligned = (start + alignment - 1) / alignment * alignment;
+    if (aligned != start)
+        ::munmap(mapping, aligned - start);
+    if (const std::size_t tail = start + length + extra - (aligned + length); tail != 0)
+        ::munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void* map_explicit_huge(std::size_t length)
+{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    // MAP_HUGE_2MB, spelled out since older headers lack it.
+    constexpr int huge_2mb = 21 << MAP_HUGE_SHIFT;
+    void* mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_2mb, -1, 0);
+    return mapping == MAP_FAILED ? nullptr : mapping;
+#else
+    static_cast<void>(length);
+    return nullptr;
+#endif
+}
+
+/**
+ * @brief True unless /sys/kernel/mm/transparent_hugepage/enabled says
+ * "[never]", in which case madvise() still succeeds but does nothing.
+ */
+bool transparent_huge_pages_enabled()
+{
+    static const bool enabled = [] {
+        std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string setting;
+        if (!std::getline(file, setting))
+            return false;
+        return setting.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+}
+
+} // namespace
+
+std::size_t mapped_size(std::size_t bytes, const AllocationOptions& options)
+{
+    if (bytes == 0)
+        return 0;
+    return round_up(bytes, wants_huge_pages(bytes, options) ? huge_page_size : page_size());
+}
+
+PageAllocation allocate_pages(std::size_t bytes, const AllocationOptions& options)
+{
+    if (!std::has_single_bit(options.alignment))
+        throw std::invalid_argument("allocate_pages(): the alignment " + std::to_string(options.alignment) +
+                                    " is not a power of two");
+
+    // No mapping can be this large, and rounding it up to whole pages, plus
+    // the slack map_aligned() maps to align it, would wrap around.
+    if (bytes > SIZE_MAX / 2 || options.alignment > SIZE_MAX / 4)
+        throw std::bad_alloc();
+
+    PageAllocation allocation;
+    allocation.mapped_bytes = mapped_size(bytes, options);
+    if (allocation.mapped_bytes == 0)
+        return allocation;
+
+    const std::size_t alignment = std::max(options.alignment, page_size());
+    if (wants_huge_pages(bytes, options))
+    {
+        // Explicit huge pages are always aligned to their size, so they cannot
+        // honour a larger alignment.
+        if (options.pages == PageKind::explicit_huge && alignment <= huge_page_size)
+        {
+            allocation.data = map_explicit_huge(allocation.mapped_bytes);
+            if (allocation.data)
+                allocation.pages = PageKind::explicit_huge;
+        }
+        if (!allocation.data)
+        {
+            // The kernel only uses huge pages for the 2 MiB aligned parts of
+            // a range.
+            allocation.data = map_aligned(allocation.mapped_bytes, std::max(alignment, huge_page_size));
+            if (allocation.data && transparent_huge_pages_enabled() &&
+                ::madvise(allocation.data, allocation.mapped_bytes, MADV_HUGEPAGE) == 0)
+                allocation.pages = PageKind::transparent_huge;
+        }
+    }
+    if (!allocation.data)
+        allocation.data = map_aligned(allocation.mapped_bytes, alignment);
+    if (!allocation.data)
+        throw std::bad_alloc();
+
+    allocation.placement = apply_placement(allocation.data, allocation.mapped_bytes, options.placement);
+
+    if (options.prefault)
+    {
+        const std::size_t stride = allocation.pages == PageKind::standard ? page_size() : huge_page_size;
+        auto* bytes_data = static_cast<volatile unsigned char*>(allocation.data);
+        for (std::size_t offset = 0; offset < allocation.mapped_bytes; offset += stride)
+            bytes_data[offset] = 0;
+    }
+    return allocation;
+}
+
+void free_pages(void* data, std::size_t mapped_bytes) noexcept
+{
+    if (data)
+        ::munmap(data, mapped_bytes);
+}
+
+std::size_t transparent_huge_bytes(const void* data, std::size_t bytes)
+{
+    // Each mapping in smaps starts with a line "start-end perms ...",
+    // followed by "Key: value kB" lines, one of which is AnonHugePages.
+    std::ifstream smaps("/proc/self/smaps");
+    const auto begin = reinterpret_cast<std::uintptr_t>(data);
+    const std::uintptr_t end = begin + bytes;
+    bool inside = false;
+    std::size_t total = 0;
+    std::string line;
+    while (std::getline(smaps, line))
+    {
+        std::uintptr_t start = 0;
+        std::uintptr_t stop = 0;
+        char dash = 0;
+        std::istringstream fields(line);
+        if (fields >> std::hex >> start >> dash >> stop && dash == '-')
+        {
+            inside = start < end && begin < stop;
+            continue;
+        }
+        std::size_t kilobytes = 0;
+        if (inside && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kilobytes) == 1)
+            total += kilobytes * 1024;
+    }
+    return total;
+}
+
+int numa_node_count()
+{
+    return static_cast<int>(online_nodes().size());
+}
+
+int current_numa_node()
+{
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (::getcpu(&cpu, &node) != 0)
+        return 0;
+    return static_cast<int>(node);
+}
+
+const char* to_string(PageKind pages)
+{
+    switch (pages)
+    {
+    case PageKind::transparent_huge:
+        return "transparent huge pages";
+    case PageKind::explicit_huge:
+        return "explicit huge pages";
+    default:
+        return "standard pages";
+    }
+}
+
+const char* to_string(NumaPlacement placement)
+{
+    switch (placement)
+    {
+    case NumaPlacement::local:
+        return "local node";
+    case NumaPlacement::interleave:
+        return "interleaved";
+    default:
+        return "first touch";
+    }
+}
+
+} // namespace mem
@@ -0,0 +1,327 @@
+/**
+ * @file ColumnFile.cpp
+ * @author Daniel Even
+ * @brief The column file checksum, writer and reader.
+ */
+#include "ColumnFile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+
+static_assert(std::endian::native == std::endian::little, "Column files are little endian");
+
+namespace {
+
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9;
+
+// Data is written in blocks of this size when there are no checksums.
+constexpr std::size_t unchecksummed_block = std::size_t{1} << 20;
+
+std::uint64_t load64(const std::byte* bytes)
+{
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+std::uint64_t round_up(std::uint64_t value, std::uint64_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+std::size_t element_size(ColumnType type)
+{
+    switch (type)
+    {
+    case ColumnType::int32:
+    case ColumnType::float32: return 4;
+    case ColumnType::int64:
+    case ColumnType::float64: return 8;
+    }
+    return 0;
+}
+
+std::uint64_t header_checksum(ColumnHeader header)
+{
+    header.header_checksum = 0;
+    return column_checksum(std::as_bytes(std::span(&header, 1)));
+}
+
+void write_all(int fd, const void* data, std::size_t size, std::uint64_t offset)
+{
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "ColumnWriter: write failed");
+        }
+        bytes += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+}
+
+} // namespace
+
+std::uint64_t column_checksum(std::span<const std::byte> bytes)
+{
+    // Four independent lanes, so that the multiplies overlap.
+    std::array<std::uint64_t, 4> lanes{prime1 + prime2, prime2, 0, 0 - prime1};
+    std::size_t i = 0;
+    for (; i + 32 <= bytes.size(); i += 32)
+    {
+        for (std::size_t lane = 0; lane < 4; ++lane)
+            lanes[lane] = std::rotl(lanes[lane] + load64(bytes.data() + i + 8 * lane) * prime2, 31) * prime1;
+    }
+
+    std::uint64_t hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) +
+                         std::rotl(lanes[3], 18) + bytes.size();
+    for (; i + 8 <= bytes.size(); i += 8)
+        hash = std::rotl(hash ^ (std::rotl(load64(bytes.data() + i) * prime2, 31) * prime1), 27) * prime1 + prime3;
+    for (; i < bytes.size(); ++i)
+        hash = std::rotl(hash ^ (static_cast<std::uint64_t>(bytes[i]) * prime3), 11) * prime1;
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ColumnWriter::ColumnWriter(const std::string& path, ColumnType type, std::size_t checksum_block)
+    : type_(type), checksum_block_(checksum_block),
+      block_size_(checksum_block ? checksum_block : unchecksummed_block)
+{
+    if (checksum_block % column_alignment != 0)
+        throw std::invalid_argument("ColumnWriter: the checksum block must be a multiple of 64 bytes");
+    if (element_size(type) == 0)
+        throw std::invalid_argument("ColumnWriter: unknown column type");
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw std::system_error(errno, std::generic_category(), "ColumnWriter: cannot create " + path);
+    block_ = std::make_unique<std::byte[]>(block_size_);
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    if (fd_ < 0)
+        return;
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void ColumnWriter::append_bytes(std::span<const std::byte> bytes)
+{
+    while (!bytes.empty())
+    {
+        const std::size_t n = std::min(bytes.size(), block_size_ - block_used_);
+        std::memcpy(block_.get() + block_used_, bytes.data(), n);
+        block_used_ += n;
+        bytes = bytes.subspan(n);
+        if (block_used_ == block_size_)
+            flush_block();
+    }
+}
+
+void ColumnWriter::flush_block()
+{
+    if (block_used_ == 0)
+        return;
+
+    if (checksum_block_ != 0)
+    {
+        if (checksum_count_ == checksum_capacity_)
+        {
+            checksum_capacity_ = std::max<std::size_t>(64, checksum_capacity_ * 2);
+            auto bigger = std::make_unique<std::uint64_t[]>(checksum_capacity_);
+            std::copy_n(checksums_.get(), checksum_count_, bigger.get());
+            checksums_ = std::move(bigger);
+        }
+        checksums_[checksum_count_++] = column_checksum(std::span<const std::byte>(block_.get(), block_used_));
+    }
+
+    write_all(fd_, block_.get(), block_used_, sizeof(ColumnHeader) + data_bytes_);
+    data_bytes_ += block_used_;
+    block_used_ = 0;
+}
+
+void ColumnWriter::close()
+{
+    if (fd_ < 0)
+        return;
+
+    try
+    {
+        flush_block();
+
+        ColumnHeader header{};
+        header.magic = ColumnHeader::expected_magic;
+        header.version = ColumnHeader::current_version;
+        header.type = type_;
+        header.element_size = static_cast<std::uint8_t>(element_size(type_));
+        header.alignment = column_alignment;
+        header.count = count_;
+        header.data_offset = sizeof(ColumnHeader);
+        header.checksum_block = checksum_block_;
+        header.checksum_offset =
+            checksum_block_ ? round_up(header.data_offset + data_bytes_, sizeof(std::uint64_t)) : 0;
+
+        if (checksum_count_ != 0)
+            write_all(fd_, checksums_.get(), checksum_count_ * sizeof(std::uint64_t), header.checksum_offset);
+        header.header_checksum = header_checksum(header);
+        write_all(fd_, &header, sizeof(header), 0);
+    }
+    catch (...)
+    {
+        ::close(std::exchange(fd_, -1));
+        throw;
+    }
+
+    if (::close(std::exchange(fd_, -1)) != 0)
+        throw std::system_error(errno, std::generic_category(), "ColumnWriter: close failed");
+}
+
+bool is_column_file(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    std::array<char, 8> magic{};
+    const bool matches = ::pread(fd, magic.data(), magic.size(), 0) == static_cast<ssize_t>(magic.size()) &&
+                         magic == ColumnHeader::expected_magic;
+    ::close(fd);
+    return matches;
+}
+
+ColumnFile::ColumnFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "ColumnFile: cannot open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < sizeof(ColumnHeader))
+    {
+        ::close(fd);
+        throw std::invalid_argument("ColumnFile: " + path + " is too short to be a column file");
+    }
+
+    map_size_ = static_cast<std::size_t>(info.st_size);
+    void* map = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (map == MAP_FAILED)
+        throw std::system_error(error, std::generic_category(), "ColumnFile: cannot map " + path);
+    map_ = static_cast<const std::byte*>(map);
+
+    auto fail = [&](const char* reason) {
+        release();
+        throw std::invalid_argument("ColumnFile: " + path + ": " + reason);
+    };
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    if (header_.magic != ColumnHeader::expected_magic)
+        fail("not a column file, or its writer did not finish");
+    if (header_.version != ColumnHeader::current_version)
+        fail("unsupported version");
+    if (header_.header_checksum != header_checksum(header_))
+        fail("the header is damaged");
+
+    const std::uint64_t size = element_size(header_.type);
+    if (size == 0 || header_.element_size != size)
+        fail("unknown element type");
+    if (header_.alignment < column_alignment || !std::has_single_bit(header_.alignment) ||
+        header_.data_offset % header_.alignment != 0 || header_.data_offset < sizeof(ColumnHeader))
+        fail("the data is not aligned");
+    if (header_.data_offset > map_size_ || header_.count > (map_size_ - header_.data_offset) / size)
+        fail("the file is truncated");
+
+    if (header_.checksum_block != 0)
+    {
+        const std::uint64_t data_bytes = header_.count * size;
+        const std::uint64_t blocks = (data_bytes + header_.checksum_block - 1) / header_.checksum_block;
+        if (header_.checksum_block % column_alignment != 0 ||
+            header_.checksum_offset < header_.data_offset + data_bytes ||
+            header_.checksum_offset % sizeof(std::uint64_t) != 0 || header_.checksum_offset > map_size_ ||
+            blocks > (map_size_ - header_.checksum_offset) / sizeof(std::uint64_t))
+            fail("the checksums are truncated");
+    }
+
+    data_ = map_ + header_.data_offset;
+    ::madvise(const_cast<std::byte*>(map_), map_size_, MADV_SEQUENTIAL);
+}
+
+ColumnFile::ColumnFile(ColumnFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+ColumnFile& ColumnFile::operator=(ColumnFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        data_ = std::exchange(other.data_, nullptr);
+        header_ = std::exchange(other.header_, ColumnHeader{});
+    }
+    return *this;
+}
+
+ColumnFile::~ColumnFile()
+{
+    release();
+}
+
+void ColumnFile::release() noexcept
+{
+    if (map_ != nullptr)
+        ::munmap(const_cast<std::byte*>(map_), map_size_);
+    map_ = nullptr;
+    data_ = nullptr;
+    map_size_ = 0;
+}
+
+void ColumnFile::verify() const
+{
+    if (header_.checksum_block == 0)
+        return;
+
+    const std::uint64_t data_bytes = header_.count * header_.element_size;
+    const std::byte* checksums = map_ + header_.checksum_offset;
+    for (std::uint64_t offset = 0, block = 0; offset < data_bytes; offset += header_.checksum_block, ++block)
+    {
+        const std::size_t length = static_cast<std::size_t>(std::min(header_.checksum_block, data_bytes - offset));
+        if (column_checksum(std::span(data_ + offset, length)) != load64(checksums + block * sizeof(std::uint64_t)))
+            throw std::invalid_argument("ColumnFile: block " + std::to_string(block) + " (bytes " +
+                                        std::to_string(header_.data_offset + offset) + " to " +
+                                        std::to_string(header_.data_offset + offset + length) +
+                                        ") does not match its checksum");
+    }
+}
+
+} // namespace io
@@ -0,0 +1,53 @@
+/**
+ * @file CpuDispatch.cpp
+ * @author Daniel Even
+ * @brief CPUID queries through the compiler's __builtin_cpu_supports, which
+ * caches CPUID itself.
+ */
+#include "CpuDispatch.hpp"
+
+namespace cpu {
+
+bool supported(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::scalar:
+        return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::sse2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::avx2:
+        return __builtin_cpu_supports("avx2");
+    case Isa::avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+Isa best_supported(std::initializer_list<Isa> candidates)
+{
+    for (Isa isa : candidates)
+        if (supported(isa))
+            return isa;
+    return Isa::scalar;
+}
+
+const char* to_string(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::sse2:
+        return "sse2";
+    case Isa::avx2:
+        return "avx2";
+    case Isa::avx512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+} // namespace cpu
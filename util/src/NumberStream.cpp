@@ -0,0 +1,302 @@
+/**
+ * @file NumberStream.cpp
+ * @author Daniel Even
+ * @brief The mmap/read() plumbing behind NumberReader, and the parse and
+ * format loops, instantiated for the element types the kernels take.
+ */
+#include "NumberStream.hpp"
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+
+namespace {
+
+// The size of a read() block.
+constexpr std::size_t block_size = std::size_t{1} << 20;
+
+// A number that is cut off by the end of a block is only carried over to the
+// next one if it starts within this many bytes of the end, so no single number
+// may be longer. A longer one that reaches the end of a block is an error.
+constexpr std::ptrdiff_t max_number_length = 256;
+
+// Room for any int64_t, or any float or double in shortest form, plus '\n'.
+constexpr std::size_t max_formatted_length = 32;
+
+constexpr std::array<bool, 256> separators = [] {
+    std::array<bool, 256> table{};
+    for (unsigned char c : {' ', '\t', '\n', '\r', '\v', '\f', ','})
+        table[c] = true;
+    return table;
+}();
+
+bool is_separator(char c)
+{
+    return separators[static_cast<unsigned char>(c)];
+}
+
+/**
+ * @brief The fast path for the common case of an integer with 1 to 7 digits:
+ * all digits are found and converted with a handful of 64-bit operations
+ * instead of one loop iteration each. Needs 8 readable bytes after the sign.
+ * Returns nullptr if the fast path does not apply, in which case from_chars
+ * decides.
+ */
+template <typename T>
+const char* parse_short_integer(const char* first, T& value)
+{
+    const bool negative = *first == '-';
+    const char* digits = first + negative;
+
+    std::uint64_t chunk;
+    std::memcpy(&chunk, digits, sizeof(chunk));
+
+    // Digits become 0..9; a byte is not a digit if that leaves it >= 10.
+    constexpr std::uint64_t ones = 0x0101010101010101;
+    const std::uint64_t offset = chunk ^ (ones * '0');
+    const std::uint64_t not_digit = (((offset & (ones * 0x7F)) + ones * 0x76) | offset) & (ones * 0x80);
+    if (not_digit == 0)
+        return nullptr;
+    const int length = std::countr_zero(not_digit) / 8;
+    if (length == 0 || !is_separator(digits[length]))
+        return nullptr;
+
+    // Move the digits to the top so the leading bytes are zeros, then combine
+    // pairs, quads and octets of digits (little endian only).
+    std::uint64_t v = offset << (8 * (8 - length));
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+
+    const auto magnitude = static_cast<T>(v);
+    value = negative ? static_cast<T>(-magnitude) : magnitude;
+    return digits + length;
+}
+
+} // namespace
+
+NumberReader::NumberReader(const std::string& path)
+{
+    if (path == "-")
+        fd_ = STDIN_FILENO;
+    else
+    {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0)
+            throw std::system_error(errno, std::generic_category(), "NumberReader: cannot open " + path);
+        owns_fd_ = true;
+    }
+
+    struct stat info;
+    if (::fstat(fd_, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        const auto size = static_cast<std::size_t>(info.st_size);
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (map != MAP_FAILED)
+        {
+            ::madvise(map, size, MADV_SEQUENTIAL);
+            map_ = map;
+            map_size_ = size;
+            begin_ = cursor_ = static_cast<const char*>(map);
+            end_ = begin_ + size;
+            eof_ = true;
+            return;
+        }
+    }
+
+    // Not mappable (or mmap failed): fall back to reading blocks.
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buffer_ = std::make_unique<char[]>(block_size);
+    begin_ = cursor_ = end_ = buffer_.get();
+    eof_ = false;
+}
+
+NumberReader NumberReader::from_memory(std::string_view text)
+{
+    NumberReader reader;
+    reader.begin_ = reader.cursor_ = text.data();
+    reader.end_ = text.data() + text.size();
+    return reader;
+}
+
+NumberReader::NumberReader(NumberReader&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+NumberReader& NumberReader::operator=(NumberReader&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        begin_ = std::exchange(other.begin_, nullptr);
+        cursor_ = std::exchange(other.cursor_, nullptr);
+        end_ = std::exchange(other.end_, nullptr);
+        consumed_ = std::exchange(other.consumed_, 0);
+        fd_ = std::exchange(other.fd_, -1);
+        owns_fd_ = std::exchange(other.owns_fd_, false);
+        eof_ = std::exchange(other.eof_, true);
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+NumberReader::~NumberReader()
+{
+    release();
+}
+
+void NumberReader::release() noexcept
+{
+    if (map_ != nullptr)
+        ::munmap(map_, map_size_);
+    if (owns_fd_)
+        ::close(fd_);
+    map_ = nullptr;
+    owns_fd_ = false;
+    fd_ = -1;
+}
+
+bool NumberReader::refill()
+{
+    if (eof_)
+        return false;
+
+    const auto tail = static_cast<std::size_t>(end_ - cursor_);
+    consumed_ += static_cast<std::uint64_t>(cursor_ - begin_);
+    std::memmove(buffer_.get(), cursor_, tail);
+
+    char* fill = buffer_.get() + tail;
+    char* const limit = buffer_.get() + block_size;
+    while (fill < limit)
+    {
+        const ssize_t n = ::read(fd_, fill, static_cast<std::size_t>(limit - fill));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "NumberReader: read failed");
+        }
+        if (n == 0)
+        {
+            eof_ = true;
+            break;
+        }
+        fill += n;
+    }
+
+    begin_ = cursor_ = buffer_.get();
+    end_ = fill;
+    return static_cast<std::size_t>(fill - buffer_.get()) > tail;
+}
+
+bool NumberReader::skip_separators()
+{
+    for (;;)
+    {
+        while (cursor_ != end_ && is_separator(*cursor_))
+            ++cursor_;
+        if (eof_ || end_ - cursor_ >= max_number_length)
+            return cursor_ != end_;
+        if (!refill())
+            return cursor_ != end_;
+    }
+}
+
+template <typename T>
+std::size_t NumberReader::read(std::span<T> out)
+{
+    std::size_t count = 0;
+    while (count < out.size() && skip_separators())
+    {
+        // from_chars does not accept a leading '+'.
+        const char* first = cursor_;
+        if (*first == '+' && first + 1 != end_ && first[1] != '-')
+            ++first;
+
+        T value;
+        if constexpr (std::is_integral_v<T> && std::endian::native == std::endian::little)
+        {
+            if (end_ - first > 8)
+            {
+                if (const char* last = parse_short_integer(first, value))
+                {
+                    out[count++] = value;
+                    cursor_ = last;
+                    continue;
+                }
+            }
+        }
+
+        const auto [last, error] = std::from_chars(first, end_, value);
+        if (error == std::errc::invalid_argument || (last != end_ && !is_separator(*last)))
+            throw std::invalid_argument("NumberReader: not a number at byte " + std::to_string(bytes_read()));
+        // skip_separators() left at least max_number_length bytes, so this
+        // number may go on in the next block.
+        if (last == end_ && !eof_)
+            throw std::invalid_argument("NumberReader: number longer than " + std::to_string(max_number_length) +
+                                        " bytes at byte " + std::to_string(bytes_read()));
+        if (error == std::errc::result_out_of_range)
+            throw std::range_error("NumberReader: number out of range at byte " + std::to_string(bytes_read()));
+
+        out[count++] = value;
+        cursor_ = last;
+    }
+    return count;
+}
+
+template <typename T>
+void format_numbers(std::span<const T> values, std::string& text)
+{
+    text.resize(values.size() * max_formatted_length);
+
+    char* cursor = text.data();
+    char* const end = text.data() + text.size();
+    for (const T& value : values)
+    {
+        cursor = std::to_chars(cursor, end, value).ptr;
+        *cursor++ = '\n';
+    }
+    text.resize(static_cast<std::size_t>(cursor - text.data()));
+}
+
+template <typename T>
+void write_numbers(std::FILE* out, std::span<const T> values)
+{
+    thread_local std::string text;
+    format_numbers(values, text);
+    std::fwrite(text.data(), 1, text.size(), out);
+}
+
+template std::size_t NumberReader::read(std::span<std::int32_t>);
+template std::size_t NumberReader::read(std::span<std::int64_t>);
+template std::size_t NumberReader::read(std::span<float>);
+template std::size_t NumberReader::read(std::span<double>);
+
+template void write_numbers(std::FILE*, std::span<const std::int32_t>);
+template void write_numbers(std::FILE*, std::span<const std::int64_t>);
+template void write_numbers(std::FILE*, std::span<const float>);
+template void write_numbers(std::FILE*, std::span<const double>);
+
+template void format_numbers(std::span<const std::int32_t>, std::string&);
+template void format_numbers(std::span<const std::int64_t>, std::string&);
+template void format_numbers(std::span<const float>, std::string&);
+template void format_numbers(std::span<const double>, std::string&);
+
+} // namespace io
@@ -0,0 +1,407 @@
+/**
+ * @file OutputSink.cpp
+ * @author Daniel Even
+ * @brief The per-thread block chains behind OutputSink, the writev() loop, and
+ * the background writer thread.
+ */
+#include "OutputSink.hpp"
+#include "MpscQueue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace io {
+
+namespace detail {
+
+struct OutputBlock : parallel::MpscNode
+{
+    explicit OutputBlock(std::size_t capacity) : data(new char[capacity]) {}
+
+    std::unique_ptr<char[]> data;
+    std::size_t size = 0;
+    // The next block of the same batch.
+    OutputBlock* chain = nullptr;
+    // Set once the batch this block starts has been written, if someone is
+    // waiting for it in flush().
+    std::atomic<bool>* done = nullptr;
+};
+
+struct ThreadBuffer
+{
+    // The blocks not written yet. 'last' is the one being appended to.
+    OutputBlock* first = nullptr;
+    OutputBlock* last = nullptr;
+    std::size_t pending = 0;
+    std::chrono::steady_clock::time_point oldest;
+    // Only written by the owning thread; atomic so stats() can read it.
+    std::atomic<std::uint64_t> lines{0};
+};
+
+} // namespace detail
+
+namespace {
+
+#ifdef IOV_MAX
+constexpr std::size_t max_iovecs = IOV_MAX;
+#else
+constexpr std::size_t max_iovecs = 1024;
+#endif
+
+// Distinguishes sinks in the thread_local cache, even when one is created at
+// the address of another that was destroyed.
+std::atomic<std::uint64_t> next_sink_id{1};
+
+OutputOptions options_from_environment()
+{
+    OutputOptions options;
+    options.policy = FlushPolicy::line;
+    if (const char* value = std::getenv("CPP_CONCEPTS_OUTPUT"))
+    {
+        const std::string_view mode(value);
+        if (mode == "size")
+            options.policy = FlushPolicy::size;
+        else if (mode == "time")
+            options.policy = FlushPolicy::time;
+        else if (mode == "explicit")
+            options.policy = FlushPolicy::explicit_only;
+        else if (mode == "background")
+        {
+            options.policy = FlushPolicy::size;
+            options.background = true;
+        }
+    }
+    return options;
+}
+
+struct CachedBuffer
+{
+    std::uint64_t sink = 0;
+    detail::ThreadBuffer* buffer = nullptr;
+};
+
+thread_local CachedBuffer cached_buffer;
+
+} // namespace
+
+OutputSink::OutputSink(int fd, const OutputOptions& options)
+    : fd_(fd), options_(options), id_(next_sink_id.fetch_add(1, std::memory_order_relaxed))
+{
+    if (options_.block_size == 0)
+        throw std::invalid_argument("OutputSink: block_size must not be 0");
+    if (options_.background)
+        writer_ = std::thread([this] { writer_loop(); });
+}
+
+OutputSink::~OutputSink()
+{
+    try
+    {
+        flush_all();
+    }
+    catch (...)
+    {
+    }
+    if (writer_.joinable())
+    {
+        stopping_.store(true, std::memory_order_release);
+        submitted_.fetch_add(1, std::memory_order_release);
+        submitted_.notify_one();
+        writer_.join();
+    }
+}
+
+detail::ThreadBuffer& OutputSink::local()
+{
+    if (cached_buffer.sink == id_)
+        return *cached_buffer.buffer;
+
+    std::lock_guard lock(buffers_mutex_);
+    const std::thread::id self = std::this_thread::get_id();
+    auto found = std::find_if(buffers_.begin(), buffers_.end(), [&](const auto& entry) { return entry.first == self; });
+    if (found == buffers_.end())
+    {
+        buffers_.emplace_back(self, std::make_unique<detail::ThreadBuffer>());
+        found = buffers_.end() - 1;
+    }
+    cached_buffer = {id_, found->second.get()};
+    return *found->second;
+}
+
+OutputSink::Block* OutputSink::new_block()
+{
+    std::lock_guard lock(pool_mutex_);
+    if (!free_.empty())
+    {
+        Block* block = free_.back();
+        free_.pop_back();
+        return block;
+    }
+    blocks_.push_back(std::make_unique<Block>(options_.block_size));
+    return blocks_.back().get();
+}
+
+void OutputSink::recycle(Block* chain)
+{
+    std::lock_guard lock(pool_mutex_);
+    while (chain != nullptr)
+    {
+        Block* next = chain->chain;
+        chain->size = 0;
+        chain->chain = nullptr;
+        chain->done = nullptr;
+        free_.push_back(chain);
+        chain = next;
+    }
+}
+
+void OutputSink::write(std::string_view text)
+{
+    detail::ThreadBuffer& buffer = local();
+    if (buffer.pending == 0 && options_.policy == FlushPolicy::time)
+        buffer.oldest = std::chrono::steady_clock::now();
+
+    while (!text.empty())
+    {
+        if (buffer.last == nullptr || buffer.last->size == options_.block_size)
+        {
+            Block* block = new_block();
+            if (buffer.last != nullptr)
+                buffer.last->chain = block;
+            else
+                buffer.first = block;
+            buffer.last = block;
+        }
+        const std::size_t n = std::min(text.size(), options_.block_size - buffer.last->size);
+        std::memcpy(buffer.last->data.get() + buffer.last->size, text.data(), n);
+        buffer.last->size += n;
+        buffer.pending += n;
+        text.remove_prefix(n);
+    }
+}
+
+void OutputSink::end_line()
+{
+    write("\n");
+    detail::ThreadBuffer& buffer = local();
+    buffer.lines.store(buffer.lines.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    switch (options_.policy)
+    {
+    case FlushPolicy::line:
+        flush(buffer, true);
+        break;
+    case FlushPolicy::size:
+        if (buffer.pending >= options_.flush_bytes)
+            flush(buffer, false);
+        break;
+    case FlushPolicy::time:
+        if (buffer.pending >= options_.flush_bytes ||
+            std::chrono::steady_clock::now() - buffer.oldest >= options_.flush_interval)
+            flush(buffer, false);
+        break;
+    case FlushPolicy::explicit_only:
+        break;
+    }
+}
+
+void OutputSink::flush()
+{
+    flush(local(), true);
+}
+
+void OutputSink::flush_all()
+{
+    std::lock_guard lock(buffers_mutex_);
+    for (auto& entry : buffers_)
+        flush(*entry.second, true);
+}
+
+void OutputSink::flush(detail::ThreadBuffer& buffer, bool wait)
+{
+    if (buffer.pending == 0)
+        return;
+
+    Block* chain = buffer.first;
+
+    if (!options_.background)
+    {
+        {
+            std::lock_guard lock(write_mutex_);
+            write_chains(&chain, 1);
+        }
+        // Only now that the text is written: if writing throws, the chain and
+        // 'pending' still describe it, and the next flush tries again.
+        buffer.pending = 0;
+        // Keep the first block for the next line.
+        recycle(chain->chain);
+        chain->size = 0;
+        chain->chain = nullptr;
+        buffer.last = chain;
+        return;
+    }
+
+    buffer.pending = 0;
+    buffer.first = buffer.last = nullptr;
+    std::atomic<bool> done{false};
+    if (wait)
+        chain->done = &done;
+    queue_.push(chain);
+    submitted_.fetch_add(1, std::memory_order_release);
+    submitted_.notify_one();
+
+    if (wait)
+    {
+        // The writer bumps 'written_' after setting 'done', and never
+        // touches 'done' again, so it may go out of scope once it is set.
+        while (!done.load(std::memory_order_acquire))
+        {
+            const std::uint64_t seen = written_.load(std::memory_order_acquire);
+            if (done.load(std::memory_order_acquire))
+                break;
+            written_.wait(seen, std::memory_order_acquire);
+        }
+        if (const int code = error_.load(std::memory_order_relaxed))
+            throw std::system_error(code, std::generic_category(), "OutputSink: write failed");
+    }
+}
+
+void OutputSink::write_chains(Block* const* chains, std::size_t count)
+{
+    std::vector<iovec> iovecs;
+    for (std::size_t i = 0; i < count; ++i)
+        for (Block* block = chains[i]; block != nullptr; block = block->chain)
+            if (block->size != 0)
+                iovecs.push_back({block->data.get(), block->size});
+
+    std::size_t next = 0;
+    while (next < iovecs.size())
+    {
+        const auto batch = static_cast<int>(std::min(iovecs.size() - next, max_iovecs));
+        const ssize_t n = ::writev(fd_, iovecs.data() + next, batch);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "OutputSink: write failed");
+        }
+        bytes_.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+
+        // Skip what was written; a partial write leaves part of one iovec.
+        auto left = static_cast<std::size_t>(n);
+        while (next < iovecs.size() && left >= iovecs[next].iov_len)
+            left -= iovecs[next++].iov_len;
+        if (left != 0)
+        {
+            iovecs[next].iov_base = static_cast<char*>(iovecs[next].iov_base) + left;
+            iovecs[next].iov_len -= left;
+        }
+    }
+}
+
+void OutputSink::writer_loop()
+{
+    std::vector<Block*> chains;
+    for (;;)
+    {
+        const std::uint64_t seen = submitted_.load(std::memory_order_acquire);
+        const bool stop = stopping_.load(std::memory_order_acquire);
+
+        while (Block* chain = queue_.pop())
+            chains.push_back(chain);
+        if (chains.empty())
+        {
+            if (stop)
+                return;
+            submitted_.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+
+        // Everything queued by every thread goes out in one writev().
+        try
+        {
+            write_chains(chains.data(), chains.size());
+        }
+        catch (const std::system_error& failure)
+        {
+            error_.store(failure.code().value(), std::memory_order_relaxed);
+        }
+
+        for (Block* chain : chains)
+        {
+            std::atomic<bool>* done = chain->done;
+            recycle(chain);
+            if (done != nullptr)
+                done->store(true, std::memory_order_release);
+        }
+        chains.clear();
+        written_.fetch_add(1, std::memory_order_release);
+        written_.notify_all();
+    }
+}
+
+const OutputOptions& OutputSink::options() const
+{
+    return options_;
+}
+
+OutputStats OutputSink::stats() const
+{
+    OutputStats stats;
+    {
+        std::lock_guard lock(buffers_mutex_);
+        for (const auto& entry : buffers_)
+            stats.lines += entry.second->lines.load(std::memory_order_relaxed);
+    }
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.syscalls = syscalls_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+OutputSink& out()
+{
+    struct Global
+    {
+        OutputSink sink{stdout_fd, options_from_environment()};
+        bool report = std::getenv("CPP_CONCEPTS_OUTPUT_STATS") != nullptr;
+
+        ~Global()
+        {
+            if (!report)
+                return;
+            try
+            {
+                sink.flush_all();
+            }
+            catch (...)
+            {
+            }
+            const OutputStats stats = sink.stats();
+            std::fprintf(stderr, "output: %llu lines, %llu bytes, %llu write calls (%.3f per line)\n",
+                         static_cast<unsigned long long>(stats.lines), static_cast<unsigned long long>(stats.bytes),
+                         static_cast<unsigned long long>(stats.syscalls),
+                         stats.lines ? static_cast<double>(stats.syscalls) / static_cast<double>(stats.lines) : 0.0);
+        }
+    };
+    static Global global;
+    return global.sink;
+}
+
+} // namespace io
@@ -0,0 +1,142 @@
+/**
+ * @file Pipeline.cpp
+ * @author Daniel Even
+ * @brief Starting, pinning and joining the stage threads, and the metrics
+ * report.
+ */
+#include "Pipeline.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace parallel {
+
+namespace {
+
+/**
+ * @brief The CPUs this process may run on, in order, or none if that cannot
+ * be found out.
+ */
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+/**
+ * @brief Pins the calling thread to 'cpu'. Returns false if it could not.
+ */
+bool pin_current_thread(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+double seconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+void Pipeline::run_stage(std::size_t index)
+{
+    StageMetrics& metrics = metrics_[index];
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        stages_[index](metrics);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard lock(error_mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+        for (const auto& channel : channels_)
+            channel->cancel();
+    }
+    const std::chrono::nanoseconds total = std::chrono::steady_clock::now() - start;
+    metrics.busy = std::max(std::chrono::nanoseconds{0}, total - metrics.starved - metrics.blocked);
+}
+
+void Pipeline::run()
+{
+    if (!complete_)
+        throw std::invalid_argument("Pipeline: the last stage must be a sink");
+    if (ran_)
+        throw std::invalid_argument("Pipeline: run() can only be called once");
+    ran_ = true;
+
+    const std::vector<int> cpus = options_.pin ? allowed_cpus() : std::vector<int>();
+    std::vector<std::thread> threads;
+    threads.reserve(stages_.size());
+    for (std::size_t i = 0; i < stages_.size(); ++i)
+    {
+        threads.emplace_back([this, i, &cpus] {
+            if (!cpus.empty() && pin_current_thread(cpus[i % cpus.size()]))
+                metrics_[i].cpu = cpus[i % cpus.size()];
+            run_stage(i);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (std::getenv("CPP_CONCEPTS_PIPELINE_STATS") != nullptr)
+        std::fputs(report().c_str(), stderr);
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+std::string Pipeline::report() const
+{
+    std::size_t bottleneck = 0;
+    for (std::size_t i = 1; i < metrics_.size(); ++i)
+        if (metrics_[i].busy > metrics_[bottleneck].busy)
+            bottleneck = i;
+
+    std::string text = "stage            cpu    batches        items   busy s  items/s busy  starved  blocked  queue "
+                       "mean/max/cap\n";
+    char line[256];
+    for (std::size_t i = 0; i < metrics_.size(); ++i)
+    {
+        const StageMetrics& stage = metrics_[i];
+        const double total = seconds(stage.busy + stage.starved + stage.blocked);
+        const auto share = [total](std::chrono::nanoseconds part) {
+            return total > 0.0 ? 100.0 * seconds(part) / total : 0.0;
+        };
+        std::snprintf(line, sizeof(line), "%-16.16s %3d %10llu %12llu %8.3f %13.4g %7.1f%% %7.1f%%  %.2f/%zu/%zu%s\n",
+                      stage.name.c_str(), stage.cpu, static_cast<unsigned long long>(stage.batches),
+                      static_cast<unsigned long long>(stage.items), seconds(stage.busy), stage.items_per_second(),
+                      share(stage.starved), share(stage.blocked), stage.mean_queue_depth, stage.max_queue_depth,
+                      stage.queue_capacity, i == bottleneck ? "  <- bottleneck" : "");
+        text += line;
+    }
+    return text;
+}
+
+} // namespace parallel
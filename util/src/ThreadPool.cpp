@@ -0,0 +1,273 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Daniel Even
+ * @brief The Chase-Lev deque operations and the worker threads' scheduling
+ * loop.
+ */
+#include "ThreadPool.hpp"
+
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace parallel {
+
+namespace {
+
+/**
+ * @brief Tells the CPU this is a spin-wait loop, so a hyperthread sibling gets
+ * the core's resources while we wait.
+ */
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+std::size_t default_thread_count()
+{
+    if (const char* value = std::getenv("CPP_CONCEPTS_THREADS"))
+    {
+        const long threads = std::strtol(value, nullptr, 10);
+        if (threads > 0)
+            return static_cast<std::size_t>(threads);
+    }
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 1;
+}
+
+// Failed steal rounds before an idle worker goes to sleep.
+constexpr int spins_before_sleep = 64;
+
+} // namespace
+
+WorkStealingDeque::WorkStealingDeque(std::size_t capacity)
+{
+    std::size_t rounded = 1;
+    while (rounded < capacity)
+        rounded *= 2;
+    buffers_.push_back(std::make_unique<Buffer>(static_cast<std::int64_t>(rounded)));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::Buffer* WorkStealingDeque::grow(Buffer* buffer, std::int64_t bottom, std::int64_t top)
+{
+    auto bigger = std::make_unique<Buffer>(buffer->capacity * 2);
+    for (std::int64_t i = top; i < bottom; ++i)
+        bigger->put(i, buffer->get(i));
+    Buffer* result = bigger.get();
+    buffers_.push_back(std::move(bigger));
+    buffer_.store(result, std::memory_order_release);
+    return result;
+}
+
+void WorkStealingDeque::push(Task* task)
+{
+    const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t t = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > buffer->capacity - 1)
+        buffer = grow(buffer, b, t);
+    buffer->put(b, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+Task* WorkStealingDeque::pop()
+{
+    const std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // Empty.
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Task* task = buffer->get(b);
+    if (t == b)
+    {
+        // The last task: race any thief for it.
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = nullptr;
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+Task* WorkStealingDeque::steal()
+{
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    Task* task = buffer->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return task;
+}
+
+thread_local ThreadPool::Worker* ThreadPool::current_ = nullptr;
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    if (threads == 0)
+        threads = default_thread_count();
+
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+        workers_.push_back(std::make_unique<Worker>(*this, i));
+
+    // Worker 0 is whichever outside thread is calling in.
+    threads_.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i)
+        threads_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    stopping_.store(true, std::memory_order_seq_cst);
+    wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    wake_epoch_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::Worker* ThreadPool::current_worker() const
+{
+    return current_ != nullptr && &current_->pool == this ? current_ : nullptr;
+}
+
+ThreadPool::Worker* ThreadPool::enter_as_worker_zero()
+{
+    Worker* previous = current_;
+    current_ = workers_.front().get();
+    return previous;
+}
+
+void ThreadPool::leave_worker(Worker* previous)
+{
+    current_ = previous;
+}
+
+void ThreadPool::push(Worker& worker, Task* task)
+{
+    worker.deque.push(task);
+
+    // Pairs with the fence in worker_loop: either the sleeper sees the task,
+    // or we see the sleeper.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) != 0)
+    {
+        wake_epoch_.fetch_add(1, std::memory_order_relaxed);
+        wake_epoch_.notify_one();
+    }
+}
+
+bool ThreadPool::steal_and_run(Worker& worker)
+{
+    const std::size_t count = workers_.size();
+    if (count < 2)
+        return false;
+
+    // xorshift picks where to start, then every other worker is tried once.
+    worker.rng ^= worker.rng << 13;
+    worker.rng ^= worker.rng >> 17;
+    worker.rng ^= worker.rng << 5;
+    const std::size_t start = worker.rng % count;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::size_t victim = (start + i) % count;
+        if (victim == worker.index)
+            continue;
+        if (Task* task = workers_[victim]->deque.steal())
+        {
+            task->execute(true);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::wait_for(Worker& worker, Task* task, const std::atomic<bool>& done)
+{
+    while (!done.load(std::memory_order_acquire))
+    {
+        // Until it is stolen the task is at the bottom of our own deque. Once
+        // it has been stolen, whatever is popped instead is older work of ours
+        // that is just as good to run while we wait.
+        if (Task* next = worker.deque.pop())
+        {
+            next->execute(false);
+            if (next == task)
+                return;
+            continue;
+        }
+        if (!steal_and_run(worker))
+            cpu_relax();
+    }
+}
+
+void ThreadPool::worker_loop(std::size_t index)
+{
+    Worker& worker = *workers_[index];
+    current_ = &worker;
+
+    int idle_rounds = 0;
+    while (!stopping_.load(std::memory_order_relaxed))
+    {
+        if (Task* task = worker.deque.pop())
+        {
+            task->execute(false);
+            idle_rounds = 0;
+            continue;
+        }
+        if (steal_and_run(worker))
+        {
+            idle_rounds = 0;
+            continue;
+        }
+        if (++idle_rounds < spins_before_sleep)
+        {
+            cpu_relax();
+            continue;
+        }
+
+        // Announce the intent to sleep before the final check for work.
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        const std::uint32_t epoch = wake_epoch_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool work_available = false;
+        for (const auto& other : workers_)
+            work_available |= !other->deque.empty();
+
+        if (!work_available && !stopping_.load(std::memory_order_relaxed))
+            wake_epoch_.wait(epoch, std::memory_order_relaxed);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        idle_rounds = 0;
+    }
+
+    current_ = nullptr;
+}
+
+} // namespace parallel
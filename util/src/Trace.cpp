@@ -0,0 +1,273 @@
+/**
+ * @file Trace.cpp
+ * @author Daniel Even
+ * @brief The out-of-line half of Trace.hpp: the site registry, the per-thread
+ * event rings, the background drain thread and the exit-time dump. This file
+ * compiles to nothing unless CPP_CONCEPTS_TRACE is defined.
+ */
+#include "Trace.hpp"
+
+#ifdef CPP_CONCEPTS_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+struct Event
+{
+    const Site* site;
+    std::uint64_t start;
+    std::uint64_t ticks;
+};
+
+/**
+ * @brief A single-producer/single-consumer ring. The owning thread is the only
+ * producer and the drain thread is the only consumer, so a pair of monotonically
+ * increasing indices is all the synchronization required. The indices live on
+ * separate cache lines so the two sides do not false-share.
+ */
+struct Ring
+{
+    static constexpr std::size_t capacity = 1u << 14;
+
+    explicit Ring(std::uint32_t index) : thread_index(index) {}
+
+    bool push(const Event& event) noexcept
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail == capacity)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h - cached_tail == capacity)
+                return false;
+        }
+        events[h & (capacity - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename F>
+    void drain(F&& consume)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t)
+            consume(events[t & (capacity - 1)]);
+        tail.store(t, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::size_t cached_tail = 0;
+    std::atomic<std::uint64_t> dropped{0};
+    const std::uint32_t thread_index;
+    std::array<Event, capacity> events;
+};
+
+/**
+ * @brief Process-wide state. It is allocated once and intentionally never
+ * destroyed so that function-local Site objects and late-exiting threads can
+ * always reach it; the dump runs from an atexit() handler instead.
+ */
+class Registry
+{
+public:
+    static Registry& instance()
+    {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    void add_site(Site* site) noexcept
+    {
+        site->next = sites_.load(std::memory_order_relaxed);
+        while (!sites_.compare_exchange_weak(site->next, site,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+        {
+        }
+    }
+
+    Ring& thread_ring()
+    {
+        thread_local Ring* ring = nullptr;
+        if (!ring)
+        {
+            std::lock_guard lock(rings_mutex_);
+            const auto index = static_cast<std::uint32_t>(rings_.size());
+            rings_.push_back(std::make_unique<Ring>(index));
+            ring = rings_.back().get();
+        }
+        return *ring;
+    }
+
+    bool events_enabled() const noexcept { return output_ != nullptr; }
+
+private:
+    Registry()
+        : origin_ticks_(now()), origin_time_(std::chrono::steady_clock::now())
+    {
+        if (const char* path = std::getenv("CPP_CONCEPTS_TRACE_FILE"))
+        {
+            output_ = std::fopen(path, "w");
+            const std::size_t length = std::strlen(path);
+            json_ = length >= 5 && std::strcmp(path + length - 5, ".json") == 0;
+        }
+
+        if (output_)
+        {
+            std::fputs(json_ ? "{\"traceEvents\":[\n"
+                             : "thread,site,start_ticks,duration_ticks\n",
+                       output_);
+            drainer_ = std::thread([this] { drain_loop(); });
+        }
+
+        std::atexit([] { instance().shutdown(); });
+    }
+
+    double ticks_per_ns() const
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - origin_time_;
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        return ns > 0.0 ? static_cast<double>(now() - origin_ticks_) / ns : 1.0;
+    }
+
+    void drain_loop()
+    {
+        while (!stop_.load(std::memory_order_acquire))
+        {
+            drain_all();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void drain_all()
+    {
+        const double scale = 1.0 / (ticks_per_ns() * 1000.0);
+        std::lock_guard lock(rings_mutex_);
+        for (auto& ring : rings_)
+        {
+            ring->drain([&](const Event& event) {
+                if (json_)
+                {
+                    std::fprintf(output_,
+                                 "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,"
+                                 "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                 first_event_ ? "" : ",\n", event.site->name,
+                                 ring->thread_index,
+                                 (event.start - origin_ticks_) * scale,
+                                 event.ticks * scale);
+                    first_event_ = false;
+                }
+                else
+                {
+                    std::fprintf(output_, "%u,%s,%llu,%llu\n", ring->thread_index,
+                                 event.site->name,
+                                 static_cast<unsigned long long>(event.start - origin_ticks_),
+                                 static_cast<unsigned long long>(event.ticks));
+                }
+            });
+        }
+    }
+
+    void shutdown()
+    {
+        if (output_)
+        {
+            stop_.store(true, std::memory_order_release);
+            drainer_.join();
+            drain_all();
+            if (json_)
+                std::fputs("\n]}\n", output_);
+            std::fclose(output_);
+            output_ = nullptr;
+        }
+        print_summary();
+    }
+
+    /**
+     * @brief Prints the call count and the approximate p50/p99 latency of every
+     * site. Percentiles are reported as the upper bound of the histogram bucket
+     * they fall into, so they are accurate to within a factor of two.
+     */
+    void print_summary() const
+    {
+        const double ns_per_tick = 1.0 / ticks_per_ns();
+
+        std::uint64_t dropped = 0;
+        for (const auto& ring : rings_)
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+
+        std::fprintf(stderr, "%-40s %12s %12s %12s\n", "site", "calls",
+                     "p50 (ns)", "p99 (ns)");
+        for (const Site* site = sites_.load(std::memory_order_acquire); site;
+             site = site->next)
+        {
+            const std::uint64_t calls = site->calls.load(std::memory_order_relaxed);
+            auto percentile = [&](double q) {
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < Site::bucket_count; ++i)
+                {
+                    seen += site->histogram[i].load(std::memory_order_relaxed);
+                    if (seen >= q * calls)
+                        return static_cast<double>(1ull << i) * ns_per_tick;
+                }
+                return 0.0;
+            };
+            std::fprintf(stderr, "%-40s %12llu %12.0f %12.0f\n", site->name,
+                         static_cast<unsigned long long>(calls), percentile(0.5),
+                         percentile(0.99));
+        }
+        if (dropped)
+            std::fprintf(stderr, "%llu trace events dropped (ring full)\n",
+                         static_cast<unsigned long long>(dropped));
+    }
+
+    std::atomic<Site*> sites_{nullptr};
+    std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::FILE* output_ = nullptr;
+    bool json_ = false;
+    bool first_event_ = true;
+    std::thread drainer_;
+    std::atomic<bool> stop_{false};
+    const std::uint64_t origin_ticks_;
+    const std::chrono::steady_clock::time_point origin_time_;
+};
+
+// Constructing the registry up front starts the drain thread and fixes the
+// time origin before the first instrumented call.
+const bool registry_initialized = (Registry::instance(), true);
+
+} // namespace
+
+Site::Site(const char* site_name) noexcept : name(site_name)
+{
+    Registry::instance().add_site(this);
+}
+
+bool events_enabled() noexcept
+{
+    static const bool enabled = Registry::instance().events_enabled();
+    return enabled;
+}
+
+void emit(const Site& site, std::uint64_t start, std::uint64_t ticks) noexcept
+{
+    Ring& ring = Registry::instance().thread_ring();
+    if (!ring.push(Event{&site, start, ticks}))
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace trace
+
+#endif // CPP_CONCEPTS_TRACE